@@ -48,6 +48,8 @@ public:
     this->AddArgument("OutputROI", false, "Write the ROI within which the segmentation will be confined to (for debugging purposes)");
     this->AddArgument("Supersample", false, "Supersample ? If set to false, no supersampling is done. If set to true and if SupersampledIsotropicSpacing is set, volume is supersampled to the specified value, otherwise the average of the in-plane and out-of-plane spacing is used.", MetaCommand::BOOL, "0");
     this->AddArgument("SupersampledIsotropicSpacing", false, "Supersampled isotropic spacing in mm.  If unspecified, no supersampleing is done", MetaCommand::FLOAT, "0.5");
+    this->AddArgument("SeparableResampling", false, "Resample with separable per-axis cubic B-spline passes, which is faster. Differs slightly from the default resampling: -1024 outside the input, and values rounded rather than truncated.", MetaCommand::BOOL, "0");
+    this->AddArgument("AntiAliasedSupersample", false, "Supersample with in-plane Gaussian anti-aliasing and trilinear interpolation (SupersampleVolume) instead of BSpline interpolation.", MetaCommand::BOOL, "0");
     this->AddArgument("Visualize", false, "Visualize the input image and the segmented surface.", MetaCommand::BOOL, "0");
     this->AddArgument("Outline", false, "Visualize the input image and the segmented surface as a cut on the slices. Only valid if the Visualize flag is also enabled.", MetaCommand::BOOL, "0");
     this->AddArgument("IgnoreDirection", false, "Ignore the direction of the DICOM image", MetaCommand::BOOL, "0");
@@ -65,6 +67,36 @@ public:
     this->AddArgument("MaximumRadius", false, "Maximum radius of the lesion in mm. This can be used as alternate way of specifying the bounds. You specify a seed and a value of say 20mm, if you know the lesion is smaller than 20mm..", MetaCommand::FLOAT, "30");
     this->AddArgument("Screenshot",false,"Screenshot directory of the final lung nodule segmentation (requires \"Visualize\" to be ON.");
 		this->AddArgument("WriteFeatureImages", false, "Write the intermediate feature images used to compute the segmentation.");
+    this->AddArgument("StreamFeatures", false, "Aggregate the feature images in a single streaming pass that only keeps the running minimum, instead of keeping every feature image in memory.", MetaCommand::BOOL, "0");
+    this->AddArgument("BrickFeatures", false, "Compute the feature images brick by brick, in parallel across bricks. Implies StreamFeatures.", MetaCommand::BOOL, "0");
+    this->AddArgument("LazyFeatures", false, "Compute the local feature images only on the tiles the segmentation front reaches.", MetaCommand::BOOL, "0");
+    this->AddArgument("SparseVesselness", false, "Compute the vesselness only near voxels above the lung threshold. Implies BrickFeatures for the vesselness.", MetaCommand::BOOL, "0");
+    this->AddArgument("FeatureBits", false, "Bits per voxel of the feature caches kept by LazyFeatures: 16 for fixed point, 32 for float. Has no effect without LazyFeatures; the feature and speed images of the level set stay float. The volume change has not been measured.", MetaCommand::INT, "32");
+    this->AddArgument("VesselEnhancingDiffusion", false, "Apply vessel enhancing diffusion (Manniesing et al.) before computing the vesselness.", MetaCommand::BOOL, "0");
+    this->AddArgument("ReferenceVesselEnhancingDiffusion", false, "Run the vessel enhancing diffusion with the toolkit's single threaded filter instead of the multithreaded one. Both give the same result up to float rounding.", MetaCommand::BOOL, "0");
+    this->AddArgument("RestrictVesselEnhancingDiffusion", false, "Only diffuse near tissue above the lung threshold. Faster, but the result differs from the reference filter away from tissue.", MetaCommand::BOOL, "0");
+    this->AddArgument("FusedCanny", false, "Compute the Canny edge feature with fused edge classification and union-find hysteresis.", MetaCommand::BOOL, "0");
+    this->AddArgument("StudyLungMask", false, "Lung mask of the whole study, shared by the segmentations of all its nodules. Read if the file exists, otherwise computed and written to it.");
+    this->AddArgument("CoarseToFine", false, "With supersampling, segment at CoarseSpacing first, then supersample, recompute the features and refine the level set only around the coarse segmentation. An approximation of the full supersampled segmentation whose volume difference has not been measured.", MetaCommand::BOOL, "0");
+    this->AddArgument("CoarseSpacing", false, "Spacing in mm of the first segmentation of CoarseToFine.", MetaCommand::FLOAT, "0.5");
+    this->AddArgument("PyramidLevels", false, "Number of grids of CoarseToFine, from CoarseSpacing to the output spacing. Intermediate grids refine the level set around its surface before the output one.", MetaCommand::INT, "2");
+    this->AddArgument("PartialVolume", false, "Also report the volume integrated from the level set by partial volume (trilinear) integration, which does not need supersampling to resolve sub-voxel boundaries.", MetaCommand::BOOL, "0");
+    this->AddArgument("MemoryBudget", false, "Peak memory allowed for the segmentation, in MB. The supersampling spacing is coarsened until the estimated peak fits; if it cannot, the segmentation is refused before anything is allocated. The estimate is computed from buffer sizes, not measured. 0 means no budget.", MetaCommand::FLOAT, "0");
+    this->AddArgument("AdaptiveROI", false, "Segment in a box of InitialRadius around the seeds first, and grow it only while the segmentation reaches its faces. The ROI (or MaximumRadius) bounds the growth.", MetaCommand::BOOL, "0");
+    this->AddArgument("InitialRadius", false, "Radius in mm of the first box of AdaptiveROI.", MetaCommand::FLOAT, "10");
+    this->AddArgument("InitialLevelSet", false, "Level set of a prior segmentation, such as the OutputImage of an earlier run, to start from instead of the seeds. Fast marching is skipped and the surface only moves within WarmStartMargin of it.");
+    this->AddArgument("InitialMask", false, "Mask of a prior segmentation, nonzero inside, to start from instead of the seeds, as InitialLevelSet.");
+    this->AddArgument("InitialTransform", false, "Transform file mapping physical points of the input to those of InitialLevelSet or InitialMask, such as the rigid registration of a follow-up scan to the previous one.");
+    this->AddArgument("WarmStartIterations", false, "Iterations of the level set from InitialLevelSet or InitialMask.", MetaCommand::INT, "50");
+    this->AddArgument("WarmStartMargin", false, "Distance in mm the surface can move from InitialLevelSet or InitialMask.", MetaCommand::FLOAT, "5");
+    this->AddArgument("BlockedGaussian", false, "Smooth with a recursive Gaussian that filters several lines at once wherever the feature generators (Hessian, Canny edges) smooth the image.", MetaCommand::BOOL, "0");
+    this->AddArgument("BrickedHoleFilling", false, "Fill the holes of the lung masks on a bricked, Z-ordered copy of the image, updating only the bricks near the last changes. Same result; the speed-up has not been measured.", MetaCommand::BOOL, "0");
+    this->AddArgument("ParallelLevelSet", false, "Evolve the geodesic active contour on several threads. The sparse field is cut into fixed chunks, so the result is the same whatever the number of threads.", MetaCommand::BOOL, "0");
+    this->AddArgument("ConvergenceTolerance", false, "Also stop the level set once the enclosed volume and the zero crossing changed by less than this fraction over ConvergenceInterval iterations. Implies ParallelLevelSet. The iterations and volumes are printed.", MetaCommand::FLOAT, "0.001");
+    this->AddArgument("ConvergenceInterval", false, "Iterations between two checks of ConvergenceTolerance.", MetaCommand::INT, "10");
+    this->AddArgument("VerifyParallelLevelSet", false, "Evolve the level set a second time with the serial update of ITK and fail unless both level sets are identical. Doubles the level set time. Implies ParallelLevelSet.", MetaCommand::BOOL, "0");
+    this->AddArgument("SparseLevelSetSpeed", false, "Keep the speed image of the level set in bricks allocated only where the speed is not 0, such as the tiles evaluated by LazyFeatures. The segmentation does not change; each speed sample costs more. Implies ParallelLevelSet.", MetaCommand::BOOL, "0");
+    this->AddArgument("BucketedFastMarching", false, "Initialise the level set with a fast marching ordered by buckets of 0.01 in time instead of a heap. Points delayed within a bucket are reopened, so the arrival times are those of the heap up to rounding.", MetaCommand::BOOL, "0");
     this->AddArgument("GetZSpacingFromSliceNameRegex",false,
       "This option was added for the NIST Biochange challenge where the Z seed index was specified by providing the filename of the DICOM slice where the seed resides. Hence if this option is specified, the Z value of the seed is ignored.");
 
@@ -2,14 +2,22 @@
 
 #include "itkImageFileReader.h"
 #include "itkImageFileWriter.h"
+#include "itkTransformFileReader.h"
 #include "itkGDCMImageIO.h"
 #include "itkGDCMImageIOFactory.h"
 #include "itkGDCMSeriesFileNames.h"
 #include "itkMetaImageIOFactory.h"
 #include "itkImageSeriesReader.h"
 #include "itkEventObject.h"
+#include "itkCommand.h"
 #include "itkOrientImageFilter.h"
 #include "itkImageToVTKImageFilter.h"
+#include "itkBlockedRecursiveGaussianImageFilterFactory.h"
+#include "itkBrickedVotingBinaryIterativeHoleFillingImageFilterFactory.h"
+#include "itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory.h"
+#include "itkBucketedFastMarchingImageFilterFactory.h"
+#include "itkStudyLungWallMaskImageFilter.h"
+#include "itkLevelSetVolumeCalculator.h"
 #include "vtkImageData.h"
 #include "vtkMarchingCubes.h"
 #include "vtkPolyData.h"
@@ -27,6 +35,62 @@
 #define VTK_CREATE(type, name) \
   vtkSmartPointer<type> name = vtkSmartPointer<type>::New()
 
+// --------------------------------------------------------------------------
+// Prints the iterations and the volume trajectory of a level set evolution
+// that was allowed to stop on convergence.
+void ReportLevelSetConvergence( itk::Object * caller, const itk::EventObject &, void * )
+{
+  typedef itk::ParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory::ParallelFilterType
+    LevelSetFilterType;
+  const LevelSetFilterType * filter = dynamic_cast< const LevelSetFilterType * >( caller );
+  if ( !filter || !filter->GetStopOnConvergence() )
+    {
+    return;
+    }
+  std::cout << "Level set iterations = " << filter->GetElapsedIterations()
+            << ( filter->GetConverged() ? " (converged)" : "" ) << std::endl;
+  std::cout << "Level set volumes =";
+  const std::vector< double > & volumes = filter->GetVolumeTrajectory();
+  for ( size_t i = 0; i < volumes.size(); ++i )
+    {
+    std::cout << " " << std::setprecision(8) << volumes[i];
+    }
+  std::cout << " mm^3" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+// True if the mask covers the same grid as the image: same extent, origin,
+// spacing and direction, the last three up to the tolerance the toolkit
+// uses between the inputs of a filter.
+template< typename TMask, typename TImage >
+bool HasSameGeometry( const TMask * mask, const TImage * image )
+{
+  const double tolerance =
+    itk::ImageToImageFilterCommon::GetGlobalDefaultCoordinateTolerance() *
+    image->GetSpacing()[0];
+  if ( mask->GetLargestPossibleRegion() != image->GetLargestPossibleRegion() )
+    {
+    return false;
+    }
+  for ( unsigned int i = 0; i < TImage::ImageDimension; ++i )
+    {
+    if ( std::abs( mask->GetOrigin()[i] - image->GetOrigin()[i] ) > tolerance ||
+         std::abs( mask->GetSpacing()[i] - image->GetSpacing()[i] ) > tolerance )
+      {
+      return false;
+      }
+    for ( unsigned int j = 0; j < TImage::ImageDimension; ++j )
+      {
+      if ( std::abs( mask->GetDirection()[i][j] - image->GetDirection()[i][j] ) >
+           itk::ImageToImageFilterCommon::GetGlobalDefaultDirectionTolerance() )
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
 // --------------------------------------------------------------------------
 LesionSegmentationCLI::InputImageType::Pointer GetImage( std::string dir, bool ignoreDirection )
 {
@@ -138,6 +202,47 @@ int main( int argc, char * argv[] )
 
   LesionSegmentationCLI args( argc, argv );
 
+  // Substitute the lane-parallel recursive Gaussian wherever the feature
+  // generators instantiate RecursiveGaussianImageFilter
+  if (args.GetOptionWasSet("BlockedGaussian"))
+    {
+    itk::BlockedRecursiveGaussianImageFilterFactory::RegisterOneFactory();
+    }
+
+  // Substitute the bricked voting hole filling wherever the lung masks are
+  // computed
+  if (args.GetOptionWasSet("BrickedHoleFilling"))
+    {
+    itk::BrickedVotingBinaryIterativeHoleFillingImageFilterFactory::RegisterOneFactory();
+    }
+
+  // Substitute the multithreaded sparse field wherever the geodesic active
+  // contour is evolved. It also holds the convergence criterion, the
+  // sparse speed image and the check against the serial update.
+  const bool sparseLevelSetSpeed = args.GetOptionWasSet("SparseLevelSetSpeed");
+  const bool verifyParallelLevelSet = args.GetOptionWasSet("VerifyParallelLevelSet");
+  if (args.GetOptionWasSet("ConvergenceTolerance"))
+    {
+    itk::CStyleCommand::Pointer convergenceReporter = itk::CStyleCommand::New();
+    convergenceReporter->SetCallback( &ReportLevelSetConvergence );
+    itk::ParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory::RegisterOneFactory(
+      args.GetValueAsFloat("ConvergenceTolerance"),
+      static_cast< unsigned int >( args.GetValueAsInt("ConvergenceInterval") ),
+      convergenceReporter, sparseLevelSetSpeed, verifyParallelLevelSet );
+    }
+  else if (args.GetOptionWasSet("ParallelLevelSet") || sparseLevelSetSpeed || verifyParallelLevelSet)
+    {
+    itk::ParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory::RegisterOneFactory(
+      0.0, 10, nullptr, sparseLevelSetSpeed, verifyParallelLevelSet );
+    }
+
+  // Substitute the bucketed fast marching wherever the level set is
+  // initialised
+  if (args.GetOptionWasSet("BucketedFastMarching"))
+    {
+    itk::BucketedFastMarchingImageFilterFactory::RegisterOneFactory();
+    }
+
   typedef LesionSegmentationCLI::InputImageType InputImageType;
   typedef LesionSegmentationCLI::RealImageType RealImageType;
   const unsigned int ImageDimension = LesionSegmentationCLI::ImageDimension;
@@ -283,6 +388,56 @@ int main( int argc, char * argv[] )
     }
   }
 
+  // Study-wide lung mask, computed once and then shared by every nodule of
+  // the study. A mask file left by another study, or by the same study read
+  // with different options, does not cover the input grid: it is recomputed
+  // and overwritten.
+  typedef SegmentationFilterType::MaskImageType MaskImageType;
+  MaskImageType::Pointer studyLungMask;
+  if (args.GetOptionWasSet("StudyLungMask"))
+    {
+    const std::string maskFileName = args.GetValueAsString("StudyLungMask");
+    try
+      {
+      if (vtksys::SystemTools::FileExists(maskFileName.c_str(), true))
+        {
+        typedef itk::ImageFileReader< MaskImageType > MaskReaderType;
+        MaskReaderType::Pointer maskReader = MaskReaderType::New();
+        maskReader->SetFileName( maskFileName );
+        maskReader->Update();
+        studyLungMask = maskReader->GetOutput();
+        if (!HasSameGeometry(studyLungMask.GetPointer(), image.GetPointer()))
+          {
+          std::cerr << "The study lung mask " << maskFileName
+                    << " does not match the geometry of the input image."
+                    << " Recomputing it." << std::endl;
+          studyLungMask = nullptr;
+          }
+        }
+      if (!studyLungMask)
+        {
+        typedef itk::StudyLungWallMaskImageFilter< InputImageType, MaskImageType > StudyLungMaskFilterType;
+        StudyLungMaskFilterType::Pointer maskFilter = StudyLungMaskFilterType::New();
+        maskFilter->SetInput( image );
+        maskFilter->SetLungThreshold( -400 );
+        maskFilter->Update();
+        studyLungMask = maskFilter->GetOutput();
+
+        typedef itk::ImageFileWriter< MaskImageType > MaskWriterType;
+        MaskWriterType::Pointer maskWriter = MaskWriterType::New();
+        maskWriter->SetFileName( maskFileName );
+        maskWriter->SetInput( studyLungMask );
+        maskWriter->UseCompressionOn();
+        maskWriter->Update();
+        }
+      }
+    catch( itk::ExceptionObject & err )
+      {
+      std::cerr << "ExceptionObject caught !" << err << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
   // Progress reporting
   typedef itk::LesionSegmentationCommandLineProgressReporter ProgressReporterType;
   ProgressReporterType::Pointer progressCommand =
@@ -312,6 +467,94 @@ int main( int argc, char * argv[] )
     seg->SetSigma(args.GetSigmas());
     }
   seg->SetSigmoidBeta(args.GetValueAsBool("PartSolid") ? -500 : -200 );
+  seg->SetStreamFeatureAggregation(args.GetOptionWasSet("StreamFeatures"));
+  seg->SetBrickStreamFeatures(args.GetOptionWasSet("BrickFeatures"));
+  seg->SetLazyFeatureEvaluation(args.GetOptionWasSet("LazyFeatures"));
+  seg->SetUseFusedCannyEdges(args.GetOptionWasSet("FusedCanny"));
+  seg->SetSparseVesselness(args.GetOptionWasSet("SparseVesselness"));
+  const int featureBits = args.GetValueAsInt("FeatureBits");
+  if (featureBits != 16 && featureBits != 32)
+    {
+    std::cerr << "FeatureBits must be 16 or 32." << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (args.GetOptionWasSet("FeatureBits") && !args.GetOptionWasSet("LazyFeatures"))
+    {
+    std::cerr << "Warning: FeatureBits only applies to the caches of LazyFeatures; ignored."
+              << std::endl;
+    }
+  seg->SetFeatureStorageBits(static_cast< unsigned int >(featureBits));
+  seg->SetUseVesselEnhancingDiffusion(args.GetOptionWasSet("VesselEnhancingDiffusion"));
+  seg->SetFastVesselEnhancingDiffusion(!args.GetOptionWasSet("ReferenceVesselEnhancingDiffusion"));
+  seg->SetRestrictVesselEnhancingDiffusion(args.GetOptionWasSet("RestrictVesselEnhancingDiffusion"));
+  seg->SetStudyLungMask(studyLungMask);
+  seg->SetSeparableResampling(args.GetOptionWasSet("SeparableResampling"));
+  seg->SetAntiAliasedSupersampling(args.GetOptionWasSet("AntiAliasedSupersample"));
+  seg->SetCoarseToFineRefinement(args.GetOptionWasSet("CoarseToFine"));
+  seg->SetCoarseSpacing(args.GetValueAsFloat("CoarseSpacing"));
+  seg->SetNumberOfPyramidLevels(args.GetValueAsInt("PyramidLevels"));
+  seg->SetAdaptiveRegionOfInterest(args.GetOptionWasSet("AdaptiveROI"));
+  seg->SetInitialRegionRadius(args.GetValueAsFloat("InitialRadius"));
+  if (args.GetOptionWasSet("InitialLevelSet") || args.GetOptionWasSet("InitialMask"))
+    {
+    // Start from a prior segmentation, optionally registered to this scan.
+    const bool isMask = !args.GetOptionWasSet("InitialLevelSet");
+    typedef itk::ImageFileReader< RealImageType > InitialReaderType;
+    InitialReaderType::Pointer initialReader = InitialReaderType::New();
+    initialReader->SetFileName(args.GetValueAsString(isMask ? "InitialMask" : "InitialLevelSet"));
+    typedef itk::TransformFileReaderTemplate< double > TransformReaderType;
+    TransformReaderType::Pointer transformReader = TransformReaderType::New();
+    try
+      {
+      initialReader->Update();
+      if (args.GetOptionWasSet("InitialTransform"))
+        {
+        transformReader->SetFileName(args.GetValueAsString("InitialTransform"));
+        transformReader->Update();
+        }
+      }
+    catch( itk::ExceptionObject & err )
+      {
+      std::cerr << "ExceptionObject caught !" << err << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (args.GetOptionWasSet("InitialTransform"))
+      {
+      const SegmentationFilterType::InitialSegmentationTransformType * transform =
+        transformReader->GetTransformList()->empty() ? nullptr :
+        dynamic_cast< const SegmentationFilterType::InitialSegmentationTransformType * >(
+          transformReader->GetTransformList()->front().GetPointer() );
+      if (!transform)
+        {
+        std::cerr << "No 3D transform in " << args.GetValueAsString("InitialTransform") << std::endl;
+        return EXIT_FAILURE;
+        }
+      seg->SetInitialSegmentationTransform(transform);
+      }
+    seg->SetInitialSegmentation(initialReader->GetOutput());
+    seg->SetInitialSegmentationIsMask(isMask);
+    seg->SetWarmStartIterations(args.GetValueAsInt("WarmStartIterations"));
+    seg->SetWarmStartMargin(args.GetValueAsFloat("WarmStartMargin"));
+    }
+  if (args.GetOptionWasSet("MemoryBudget"))
+    {
+    // Plan before anything is allocated; a plan that does not fit the budget
+    // is refused here.
+    seg->SetMemoryBudget(static_cast< itk::SizeValueType >(
+      args.GetValueAsFloat("MemoryBudget") * 1024.0 * 1024.0));
+    try
+      {
+      seg->UpdateOutputInformation();
+      }
+    catch( itk::ExceptionObject & err )
+      {
+      std::cerr << err.GetDescription() << std::endl;
+      return EXIT_FAILURE;
+      }
+    std::cout << "Estimated peak memory = " << seg->GetEstimatedPeakMemory() / (1024 * 1024)
+      << " MB, runtime = " << seg->GetEstimatedRuntime() << " s, spacing = "
+      << seg->GetOutput()->GetSpacing() << std::endl;
+    }
   seg->Update();
 
 
@@ -329,16 +572,31 @@ int main( int argc, char * argv[] )
 
   // View and Compute volume
 	const bool visualize = args.GetOptionWasSet("Visualize");
-	if (visualize)
+	const bool partialVolume = args.GetOptionWasSet("PartialVolume");
+	itk::VTKViewImageAndSegmentation::Pointer view;
+	if (visualize || partialVolume)
 	{
-		itk::VTKViewImageAndSegmentation::Pointer view =
-			itk::VTKViewImageAndSegmentation::New();
+		view = itk::VTKViewImageAndSegmentation::New();
 		view->SetImage(image);
 		view->SetSegmentationSurfaceFromLevelSet(seg->GetOutput(), -0.5);
+		std::cout << "Computed Volume = " << std::setprecision(8) << (view->GetVolume()) << " mm^3" << std::endl;
+	}
+	if (partialVolume)
+	{
+		// Integrated from the level set itself, next to the marching cubes
+		// volume above.
+		typedef itk::LevelSetVolumeCalculator< RealImageType > VolumeCalculatorType;
+		VolumeCalculatorType::Pointer volumeCalculator = VolumeCalculatorType::New();
+		volumeCalculator->SetImage(seg->GetOutput());
+		volumeCalculator->SetIsoValue(-0.5);
+		volumeCalculator->Compute();
+		std::cout << "Partial Volume = " << std::setprecision(8) << volumeCalculator->GetVolume() << " mm^3" << std::endl;
+	}
+	if (visualize)
+	{
 		view->SetSegmentationRenderMode(args.GetOptionWasSet("Outline") ?
 			itk::VTKViewImageAndSegmentation::SegmentationRenderMode::Outline :
 			itk::VTKViewImageAndSegmentation::SegmentationRenderMode::Surface);
-		std::cout << "Computed Volume = " << std::setprecision(8) << (view->GetVolume()) << " mm^3" << std::endl;
 		if (args.GetOptionWasSet("OutputMesh"))
 			view->WriteSegmentationAsSurface(args.GetValueAsString("OutputMesh").c_str());
 
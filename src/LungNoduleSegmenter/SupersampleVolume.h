@@ -2,16 +2,19 @@
 #pragma once
 
 #include "itkImage.h"
-#include "itkResampleImageFilter.h"
-#include "itkRecursiveGaussianImageFilter.h"
-#include "itkIdentityTransform.h"
+#include "itkMath.h"
+#include "itkNumericTraits.h"
+#include "itkParallelForEachBlock.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 namespace supersample
 {
 
 /**
  * Supersamples a volume.
- * 
+ *
  * Precision:
  *    InputPixelType is the precision of the input pixel
  *    TPrecision is the precision of the internal computations (for resampling)
@@ -31,7 +34,15 @@ namespace supersample
  *     desired TOutputPixelType
  * (b) If 'supersample' is true, but 'isotropicSpacing' is not specified, then the output spacing is
  *     chosen as the sqrt of the L2 norm of the in-plane and out-of-plane spacing.
- * (c) If 'supersanmple' is true and the 'isotropicSpacing' is specified, it is use. 
+ * (c) If 'supersanmple' is true and the 'isotropicSpacing' is specified, it is use.
+ *
+ * Implementation
+ *    Cast, anti-aliasing and interpolation are fused in one multithreaded pass over slabs of
+ *    output slices. Each slab keeps a ring buffer of the two cast and smoothed input slices its
+ *    current output slice lies between, so no intermediate volume is allocated. The in-plane
+ *    smoothing is a sampled Gaussian truncated at 4 sigma, with the edge values extended, and
+ *    the interpolation is trilinear with the bounds of LinearInterpolateImageFunction: points
+ *    more than half a voxel outside the input get -1000.
  *
 **/
 template< class InputPixelType = short, class TPrecision = float, class TOutputPixelType = float >
@@ -45,95 +56,334 @@ public:
   typedef itk::Image< InternalPixelType, 3 > InternalImageType;
   typedef itk::Image< OutputPixelType, 3 > OutputImageType;
   typedef typename OutputImageType::Pointer OutputImagePointer;
+  typedef typename OutputImageType::RegionType OutputRegionType;
+  typedef itk::ImageBase< 3 > GridType;
+
+  /** Output spacing for 'isotropicSpacing', see (b) and (c) above. */
+  static double GetIsotropicSpacing( const InputImageType * in, double isotropicSpacing = 0 )
+  {
+    const typename InputImageType::SpacingType& inputSpacing = in->GetSpacing();
+    return (isotropicSpacing == 0 ?
+      std::sqrt( inputSpacing[2] * inputSpacing[0] ) : isotropicSpacing);
+  }
+
+  /** Image with the geometry Execute() produces, not allocated. Only needs the output
+   * information of 'in'. */
+  static OutputImagePointer GetOutputGeometry( const InputImageType * in, bool supersample = true, double isotropicSpacing = 0 )
+  {
+    OutputImagePointer out = OutputImageType::New();
+    out->SetOrigin( in->GetOrigin() );
+    out->SetDirection( in->GetDirection() );
+    if (!supersample)
+    {
+      out->SetSpacing( in->GetSpacing() );
+      out->SetRegions( in->GetLargestPossibleRegion() );
+      return out;
+    }
+
+    const typename InputImageType::SpacingType& inputSpacing = in->GetSpacing();
+    const double isoSpacing = GetIsotropicSpacing( in, isotropicSpacing );
+    typename OutputImageType::SpacingType spacing;
+    spacing.Fill( isoSpacing );
+    out->SetSpacing( spacing );
+
+    typename InputImageType::SizeType inputSize = in->GetLargestPossibleRegion().GetSize();
+    typedef typename InputImageType::SizeType::SizeValueType SizeValueType;
+    const double dx = inputSize[0] * inputSpacing[0] / isoSpacing;
+    const double dy = inputSize[1] * inputSpacing[1] / isoSpacing;
+    const double dz = (double)(inputSize[2] - 1 ) * inputSpacing[2] / isoSpacing;
+    typename OutputImageType::SizeType   size;
+    size[0] = static_cast<SizeValueType>( dx );
+    size[1] = static_cast<SizeValueType>( dy );
+    size[2] = static_cast<SizeValueType>( dz );
+    out->SetRegions( size );
+    return out;
+  }
 
   static OutputImagePointer Execute( const InputImageType * in, bool supersample = true, double isotropicSpacing = 0)
   {
-    typedef TOutputPixelType OutputPixelType;
-    typedef TPrecision InternalPixelType;
-    typedef itk::Image< InputPixelType, 3 > InputImageType;
-    typedef itk::Image< InternalPixelType, 3 > InternalImageType;
-    typedef itk::Image< OutputPixelType, 3 > OutputImageType;
+    typedef itk::SizeValueType SizeValueType;
+
+    OutputImagePointer out = GetOutputGeometry( in, supersample, isotropicSpacing );
+    out->Allocate();
+
+    if (!supersample)
+    {
+      const typename InputImageType::RegionType inputRegion = in->GetBufferedRegion();
+      const SizeValueType nz = inputRegion.GetSize()[2];
+      const SizeValueType sliceSize = inputRegion.GetSize()[0] * inputRegion.GetSize()[1];
+      const InputPixelType * input = in->GetBufferPointer();
+      OutputPixelType * output = out->GetBufferPointer();
+      auto castSlice = [&]( SizeValueType z, itk::ThreadIdType )
+        {
+        for (SizeValueType i = z * sliceSize; i < (z + 1) * sliceSize; ++i)
+          {
+          output[i] = static_cast< OutputPixelType >( static_cast< InternalPixelType >( input[i] ) );
+          }
+        };
+      itk::ParallelForEachBlock( nz, castSlice );
+      return out;
+    }
+
+    Resample( in, out );
+    return out;
+  }
+
+  /** The supersampling of 'in' over 'region' of 'grid', which must have the
+   * direction of 'in' but may have another origin and spacing: the voxels of
+   * Execute() when 'grid' is GetOutputGeometry( in, true, spacing ). Lets a
+   * band of a fine grid be filled without the whole volume. */
+  static OutputImagePointer ExecuteOnGrid( const InputImageType * in, const GridType * grid,
+                                           const OutputRegionType & region )
+  {
+    if (grid->GetDirection() != in->GetDirection())
+    {
+      itkGenericExceptionMacro( "SupersampleVolume needs a grid with the direction of the input" );
+    }
+    OutputImagePointer out = OutputImageType::New();
+    out->CopyInformation( grid );
+    out->SetBufferedRegion( region );
+    out->SetRequestedRegion( region );
+    out->Allocate();
+    Resample( in, out );
+    return out;
+  }
 
-    typedef itk::CastImageFilter< InputImageType, InternalImageType > CastFilterType;
-    typename CastFilterType::Pointer castFilter = CastFilterType::New();
-    castFilter->SetInput(in);
-    castFilter->Update();
+private:
+  /** Fills the buffered region of 'out' from 'in'. */
+  static void Resample( const InputImageType * in, OutputImageType * out )
+  {
+    typedef itk::SizeValueType SizeValueType;
+    typedef itk::IndexValueType IndexValueType;
 
-    typename InternalImageType::Pointer inputImage;
+    const typename InputImageType::RegionType inputRegion = in->GetBufferedRegion();
+    const SizeValueType nx = inputRegion.GetSize()[0];
+    const SizeValueType ny = inputRegion.GetSize()[1];
+    const SizeValueType sliceSize = nx * ny;
+    const InputPixelType * input = in->GetBufferPointer();
+    OutputPixelType * output = out->GetBufferPointer();
 
     const typename InputImageType::SpacingType& inputSpacing = in->GetSpacing();
-    const double isoSpacing = (isotropicSpacing == 0 ? 
-      std::sqrt( inputSpacing[2] * inputSpacing[0] ) : isotropicSpacing);
+    const typename OutputImageType::SpacingType& spacing = out->GetSpacing();
 
     // This is the case where we are supersampling along Z but subsampling along X and Y.
     // In this case, we need to apply a gaussian in-plane as per Nyquist criterion.
-    // Let us handle this specially
-    if (supersample && (inputSpacing[0] < isotropicSpacing && inputSpacing[1] < isotropicSpacing))
+    const bool smooth = inputSpacing[0] < spacing[0] && inputSpacing[1] < spacing[1];
+    std::vector< InternalPixelType > kernelX;
+    std::vector< InternalPixelType > kernelY;
+    if (smooth)
     {
-      typedef itk::RecursiveGaussianImageFilter<
-        InternalImageType, InternalImageType > GaussianFilterType;
-      typename GaussianFilterType::Pointer smootherX = GaussianFilterType::New();
-      typename GaussianFilterType::Pointer smootherY = GaussianFilterType::New();
-      smootherX->SetInput( castFilter->GetOutput() );
-      smootherY->SetInput( smootherX->GetOutput() );
-      smootherX->SetSigma( isoSpacing );
-      smootherY->SetSigma( isoSpacing );
-      smootherX->SetDirection( 0 );
-      smootherY->SetDirection( 1 );
-      smootherY->Update();
-      inputImage = smootherY->GetOutput();
+      MakeGaussianKernel( spacing[0] / inputSpacing[0], kernelX );
+      MakeGaussianKernel( spacing[1] / inputSpacing[1], kernelY );
     }
-    else
+
+    // Input index of the output origin, along each (shared) axis.
+    const typename OutputImageType::PointType::VectorType shift = out->GetOrigin() - in->GetOrigin();
+    const typename OutputImageType::RegionType outputRegion = out->GetBufferedRegion();
+    const typename OutputImageType::SizeType outputSize = outputRegion.GetSize();
+    AxisTable tableX;
+    AxisTable tableY;
+    AxisTable tableZ;
+    for (unsigned int i = 0; i < 3; ++i)
     {
-      inputImage = castFilter->GetOutput();
+      double offset = 0.0;
+      for (unsigned int j = 0; j < 3; ++j)
+      {
+        offset += in->GetDirection()[j][i] * shift[j];
+      }
+      AxisTable & table = (i == 0 ? tableX : (i == 1 ? tableY : tableZ));
+      BuildAxisTable( inputRegion.GetIndex()[i], inputRegion.GetSize()[i],
+                      offset / inputSpacing[i], outputRegion.GetIndex()[i], outputSize[i],
+                      spacing[i] / inputSpacing[i], table );
     }
 
-    inputImage->DisconnectPipeline();
-    castFilter = NULL;
+    const OutputPixelType defaultValue = ToOutput( -1000.0 );
+    const SizeValueType outputSliceSize = outputSize[0] * outputSize[1];
+    const SizeValueType slabThickness = 4;
+    const SizeValueType numberOfSlabs = (outputSize[2] + slabThickness - 1) / slabThickness;
+    auto resampleSlab = [&]( SizeValueType slab, itk::ThreadIdType )
+      {
+      // The two smoothed input slices the current output slice lies between,
+      // in slots k % 2, and the scratch for the smoothing and the z blend.
+      std::vector< InternalPixelType > ring[2];
+      IndexValueType ringSlice[2] = { -1, -1 };
+      ring[0].resize( sliceSize );
+      ring[1].resize( sliceSize );
+      std::vector< InternalPixelType > scratch( sliceSize );
+      std::vector< InternalPixelType > plane( sliceSize );
+      auto getSlice = [&]( SizeValueType k ) -> const InternalPixelType *
+        {
+        const unsigned int slot = k % 2;
+        if (ringSlice[slot] != static_cast< IndexValueType >( k ))
+          {
+          PrepareSlice( input + k * sliceSize, nx, ny, smooth, kernelX, kernelY,
+                        scratch.data(), ring[slot].data() );
+          ringSlice[slot] = static_cast< IndexValueType >( k );
+          }
+        return ring[slot].data();
+        };
 
-    if (!supersample)
-    {
-      return inputImage;
-    }
+      const SizeValueType firstZ = slab * slabThickness;
+      const SizeValueType lastZ = std::min( firstZ + slabThickness, outputSize[2] );
+      for (SizeValueType z = firstZ; z < lastZ; ++z)
+        {
+        OutputPixelType * outSlice = output + z * outputSliceSize;
+        if (!tableZ.Inside[z])
+          {
+          std::fill( outSlice, outSlice + outputSliceSize, defaultValue );
+          continue;
+          }
+        const InternalPixelType * s0 = getSlice( tableZ.Index0[z] );
+        const InternalPixelType * s1 = getSlice( tableZ.Index1[z] );
+        const InternalPixelType wz = tableZ.Weight[z];
+        for (SizeValueType i = 0; i < sliceSize; ++i)
+          {
+          plane[i] = s0[i] + wz * ( s1[i] - s0[i] );
+          }
 
-    typedef itk::ResampleImageFilter< InternalImageType, OutputImageType > ResampleFilterType;
-    typename ResampleFilterType::Pointer resampler = ResampleFilterType::New();
-    typedef itk::IdentityTransform< double, 3 > TransformType;
-    TransformType::Pointer transform = TransformType::New();
-    transform->SetIdentity();
-    resampler->SetTransform( transform );
+        for (SizeValueType y = 0; y < outputSize[1]; ++y)
+          {
+          OutputPixelType * outRow = outSlice + y * outputSize[0];
+          if (!tableY.Inside[y])
+            {
+            std::fill( outRow, outRow + outputSize[0], defaultValue );
+            continue;
+            }
+          const InternalPixelType * r0 = plane.data() + tableY.Index0[y] * nx;
+          const InternalPixelType * r1 = plane.data() + tableY.Index1[y] * nx;
+          const InternalPixelType wy = tableY.Weight[y];
+          for (SizeValueType x = 0; x < outputSize[0]; ++x)
+            {
+            if (!tableX.Inside[x])
+              {
+              outRow[x] = defaultValue;
+              continue;
+              }
+            const SizeValueType i0 = tableX.Index0[x];
+            const SizeValueType i1 = tableX.Index1[x];
+            const InternalPixelType wx = tableX.Weight[x];
+            const InternalPixelType v0 = r0[i0] + wx * ( r0[i1] - r0[i0] );
+            const InternalPixelType v1 = r1[i0] + wx * ( r1[i1] - r1[i0] );
+            outRow[x] = ToOutput( v0 + wy * ( v1 - v0 ) );
+            }
+          }
+        }
+      };
+    itk::ParallelForEachBlock( numberOfSlabs, resampleSlab );
+  }
 
-    typedef itk::LinearInterpolateImageFunction< InternalImageType, double > InterpolatorType;
-    typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
-    resampler->SetInterpolator( interpolator );
-    resampler->SetDefaultPixelValue( -1000 );
+  /** Linear interpolation along one axis: the two buffer positions and the
+   * weight of the second, and whether the point is inside. */
+  struct AxisTable
+  {
+    std::vector< itk::SizeValueType >  Index0;
+    std::vector< itk::SizeValueType >  Index1;
+    std::vector< InternalPixelType >   Weight;
+    std::vector< unsigned char >       Inside;
+  };
 
-    typename OutputImageType::SpacingType spacing;
-    spacing[0] = isoSpacing;
-    spacing[1] = isoSpacing;
-    spacing[2] = isoSpacing;
-    resampler->SetOutputSpacing( spacing );
-    resampler->SetOutputOrigin( inputImage->GetOrigin() );
-    resampler->SetOutputDirection( inputImage->GetDirection() );
-
-    typename InputImageType::SizeType inputSize = inputImage->GetLargestPossibleRegion().GetSize();
-    typedef typename InputImageType::SizeType::SizeValueType SizeValueType;
-    const double dx = inputSize[0] * inputSpacing[0] / isoSpacing;
-    const double dy = inputSize[1] * inputSpacing[1] / isoSpacing;
-    const double dz = (double)(inputSize[2] - 1 ) * inputSpacing[2] / isoSpacing;
-    typename InputImageType::SizeType   size;
-    size[0] = static_cast<SizeValueType>( dx );
-    size[1] = static_cast<SizeValueType>( dy );
-    size[2] = static_cast<SizeValueType>( dz );
+  /** Output voxel 'first' + i is at input index offset + ( first + i ) * ratio; the
+   * buffer starts at 'start'. */
+  static void BuildAxisTable( itk::IndexValueType start, itk::SizeValueType n, double offset,
+                              itk::IndexValueType first, itk::SizeValueType outputSize,
+                              double ratio, AxisTable & table )
+  {
+    table.Index0.resize( outputSize );
+    table.Index1.resize( outputSize );
+    table.Weight.resize( outputSize );
+    table.Inside.resize( outputSize );
+    const itk::IndexValueType last = static_cast< itk::IndexValueType >( n ) - 1;
+    for (itk::SizeValueType i = 0; i < outputSize; ++i)
+    {
+      const double x = offset + ( first + static_cast< itk::IndexValueType >( i ) ) * ratio - start;
+      table.Inside[i] = x >= -0.5 && x < n - 0.5;
+      const itk::IndexValueType k = itk::Math::Floor< itk::IndexValueType >( x );
+      table.Index0[i] = static_cast< itk::SizeValueType >( std::max< itk::IndexValueType >( 0, std::min( k, last ) ) );
+      table.Index1[i] = static_cast< itk::SizeValueType >( std::max< itk::IndexValueType >( 0, std::min( k + 1, last ) ) );
+      table.Weight[i] = static_cast< InternalPixelType >( x - k );
+    }
+  }
 
-    resampler->SetSize( size );
-    resampler->SetInput( inputImage );
-    resampler->Update();
+  /** Normalised Gaussian of standard deviation 'sigma' (in voxels), truncated at 4 sigma. */
+  static void MakeGaussianKernel( double sigma, std::vector< InternalPixelType > & kernel )
+  {
+    const int radius = std::max( 1, static_cast< int >( std::ceil( 4.0 * sigma ) ) );
+    std::vector< double > weights( 2 * radius + 1 );
+    double sum = 0.0;
+    for (int i = -radius; i <= radius; ++i)
+    {
+      weights[i + radius] = std::exp( -0.5 * i * i / ( sigma * sigma ) );
+      sum += weights[i + radius];
+    }
+    kernel.resize( weights.size() );
+    for (std::size_t i = 0; i < weights.size(); ++i)
+    {
+      kernel[i] = static_cast< InternalPixelType >( weights[i] / sum );
+    }
+  }
 
-    typename OutputImageType::Pointer out = resampler->GetOutput();
-    out->DisconnectPipeline();
+  /** Cast one input slice into 'out', smoothed in-plane if 'smooth'. */
+  static void PrepareSlice( const InputPixelType * slice, itk::SizeValueType nx, itk::SizeValueType ny,
+                            bool smooth,
+                            const std::vector< InternalPixelType > & kernelX,
+                            const std::vector< InternalPixelType > & kernelY,
+                            InternalPixelType * scratch, InternalPixelType * out )
+  {
+    if (!smooth)
+    {
+      for (itk::SizeValueType i = 0; i < nx * ny; ++i)
+      {
+        out[i] = static_cast< InternalPixelType >( slice[i] );
+      }
+      return;
+    }
 
-    return out;
+    // Along x into the scratch, then along y into 'out'.
+    const itk::IndexValueType rx = static_cast< itk::IndexValueType >( kernelX.size() / 2 );
+    const itk::IndexValueType ry = static_cast< itk::IndexValueType >( kernelY.size() / 2 );
+    const itk::IndexValueType lastX = static_cast< itk::IndexValueType >( nx ) - 1;
+    const itk::IndexValueType lastY = static_cast< itk::IndexValueType >( ny ) - 1;
+    for (itk::SizeValueType y = 0; y < ny; ++y)
+    {
+      const InputPixelType * row = slice + y * nx;
+      InternalPixelType * smoothed = scratch + y * nx;
+      for (itk::IndexValueType x = 0; x <= lastX; ++x)
+      {
+        InternalPixelType sum = 0;
+        for (itk::IndexValueType k = -rx; k <= rx; ++k)
+        {
+          const itk::IndexValueType j = std::max< itk::IndexValueType >( 0, std::min( x + k, lastX ) );
+          sum += kernelX[k + rx] * static_cast< InternalPixelType >( row[j] );
+        }
+        smoothed[x] = sum;
+      }
+    }
+    for (itk::IndexValueType y = 0; y <= lastY; ++y)
+    {
+      InternalPixelType * outRow = out + y * nx;
+      std::fill( outRow, outRow + nx, InternalPixelType( 0 ) );
+      for (itk::IndexValueType k = -ry; k <= ry; ++k)
+      {
+        const itk::IndexValueType j = std::max< itk::IndexValueType >( 0, std::min( y + k, lastY ) );
+        const InternalPixelType * inRow = scratch + j * nx;
+        const InternalPixelType w = kernelY[k + ry];
+        for (itk::SizeValueType x = 0; x < nx; ++x)
+        {
+          outRow[x] += w * inRow[x];
+        }
+      }
+    }
+  }
+
+  /** As ResampleImageFilter: clamped to the output range, then cast. */
+  static OutputPixelType ToOutput( double value )
+  {
+    if (itk::NumericTraits< OutputPixelType >::is_integer)
+    {
+      value = std::max( value, static_cast< double >( itk::NumericTraits< OutputPixelType >::NonpositiveMin() ) );
+      value = std::min( value, static_cast< double >( itk::NumericTraits< OutputPixelType >::max() ) );
+    }
+    return static_cast< OutputPixelType >( value );
   }
 
 };
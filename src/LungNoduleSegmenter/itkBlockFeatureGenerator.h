@@ -0,0 +1,124 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkBlockFeatureGenerator.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkBlockFeatureGenerator_h
+#define itkBlockFeatureGenerator_h
+
+#include "itkFeatureGenerator.h"
+#include "itkImage.h"
+#include "itkImageSpatialObject.h"
+
+namespace itk
+{
+
+/** \class BlockFeatureGenerator
+ * \brief Base class for feature generators that can evaluate their feature
+ * on any sub-region of the input.
+ *
+ * Subclasses implement GenerateBlock(), which fills the pixels of a region
+ * of an output image from the input image and must be safe to call
+ * concurrently from several threads on disjoint regions. Standalone, the
+ * generator behaves like any other FeatureGenerator: GenerateData() splits
+ * the input into slabs and fills a full feature image in parallel. The
+ * StreamingMinimumFeatureAggregator instead calls GenerateBlock() directly
+ * and folds each block into its running minimum, so the full feature image
+ * is never materialised.
+ *
+ * \ingroup SpatialObjectFilters
+ * \ingroup LesionSizingToolkit
+ */
+template <unsigned int NDimension>
+class ITK_EXPORT BlockFeatureGenerator : public FeatureGenerator<NDimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(BlockFeatureGenerator);
+
+  /** Standard class typedefs. */
+  typedef BlockFeatureGenerator             Self;
+  typedef FeatureGenerator<NDimension>      Superclass;
+  typedef SmartPointer<Self>                Pointer;
+  typedef SmartPointer<const Self>          ConstPointer;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(BlockFeatureGenerator, FeatureGenerator);
+
+  /** Dimension of the space */
+  itkStaticConstMacro(Dimension, unsigned int, NDimension);
+
+  /** Type of spatialObject that will be passed as input to this
+   * feature generator. */
+  typedef signed short                                          InputPixelType;
+  typedef Image< InputPixelType, Dimension >                    InputImageType;
+  typedef ImageSpatialObject< NDimension, InputPixelType >      InputImageSpatialObjectType;
+  typedef typename Superclass::SpatialObjectType                SpatialObjectType;
+
+  typedef float                                                 OutputPixelType;
+  typedef Image< OutputPixelType, Dimension >                   OutputImageType;
+  typedef ImageSpatialObject< NDimension, OutputPixelType >     OutputImageSpatialObjectType;
+
+  typedef typename InputImageType::RegionType                   RegionType;
+  typedef typename InputImageType::SizeType                     SizeType;
+
+  /** Input data that will be used for generating the feature. */
+  using ProcessObject::SetInput;
+  void SetInput( const SpatialObjectType * input );
+
+  /** Output data that carries the feature in the form of a
+   * SpatialObject. */
+  const SpatialObjectType * GetFeature() const;
+
+  /** Compute the feature for the pixels of \a region, reading from \a input
+   * and writing into \a output. \a output must have the input geometry and a
+   * buffered region that contains \a region. Must be thread safe. */
+  virtual void GenerateBlock( const InputImageType * input,
+                              const RegionType & region,
+                              OutputImageType * output ) const = 0;
+
+  /** Number of voxels, per axis, that GenerateBlock() reads from the input
+   * beyond the block it computes. Zero for pointwise features. Used by the
+   * aggregator to keep bricks large compared with their halo. */
+  virtual SizeType GetBlockHaloRadius( const InputImageType * input ) const;
+
+  /** Image the aggregator passes to GenerateBlock(): the generator's own
+   * input image if one is connected, \a defaultInput otherwise. This lets a
+   * block feature read a preprocessed image of the same geometry. */
+  const InputImageType * GetBlockInputImage( const InputImageType * defaultInput ) const;
+
+  /** Number of slices per block used by the standalone GenerateData(). */
+  itkSetMacro( NumberOfSlicesPerBlock, unsigned int );
+  itkGetMacro( NumberOfSlicesPerBlock, unsigned int );
+
+protected:
+  BlockFeatureGenerator();
+  ~BlockFeatureGenerator() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  /** Computes the full feature image, block by block. */
+  void GenerateData() override;
+
+  const InputImageType * GetInputImage() const;
+
+private:
+  unsigned int m_NumberOfSlicesPerBlock;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkBlockFeatureGenerator.hxx"
+#endif
+
+#endif
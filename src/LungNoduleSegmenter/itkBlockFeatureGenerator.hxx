@@ -0,0 +1,167 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkBlockFeatureGenerator.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkBlockFeatureGenerator_hxx
+#define itkBlockFeatureGenerator_hxx
+
+#include "itkBlockFeatureGenerator.h"
+#include "itkParallelForEachBlock.h"
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template <unsigned int NDimension>
+BlockFeatureGenerator<NDimension>
+::BlockFeatureGenerator() : m_NumberOfSlicesPerBlock(4)
+{
+  this->SetNumberOfRequiredInputs( 1 );
+  this->SetNumberOfRequiredOutputs( 1 );
+
+  typename OutputImageSpatialObjectType::Pointer outputObject = OutputImageSpatialObjectType::New();
+
+  this->ProcessObject::SetNthOutput( 0, outputObject.GetPointer() );
+}
+
+
+/*
+ * Destructor
+ */
+template <unsigned int NDimension>
+BlockFeatureGenerator<NDimension>
+::~BlockFeatureGenerator()
+{
+}
+
+template <unsigned int NDimension>
+void
+BlockFeatureGenerator<NDimension>
+::SetInput( const SpatialObjectType * spatialObject )
+{
+  // Process object is not const-correct so the const casting is required.
+  this->SetNthInput(0, const_cast<SpatialObjectType *>( spatialObject ));
+}
+
+template <unsigned int NDimension>
+const typename BlockFeatureGenerator<NDimension>::SpatialObjectType *
+BlockFeatureGenerator<NDimension>
+::GetFeature() const
+{
+  if (this->GetNumberOfOutputs() < 1)
+    {
+    return nullptr;
+    }
+
+  return static_cast<const SpatialObjectType*>(this->ProcessObject::GetOutput(0));
+}
+
+template <unsigned int NDimension>
+const typename BlockFeatureGenerator<NDimension>::InputImageType *
+BlockFeatureGenerator<NDimension>
+::GetInputImage() const
+{
+  const InputImageSpatialObjectType * inputObject =
+    dynamic_cast<const InputImageSpatialObjectType * >( this->ProcessObject::GetInput(0) );
+
+  if( !inputObject )
+    {
+    itkExceptionMacro("Missing input spatial object");
+    }
+
+  const InputImageType * inputImage = inputObject->GetImage();
+
+  if( !inputImage )
+    {
+    itkExceptionMacro("Missing input image");
+    }
+
+  return inputImage;
+}
+
+template <unsigned int NDimension>
+const typename BlockFeatureGenerator<NDimension>::InputImageType *
+BlockFeatureGenerator<NDimension>
+::GetBlockInputImage( const InputImageType * defaultInput ) const
+{
+  const InputImageSpatialObjectType * inputObject =
+    dynamic_cast<const InputImageSpatialObjectType * >( this->ProcessObject::GetInput(0) );
+
+  if( inputObject && inputObject->GetImage() )
+    {
+    return inputObject->GetImage();
+    }
+  return defaultInput;
+}
+
+template <unsigned int NDimension>
+typename BlockFeatureGenerator<NDimension>::SizeType
+BlockFeatureGenerator<NDimension>
+::GetBlockHaloRadius( const InputImageType * ) const
+{
+  SizeType radius;
+  radius.Fill( 0 );
+  return radius;
+}
+
+
+/*
+ * PrintSelf
+ */
+template <unsigned int NDimension>
+void
+BlockFeatureGenerator<NDimension>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "Slices per block " << this->m_NumberOfSlicesPerBlock << std::endl;
+}
+
+
+/*
+ * Generate Data
+ */
+template <unsigned int NDimension>
+void
+BlockFeatureGenerator<NDimension>
+::GenerateData()
+{
+  const InputImageType * inputImage = this->GetInputImage();
+
+  typename OutputImageType::Pointer outputImage = OutputImageType::New();
+  outputImage->CopyInformation( inputImage );
+  outputImage->SetRegions( inputImage->GetBufferedRegion() );
+  outputImage->Allocate();
+
+  const SlabRegionSplitter< NDimension > splitter(
+    inputImage->GetBufferedRegion(), this->m_NumberOfSlicesPerBlock );
+  const Self * self = this;
+  OutputImageType * output = outputImage.GetPointer();
+  auto generateSlab = [self, inputImage, output, &splitter]( SizeValueType slab, ThreadIdType )
+    {
+    self->GenerateBlock( inputImage, splitter.GetSlab( slab ), output );
+    };
+  ParallelForEachBlock( splitter.GetNumberOfSlabs(), generateSlab );
+
+  auto * outputObject = dynamic_cast< OutputImageSpatialObjectType * >(this->ProcessObject::GetOutput(0));
+
+  outputObject->SetImage( outputImage );
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,106 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkBlockedRecursiveGaussianImageFilter.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkBlockedRecursiveGaussianImageFilter_h
+#define itkBlockedRecursiveGaussianImageFilter_h
+
+#include "itkRecursiveGaussianImageFilter.h"
+
+namespace itk
+{
+
+/** \class BlockedRecursiveGaussianImageFilter
+ * \brief RecursiveGaussianImageFilter that runs the IIR recursion on several
+ * adjacent scanlines at once.
+ *
+ * The coefficients (Deriche's approximation of the Gaussian and of its first
+ * and second derivatives) and the boundary handling are inherited unchanged
+ * from RecursiveGaussianImageFilter. Only ThreadedGenerateData() differs:
+ * instead of filtering one line at a time, NumberOfLanes lines that are
+ * adjacent along a second axis are gathered into an interleaved scratch
+ * buffer, so that every step of the causal and anti-causal recursions
+ * operates on a contiguous group of lanes that the compiler can keep in SIMD
+ * registers. The gather and scatter are done in short tiles along the
+ * filtering direction, which makes them cache-blocked transposes for the
+ * x axis and cache-line sized reads for the strided y and z axes.
+ *
+ * Since the class derives from RecursiveGaussianImageFilter it can be used
+ * wherever that filter is, either directly or through the object factory
+ * override installed by BlockedRecursiveGaussianImageFilterFactory.
+ * Only scalar pixel types are supported.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template< typename TInputImage, typename TOutputImage = TInputImage >
+class ITK_EXPORT BlockedRecursiveGaussianImageFilter :
+  public RecursiveGaussianImageFilter< TInputImage, TOutputImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef BlockedRecursiveGaussianImageFilter                       Self;
+  typedef RecursiveGaussianImageFilter< TInputImage, TOutputImage > Superclass;
+  typedef SmartPointer< Self >                                      Pointer;
+  typedef SmartPointer< const Self >                                ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(BlockedRecursiveGaussianImageFilter, RecursiveGaussianImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  typedef TInputImage                                   InputImageType;
+  typedef TOutputImage                                  OutputImageType;
+  typedef typename InputImageType::PixelType            InputPixelType;
+  typedef typename OutputImageType::PixelType           OutputPixelType;
+  typedef typename OutputImageType::RegionType          OutputImageRegionType;
+  typedef typename OutputImageType::IndexType           IndexType;
+  typedef typename OutputImageType::SizeType            SizeType;
+  typedef typename NumericTraits< InputPixelType >::ScalarRealType ScalarRealType;
+
+  /** Number of scanlines filtered together. One cache line worth of
+   * ScalarRealType values. */
+  itkStaticConstMacro(NumberOfLanes, unsigned int, 64 / sizeof(ScalarRealType));
+
+  /** Length of the tiles (along the filtering direction) used while
+   * transposing scanlines in and out of the interleaved buffer. */
+  itkStaticConstMacro(TileLength, unsigned int, 16);
+
+protected:
+  BlockedRecursiveGaussianImageFilter() {}
+  ~BlockedRecursiveGaussianImageFilter() override {}
+
+  void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
+                            ThreadIdType threadId) override;
+
+  /** Causal + anti-causal recursion on NumberOfLanes interleaved lines.
+   * Element i of lane l is stored at [i * NumberOfLanes + l]. This is the
+   * lane-parallel counterpart of RecursiveSeparableImageFilter::FilterDataArray. */
+  void FilterLanes(ScalarRealType *outs, const ScalarRealType *data,
+                   ScalarRealType *scratch, SizeValueType ln) const;
+
+private:
+  ITK_DISALLOW_COPY_AND_ASSIGN(BlockedRecursiveGaussianImageFilter);
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBlockedRecursiveGaussianImageFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,258 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkBlockedRecursiveGaussianImageFilter.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkBlockedRecursiveGaussianImageFilter_hxx
+#define itkBlockedRecursiveGaussianImageFilter_hxx
+
+#include "itkBlockedRecursiveGaussianImageFilter.h"
+#include "itkProgressReporter.h"
+#include <algorithm>
+#include <vector>
+
+namespace itk
+{
+
+template< typename TInputImage, typename TOutputImage >
+void
+BlockedRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
+                       ThreadIdType threadId)
+{
+  if ( ImageDimension < 2 )
+    {
+    // There is no second axis to gather lanes from.
+    Superclass::ThreadedGenerateData(outputRegionForThread, threadId);
+    return;
+    }
+
+  const InputImageType * inputImage = this->GetInput();
+  OutputImageType *      outputImage = this->GetOutput();
+
+  const unsigned int direction = this->GetDirection();
+  const unsigned int laneAxis = ( direction == 0 ) ? 1 : 0;
+  const unsigned int lanes = NumberOfLanes;
+
+  const IndexType regionIndex = outputRegionForThread.GetIndex();
+  const SizeType  regionSize = outputRegionForThread.GetSize();
+  const SizeValueType ln = regionSize[direction];
+
+  // Every group holds up to NumberOfLanes lines, adjacent along laneAxis.
+  SizeType groupSize = regionSize;
+  groupSize[direction] = 1;
+  groupSize[laneAxis] = ( regionSize[laneAxis] + lanes - 1 ) / lanes;
+  SizeValueType numberOfGroups = 1;
+  for ( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+    numberOfGroups *= groupSize[d];
+    }
+
+  const OffsetValueType * inputOffsets = inputImage->GetOffsetTable();
+  const OffsetValueType * outputOffsets = outputImage->GetOffsetTable();
+  const OffsetValueType inDirStride = inputOffsets[direction];
+  const OffsetValueType inLaneStride = inputOffsets[laneAxis];
+  const OffsetValueType outDirStride = outputOffsets[direction];
+  const OffsetValueType outLaneStride = outputOffsets[laneAxis];
+
+  std::vector< ScalarRealType > data( ln * lanes, NumericTraits< ScalarRealType >::ZeroValue() );
+  std::vector< ScalarRealType > outs( ln * lanes );
+  std::vector< ScalarRealType > scratch( ln * lanes );
+
+  ProgressReporter progress(this, threadId, numberOfGroups, 10);
+
+  for ( SizeValueType g = 0; g < numberOfGroups; ++g )
+    {
+    IndexType lineStart = regionIndex;
+    SizeValueType remainder = g;
+    for ( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+      if ( d == direction )
+        {
+        continue;
+        }
+      const SizeValueType coordinate = remainder % groupSize[d];
+      remainder /= groupSize[d];
+      lineStart[d] += static_cast< IndexValueType >(
+        d == laneAxis ? coordinate * lanes : coordinate );
+      }
+
+    const SizeValueType usedLanes = std::min< SizeValueType >( lanes,
+      regionSize[laneAxis] - static_cast< SizeValueType >( lineStart[laneAxis] - regionIndex[laneAxis] ) );
+
+    const InputPixelType *inBase =
+      inputImage->GetBufferPointer() + inputImage->ComputeOffset(lineStart);
+    OutputPixelType *outBase =
+      outputImage->GetBufferPointer() + outputImage->ComputeOffset(lineStart);
+
+    // Gather, tile by tile, into the interleaved buffer. Unused lanes of the
+    // last group keep whatever they held; their results are never stored.
+    for ( SizeValueType i0 = 0; i0 < ln; i0 += TileLength )
+      {
+      const SizeValueType i1 = std::min< SizeValueType >( ln, i0 + TileLength );
+      for ( SizeValueType l = 0; l < usedLanes; ++l )
+        {
+        const InputPixelType *src = inBase + l * inLaneStride;
+        for ( SizeValueType i = i0; i < i1; ++i )
+          {
+          data[i * lanes + l] = static_cast< ScalarRealType >( src[i * inDirStride] );
+          }
+        }
+      }
+
+    this->FilterLanes( &outs[0], &data[0], &scratch[0], ln );
+
+    // Scatter back, with the same tiling.
+    for ( SizeValueType i0 = 0; i0 < ln; i0 += TileLength )
+      {
+      const SizeValueType i1 = std::min< SizeValueType >( ln, i0 + TileLength );
+      for ( SizeValueType l = 0; l < usedLanes; ++l )
+        {
+        OutputPixelType *dst = outBase + l * outLaneStride;
+        for ( SizeValueType i = i0; i < i1; ++i )
+          {
+          dst[i * outDirStride] = static_cast< OutputPixelType >( outs[i * lanes + l] );
+          }
+        }
+      }
+
+    progress.CompletedPixel();
+    }
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+BlockedRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::FilterLanes(ScalarRealType *outs, const ScalarRealType *data,
+              ScalarRealType *scratch, SizeValueType ln) const
+{
+  const unsigned int L = NumberOfLanes;
+
+  const ScalarRealType N0 = this->m_N0;
+  const ScalarRealType N1 = this->m_N1;
+  const ScalarRealType N2 = this->m_N2;
+  const ScalarRealType N3 = this->m_N3;
+  const ScalarRealType D1 = this->m_D1;
+  const ScalarRealType D2 = this->m_D2;
+  const ScalarRealType D3 = this->m_D3;
+  const ScalarRealType D4 = this->m_D4;
+  const ScalarRealType M1 = this->m_M1;
+  const ScalarRealType M2 = this->m_M2;
+  const ScalarRealType M3 = this->m_M3;
+  const ScalarRealType M4 = this->m_M4;
+  const ScalarRealType BN1 = this->m_BN1;
+  const ScalarRealType BN2 = this->m_BN2;
+  const ScalarRealType BN3 = this->m_BN3;
+  const ScalarRealType BN4 = this->m_BN4;
+  const ScalarRealType BM1 = this->m_BM1;
+  const ScalarRealType BM2 = this->m_BM2;
+  const ScalarRealType BM3 = this->m_BM3;
+  const ScalarRealType BM4 = this->m_BM4;
+
+  // Causal direction pass. The first sample of every line is assumed to
+  // extend from the border to infinity.
+  const ScalarRealType *d0 = data;
+  const ScalarRealType *d1 = data + L;
+  const ScalarRealType *d2 = data + 2 * L;
+  const ScalarRealType *d3 = data + 3 * L;
+  ScalarRealType *s0 = scratch;
+  ScalarRealType *s1 = scratch + L;
+  ScalarRealType *s2 = scratch + 2 * L;
+  ScalarRealType *s3 = scratch + 3 * L;
+  for ( unsigned int l = 0; l < L; ++l )
+    {
+    const ScalarRealType outV1 = d0[l];
+    s0[l] = outV1 * N0 + outV1 * N1 + outV1 * N2 + outV1 * N3;
+    s1[l] = d1[l] * N0 + outV1 * N1 + outV1 * N2 + outV1 * N3;
+    s2[l] = d2[l] * N0 + d1[l] * N1 + outV1 * N2 + outV1 * N3;
+    s3[l] = d3[l] * N0 + d2[l] * N1 + d1[l] * N2 + outV1 * N3;
+
+    s0[l] -= outV1 * BN1 + outV1 * BN2 + outV1 * BN3 + outV1 * BN4;
+    s1[l] -= s0[l] * D1 + outV1 * BN2 + outV1 * BN3 + outV1 * BN4;
+    s2[l] -= s1[l] * D1 + s0[l] * D2 + outV1 * BN3 + outV1 * BN4;
+    s3[l] -= s2[l] * D1 + s1[l] * D2 + s0[l] * D3 + outV1 * BN4;
+    }
+
+  for ( SizeValueType i = 4; i < ln; ++i )
+    {
+    const ScalarRealType *x0 = data + i * L;
+    const ScalarRealType *x1 = x0 - L;
+    const ScalarRealType *x2 = x0 - 2 * L;
+    const ScalarRealType *x3 = x0 - 3 * L;
+    ScalarRealType *y0 = scratch + i * L;
+    const ScalarRealType *y1 = y0 - L;
+    const ScalarRealType *y2 = y0 - 2 * L;
+    const ScalarRealType *y3 = y0 - 3 * L;
+    const ScalarRealType *y4 = y0 - 4 * L;
+    for ( unsigned int l = 0; l < L; ++l )
+      {
+      y0[l] = x0[l] * N0 + x1[l] * N1 + x2[l] * N2 + x3[l] * N3;
+      y0[l] -= y1[l] * D1 + y2[l] * D2 + y3[l] * D3 + y4[l] * D4;
+      }
+    }
+
+  // Store the causal result.
+  std::copy( scratch, scratch + ln * L, outs );
+
+  // Anti-causal direction pass. The last sample of every line is assumed to
+  // extend from the border to infinity.
+  const ScalarRealType *e1 = data + ( ln - 1 ) * L;
+  const ScalarRealType *e2 = data + ( ln - 2 ) * L;
+  const ScalarRealType *e3 = data + ( ln - 3 ) * L;
+  ScalarRealType *t1 = scratch + ( ln - 1 ) * L;
+  ScalarRealType *t2 = scratch + ( ln - 2 ) * L;
+  ScalarRealType *t3 = scratch + ( ln - 3 ) * L;
+  ScalarRealType *t4 = scratch + ( ln - 4 ) * L;
+  for ( unsigned int l = 0; l < L; ++l )
+    {
+    const ScalarRealType outV2 = e1[l];
+    t1[l] = outV2 * M1 + outV2 * M2 + outV2 * M3 + outV2 * M4;
+    t2[l] = e1[l] * M1 + outV2 * M2 + outV2 * M3 + outV2 * M4;
+    t3[l] = e2[l] * M1 + e1[l] * M2 + outV2 * M3 + outV2 * M4;
+    t4[l] = e3[l] * M1 + e2[l] * M2 + e1[l] * M3 + outV2 * M4;
+
+    t1[l] -= outV2 * BM1 + outV2 * BM2 + outV2 * BM3 + outV2 * BM4;
+    t2[l] -= t1[l] * D1 + outV2 * BM2 + outV2 * BM3 + outV2 * BM4;
+    t3[l] -= t2[l] * D1 + t1[l] * D2 + outV2 * BM3 + outV2 * BM4;
+    t4[l] -= t3[l] * D1 + t2[l] * D2 + t1[l] * D3 + outV2 * BM4;
+    }
+
+  for ( SizeValueType i = ln - 4; i > 0; --i )
+    {
+    const ScalarRealType *x0 = data + i * L;
+    const ScalarRealType *x1 = x0 + L;
+    const ScalarRealType *x2 = x0 + 2 * L;
+    const ScalarRealType *x3 = x0 + 3 * L;
+    ScalarRealType *y0 = scratch + ( i - 1 ) * L;
+    const ScalarRealType *y1 = y0 + L;
+    const ScalarRealType *y2 = y0 + 2 * L;
+    const ScalarRealType *y3 = y0 + 3 * L;
+    const ScalarRealType *y4 = y0 + 4 * L;
+    for ( unsigned int l = 0; l < L; ++l )
+      {
+      y0[l] = x0[l] * M1 + x1[l] * M2 + x2[l] * M3 + x3[l] * M4;
+      y0[l] -= y1[l] * D1 + y2[l] * D2 + y3[l] * D3 + y4[l] * D4;
+      }
+    }
+
+  // Roll the anti-causal part into the output.
+  for ( SizeValueType i = 0; i < ln * L; ++i )
+    {
+    outs[i] += scratch[i];
+    }
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,104 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkBlockedRecursiveGaussianImageFilterFactory.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkBlockedRecursiveGaussianImageFilterFactory_h
+#define itkBlockedRecursiveGaussianImageFilterFactory_h
+
+#include "itkObjectFactoryBase.h"
+#include "itkCreateObjectFunction.h"
+#include "itkVersion.h"
+#include "itkImage.h"
+#include "itkBlockedRecursiveGaussianImageFilter.h"
+#include <typeinfo>
+
+namespace itk
+{
+
+/** \class BlockedRecursiveGaussianImageFilterFactory
+ * \brief Object factory that substitutes BlockedRecursiveGaussianImageFilter
+ * for RecursiveGaussianImageFilter.
+ *
+ * Once registered, every RecursiveGaussianImageFilter::New() for one of the
+ * scalar image types below returns the blocked implementation. This reaches
+ * the Gaussian smoothing done inside the toolkit's feature generators
+ * (Hessian for the vesselness, Canny edges) without modifying them.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+class BlockedRecursiveGaussianImageFilterFactory : public ObjectFactoryBase
+{
+public:
+  typedef BlockedRecursiveGaussianImageFilterFactory Self;
+  typedef ObjectFactoryBase                          Superclass;
+  typedef SmartPointer< Self >                       Pointer;
+  typedef SmartPointer< const Self >                 ConstPointer;
+
+  const char * GetITKSourceVersion() const override
+    {
+    return ITK_SOURCE_VERSION;
+    }
+
+  const char * GetDescription() const override
+    {
+    return "Lane-parallel RecursiveGaussianImageFilter";
+    }
+
+  /** Method for class instantiation. */
+  itkFactorylessNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(BlockedRecursiveGaussianImageFilterFactory, ObjectFactoryBase);
+
+  /** Register one factory of this type */
+  static void RegisterOneFactory()
+    {
+    Pointer factory = Self::New();
+    ObjectFactoryBase::RegisterFactory(factory);
+    }
+
+protected:
+  BlockedRecursiveGaussianImageFilterFactory()
+    {
+    this->OverrideFilterType< short, float, 3 >();
+    this->OverrideFilterType< short, double, 3 >();
+    this->OverrideFilterType< float, float, 3 >();
+    this->OverrideFilterType< float, double, 3 >();
+    this->OverrideFilterType< double, double, 3 >();
+    this->OverrideFilterType< float, float, 2 >();
+    this->OverrideFilterType< double, double, 2 >();
+    }
+
+  template< typename TInputPixel, typename TOutputPixel, unsigned int VDimension >
+  void OverrideFilterType()
+    {
+    typedef Image< TInputPixel, VDimension >                                  InputImageType;
+    typedef Image< TOutputPixel, VDimension >                                 OutputImageType;
+    typedef RecursiveGaussianImageFilter< InputImageType, OutputImageType >   BaseFilterType;
+    typedef BlockedRecursiveGaussianImageFilter< InputImageType, OutputImageType > BlockedFilterType;
+    this->RegisterOverride( typeid( BaseFilterType ).name(),
+                            typeid( BlockedFilterType ).name(),
+                            "Lane-parallel RecursiveGaussianImageFilter override",
+                            true,
+                            CreateObjectFunction< BlockedFilterType >::New() );
+    }
+
+private:
+  ITK_DISALLOW_COPY_AND_ASSIGN(BlockedRecursiveGaussianImageFilterFactory);
+};
+
+} // end namespace itk
+
+#endif
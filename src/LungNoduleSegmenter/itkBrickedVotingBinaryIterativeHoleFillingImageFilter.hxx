@@ -0,0 +1,430 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkBrickedVotingBinaryIterativeHoleFillingImageFilter.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkBrickedVotingBinaryIterativeHoleFillingImageFilter_hxx
+#define itkBrickedVotingBinaryIterativeHoleFillingImageFilter_hxx
+
+#include "itkBrickedVotingBinaryIterativeHoleFillingImageFilter.h"
+#include "itkParallelForEachBlock.h"
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+
+namespace itk
+{
+
+namespace BrickedVotingDetail
+{
+/** Interleaves the bits of the brick coordinates, x lowest. */
+inline std::uint64_t MortonCode( SizeValueType x, SizeValueType y, SizeValueType z )
+{
+  std::uint64_t code = 0;
+  for ( unsigned int bit = 0; bit < 21; ++bit )
+    {
+    code |= ( static_cast< std::uint64_t >( ( x >> bit ) & 1 ) << ( 3 * bit ) ) |
+            ( static_cast< std::uint64_t >( ( y >> bit ) & 1 ) << ( 3 * bit + 1 ) ) |
+            ( static_cast< std::uint64_t >( ( z >> bit ) & 1 ) << ( 3 * bit + 2 ) );
+    }
+  return code;
+}
+} // end namespace BrickedVotingDetail
+
+
+/**
+ * Constructor
+ */
+template< typename TImage >
+BrickedVotingBinaryIterativeHoleFillingImageFilter< TImage >
+::BrickedVotingBinaryIterativeHoleFillingImageFilter() :
+  m_NumberOfIterationsRun( 0 ),
+  m_NumberOfPixelsFilled( 0 )
+{
+}
+
+
+template< typename TImage >
+void
+BrickedVotingBinaryIterativeHoleFillingImageFilter< TImage >
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  ImageType * input = const_cast< ImageType * >( this->GetInput() );
+  if ( input )
+    {
+    input->SetRequestedRegionToLargestPossibleRegion();
+    }
+}
+
+
+template< typename TImage >
+void
+BrickedVotingBinaryIterativeHoleFillingImageFilter< TImage >
+::EnlargeOutputRequestedRegion( DataObject * output )
+{
+  Superclass::EnlargeOutputRequestedRegion( output );
+  output->SetRequestedRegionToLargestPossibleRegion();
+}
+
+
+template< typename TImage >
+void
+BrickedVotingBinaryIterativeHoleFillingImageFilter< TImage >
+::GenerateData()
+{
+  this->AllocateOutputs();
+  const ImageType * input = this->GetInput();
+  ImageType * output = this->GetOutput();
+
+  const RegionType region = output->GetRequestedRegion();
+  const SizeType size = region.GetSize();
+  const IndexType start = region.GetIndex();
+  const SizeType radius = this->GetRadius();
+  const PixelType foreground = this->GetForegroundValue();
+  const PixelType background = this->GetBackgroundValue();
+
+  this->m_NumberOfIterationsRun = 0;
+  this->m_NumberOfPixelsFilled = 0;
+  if ( region.GetNumberOfPixels() == 0 )
+    {
+    return;
+    }
+
+  // Birth threshold, as in VotingBinaryHoleFillingImageFilter.
+  SizeValueType neighbourhoodSize = 1;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    neighbourhoodSize *= 2 * radius[i] + 1;
+    }
+  const SizeValueType birth = ( neighbourhoodSize - 1 ) / 2 + this->GetMajorityThreshold();
+
+  // Bricks, and their slots in Morton order.
+  const SizeValueType brickSize = BrickSize;
+  const SizeValueType brickPixels = brickSize * brickSize * brickSize;
+  SizeValueType numberOfBricksPerAxis[3];
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    numberOfBricksPerAxis[i] = ( size[i] + brickSize - 1 ) >> BrickShift;
+    }
+  const SizeValueType numberOfBricks =
+    numberOfBricksPerAxis[0] * numberOfBricksPerAxis[1] * numberOfBricksPerAxis[2];
+  std::vector< SizeValueType > brickOfSlot( numberOfBricks );
+  std::iota( brickOfSlot.begin(), brickOfSlot.end(), 0 );
+  std::vector< std::uint64_t > codes( numberOfBricks );
+  for ( SizeValueType brick = 0; brick < numberOfBricks; ++brick )
+    {
+    const SizeValueType x = brick % numberOfBricksPerAxis[0];
+    const SizeValueType y = ( brick / numberOfBricksPerAxis[0] ) % numberOfBricksPerAxis[1];
+    const SizeValueType z = brick / ( numberOfBricksPerAxis[0] * numberOfBricksPerAxis[1] );
+    codes[brick] = BrickedVotingDetail::MortonCode( x, y, z );
+    }
+  std::sort( brickOfSlot.begin(), brickOfSlot.end(),
+             [&]( SizeValueType a, SizeValueType b ) { return codes[a] < codes[b]; } );
+  std::vector< SizeValueType > slotOfBrick( numberOfBricks );
+  for ( SizeValueType slot = 0; slot < numberOfBricks; ++slot )
+    {
+    slotOfBrick[brickOfSlot[slot]] = slot;
+    }
+  auto brickRegionOfSlot = [&]( SizeValueType slot )
+    {
+    SizeValueType brick = brickOfSlot[slot];
+    RegionType r;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      const SizeValueType first = ( brick % numberOfBricksPerAxis[i] ) << BrickShift;
+      brick /= numberOfBricksPerAxis[i];
+      r.SetIndex( i, start[i] + static_cast< IndexValueType >( first ) );
+      r.SetSize( i, std::min( brickSize, size[i] - first ) );
+      }
+    return r;
+    };
+  auto offsetInBrick = [&]( const IndexType & index )
+    {
+    const SizeValueType mask = brickSize - 1;
+    return ( ( static_cast< SizeValueType >( index[2] - start[2] ) & mask ) << ( 2 * BrickShift ) ) |
+           ( ( static_cast< SizeValueType >( index[1] - start[1] ) & mask ) << BrickShift ) |
+           ( static_cast< SizeValueType >( index[0] - start[0] ) & mask );
+    };
+
+  // Classes of the input pixels. The padding of the bricks cut by the end
+  // of the image is never read: neighbours are clamped to the image.
+  std::vector< unsigned char > state( numberOfBricks * brickPixels, Other );
+  std::vector< unsigned char > hasBackground( numberOfBricks, 0 );
+  auto classifyBrick = [&]( SizeValueType slot, ThreadIdType )
+    {
+    unsigned char * classes = &state[slot * brickPixels];
+    auto classifyLine = [&]( const IndexType & lineStart, SizeValueType n )
+      {
+      const PixelType * in = input->GetBufferPointer() + input->ComputeOffset( lineStart );
+      unsigned char * out = classes + offsetInBrick( lineStart );
+      for ( SizeValueType x = 0; x < n; ++x )
+        {
+        out[x] = in[x] == background ? Background : ( in[x] == foreground ? Foreground : Other );
+        hasBackground[slot] |= out[x] == Background;
+        }
+      };
+    ForEachRegionLine( brickRegionOfSlot( slot ), classifyLine );
+    };
+  ParallelForEachBlock( numberOfBricks, classifyBrick );
+
+  // Reach of a brick's apron, in bricks.
+  IndexValueType reach[3];
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    reach[i] = static_cast< IndexValueType >( ( radius[i] + brickSize - 1 ) >> BrickShift );
+    }
+
+  const ThreadIdType numberOfThreads = GetParallelForEachBlockNumberOfThreads( numberOfBricks );
+  std::vector< std::vector< std::uint32_t > > scratch( numberOfThreads );
+  std::vector< SizeValueType > filledPerThread( numberOfThreads );
+  std::vector< unsigned char > next = state;
+  std::vector< unsigned char > changed( numberOfBricks, 0 );
+  std::vector< unsigned char > active = hasBackground;
+  std::vector< SizeValueType > activeSlots;
+
+  // Updates a brick from the classes of the previous iteration: gathers the
+  // brick and its apron, box sums the foreground along x, y then z, and
+  // applies the birth rule.
+  auto updateBrick = [&]( SizeValueType i, ThreadIdType threadId )
+    {
+    const SizeValueType slot = activeSlots[i];
+    const RegionType brickRegion = brickRegionOfSlot( slot );
+    SizeValueType apron[3];
+    for ( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+      apron[d] = brickSize + 2 * radius[d];
+      }
+    const SizeValueType apronPixels = apron[0] * apron[1] * apron[2];
+    std::vector< std::uint32_t > & buffer = scratch[threadId];
+    buffer.resize( 2 * apronPixels );
+    std::uint32_t * counts = &buffer[0];
+    std::uint32_t * sums = &buffer[apronPixels];
+
+    // Brick and offset of each apron coordinate, per axis, clamped to the
+    // image.
+    std::vector< SizeValueType > brickAlong[3];
+    std::vector< SizeValueType > offsetAlong[3];
+    for ( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+      brickAlong[d].resize( apron[d] );
+      offsetAlong[d].resize( apron[d] );
+      const IndexValueType first = brickRegion.GetIndex()[d] - start[d] -
+        static_cast< IndexValueType >( radius[d] );
+      const IndexValueType last = static_cast< IndexValueType >( size[d] ) - 1;
+      for ( SizeValueType a = 0; a < apron[d]; ++a )
+        {
+        const IndexValueType p = std::min( std::max< IndexValueType >(
+          first + static_cast< IndexValueType >( a ), 0 ), last );
+        brickAlong[d][a] = static_cast< SizeValueType >( p ) >> BrickShift;
+        offsetAlong[d][a] = ( static_cast< SizeValueType >( p ) & ( brickSize - 1 ) ) <<
+          ( d * BrickShift );
+        }
+      }
+    for ( SizeValueType z = 0; z < apron[2]; ++z )
+      {
+      for ( SizeValueType y = 0; y < apron[1]; ++y )
+        {
+        const SizeValueType rowBrick = numberOfBricksPerAxis[0] *
+          ( brickAlong[1][y] + numberOfBricksPerAxis[1] * brickAlong[2][z] );
+        const SizeValueType rowOffset = offsetAlong[1][y] + offsetAlong[2][z];
+        std::uint32_t * row = counts + ( z * apron[1] + y ) * apron[0];
+        for ( SizeValueType x = 0; x < apron[0]; ++x )
+          {
+          const SizeValueType source = slotOfBrick[rowBrick + brickAlong[0][x]];
+          row[x] = state[source * brickPixels + rowOffset + offsetAlong[0][x]] == Foreground;
+          }
+        }
+      }
+
+    // Box sums over the window of each brick pixel. Sums along an axis are
+    // only kept where the later axes still need them.
+    const SizeValueType w[3] = { 2 * radius[0] + 1, 2 * radius[1] + 1, 2 * radius[2] + 1 };
+    for ( SizeValueType z = 0; z < apron[2]; ++z )
+      {
+      for ( SizeValueType y = 0; y < apron[1]; ++y )
+        {
+        const std::uint32_t * in = counts + ( z * apron[1] + y ) * apron[0];
+        std::uint32_t * out = sums + ( z * apron[1] + y ) * apron[0];
+        std::uint32_t s = 0;
+        for ( SizeValueType x = 0; x < w[0] - 1; ++x )
+          {
+          s += in[x];
+          }
+        for ( SizeValueType x = 0; x < brickSize; ++x )
+          {
+          s += in[x + w[0] - 1];
+          out[x] = s;
+          s -= in[x];
+          }
+        }
+      }
+    for ( SizeValueType z = 0; z < apron[2]; ++z )
+      {
+      const std::uint32_t * in = sums + z * apron[1] * apron[0];
+      std::uint32_t * out = counts + z * apron[1] * apron[0];
+      for ( SizeValueType x = 0; x < brickSize; ++x )
+        {
+        std::uint32_t s = 0;
+        for ( SizeValueType y = 0; y < w[1] - 1; ++y )
+          {
+          s += in[y * apron[0] + x];
+          }
+        for ( SizeValueType y = 0; y < brickSize; ++y )
+          {
+          s += in[( y + w[1] - 1 ) * apron[0] + x];
+          out[y * apron[0] + x] = s;
+          s -= in[y * apron[0] + x];
+          }
+        }
+      }
+
+    const unsigned char * previous = &state[slot * brickPixels];
+    unsigned char * updated = &next[slot * brickPixels];
+    const SizeValueType plane = apron[1] * apron[0];
+    SizeValueType filled = 0;
+    for ( SizeValueType y = 0; y < brickRegion.GetSize()[1]; ++y )
+      {
+      for ( SizeValueType x = 0; x < brickRegion.GetSize()[0]; ++x )
+        {
+        const std::uint32_t * in = counts + y * apron[0] + x;
+        std::uint32_t s = 0;
+        for ( SizeValueType z = 0; z < w[2] - 1; ++z )
+          {
+          s += in[z * plane];
+          }
+        for ( SizeValueType z = 0; z < brickRegion.GetSize()[2]; ++z )
+          {
+          s += in[( z + w[2] - 1 ) * plane];
+          const SizeValueType p = ( z << ( 2 * BrickShift ) ) | ( y << BrickShift ) | x;
+          if ( previous[p] == Background && s >= birth )
+            {
+            updated[p] = Foreground;
+            ++filled;
+            }
+          s -= in[z * plane];
+          }
+        }
+      }
+    changed[slot] = filled != 0;
+    filledPerThread[threadId] += filled;
+    };
+
+  const unsigned int maximumNumberOfIterations = this->GetMaximumNumberOfIterations();
+  while ( this->m_NumberOfIterationsRun < maximumNumberOfIterations &&
+          !this->GetAbortGenerateData() )
+    {
+    activeSlots.clear();
+    for ( SizeValueType slot = 0; slot < numberOfBricks; ++slot )
+      {
+      if ( active[slot] )
+        {
+        activeSlots.push_back( slot );
+        }
+      }
+    std::fill( changed.begin(), changed.end(), 0 );
+    std::fill( filledPerThread.begin(), filledPerThread.end(), 0 );
+    ParallelForEachBlock( activeSlots.size(), updateBrick );
+    ++this->m_NumberOfIterationsRun;
+
+    const SizeValueType filled =
+      std::accumulate( filledPerThread.begin(), filledPerThread.end(), SizeValueType( 0 ) );
+    this->m_NumberOfPixelsFilled += filled;
+    if ( filled == 0 )
+      {
+      break;
+      }
+
+    // The next iteration reads what this one filled, and only revisits the
+    // bricks within reach of a change that still have background.
+    for ( SizeValueType slot = 0; slot < numberOfBricks; ++slot )
+      {
+      if ( changed[slot] )
+        {
+        std::copy( next.begin() + slot * brickPixels, next.begin() + ( slot + 1 ) * brickPixels,
+                   state.begin() + slot * brickPixels );
+        const unsigned char * classes = &state[slot * brickPixels];
+        hasBackground[slot] = std::find( classes, classes + brickPixels, Background ) !=
+          classes + brickPixels;
+        }
+      }
+    std::fill( active.begin(), active.end(), 0 );
+    for ( SizeValueType slot = 0; slot < numberOfBricks; ++slot )
+      {
+      if ( !changed[slot] )
+        {
+        continue;
+        }
+      const SizeValueType brick = brickOfSlot[slot];
+      const IndexValueType b[3] = {
+        static_cast< IndexValueType >( brick % numberOfBricksPerAxis[0] ),
+        static_cast< IndexValueType >( ( brick / numberOfBricksPerAxis[0] ) % numberOfBricksPerAxis[1] ),
+        static_cast< IndexValueType >( brick / ( numberOfBricksPerAxis[0] * numberOfBricksPerAxis[1] ) ) };
+      for ( IndexValueType z = std::max< IndexValueType >( 0, b[2] - reach[2] );
+            z <= std::min< IndexValueType >( numberOfBricksPerAxis[2] - 1, b[2] + reach[2] ); ++z )
+        {
+        for ( IndexValueType y = std::max< IndexValueType >( 0, b[1] - reach[1] );
+              y <= std::min< IndexValueType >( numberOfBricksPerAxis[1] - 1, b[1] + reach[1] ); ++y )
+          {
+          for ( IndexValueType x = std::max< IndexValueType >( 0, b[0] - reach[0] );
+                x <= std::min< IndexValueType >( numberOfBricksPerAxis[0] - 1, b[0] + reach[0] ); ++x )
+            {
+            const SizeValueType neighbour =
+              slotOfBrick[x + numberOfBricksPerAxis[0] * ( y + numberOfBricksPerAxis[1] * z )];
+            active[neighbour] = hasBackground[neighbour];
+            }
+          }
+        }
+      }
+
+    this->UpdateProgress( static_cast< float >( this->m_NumberOfIterationsRun ) /
+                          static_cast< float >( maximumNumberOfIterations ) );
+    }
+
+  // The input, with the filled pixels set to the foreground.
+  auto writeBrick = [&]( SizeValueType slot, ThreadIdType )
+    {
+    const unsigned char * classes = &state[slot * brickPixels];
+    auto writeLine = [&]( const IndexType & lineStart, SizeValueType n )
+      {
+      const PixelType * in = input->GetBufferPointer() + input->ComputeOffset( lineStart );
+      PixelType * out = output->GetBufferPointer() + output->ComputeOffset( lineStart );
+      const unsigned char * c = classes + offsetInBrick( lineStart );
+      for ( SizeValueType x = 0; x < n; ++x )
+        {
+        out[x] = c[x] == Foreground ? foreground : in[x];
+        }
+      };
+    ForEachRegionLine( brickRegionOfSlot( slot ), writeLine );
+    };
+  ParallelForEachBlock( numberOfBricks, writeBrick );
+}
+
+
+/*
+ * PrintSelf
+ */
+template< typename TImage >
+void
+BrickedVotingBinaryIterativeHoleFillingImageFilter< TImage >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "NumberOfIterationsRun: " << this->m_NumberOfIterationsRun << std::endl;
+  os << indent << "NumberOfPixelsFilled: " << this->m_NumberOfPixelsFilled << std::endl;
+}
+
+} // end namespace itk
+
+#endif
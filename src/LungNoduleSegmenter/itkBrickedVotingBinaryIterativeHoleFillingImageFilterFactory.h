@@ -0,0 +1,100 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkBrickedVotingBinaryIterativeHoleFillingImageFilterFactory.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkBrickedVotingBinaryIterativeHoleFillingImageFilterFactory_h
+#define itkBrickedVotingBinaryIterativeHoleFillingImageFilterFactory_h
+
+#include "itkObjectFactoryBase.h"
+#include "itkCreateObjectFunction.h"
+#include "itkVersion.h"
+#include "itkImage.h"
+#include "itkBrickedVotingBinaryIterativeHoleFillingImageFilter.h"
+#include <typeinfo>
+
+namespace itk
+{
+
+/** \class BrickedVotingBinaryIterativeHoleFillingImageFilterFactory
+ * \brief Object factory that substitutes
+ * BrickedVotingBinaryIterativeHoleFillingImageFilter for
+ * VotingBinaryIterativeHoleFillingImageFilter.
+ *
+ * Once registered, every VotingBinaryIterativeHoleFillingImageFilter::New()
+ * for one of the 3D image types below returns the bricked implementation.
+ * This reaches the hole filling of the lung mask inside the toolkit's lung
+ * wall feature generator without modifying it.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+class BrickedVotingBinaryIterativeHoleFillingImageFilterFactory : public ObjectFactoryBase
+{
+public:
+  typedef BrickedVotingBinaryIterativeHoleFillingImageFilterFactory Self;
+  typedef ObjectFactoryBase                          Superclass;
+  typedef SmartPointer< Self >                       Pointer;
+  typedef SmartPointer< const Self >                 ConstPointer;
+
+  const char * GetITKSourceVersion() const override
+    {
+    return ITK_SOURCE_VERSION;
+    }
+
+  const char * GetDescription() const override
+    {
+    return "Bricked VotingBinaryIterativeHoleFillingImageFilter";
+    }
+
+  /** Method for class instantiation. */
+  itkFactorylessNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(BrickedVotingBinaryIterativeHoleFillingImageFilterFactory, ObjectFactoryBase);
+
+  /** Register one factory of this type */
+  static void RegisterOneFactory()
+    {
+    Pointer factory = Self::New();
+    ObjectFactoryBase::RegisterFactory(factory);
+    }
+
+protected:
+  BrickedVotingBinaryIterativeHoleFillingImageFilterFactory()
+    {
+    this->OverrideFilterType< unsigned char >();
+    this->OverrideFilterType< short >();
+    this->OverrideFilterType< float >();
+    }
+
+  template< typename TPixel >
+  void OverrideFilterType()
+    {
+    typedef Image< TPixel, 3 >                                          ImageType;
+    typedef VotingBinaryIterativeHoleFillingImageFilter< ImageType >    BaseFilterType;
+    typedef BrickedVotingBinaryIterativeHoleFillingImageFilter< ImageType > BrickedFilterType;
+    this->RegisterOverride( typeid( BaseFilterType ).name(),
+                            typeid( BrickedFilterType ).name(),
+                            "Bricked VotingBinaryIterativeHoleFillingImageFilter override",
+                            true,
+                            CreateObjectFunction< BrickedFilterType >::New() );
+    }
+
+private:
+  ITK_DISALLOW_COPY_AND_ASSIGN(BrickedVotingBinaryIterativeHoleFillingImageFilterFactory);
+};
+
+} // end namespace itk
+
+#endif
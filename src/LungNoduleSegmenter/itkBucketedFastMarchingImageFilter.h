@@ -0,0 +1,146 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkBucketedFastMarchingImageFilter.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkBucketedFastMarchingImageFilter_h
+#define itkBucketedFastMarchingImageFilter_h
+
+#include "itkFastMarchingImageFilter.h"
+#include <vector>
+
+namespace itk
+{
+
+/** \class BucketedFastMarchingImageFilter
+ * \brief FastMarchingImageFilter with an untidy bucket priority queue.
+ *
+ * The front is ordered by an array of buckets of BucketWidth in time
+ * instead of a binary heap (Yatziv, Bartesaghi and Sapiro, "O(N)
+ * implementation of the fast marching algorithm", 2006): a trial point goes
+ * to the bucket of its time, in O(1), and the buckets are emptied in order,
+ * first in first out within each. The buckets span the times from the
+ * earliest trial point to the stopping value only, and points whose time is
+ * past the stopping value are written to the output but never queued, since
+ * the superclass would stop before reaching them. The entries are linear
+ * offsets into the output buffer, and the storage of emptied buckets is
+ * reused for the next ones, so the march allocates little after its start.
+ *
+ * The update of a point from its alive neighbours is that of the
+ * superclass. Within a bucket the points are not visited in order of time,
+ * so a point can become alive before a neighbour that is up to BucketWidth
+ * earlier, and miss its contribution. Left alone, such delays would add up
+ * along the front. Instead, whenever a point becomes alive its alive
+ * neighbours are solved again too, and those whose time decreases are
+ * reopened and queued in the current bucket (GetNumberOfReopenedPoints()).
+ * When the march ends, every alive time is then the solution of the upwind
+ * update from its final alive neighbours, the discrete equations the heap
+ * of the superclass solves in order: the times are those of the superclass
+ * up to rounding, whatever BucketWidth, which only trades buckets against
+ * reopenings. This follows from the update being monotone in the
+ * neighbouring times; it has not been measured, the two filters have not
+ * been compared on a seeded case.
+ *
+ * Trial and alive points, the speed image or constant, the normalization
+ * factor and the stopping value are honoured. OutsidePoints are not: the
+ * superclass keeps them private, so they are marched through like any
+ * other point. The label image of the superclass is not filled; when
+ * CollectPoints is on, the superclass' implementation is run instead.
+ *
+ * Since the class derives from FastMarchingImageFilter it can be used
+ * wherever that filter is, directly or through the object factory override
+ * installed by BucketedFastMarchingImageFilterFactory, which reaches the
+ * initialisation of the toolkit's segmentation module.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template< typename TLevelSet, typename TSpeedImage = Image< float, TLevelSet::ImageDimension > >
+class ITK_EXPORT BucketedFastMarchingImageFilter :
+  public FastMarchingImageFilter< TLevelSet, TSpeedImage >
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(BucketedFastMarchingImageFilter);
+
+  /** Standard class typedefs. */
+  typedef BucketedFastMarchingImageFilter                   Self;
+  typedef FastMarchingImageFilter< TLevelSet, TSpeedImage > Superclass;
+  typedef SmartPointer< Self >                              Pointer;
+  typedef SmartPointer< const Self >                        ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(BucketedFastMarchingImageFilter, FastMarchingImageFilter);
+
+  itkStaticConstMacro(SetDimension, unsigned int, TLevelSet::ImageDimension);
+
+  typedef typename Superclass::LevelSetImageType    LevelSetImageType;
+  typedef typename Superclass::SpeedImageType       SpeedImageType;
+  typedef typename Superclass::PixelType            PixelType;
+  typedef typename Superclass::IndexType            IndexType;
+  typedef typename Superclass::NodeContainer        NodeContainer;
+  typedef typename LevelSetImageType::RegionType    RegionType;
+
+  /** Width in time of the buckets. Smaller is closer to the superclass and
+   * uses more buckets. Defaults to 0.01. */
+  itkSetClampMacro( BucketWidth, double, NumericTraits< double >::min(), NumericTraits< double >::max() );
+  itkGetConstMacro( BucketWidth, double );
+
+  /** Number of points made alive by the last update. */
+  itkGetConstMacro( NumberOfAlivePoints, SizeValueType );
+
+  /** Number of times the last update reopened an alive point whose time
+   * decreased. */
+  itkGetConstMacro( NumberOfReopenedPoints, SizeValueType );
+
+protected:
+  BucketedFastMarchingImageFilter();
+  ~BucketedFastMarchingImageFilter() override {}
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  void GenerateData() override;
+
+private:
+  /** Points of the front are identified by their offset in the output. */
+  typedef OffsetValueType                 EntryType;
+  typedef std::vector< EntryType >        BucketType;
+
+  /** Status of the points of the output. The alive ones come last, so
+   * that ">= Alive" tests for both; the initial ones are never updated. */
+  enum { Far = 0, Trial = 1, InitialTrial = 2, Alive = 3, InitialAlive = 4 };
+
+  /** Time of the point at \a index from its alive neighbours, as computed
+   * by FastMarchingImageFilter::UpdateValue(). */
+  double SolveEikonal( const IndexType & index, OffsetValueType offset, double inverseSpeedSquared ) const;
+
+  double                        m_BucketWidth;
+  SizeValueType                 m_NumberOfAlivePoints;
+  SizeValueType                 m_NumberOfReopenedPoints;
+
+  // State of the current update.
+  RegionType                    m_Region;
+  const PixelType *             m_Times;
+  const unsigned char *         m_Status;
+  OffsetValueType               m_Strides[SetDimension];
+  double                        m_SpaceFactors[SetDimension];
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkBucketedFastMarchingImageFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,316 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkBucketedFastMarchingImageFilter.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkBucketedFastMarchingImageFilter_hxx
+#define itkBucketedFastMarchingImageFilter_hxx
+
+#include "itkBucketedFastMarchingImageFilter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template< typename TLevelSet, typename TSpeedImage >
+BucketedFastMarchingImageFilter< TLevelSet, TSpeedImage >
+::BucketedFastMarchingImageFilter() :
+  m_BucketWidth( 0.01 ),
+  m_NumberOfAlivePoints( 0 ),
+  m_NumberOfReopenedPoints( 0 ),
+  m_Times( nullptr ),
+  m_Status( nullptr )
+{
+}
+
+
+template< typename TLevelSet, typename TSpeedImage >
+double
+BucketedFastMarchingImageFilter< TLevelSet, TSpeedImage >
+::SolveEikonal( const IndexType & index, OffsetValueType offset, double inverseSpeedSquared ) const
+{
+  const double largeValue = static_cast< double >( NumericTraits< PixelType >::max() / 2.0 );
+
+  // Earliest alive neighbour along each axis, sorted by time.
+  double values[SetDimension];
+  unsigned int axes[SetDimension];
+  unsigned int numberOfValues = 0;
+  const IndexType & start = this->m_Region.GetIndex();
+  const typename RegionType::SizeType & size = this->m_Region.GetSize();
+  for ( unsigned int j = 0; j < SetDimension; ++j )
+    {
+    double best = largeValue;
+    if ( index[j] > start[j] )
+      {
+      const OffsetValueType neighbor = offset - this->m_Strides[j];
+      if ( this->m_Status[neighbor] >= Alive )
+        {
+        best = std::min( best, static_cast< double >( this->m_Times[neighbor] ) );
+        }
+      }
+    if ( index[j] + 1 < start[j] + static_cast< IndexValueType >( size[j] ) )
+      {
+      const OffsetValueType neighbor = offset + this->m_Strides[j];
+      if ( this->m_Status[neighbor] >= Alive )
+        {
+        best = std::min( best, static_cast< double >( this->m_Times[neighbor] ) );
+        }
+      }
+    if ( best < largeValue )
+      {
+      unsigned int k = numberOfValues++;
+      for ( ; k > 0 && values[k - 1] > best; --k )
+        {
+        values[k] = values[k - 1];
+        axes[k] = axes[k - 1];
+        }
+      values[k] = best;
+      axes[k] = j;
+      }
+    }
+
+  // Grow the quadratic one axis at a time, as long as the solution is not
+  // earlier than the next neighbour.
+  double solution = largeValue;
+  double aa = 0.0;
+  double bb = 0.0;
+  double cc = -inverseSpeedSquared;
+  for ( unsigned int k = 0; k < numberOfValues && solution >= values[k]; ++k )
+    {
+    const double spaceFactor = this->m_SpaceFactors[axes[k]];
+    aa += spaceFactor;
+    bb += values[k] * spaceFactor;
+    cc += values[k] * values[k] * spaceFactor;
+    const double discrim = bb * bb - aa * cc;
+    if ( discrim < 0.0 )
+      {
+      itkExceptionMacro( "Discriminant of quadratic equation is negative" );
+      }
+    solution = ( std::sqrt( discrim ) + bb ) / aa;
+    }
+  return solution;
+}
+
+
+template< typename TLevelSet, typename TSpeedImage >
+void
+BucketedFastMarchingImageFilter< TLevelSet, TSpeedImage >
+::GenerateData()
+{
+  this->m_NumberOfAlivePoints = 0;
+  this->m_NumberOfReopenedPoints = 0;
+  const NodeContainer * trialPoints = this->GetTrialPoints();
+  const NodeContainer * alivePoints = this->GetAlivePoints();
+  const double stoppingValue = this->GetStoppingValue();
+
+  // The buckets span the trial times up to the stopping value. Without a
+  // stopping value, or when it is too far for the bucket width, the heap
+  // of the superclass is the better choice.
+  double base = NumericTraits< double >::max();
+  if ( trialPoints )
+    {
+    for ( typename NodeContainer::ConstIterator it = trialPoints->Begin(); it != trialPoints->End(); ++it )
+      {
+      base = std::min( base, static_cast< double >( it.Value().GetValue() ) );
+      }
+    }
+  LevelSetImageType * output = this->GetOutput();
+  const double span = base <= stoppingValue ? ( stoppingValue - base ) / this->m_BucketWidth : 0.0;
+  if ( this->GetCollectPoints() ||
+       span > static_cast< double >( output->GetRequestedRegion().GetNumberOfPixels() ) )
+    {
+    Superclass::GenerateData();
+    return;
+    }
+
+  const SpeedImageType * speedImage = this->GetInput();
+  const PixelType largeValue = static_cast< PixelType >( NumericTraits< PixelType >::max() / 2.0 );
+
+  output->SetBufferedRegion( output->GetRequestedRegion() );
+  output->Allocate();
+  output->FillBuffer( largeValue );
+  this->m_Region = output->GetBufferedRegion();
+  PixelType * times = output->GetBufferPointer();
+  std::vector< unsigned char > status( this->m_Region.GetNumberOfPixels(), Far );
+  this->m_Times = times;
+  this->m_Status = status.data();
+  for ( unsigned int j = 0; j < SetDimension; ++j )
+    {
+    this->m_Strides[j] = output->GetOffsetTable()[j];
+    this->m_SpaceFactors[j] = 1.0 / ( output->GetSpacing()[j] * output->GetSpacing()[j] );
+    }
+
+  if ( alivePoints )
+    {
+    for ( typename NodeContainer::ConstIterator it = alivePoints->Begin(); it != alivePoints->End(); ++it )
+      {
+      if ( this->m_Region.IsInside( it.Value().GetIndex() ) )
+        {
+        const OffsetValueType offset = output->ComputeOffset( it.Value().GetIndex() );
+        times[offset] = it.Value().GetValue();
+        status[offset] = InitialAlive;
+        }
+      }
+    }
+
+  // Initial trial points keep their time until they become alive, as in
+  // the superclass.
+  const SizeValueType numberOfBuckets = static_cast< SizeValueType >( span ) + 1;
+  std::vector< BucketType > buckets( numberOfBuckets );
+  std::vector< BucketType > spares;
+  if ( trialPoints )
+    {
+    buckets[0].reserve( trialPoints->Size() );
+    for ( typename NodeContainer::ConstIterator it = trialPoints->Begin(); it != trialPoints->End(); ++it )
+      {
+      if ( !this->m_Region.IsInside( it.Value().GetIndex() ) )
+        {
+        continue;
+        }
+      const OffsetValueType offset = output->ComputeOffset( it.Value().GetIndex() );
+      if ( status[offset] == InitialAlive )
+        {
+        continue;
+        }
+      const double value = it.Value().GetValue();
+      times[offset] = static_cast< PixelType >( value );
+      status[offset] = InitialTrial;
+      if ( value <= stoppingValue )
+        {
+        const SizeValueType b = std::min( numberOfBuckets - 1,
+          static_cast< SizeValueType >( ( value - base ) / this->m_BucketWidth ) );
+        buckets[b].push_back( offset );
+        }
+      }
+    }
+
+  double inverseSpeedSquared = 1.0 / ( this->GetSpeedConstant() * this->GetSpeedConstant() );
+  const double normalizationFactor = this->GetNormalizationFactor();
+  const IndexType & start = this->m_Region.GetIndex();
+  const typename RegionType::SizeType & size = this->m_Region.GetSize();
+
+  this->UpdateProgress( 0.0 );
+  const SizeValueType progressStep = std::max< SizeValueType >( 1, numberOfBuckets / 100 );
+  for ( SizeValueType b = 0; b < numberOfBuckets && !this->GetAbortGenerateData(); ++b )
+    {
+    // The bucket grows while it is emptied: points that get a time within
+    // it are appended and visited in turn.
+    for ( SizeValueType e = 0; e < buckets[b].size(); ++e )
+      {
+      const OffsetValueType offset = buckets[b][e];
+      if ( status[offset] >= Alive )
+        {
+        continue;
+        }
+      status[offset] = status[offset] == InitialTrial ? InitialAlive : Alive;
+      ++this->m_NumberOfAlivePoints;
+
+      const IndexType index = output->ComputeIndex( offset );
+      for ( unsigned int j = 0; j < SetDimension; ++j )
+        {
+        for ( int side = -1; side <= 1; side += 2 )
+          {
+          const IndexValueType neighborIndex = index[j] + side;
+          if ( neighborIndex < start[j] ||
+               neighborIndex >= start[j] + static_cast< IndexValueType >( size[j] ) )
+            {
+            continue;
+            }
+          const OffsetValueType neighbor = offset + side * this->m_Strides[j];
+          if ( status[neighbor] == InitialTrial || status[neighbor] == InitialAlive )
+            {
+            continue;
+            }
+
+          IndexType neighborIdx = index;
+          neighborIdx[j] = neighborIndex;
+          if ( speedImage )
+            {
+            const double speed = static_cast< double >( speedImage->GetPixel( neighborIdx ) ) /
+              normalizationFactor;
+            inverseSpeedSquared = 1.0 / ( speed * speed );
+            }
+          const double solution = this->SolveEikonal( neighborIdx, neighbor, inverseSpeedSquared );
+          if ( !( solution < static_cast< double >( largeValue ) ) )
+            {
+            continue;
+            }
+
+          // A point made alive before a neighbour that turned out earlier
+          // is reopened if its time decreases, so that the delay does not
+          // carry on along the front. Times only decrease, so this ends.
+          if ( status[neighbor] == Alive )
+            {
+            if ( !( static_cast< PixelType >( solution ) < times[neighbor] ) )
+              {
+              continue;
+              }
+            --this->m_NumberOfAlivePoints;
+            ++this->m_NumberOfReopenedPoints;
+            }
+          times[neighbor] = static_cast< PixelType >( solution );
+          status[neighbor] = Trial;
+
+          // Points past the stopping value would never become alive.
+          if ( solution <= stoppingValue )
+            {
+            const SizeValueType target = std::min( numberOfBuckets - 1, std::max( b,
+              static_cast< SizeValueType >( ( solution - base ) / this->m_BucketWidth ) ) );
+            BucketType & bucket = buckets[target];
+            if ( bucket.capacity() == 0 && !spares.empty() )
+              {
+              bucket.swap( spares.back() );
+              spares.pop_back();
+              }
+            bucket.push_back( neighbor );
+            }
+          }
+        }
+      }
+
+    // Hand the storage of the bucket over to the next ones.
+    buckets[b].clear();
+    spares.push_back( BucketType() );
+    spares.back().swap( buckets[b] );
+
+    if ( ( b + 1 ) % progressStep == 0 )
+      {
+      this->UpdateProgress( static_cast< float >( b + 1 ) / numberOfBuckets );
+      }
+    }
+  this->UpdateProgress( 1.0 );
+
+  this->m_Times = nullptr;
+  this->m_Status = nullptr;
+}
+
+
+template< typename TLevelSet, typename TSpeedImage >
+void
+BucketedFastMarchingImageFilter< TLevelSet, TSpeedImage >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "BucketWidth: " << this->m_BucketWidth << std::endl;
+  os << indent << "NumberOfAlivePoints: " << this->m_NumberOfAlivePoints << std::endl;
+  os << indent << "NumberOfReopenedPoints: " << this->m_NumberOfReopenedPoints << std::endl;
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,92 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkBucketedFastMarchingImageFilterFactory.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkBucketedFastMarchingImageFilterFactory_h
+#define itkBucketedFastMarchingImageFilterFactory_h
+
+#include "itkObjectFactoryBase.h"
+#include "itkCreateObjectFunction.h"
+#include "itkVersion.h"
+#include "itkImage.h"
+#include "itkBucketedFastMarchingImageFilter.h"
+#include <typeinfo>
+
+namespace itk
+{
+
+/** \class BucketedFastMarchingImageFilterFactory
+ * \brief Object factory that substitutes BucketedFastMarchingImageFilter
+ * for FastMarchingImageFilter.
+ *
+ * Once registered, every FastMarchingImageFilter::New() on 3D float images
+ * returns the bucketed implementation. This reaches the initialisation of
+ * the level set inside the toolkit's
+ * FastMarchingAndGeodesicActiveContourLevelSetSegmentationModule without
+ * modifying it.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+class BucketedFastMarchingImageFilterFactory : public ObjectFactoryBase
+{
+public:
+  typedef BucketedFastMarchingImageFilterFactory Self;
+  typedef ObjectFactoryBase                          Superclass;
+  typedef SmartPointer< Self >                       Pointer;
+  typedef SmartPointer< const Self >                 ConstPointer;
+
+  const char * GetITKSourceVersion() const override
+    {
+    return ITK_SOURCE_VERSION;
+    }
+
+  const char * GetDescription() const override
+    {
+    return "Bucketed FastMarchingImageFilter";
+    }
+
+  /** Method for class instantiation. */
+  itkFactorylessNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(BucketedFastMarchingImageFilterFactory, ObjectFactoryBase);
+
+  /** Register one factory of this type */
+  static void RegisterOneFactory()
+    {
+    Pointer factory = Self::New();
+    ObjectFactoryBase::RegisterFactory(factory);
+    }
+
+protected:
+  BucketedFastMarchingImageFilterFactory()
+    {
+    typedef Image< float, 3 >                                     ImageType;
+    typedef FastMarchingImageFilter< ImageType, ImageType >       BaseFilterType;
+    typedef BucketedFastMarchingImageFilter< ImageType, ImageType > BucketedFilterType;
+    this->RegisterOverride( typeid( BaseFilterType ).name(),
+                            typeid( BucketedFilterType ).name(),
+                            "Bucketed FastMarchingImageFilter override",
+                            true,
+                            CreateObjectFunction< BucketedFilterType >::New() );
+    }
+
+private:
+  ITK_DISALLOW_COPY_AND_ASSIGN(BucketedFastMarchingImageFilterFactory);
+};
+
+} // end namespace itk
+
+#endif
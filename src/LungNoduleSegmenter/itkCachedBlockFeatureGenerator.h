@@ -0,0 +1,113 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkCachedBlockFeatureGenerator.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkCachedBlockFeatureGenerator_h
+#define itkCachedBlockFeatureGenerator_h
+
+#include "itkBlockFeatureGenerator.h"
+#include "itkSparseBrickImage.h"
+#include "itkContinuousIndex.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace itk
+{
+
+/** \class CachedBlockFeatureGenerator
+ * \brief Feature read from a precomputed cache, evaluated block by block.
+ *
+ * The CachedFeature holds a feature in [0,1] as 16 bit fixed point codes
+ * (value * 65535, rounded), on any grid, typically the study grid, in a
+ * SparseBrickImage: bricks where the feature is uniformly its background
+ * take no memory. Each block is filled by linear interpolation of the cache
+ * at the physical positions of the block voxels; positions outside the
+ * buffered region of the cache get OutsideValue. As a BlockFeatureGenerator the feature can be
+ * folded in brick by brick, or lazily tile by tile, by the streaming
+ * aggregators.
+ *
+ * \ingroup SpatialObjectFilters
+ * \ingroup LesionSizingToolkit
+ */
+template <unsigned int NDimension>
+class ITK_EXPORT CachedBlockFeatureGenerator : public BlockFeatureGenerator<NDimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(CachedBlockFeatureGenerator);
+
+  /** Standard class typedefs. */
+  typedef CachedBlockFeatureGenerator       Self;
+  typedef BlockFeatureGenerator<NDimension> Superclass;
+  typedef SmartPointer<Self>                Pointer;
+  typedef SmartPointer<const Self>          ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(CachedBlockFeatureGenerator, BlockFeatureGenerator);
+
+  typedef typename Superclass::InputImageType   InputImageType;
+  typedef typename Superclass::OutputImageType  OutputImageType;
+  typedef typename Superclass::OutputPixelType  OutputPixelType;
+  typedef typename Superclass::RegionType       RegionType;
+
+  typedef std::uint16_t                                 CachePixelType;
+  typedef SparseBrickImage< CachePixelType, NDimension > CacheImageType;
+
+  /** Code of a feature value in the cache. */
+  static CachePixelType Encode( double value )
+    {
+    // Written so that NaN encodes as 0.
+    const double v = value > 0.0 ? std::min( value, 1.0 ) : 0.0;
+    return static_cast< CachePixelType >( v * 65535.0 + 0.5 );
+    }
+
+  /** The cached feature codes. */
+  void SetCachedFeature( const CacheImageType * cache );
+  itkGetConstObjectMacro( CachedFeature, CacheImageType );
+
+  /** Feature outside the cache. Defaults to 1. */
+  itkSetMacro( OutsideValue, double );
+  itkGetMacro( OutsideValue, double );
+
+  void GenerateBlock( const InputImageType * input,
+                      const RegionType & region,
+                      OutputImageType * output ) const override;
+
+protected:
+  CachedBlockFeatureGenerator();
+  ~CachedBlockFeatureGenerator() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+private:
+  typedef ContinuousIndex< double, NDimension > ContinuousIndexType;
+
+  /** Linear interpolation of the codes at \a index, which must be within
+   * half a voxel of the buffered region. Beyond the first and last voxel
+   * the value is constant. */
+  double InterpolateCode( const ContinuousIndexType & index ) const;
+
+  typename CacheImageType::ConstPointer   m_CachedFeature;
+  double                                  m_OutsideValue;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkCachedBlockFeatureGenerator.hxx"
+#endif
+
+#endif
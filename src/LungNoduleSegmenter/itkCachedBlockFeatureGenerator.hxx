@@ -0,0 +1,213 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkCachedBlockFeatureGenerator.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkCachedBlockFeatureGenerator_hxx
+#define itkCachedBlockFeatureGenerator_hxx
+
+#include "itkCachedBlockFeatureGenerator.h"
+#include "itkParallelForEachBlock.h"
+#include "itkMath.h"
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template <unsigned int NDimension>
+CachedBlockFeatureGenerator<NDimension>
+::CachedBlockFeatureGenerator()
+{
+  this->m_OutsideValue = 1.0;
+}
+
+
+/*
+ * Destructor
+ */
+template <unsigned int NDimension>
+CachedBlockFeatureGenerator<NDimension>
+::~CachedBlockFeatureGenerator()
+{
+}
+
+
+template <unsigned int NDimension>
+void
+CachedBlockFeatureGenerator<NDimension>
+::SetCachedFeature( const CacheImageType * cache )
+{
+  if ( this->m_CachedFeature != cache )
+    {
+    this->m_CachedFeature = cache;
+    this->Modified();
+    }
+}
+
+
+/*
+ * PrintSelf
+ */
+template <unsigned int NDimension>
+void
+CachedBlockFeatureGenerator<NDimension>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "Cached feature " << this->m_CachedFeature.GetPointer() << std::endl;
+  if ( this->m_CachedFeature )
+    {
+    os << indent << "Cached feature bytes "
+       << this->m_CachedFeature->GetNumberOfAllocatedBytes() << std::endl;
+    }
+  os << indent << "Outside value " << this->m_OutsideValue << std::endl;
+}
+
+
+template <unsigned int NDimension>
+double
+CachedBlockFeatureGenerator<NDimension>
+::InterpolateCode( const ContinuousIndexType & index ) const
+{
+  typedef typename CacheImageType::IndexType   IndexType;
+
+  const CacheImageType * cache = this->m_CachedFeature;
+  const IndexType first = cache->GetBufferedRegion().GetIndex();
+  const IndexType last = cache->GetBufferedRegion().GetUpperIndex();
+
+  // Lower corner and weight of the upper corner, per axis.
+  IndexType base;
+  double weight[NDimension];
+  for ( unsigned int i = 0; i < NDimension; ++i )
+    {
+    base[i] = Math::Floor< IndexValueType >( index[i] );
+    weight[i] = index[i] - static_cast< double >( base[i] );
+    if ( base[i] < first[i] )
+      {
+      base[i] = first[i];
+      weight[i] = 0.0;
+      }
+    else if ( base[i] >= last[i] )
+      {
+      base[i] = last[i];
+      weight[i] = 0.0;
+      }
+    }
+
+  double value = 0.0;
+  for ( unsigned int corner = 0; corner < ( 1u << NDimension ); ++corner )
+    {
+    IndexType neighbour = base;
+    double w = 1.0;
+    for ( unsigned int i = 0; i < NDimension; ++i )
+      {
+      if ( corner & ( 1u << i ) )
+        {
+        ++neighbour[i];
+        w *= weight[i];
+        }
+      else
+        {
+        w *= 1.0 - weight[i];
+        }
+      }
+    if ( w != 0.0 )
+      {
+      value += w * cache->GetPixel( neighbour );
+      }
+    }
+  return value;
+}
+
+
+template <unsigned int NDimension>
+void
+CachedBlockFeatureGenerator<NDimension>
+::GenerateBlock( const InputImageType *,
+                 const RegionType & region,
+                 OutputImageType * output ) const
+{
+  if ( !this->m_CachedFeature )
+    {
+    itkExceptionMacro("Missing cached feature");
+    }
+
+  typedef typename OutputImageType::IndexType   IndexType;
+  typedef typename OutputImageType::PointType   PointType;
+
+  // Both index to point mappings are affine, so the continuous index in the
+  // cache is the one of the region start plus a fixed step per output axis.
+  const IndexType origin = region.GetIndex();
+  PointType point;
+  output->TransformIndexToPhysicalPoint( origin, point );
+  ContinuousIndexType start;
+  this->m_CachedFeature->TransformPhysicalPointToContinuousIndex( point, start );
+  ContinuousIndexType step[NDimension];
+  for ( unsigned int i = 0; i < NDimension; ++i )
+    {
+    IndexType next = origin;
+    ++next[i];
+    output->TransformIndexToPhysicalPoint( next, point );
+    this->m_CachedFeature->TransformPhysicalPointToContinuousIndex( point, step[i] );
+    for ( unsigned int j = 0; j < NDimension; ++j )
+      {
+      step[i][j] -= start[j];
+      }
+    }
+
+  const double scale = 1.0 / 65535.0;
+  const OutputPixelType outside = static_cast< OutputPixelType >( this->m_OutsideValue );
+  ContinuousIndexType lower;
+  ContinuousIndexType upper;
+  for ( unsigned int i = 0; i < NDimension; ++i )
+    {
+    lower[i] = this->m_CachedFeature->GetBufferedRegion().GetIndex()[i] - 0.5;
+    upper[i] = this->m_CachedFeature->GetBufferedRegion().GetUpperIndex()[i] + 0.5;
+    }
+  auto interpolateLine = [&]( const IndexType & lineStart, SizeValueType n )
+    {
+    ContinuousIndexType ci = start;
+    for ( unsigned int i = 1; i < NDimension; ++i )
+      {
+      const double offset = static_cast< double >( lineStart[i] - origin[i] );
+      for ( unsigned int j = 0; j < NDimension; ++j )
+        {
+        ci[j] += offset * step[i][j];
+        }
+      }
+    OutputPixelType * out = output->GetBufferPointer() + output->ComputeOffset( lineStart );
+    for ( SizeValueType x = 0; x < n; ++x )
+      {
+      bool inside = true;
+      for ( unsigned int j = 0; j < NDimension; ++j )
+        {
+        inside = inside && ci[j] >= lower[j] && ci[j] < upper[j];
+        }
+      out[x] = inside
+        ? static_cast< OutputPixelType >( this->InterpolateCode( ci ) * scale )
+        : outside;
+      for ( unsigned int j = 0; j < NDimension; ++j )
+        {
+        ci[j] += step[0][j];
+        }
+      }
+    };
+  ForEachRegionLine( region, interpolateLine );
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,165 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkFusedCannyEdgesFeatureGenerator.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkFusedCannyEdgesFeatureGenerator_h
+#define itkFusedCannyEdgesFeatureGenerator_h
+
+#include "itkFeatureGenerator.h"
+#include "itkImage.h"
+#include "itkImageSpatialObject.h"
+#include "itkFixedArray.h"
+#include <vector>
+
+namespace itk
+{
+
+/** \class FusedCannyEdgesFeatureGenerator
+ * \brief Canny edges feature computed with fused passes.
+ *
+ * Computes the same kind of feature as CannyEdgesFeatureGenerator: Canny
+ * edges of the input smoothed by a Gaussian of SigmaArray, followed by a
+ * distance-to-edge map windowed to [0,1]. The edge detection follows
+ * CannyEdgeDetectionImageFilter: an edge candidate is a zero crossing of the
+ * second derivative along the gradient where the gradient magnitude is a
+ * maximum, weighted by the gradient magnitude, and hysteresis keeps the
+ * candidates above LowerThreshold that are connected (26-connectivity) to a
+ * candidate above UpperThreshold.
+ *
+ * The work is organised differently:
+ *  - Smoothing uses the lane-parallel recursive Gaussian.
+ *  - The second directional derivative, gradient magnitude, zero crossing
+ *    and non-maximum test are fused in one slab-parallel pass. Each slab
+ *    computes its second derivative slices locally, with a one slice halo,
+ *    and writes only a one byte class per voxel (none, weak, strong).
+ *  - Hysteresis is a union-find over the weak and strong voxels. Slabs are
+ *    labelled in parallel, the slab seams are merged in order, and a
+ *    component is an edge if it holds a strong voxel. Roots are always the
+ *    smallest voxel index of their component, so the result does not depend
+ *    on the number of threads.
+ *
+ * The edge map is then turned into the feature by a signed Maurer distance
+ * map in physical units, windowed linearly from [0, DistanceWindowMaximum]
+ * to [0,1]. Only 3D images are supported.
+ *
+ * \ingroup SpatialObjectFilters
+ * \ingroup LesionSizingToolkit
+ */
+template <unsigned int NDimension>
+class ITK_EXPORT FusedCannyEdgesFeatureGenerator : public FeatureGenerator<NDimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(FusedCannyEdgesFeatureGenerator);
+
+  static_assert( NDimension == 3, "FusedCannyEdgesFeatureGenerator only supports 3D images" );
+
+  /** Standard class typedefs. */
+  typedef FusedCannyEdgesFeatureGenerator   Self;
+  typedef FeatureGenerator<NDimension>      Superclass;
+  typedef SmartPointer<Self>                Pointer;
+  typedef SmartPointer<const Self>          ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(FusedCannyEdgesFeatureGenerator, FeatureGenerator);
+
+  /** Dimension of the space */
+  itkStaticConstMacro(Dimension, unsigned int, NDimension);
+
+  /** Type of spatialObject that will be passed as input to this
+   * feature generator. */
+  typedef signed short                                          InputPixelType;
+  typedef Image< InputPixelType, Dimension >                    InputImageType;
+  typedef ImageSpatialObject< NDimension, InputPixelType >      InputImageSpatialObjectType;
+  typedef typename Superclass::SpatialObjectType                SpatialObjectType;
+
+  typedef float                                                 InternalPixelType;
+  typedef Image< InternalPixelType, Dimension >                 InternalImageType;
+
+  typedef float                                                 OutputPixelType;
+  typedef Image< OutputPixelType, Dimension >                   OutputImageType;
+  typedef ImageSpatialObject< NDimension, OutputPixelType >     OutputImageSpatialObjectType;
+
+  typedef FixedArray< double, Dimension >                       SigmaArrayType;
+
+  /** Input data that will be used for generating the feature. */
+  using ProcessObject::SetInput;
+  void SetInput( const SpatialObjectType * input );
+
+  /** Output data that carries the feature in the form of a
+   * SpatialObject. */
+  const SpatialObjectType * GetFeature() const;
+
+  /** Sigma of the Gaussian smoothing, in physical units, for all axes. */
+  void SetSigma( double sigma );
+
+  /** Sigma of the Gaussian smoothing, in physical units, per axis. */
+  itkSetMacro( SigmaArray, SigmaArrayType );
+  itkGetConstReferenceMacro( SigmaArray, SigmaArrayType );
+
+  /** Upper threshold of the hysteresis (strong edges). */
+  itkSetMacro( UpperThreshold, double );
+  itkGetMacro( UpperThreshold, double );
+
+  /** Lower threshold of the hysteresis (weak edges). */
+  itkSetMacro( LowerThreshold, double );
+  itkGetMacro( LowerThreshold, double );
+
+  /** Distance to the edges, in physical units, mapped to a feature of 1.
+   * Distances are windowed linearly from [0, DistanceWindowMaximum] to
+   * [0, 1]. Defaults to 5. */
+  itkSetMacro( DistanceWindowMaximum, double );
+  itkGetMacro( DistanceWindowMaximum, double );
+
+  /** Thickness (in slices) of the slabs processed in parallel. */
+  itkSetMacro( NumberOfSlicesPerBlock, unsigned int );
+  itkGetMacro( NumberOfSlicesPerBlock, unsigned int );
+
+protected:
+  FusedCannyEdgesFeatureGenerator();
+  ~FusedCannyEdgesFeatureGenerator() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  void GenerateData() override;
+
+  /** Classification of a voxel before hysteresis. */
+  enum EdgeClassType { NotEdge = 0, WeakEdge = 1, StrongEdge = 2 };
+
+  /** Differentiate and classify every voxel of \a smoothed. */
+  void ClassifyEdgeCandidates( const InternalImageType * smoothed,
+                               std::vector< unsigned char > & classes ) const;
+
+  /** Resolve the hysteresis and write 1 on edges, 0 elsewhere. */
+  void ResolveHysteresis( const typename InternalImageType::SizeType & size,
+                          std::vector< unsigned char > & classes,
+                          InternalImageType * edges ) const;
+
+private:
+  SigmaArrayType  m_SigmaArray;
+  double          m_UpperThreshold;
+  double          m_LowerThreshold;
+  double          m_DistanceWindowMaximum;
+  unsigned int    m_NumberOfSlicesPerBlock;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkFusedCannyEdgesFeatureGenerator.hxx"
+#endif
+
+#endif
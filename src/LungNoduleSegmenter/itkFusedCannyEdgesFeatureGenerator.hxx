@@ -0,0 +1,532 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkFusedCannyEdgesFeatureGenerator.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkFusedCannyEdgesFeatureGenerator_hxx
+#define itkFusedCannyEdgesFeatureGenerator_hxx
+
+#include "itkFusedCannyEdgesFeatureGenerator.h"
+#include "itkBlockedRecursiveGaussianImageFilter.h"
+#include "itkCastImageFilter.h"
+#include "itkSignedMaurerDistanceMapImageFilter.h"
+#include "itkIntensityWindowingImageFilter.h"
+#include "itkParallelForEachBlock.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template <unsigned int NDimension>
+FusedCannyEdgesFeatureGenerator<NDimension>
+::FusedCannyEdgesFeatureGenerator()
+{
+  this->SetNumberOfRequiredInputs( 1 );
+  this->SetNumberOfRequiredOutputs( 1 );
+
+  typename OutputImageSpatialObjectType::Pointer outputObject = OutputImageSpatialObjectType::New();
+
+  this->ProcessObject::SetNthOutput( 0, outputObject.GetPointer() );
+
+  this->m_SigmaArray.Fill( 1.0 );
+  this->m_UpperThreshold = NumericTraits< InternalPixelType >::max();
+  this->m_LowerThreshold = NumericTraits< InternalPixelType >::NonpositiveMin();
+  this->m_DistanceWindowMaximum = 5.0;
+  this->m_NumberOfSlicesPerBlock = 8;
+}
+
+
+/*
+ * Destructor
+ */
+template <unsigned int NDimension>
+FusedCannyEdgesFeatureGenerator<NDimension>
+::~FusedCannyEdgesFeatureGenerator()
+{
+}
+
+template <unsigned int NDimension>
+void
+FusedCannyEdgesFeatureGenerator<NDimension>
+::SetInput( const SpatialObjectType * spatialObject )
+{
+  // Process object is not const-correct so the const casting is required.
+  this->SetNthInput(0, const_cast<SpatialObjectType *>( spatialObject ));
+}
+
+template <unsigned int NDimension>
+const typename FusedCannyEdgesFeatureGenerator<NDimension>::SpatialObjectType *
+FusedCannyEdgesFeatureGenerator<NDimension>
+::GetFeature() const
+{
+  if (this->GetNumberOfOutputs() < 1)
+    {
+    return nullptr;
+    }
+
+  return static_cast<const SpatialObjectType*>(this->ProcessObject::GetOutput(0));
+}
+
+template <unsigned int NDimension>
+void
+FusedCannyEdgesFeatureGenerator<NDimension>
+::SetSigma( double sigma )
+{
+  SigmaArrayType sigmas;
+  sigmas.Fill( sigma );
+  this->SetSigmaArray( sigmas );
+}
+
+
+/*
+ * PrintSelf
+ */
+template <unsigned int NDimension>
+void
+FusedCannyEdgesFeatureGenerator<NDimension>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "Sigma " << this->m_SigmaArray << std::endl;
+  os << indent << "Upper threshold " << this->m_UpperThreshold << std::endl;
+  os << indent << "Lower threshold " << this->m_LowerThreshold << std::endl;
+  os << indent << "Distance window maximum " << this->m_DistanceWindowMaximum << std::endl;
+  os << indent << "Slices per block " << this->m_NumberOfSlicesPerBlock << std::endl;
+}
+
+
+/*
+ * Generate Data
+ */
+template <unsigned int NDimension>
+void
+FusedCannyEdgesFeatureGenerator<NDimension>
+::GenerateData()
+{
+  const InputImageSpatialObjectType * inputObject =
+    dynamic_cast<const InputImageSpatialObjectType * >( this->ProcessObject::GetInput(0) );
+
+  if( !inputObject )
+    {
+    itkExceptionMacro("Missing input spatial object");
+    }
+
+  const InputImageType * inputImage = inputObject->GetImage();
+
+  if( !inputImage )
+    {
+    itkExceptionMacro("Missing input image");
+    }
+
+  // Gaussian smoothing, one axis at a time, in place after the cast.
+  typedef CastImageFilter< InputImageType, InternalImageType >  CastFilterType;
+  typedef BlockedRecursiveGaussianImageFilter<
+    InternalImageType, InternalImageType >                      GaussianFilterType;
+
+  typename CastFilterType::Pointer cast = CastFilterType::New();
+  cast->SetInput( inputImage );
+
+  typename GaussianFilterType::Pointer smoothers[NDimension];
+  for ( unsigned int d = 0; d < NDimension; ++d )
+    {
+    smoothers[d] = GaussianFilterType::New();
+    smoothers[d]->SetDirection( d );
+    smoothers[d]->SetOrder( GaussianFilterType::ZeroOrder );
+    smoothers[d]->SetSigma( this->m_SigmaArray[d] );
+    smoothers[d]->SetNormalizeAcrossScale( false );
+    smoothers[d]->InPlaceOn();
+    smoothers[d]->SetInput( d == 0 ? cast->GetOutput() : smoothers[d - 1]->GetOutput() );
+    }
+  smoothers[NDimension - 1]->Update();
+  typename InternalImageType::Pointer smoothed = smoothers[NDimension - 1]->GetOutput();
+  smoothed->DisconnectPipeline();
+  this->UpdateProgress( 0.3 );
+
+  std::vector< unsigned char > classes;
+  this->ClassifyEdgeCandidates( smoothed, classes );
+  this->UpdateProgress( 0.5 );
+
+  // The smoothed image is not needed anymore; reuse its buffer for the edges.
+  typename InternalImageType::Pointer edges = smoothed;
+  this->ResolveHysteresis( edges->GetBufferedRegion().GetSize(), classes, edges );
+  classes.clear();
+  classes.shrink_to_fit();
+  this->UpdateProgress( 0.7 );
+
+  typedef SignedMaurerDistanceMapImageFilter<
+    InternalImageType, InternalImageType >                      DistanceMapFilterType;
+  typedef IntensityWindowingImageFilter<
+    InternalImageType, OutputImageType >                        WindowFilterType;
+
+  typename DistanceMapFilterType::Pointer distanceMap = DistanceMapFilterType::New();
+  distanceMap->SetInput( edges );
+  distanceMap->SetBackgroundValue( NumericTraits< InternalPixelType >::ZeroValue() );
+  distanceMap->SetInsideIsPositive( false );
+  distanceMap->SetSquaredDistance( false );
+  distanceMap->SetUseImageSpacing( true );
+
+  typename WindowFilterType::Pointer window = WindowFilterType::New();
+  window->SetInput( distanceMap->GetOutput() );
+  window->SetWindowMinimum( 0.0 );
+  window->SetWindowMaximum( this->m_DistanceWindowMaximum );
+  window->SetOutputMinimum( 0.0 );
+  window->SetOutputMaximum( 1.0 );
+  window->Update();
+  this->UpdateProgress( 1.0 );
+
+  typename OutputImageType::Pointer outputImage = window->GetOutput();
+  outputImage->DisconnectPipeline();
+
+  auto * outputObject = dynamic_cast< OutputImageSpatialObjectType * >(this->ProcessObject::GetOutput(0));
+
+  outputObject->SetImage( outputImage );
+}
+
+
+template <unsigned int NDimension>
+void
+FusedCannyEdgesFeatureGenerator<NDimension>
+::ClassifyEdgeCandidates( const InternalImageType * smoothed,
+                          std::vector< unsigned char > & classes ) const
+{
+  const typename InternalImageType::SizeType size = smoothed->GetBufferedRegion().GetSize();
+  const SizeValueType nx = size[0];
+  const SizeValueType ny = size[1];
+  const SizeValueType nz = size[2];
+  const SizeValueType sliceSize = nx * ny;
+  const InternalPixelType * image = smoothed->GetBufferPointer();
+  const double upperThreshold = this->m_UpperThreshold;
+  const double lowerThreshold = this->m_LowerThreshold;
+
+  classes.assign( sliceSize * nz, NotEdge );
+
+  // Indices of the neighbours, clamped to the image (zero flux boundary).
+  auto before = []( SizeValueType i ) { return i > 0 ? i - 1 : i; };
+  auto after = []( SizeValueType i, SizeValueType n ) { return i + 1 < n ? i + 1 : i; };
+
+  // Second derivative along the gradient, in pixel units, as computed by
+  // CannyEdgeDetectionImageFilter.
+  auto secondDerivative = [&]( SizeValueType x, SizeValueType y, SizeValueType z ) -> InternalPixelType
+    {
+    const SizeValueType xm = before( x ), xp = after( x, nx );
+    const SizeValueType ym = before( y ), yp = after( y, ny );
+    const SizeValueType zm = before( z ), zp = after( z, nz );
+    auto s = [&]( SizeValueType i, SizeValueType j, SizeValueType k ) -> double
+      {
+      return image[i + nx * j + sliceSize * k];
+      };
+
+    const double c = s( x, y, z );
+    const double dx[3] = { 0.5 * ( s( xp, y, z ) - s( xm, y, z ) ),
+                           0.5 * ( s( x, yp, z ) - s( x, ym, z ) ),
+                           0.5 * ( s( x, y, zp ) - s( x, y, zm ) ) };
+    const double dxx[3] = { s( xp, y, z ) - 2.0 * c + s( xm, y, z ),
+                            s( x, yp, z ) - 2.0 * c + s( x, ym, z ),
+                            s( x, y, zp ) - 2.0 * c + s( x, y, zm ) };
+    const double dxy = 0.25 * ( s( xm, ym, z ) - s( xm, yp, z ) - s( xp, ym, z ) + s( xp, yp, z ) );
+    const double dxz = 0.25 * ( s( xm, y, zm ) - s( xm, y, zp ) - s( xp, y, zm ) + s( xp, y, zp ) );
+    const double dyz = 0.25 * ( s( x, ym, zm ) - s( x, ym, zp ) - s( x, yp, zm ) + s( x, yp, zp ) );
+
+    double deriv = 2.0 * ( dx[0] * dx[1] * dxy + dx[0] * dx[2] * dxz + dx[1] * dx[2] * dyz );
+    double gradMag = 0.0001;
+    for ( unsigned int i = 0; i < 3; ++i )
+      {
+      deriv += dx[i] * dx[i] * dxx[i];
+      gradMag += dx[i] * dx[i];
+      }
+    return static_cast< InternalPixelType >( deriv / gradMag );
+    };
+
+  const SizeValueType thickness = std::max< SizeValueType >( 1, this->m_NumberOfSlicesPerBlock );
+  const SizeValueType numberOfSlabs = ( nz + thickness - 1 ) / thickness;
+  std::vector< std::vector< InternalPixelType > > secondDerivatives(
+    GetParallelForEachBlockNumberOfThreads( numberOfSlabs ) );
+
+  auto classifySlab = [&]( SizeValueType slab, ThreadIdType threadId )
+    {
+    const SizeValueType z0 = slab * thickness;
+    const SizeValueType z1 = std::min( nz, z0 + thickness );
+
+    // Second derivative of the slab and of one slice on each side.
+    const SizeValueType zlo = before( z0 );
+    const SizeValueType zhi = after( z1 - 1, nz );
+    std::vector< InternalPixelType > & buffer = secondDerivatives[threadId];
+    buffer.resize( ( zhi - zlo + 1 ) * sliceSize );
+    for ( SizeValueType z = zlo; z <= zhi; ++z )
+      {
+      InternalPixelType * out = &buffer[( z - zlo ) * sliceSize];
+      for ( SizeValueType y = 0; y < ny; ++y )
+        {
+        for ( SizeValueType x = 0; x < nx; ++x )
+          {
+          *out++ = secondDerivative( x, y, z );
+          }
+        }
+      }
+    auto d = [&]( SizeValueType i, SizeValueType j, SizeValueType k ) -> InternalPixelType
+      {
+      return buffer[i + nx * j + sliceSize * ( k - zlo )];
+      };
+    auto s = [&]( SizeValueType i, SizeValueType j, SizeValueType k ) -> double
+      {
+      return image[i + nx * j + sliceSize * k];
+      };
+
+    for ( SizeValueType z = z0; z < z1; ++z )
+      {
+      const SizeValueType zm = before( z ), zp = after( z, nz );
+      for ( SizeValueType y = 0; y < ny; ++y )
+        {
+        const SizeValueType ym = before( y ), yp = after( y, ny );
+        for ( SizeValueType x = 0; x < nx; ++x )
+          {
+          const SizeValueType xm = before( x ), xp = after( x, nx );
+
+          // Zero crossing of the second derivative, with the tie breaking
+          // of ZeroCrossingImageFilter (face neighbours, -1 offsets first).
+          const InternalPixelType c = d( x, y, z );
+          const InternalPixelType neighbours[6] = {
+            d( xm, y, z ), d( x, ym, z ), d( x, y, zm ),
+            d( xp, y, z ), d( x, yp, z ), d( x, y, zp ) };
+          bool crossing = false;
+          for ( unsigned int i = 0; i < 6 && !crossing; ++i )
+            {
+            const InternalPixelType that = neighbours[i];
+            if ( ( c < 0 && that > 0 ) || ( c > 0 && that < 0 ) ||
+                 ( c == 0 && that != 0 ) || ( c != 0 && that == 0 ) )
+              {
+              const InternalPixelType absThis = std::abs( c );
+              const InternalPixelType absThat = std::abs( that );
+              crossing = absThis < absThat || ( absThis == absThat && i >= 3 );
+              }
+            }
+          if ( !crossing )
+            {
+            continue;
+            }
+
+          // Keep the crossing only where the gradient magnitude is a
+          // maximum along the gradient.
+          const double dx[3] = { 0.5 * ( s( xp, y, z ) - s( xm, y, z ) ),
+                                 0.5 * ( s( x, yp, z ) - s( x, ym, z ) ),
+                                 0.5 * ( s( x, y, zp ) - s( x, y, zm ) ) };
+          const double dx1[3] = { 0.5 * ( d( xp, y, z ) - d( xm, y, z ) ),
+                                  0.5 * ( d( x, yp, z ) - d( x, ym, z ) ),
+                                  0.5 * ( d( x, y, zp ) - d( x, y, zm ) ) };
+          const double gradMag = std::sqrt( 0.0001 +
+            dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2] );
+          const double derivPos =
+            ( dx1[0] * dx[0] + dx1[1] * dx[1] + dx1[2] * dx[2] ) / gradMag;
+          if ( derivPos > 0 )
+            {
+            continue;
+            }
+
+          unsigned char & voxelClass = classes[x + nx * y + sliceSize * z];
+          if ( gradMag > upperThreshold )
+            {
+            voxelClass = StrongEdge;
+            }
+          else if ( gradMag > lowerThreshold )
+            {
+            voxelClass = WeakEdge;
+            }
+          }
+        }
+      }
+    };
+  ParallelForEachBlock( numberOfSlabs, classifySlab );
+}
+
+
+template <unsigned int NDimension>
+void
+FusedCannyEdgesFeatureGenerator<NDimension>
+::ResolveHysteresis( const typename InternalImageType::SizeType & size,
+                     std::vector< unsigned char > & classes,
+                     InternalImageType * edges ) const
+{
+  typedef std::uint32_t LabelType;
+
+  const SizeValueType nx = size[0];
+  const SizeValueType ny = size[1];
+  const SizeValueType nz = size[2];
+  const SizeValueType sliceSize = nx * ny;
+  if ( sliceSize * nz > static_cast< SizeValueType >( std::numeric_limits< LabelType >::max() ) )
+    {
+    itkExceptionMacro("Image of " << size << " voxels is too large for the edge labels");
+    }
+
+  // Union-find forest over the edge candidates. The smaller root always
+  // becomes the parent, so parent[v] <= v and each root is the smallest
+  // index of its component.
+  std::vector< LabelType > parent( sliceSize * nz );
+  auto find = [&parent]( LabelType v )
+    {
+    while ( parent[v] != v )
+      {
+      parent[v] = parent[parent[v]];
+      v = parent[v];
+      }
+    return v;
+    };
+  auto unite = [&]( LabelType a, LabelType b )
+    {
+    a = find( a );
+    b = find( b );
+    if ( a < b )
+      {
+      parent[b] = a;
+      }
+    else if ( b < a )
+      {
+      parent[a] = b;
+      }
+    };
+
+  // Neighbours preceding a voxel in raster order, 13 of the 26.
+  struct NeighbourType { int x, y, z; };
+  std::vector< NeighbourType > preceding;
+  for ( int dz = -1; dz <= 0; ++dz )
+    {
+    for ( int dy = -1; dy <= 1; ++dy )
+      {
+      for ( int dx = -1; dx <= 1; ++dx )
+        {
+        if ( dz < 0 || dy < 0 || ( dy == 0 && dx < 0 ) )
+          {
+          NeighbourType n = { dx, dy, dz };
+          preceding.push_back( n );
+          }
+        }
+      }
+    }
+
+  // Unites voxel (x,y,z) with its candidate neighbours among \a offsets,
+  // not looking below slice zmin.
+  auto linkVoxel = [&]( SizeValueType x, SizeValueType y, SizeValueType z,
+                        SizeValueType zmin, const std::vector< NeighbourType > & offsets )
+    {
+    const LabelType v = static_cast< LabelType >( x + nx * y + sliceSize * z );
+    for ( size_t k = 0; k < offsets.size(); ++k )
+      {
+      const NeighbourType & n = offsets[k];
+      const OffsetValueType xn = static_cast< OffsetValueType >( x ) + n.x;
+      const OffsetValueType yn = static_cast< OffsetValueType >( y ) + n.y;
+      const OffsetValueType zn = static_cast< OffsetValueType >( z ) + n.z;
+      if ( xn < 0 || yn < 0 || zn < static_cast< OffsetValueType >( zmin ) ||
+           xn >= static_cast< OffsetValueType >( nx ) || yn >= static_cast< OffsetValueType >( ny ) )
+        {
+        continue;
+        }
+      const LabelType w = static_cast< LabelType >( xn + nx * yn + sliceSize * zn );
+      if ( classes[w] != NotEdge )
+        {
+        unite( v, w );
+        }
+      }
+    };
+
+  // Label the slabs in parallel. Unions stay within a slab, so the threads
+  // never touch the same part of the forest.
+  const SizeValueType thickness = std::max< SizeValueType >( 1, this->m_NumberOfSlicesPerBlock );
+  const SizeValueType numberOfSlabs = ( nz + thickness - 1 ) / thickness;
+  auto labelSlab = [&]( SizeValueType slab, ThreadIdType )
+    {
+    const SizeValueType z0 = slab * thickness;
+    const SizeValueType z1 = std::min( nz, z0 + thickness );
+    for ( SizeValueType z = z0; z < z1; ++z )
+      {
+      for ( SizeValueType y = 0; y < ny; ++y )
+        {
+        for ( SizeValueType x = 0; x < nx; ++x )
+          {
+          const LabelType v = static_cast< LabelType >( x + nx * y + sliceSize * z );
+          if ( classes[v] == NotEdge )
+            {
+            continue;
+            }
+          parent[v] = v;
+          linkVoxel( x, y, z, z0, preceding );
+          }
+        }
+      }
+    };
+  ParallelForEachBlock( numberOfSlabs, labelSlab );
+
+  // Merge across the slab seams, in order.
+  std::vector< NeighbourType > below;
+  for ( size_t k = 0; k < preceding.size(); ++k )
+    {
+    if ( preceding[k].z < 0 )
+      {
+      below.push_back( preceding[k] );
+      }
+    }
+  for ( SizeValueType slab = 1; slab < numberOfSlabs; ++slab )
+    {
+    const SizeValueType z = slab * thickness;
+    for ( SizeValueType y = 0; y < ny; ++y )
+      {
+      for ( SizeValueType x = 0; x < nx; ++x )
+        {
+        if ( classes[x + nx * y + sliceSize * z] != NotEdge )
+          {
+          linkVoxel( x, y, z, z - 1, below );
+          }
+        }
+      }
+    }
+
+  // Point every candidate at its root, and mark the roots of components
+  // holding a strong voxel. Roots precede their members, so one forward
+  // sweep suffices.
+  for ( SizeValueType v = 0; v < sliceSize * nz; ++v )
+    {
+    if ( classes[v] == NotEdge )
+      {
+      continue;
+      }
+    parent[v] = parent[parent[v]];
+    if ( classes[v] == StrongEdge )
+      {
+      classes[parent[v]] = StrongEdge;
+      }
+    }
+
+  InternalPixelType * out = edges->GetBufferPointer();
+  auto writeSlab = [&]( SizeValueType slab, ThreadIdType )
+    {
+    const SizeValueType first = slab * thickness * sliceSize;
+    const SizeValueType last = std::min( nz, ( slab + 1 ) * thickness ) * sliceSize;
+    for ( SizeValueType v = first; v < last; ++v )
+      {
+      out[v] = ( classes[v] != NotEdge && classes[parent[v]] == StrongEdge ) ?
+        NumericTraits< InternalPixelType >::OneValue() :
+        NumericTraits< InternalPixelType >::ZeroValue();
+      }
+    };
+  ParallelForEachBlock( numberOfSlabs, writeSlab );
+}
+
+} // end namespace itk
+
+#endif
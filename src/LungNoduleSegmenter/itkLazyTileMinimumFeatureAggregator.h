@@ -0,0 +1,160 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkLazyTileMinimumFeatureAggregator.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkLazyTileMinimumFeatureAggregator_h
+#define itkLazyTileMinimumFeatureAggregator_h
+
+#include "itkStreamingMinimumFeatureAggregator.h"
+#include "itkQuantizedFeatureBuffer.h"
+#include <vector>
+
+namespace itk
+{
+
+/** \class LazyTileMinimumFeatureAggregator
+ * \brief Minimum feature aggregator that only evaluates active tiles.
+ *
+ * The ROI is divided into tiles of TileSize voxels. Tiles start out
+ * inactive, and the aggregated feature is 0 over inactive tiles, which
+ * stops any front propagating on it. Tiles are activated explicitly, around
+ * seed points with ActivateTilesAround() and around an evolving
+ * segmentation with ActivateTilesTouchedBy(). On the next update the block
+ * features of the newly activated tiles are computed and cached; tiles that
+ * were computed before are not recomputed.
+ *
+ * Regular (whole image) feature generators cannot be evaluated per tile.
+ * They are computed once, their minimum is cached, and that cache is reused
+ * by every subsequent update.
+ *
+ * The caches are kept in FeatureStorage: float, or 16 bit fixed point
+ * over [0,1] (see QuantizedFeatureBuffer), dequantised while the output is
+ * assembled. They are brick-mapped, with bricks of TileSize rounded up to a
+ * power of two: the block feature cache only holds the bricks of the tiles
+ * computed so far, and the cache of the regular features drops the bricks
+ * where their minimum is 0. They are keyed on the input image, its modification time and
+ * buffered region, and on the modification times of the feature
+ * generators. A new input geometry, or ResetTiles(), drops them along with
+ * the tiles; any other change of the key, Modified() or a change of
+ * FeatureStorage recomputes the active tiles on the next update. Activating
+ * tiles does not invalidate the caches, and neither does the aggregator
+ * releasing the generators' features once they are cached.
+ *
+ * \ingroup SpatialObjectFilters
+ * \ingroup LesionSizingToolkit
+ */
+template <unsigned int NDimension>
+class ITK_EXPORT LazyTileMinimumFeatureAggregator : public StreamingMinimumFeatureAggregator<NDimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(LazyTileMinimumFeatureAggregator);
+
+  /** Standard class typedefs. */
+  typedef LazyTileMinimumFeatureAggregator              Self;
+  typedef StreamingMinimumFeatureAggregator<NDimension> Superclass;
+  typedef SmartPointer<Self>                            Pointer;
+  typedef SmartPointer<const Self>                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(LazyTileMinimumFeatureAggregator, StreamingMinimumFeatureAggregator);
+
+  typedef typename Superclass::InputImageType   InputImageType;
+  typedef typename Superclass::OutputImageType  OutputImageType;
+  typedef typename Superclass::OutputPixelType  OutputPixelType;
+  typedef typename Superclass::RegionType       RegionType;
+  typedef typename Superclass::SizeType         SizeType;
+  typedef typename InputImageType::IndexType    IndexType;
+  typedef typename InputImageType::PointType    PointType;
+
+  /** Edge length of the tiles, in voxels. Defaults to 16. */
+  itkSetMacro( TileSize, unsigned int );
+  itkGetMacro( TileSize, unsigned int );
+
+  typedef QuantizedFeatureStorage::StorageType FeatureStorageType;
+
+  /** Storage of the cached features. Defaults to float. */
+  itkSetMacro( FeatureStorage, FeatureStorageType );
+  itkGetMacro( FeatureStorage, FeatureStorageType );
+
+  /** Drop all cached features and deactivate every tile. */
+  void ResetTiles();
+
+  /** Activate the tiles within \a radius (physical units) of \a point.
+   * Returns the number of newly activated tiles. */
+  SizeValueType ActivateTilesAround( const PointType & point, double radius );
+
+  /** Activate every tile that contains a voxel of \a levelSet at or above
+   * \a threshold, together with its face, edge and corner neighbours.
+   * \a levelSet must have the geometry of the input. Returns the number of
+   * newly activated tiles. */
+  SizeValueType ActivateTilesTouchedBy( const OutputImageType * levelSet, double threshold );
+
+  /** Activate all tiles. Returns the number of newly activated tiles. */
+  SizeValueType ActivateAllTiles();
+
+  SizeValueType GetNumberOfTiles() const
+    { return static_cast< SizeValueType >( this->m_TileState.size() ); }
+  SizeValueType GetNumberOfActiveTiles() const;
+
+  /** Invalidates the cached features, not the active tiles. */
+  void Modified() const override;
+
+protected:
+  LazyTileMinimumFeatureAggregator();
+  ~LazyTileMinimumFeatureAggregator() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  void GenerateData() override;
+
+private:
+  enum TileStateType { Inactive = 0, Pending, Computed };
+
+  /** (Re)build the tile grid if the input geometry has changed. */
+  void InitializeTiles();
+
+  /** Drop the cached features if their key has changed; the computed tiles
+   * are computed again. */
+  void ValidateCaches();
+
+  /** Modified() for tile activations, which keep the caches. */
+  void TilesModified() { this->Superclass::Modified(); }
+
+  SizeValueType ActivateTile( SizeValueType tile );
+
+  RegionType GetTileRegion( SizeValueType tile ) const;
+
+  unsigned int                            m_TileSize;
+  FeatureStorageType                      m_FeatureStorage;
+  const InputImageType *                  m_TiledInput;
+  ModifiedTimeType                        m_TiledInputMTime;
+  ModifiedTimeType                        m_GeneratorsMTime;
+  mutable bool                            m_CachesModified;
+  RegionType                              m_TiledRegion;
+  SizeType                                m_NumberOfTilesPerAxis;
+  std::vector< unsigned char >            m_TileState;
+  QuantizedFeatureBuffer< NDimension >    m_RegularFeatureCache;
+  QuantizedFeatureBuffer< NDimension >    m_BlockFeatureCache;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkLazyTileMinimumFeatureAggregator.hxx"
+#endif
+
+#endif
@@ -0,0 +1,513 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkLazyTileMinimumFeatureAggregator.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkLazyTileMinimumFeatureAggregator_hxx
+#define itkLazyTileMinimumFeatureAggregator_hxx
+
+#include "itkLazyTileMinimumFeatureAggregator.h"
+#include "itkParallelForEachBlock.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template <unsigned int NDimension>
+LazyTileMinimumFeatureAggregator<NDimension>
+::LazyTileMinimumFeatureAggregator() :
+  m_TileSize(16),
+  m_FeatureStorage(QuantizedFeatureStorage::Float32),
+  m_TiledInput(nullptr),
+  m_TiledInputMTime(0),
+  m_GeneratorsMTime(0),
+  m_CachesModified(false)
+{
+  this->m_NumberOfTilesPerAxis.Fill( 0 );
+}
+
+
+/*
+ * Destructor
+ */
+template <unsigned int NDimension>
+LazyTileMinimumFeatureAggregator<NDimension>
+::~LazyTileMinimumFeatureAggregator()
+{
+}
+
+
+/*
+ * PrintSelf
+ */
+template <unsigned int NDimension>
+void
+LazyTileMinimumFeatureAggregator<NDimension>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "Tile size " << this->m_TileSize << std::endl;
+  os << indent << "Feature storage " << this->m_FeatureStorage << std::endl;
+  os << indent << "Active tiles " << this->GetNumberOfActiveTiles()
+     << " of " << this->GetNumberOfTiles() << std::endl;
+}
+
+
+template <unsigned int NDimension>
+void
+LazyTileMinimumFeatureAggregator<NDimension>
+::Modified() const
+{
+  Superclass::Modified();
+  this->m_CachesModified = true;
+}
+
+
+template <unsigned int NDimension>
+void
+LazyTileMinimumFeatureAggregator<NDimension>
+::ResetTiles()
+{
+  this->m_TiledInput = nullptr;
+  this->m_TileState.clear();
+  this->m_RegularFeatureCache.Release();
+  this->m_BlockFeatureCache.Release();
+  this->Modified();
+}
+
+
+template <unsigned int NDimension>
+void
+LazyTileMinimumFeatureAggregator<NDimension>
+::ValidateCaches()
+{
+  const ModifiedTimeType inputMTime = this->m_TiledInput->GetMTime();
+  const ModifiedTimeType generatorsMTime = this->GetFeatureGeneratorsMTime();
+  const bool storageChanged =
+    ( this->m_RegularFeatureCache.IsAllocated() &&
+      this->m_RegularFeatureCache.GetStorage() != this->m_FeatureStorage ) ||
+    ( this->m_BlockFeatureCache.IsAllocated() &&
+      this->m_BlockFeatureCache.GetStorage() != this->m_FeatureStorage );
+  if( this->m_CachesModified || storageChanged || inputMTime != this->m_TiledInputMTime ||
+      generatorsMTime != this->m_GeneratorsMTime )
+    {
+    this->m_RegularFeatureCache.Release();
+    this->m_BlockFeatureCache.Release();
+    std::replace( this->m_TileState.begin(), this->m_TileState.end(),
+                  static_cast< unsigned char >( Computed ), static_cast< unsigned char >( Pending ) );
+    }
+  this->m_TiledInputMTime = inputMTime;
+  this->m_GeneratorsMTime = generatorsMTime;
+  this->m_CachesModified = false;
+}
+
+
+template <unsigned int NDimension>
+void
+LazyTileMinimumFeatureAggregator<NDimension>
+::InitializeTiles()
+{
+  // The tiles only depend on the geometry of the input; its contents are
+  // checked by ValidateCaches().
+  const InputImageType * input = this->GetInputImage();
+  if( input == this->m_TiledInput && input->GetBufferedRegion() == this->m_TiledRegion )
+    {
+    return;
+    }
+
+  this->m_TiledInput = input;
+  this->m_TiledInputMTime = input->GetMTime();
+  this->m_GeneratorsMTime = this->GetFeatureGeneratorsMTime();
+  this->m_CachesModified = false;
+  this->m_TiledRegion = input->GetBufferedRegion();
+  SizeValueType numberOfTiles = 1;
+  for ( unsigned int i = 0; i < NDimension; ++i )
+    {
+    this->m_NumberOfTilesPerAxis[i] =
+      ( this->m_TiledRegion.GetSize()[i] + this->m_TileSize - 1 ) / this->m_TileSize;
+    numberOfTiles *= this->m_NumberOfTilesPerAxis[i];
+    }
+  this->m_TileState.assign( numberOfTiles, Inactive );
+  this->m_RegularFeatureCache.Release();
+  this->m_BlockFeatureCache.Release();
+}
+
+
+template <unsigned int NDimension>
+typename LazyTileMinimumFeatureAggregator<NDimension>::RegionType
+LazyTileMinimumFeatureAggregator<NDimension>
+::GetTileRegion( SizeValueType tile ) const
+{
+  SizeType tileSize;
+  tileSize.Fill( this->m_TileSize );
+  return BrickRegionSplitter< NDimension >( this->m_TiledRegion, tileSize ).GetBrick( tile );
+}
+
+
+template <unsigned int NDimension>
+SizeValueType
+LazyTileMinimumFeatureAggregator<NDimension>
+::ActivateTile( SizeValueType tile )
+{
+  if( this->m_TileState[tile] != Inactive )
+    {
+    return 0;
+    }
+  this->m_TileState[tile] = Pending;
+  return 1;
+}
+
+
+template <unsigned int NDimension>
+SizeValueType
+LazyTileMinimumFeatureAggregator<NDimension>
+::GetNumberOfActiveTiles() const
+{
+  return static_cast< SizeValueType >( this->m_TileState.size() -
+    std::count( this->m_TileState.begin(), this->m_TileState.end(), Inactive ) );
+}
+
+
+template <unsigned int NDimension>
+SizeValueType
+LazyTileMinimumFeatureAggregator<NDimension>
+::ActivateAllTiles()
+{
+  this->InitializeTiles();
+  SizeValueType activated = 0;
+  for ( SizeValueType tile = 0; tile < this->m_TileState.size(); ++tile )
+    {
+    activated += this->ActivateTile( tile );
+    }
+  if( activated )
+    {
+    this->TilesModified();
+    }
+  return activated;
+}
+
+
+template <unsigned int NDimension>
+SizeValueType
+LazyTileMinimumFeatureAggregator<NDimension>
+::ActivateTilesAround( const PointType & point, double radius )
+{
+  this->InitializeTiles();
+  const InputImageType * input = this->m_TiledInput;
+
+  ContinuousIndex< double, NDimension > center;
+  input->TransformPhysicalPointToContinuousIndex( point, center );
+
+  // Range of tiles overlapped by the bounding box of the sphere.
+  IndexType firstTile;
+  IndexType lastTile;
+  for ( unsigned int i = 0; i < NDimension; ++i )
+    {
+    const double r = radius / input->GetSpacing()[i];
+    const double lo = center[i] - r - this->m_TiledRegion.GetIndex()[i];
+    const double hi = center[i] + r - this->m_TiledRegion.GetIndex()[i];
+    const IndexValueType last = static_cast< IndexValueType >( this->m_NumberOfTilesPerAxis[i] ) - 1;
+    firstTile[i] = std::max< IndexValueType >( 0,
+      static_cast< IndexValueType >( std::floor( lo / this->m_TileSize ) ) );
+    lastTile[i] = std::min< IndexValueType >( last,
+      static_cast< IndexValueType >( std::floor( hi / this->m_TileSize ) ) );
+    if( firstTile[i] > lastTile[i] )
+      {
+      return 0;
+      }
+    }
+
+  SizeValueType activated = 0;
+  IndexType t = firstTile;
+  while( true )
+    {
+    SizeValueType tile = 0;
+    for ( int i = NDimension - 1; i >= 0; --i )
+      {
+      tile = tile * this->m_NumberOfTilesPerAxis[i] + static_cast< SizeValueType >( t[i] );
+      }
+    activated += this->ActivateTile( tile );
+
+    unsigned int axis = 0;
+    while( axis < NDimension && ++t[axis] > lastTile[axis] )
+      {
+      t[axis] = firstTile[axis];
+      ++axis;
+      }
+    if( axis == NDimension )
+      {
+      break;
+      }
+    }
+
+  if( activated )
+    {
+    this->TilesModified();
+    }
+  return activated;
+}
+
+
+template <unsigned int NDimension>
+SizeValueType
+LazyTileMinimumFeatureAggregator<NDimension>
+::ActivateTilesTouchedBy( const OutputImageType * levelSet, double threshold )
+{
+  this->InitializeTiles();
+  if( levelSet->GetBufferedRegion() != this->m_TiledRegion )
+    {
+    itkExceptionMacro("Level set region " << levelSet->GetBufferedRegion()
+                      << " does not match the tiled region " << this->m_TiledRegion);
+    }
+
+  // Find the touched tiles in parallel, then activate serially.
+  const SizeValueType numberOfTiles = this->GetNumberOfTiles();
+  std::vector< unsigned char > touched( numberOfTiles, 0 );
+  const OutputPixelType level = static_cast< OutputPixelType >( threshold );
+  auto inspectTile = [&]( SizeValueType tile, ThreadIdType )
+    {
+    if( this->m_TileState[tile] == Inactive )
+      {
+      // Nothing moves on a tile with zero speed.
+      return;
+      }
+    bool found = false;
+    auto inspectLine = [&]( const IndexType & start, SizeValueType n )
+      {
+      const OutputPixelType * value = levelSet->GetBufferPointer() + levelSet->ComputeOffset( start );
+      for( SizeValueType i = 0; i < n && !found; ++i )
+        {
+        found = value[i] >= level;
+        }
+      };
+    ForEachRegionLine( this->GetTileRegion( tile ), inspectLine );
+    touched[tile] = found;
+    };
+  ParallelForEachBlock( numberOfTiles, inspectTile );
+
+  SizeValueType activated = 0;
+  for ( SizeValueType tile = 0; tile < numberOfTiles; ++tile )
+    {
+    if( !touched[tile] )
+      {
+      continue;
+      }
+    IndexType t;
+    SizeValueType rest = tile;
+    for ( unsigned int i = 0; i < NDimension; ++i )
+      {
+      t[i] = static_cast< IndexValueType >( rest % this->m_NumberOfTilesPerAxis[i] );
+      rest /= this->m_NumberOfTilesPerAxis[i];
+      }
+
+    // Visit the 3^N neighbourhood of the tile.
+    SizeValueType numberOfNeighbours = 1;
+    for ( unsigned int i = 0; i < NDimension; ++i )
+      {
+      numberOfNeighbours *= 3;
+      }
+    for ( SizeValueType k = 0; k < numberOfNeighbours; ++k )
+      {
+      SizeValueType code = k;
+      SizeValueType neighbour = 0;
+      SizeValueType stride = 1;
+      bool inside = true;
+      for ( unsigned int i = 0; i < NDimension; ++i )
+        {
+        const IndexValueType n = t[i] + static_cast< IndexValueType >( code % 3 ) - 1;
+        code /= 3;
+        inside = inside && n >= 0 &&
+          n < static_cast< IndexValueType >( this->m_NumberOfTilesPerAxis[i] );
+        neighbour += static_cast< SizeValueType >( n ) * stride;
+        stride *= this->m_NumberOfTilesPerAxis[i];
+        }
+      if( inside )
+        {
+        activated += this->ActivateTile( neighbour );
+        }
+      }
+    }
+
+  if( activated )
+    {
+    this->TilesModified();
+    }
+  return activated;
+}
+
+
+/*
+ * Generate Data
+ */
+template <unsigned int NDimension>
+void
+LazyTileMinimumFeatureAggregator<NDimension>
+::GenerateData()
+{
+  if( this->GetNumberOfFeatureGenerators() == 0 )
+    {
+    itkExceptionMacro("No feature generators were added to the aggregator");
+    }
+
+  this->InitializeTiles();
+  this->ValidateCaches();
+  const InputImageType * input = this->m_TiledInput;
+
+  // Whole image features, computed once. The float minimum only lives until
+  // it has been stored.
+  if( this->HasRegularFeatureGenerators() && !this->m_RegularFeatureCache.IsAllocated() )
+    {
+    typename OutputImageType::Pointer minimum = OutputImageType::New();
+    minimum->CopyInformation( input );
+    minimum->SetRegions( this->m_TiledRegion );
+    minimum->Allocate();
+    minimum->FillBuffer( NumericTraits< OutputPixelType >::max() );
+    this->FoldRegularFeatures( minimum );
+    // Releasing the generators' features modifies them; that is not a change
+    // of the features the cache was computed from.
+    this->m_GeneratorsMTime = this->GetFeatureGeneratorsMTime();
+
+    this->m_RegularFeatureCache.Allocate( this->m_FeatureStorage, this->m_TiledRegion,
+                                          this->m_TileSize );
+    this->m_RegularFeatureCache.AllocateBricks( this->m_TiledRegion );
+    QuantizedFeatureBuffer< NDimension > * cache = &this->m_RegularFeatureCache;
+    const OutputImageType * values = minimum;
+    auto storeTile = [&]( SizeValueType tile, ThreadIdType )
+      {
+      auto storeLine = [&]( const IndexType & start, SizeValueType n )
+        {
+        cache->Store( start, values->GetBufferPointer() + values->ComputeOffset( start ), n );
+        };
+      ForEachRegionLine( this->GetTileRegion( tile ), storeLine );
+      };
+    ParallelForEachBlock( this->GetNumberOfTiles(), storeTile );
+    // The wall and the outside of the lungs usually leave whole bricks at 0.
+    cache->ReleaseBackgroundBricks();
+    }
+
+  // Block features of the tiles activated since the last update. Each tile
+  // is computed into per-thread float scratch, then stored in the cache.
+  if( this->HasBlockFeatureGenerators() )
+    {
+    this->VerifyBlockInputImages( input );
+    if( !this->m_BlockFeatureCache.IsAllocated() )
+      {
+      this->m_BlockFeatureCache.Allocate( this->m_FeatureStorage, this->m_TiledRegion,
+                                          this->m_TileSize );
+      }
+
+    // The bricks of the pending tiles are allocated up front, so that the
+    // threads only write to them.
+    std::vector< SizeValueType > pending;
+    for ( SizeValueType tile = 0; tile < this->m_TileState.size(); ++tile )
+      {
+      if( this->m_TileState[tile] == Pending )
+        {
+        pending.push_back( tile );
+        this->m_BlockFeatureCache.AllocateBricks( this->GetTileRegion( tile ) );
+        }
+      }
+
+    const ThreadIdType numberOfThreads = GetParallelForEachBlockNumberOfThreads( pending.size() );
+    std::vector< typename OutputImageType::Pointer > tileValues( numberOfThreads );
+    std::vector< typename OutputImageType::Pointer > scratch( numberOfThreads );
+    QuantizedFeatureBuffer< NDimension > * cache = &this->m_BlockFeatureCache;
+    auto computeTile = [&]( SizeValueType i, ThreadIdType threadId )
+      {
+      const RegionType region = this->GetTileRegion( pending[i] );
+      typename OutputImageType::Pointer & values = tileValues[threadId];
+      if( values.IsNull() || values->GetBufferedRegion().GetSize() != region.GetSize() )
+        {
+        values = OutputImageType::New();
+        values->CopyInformation( input );
+        values->SetBufferedRegion( region );
+        values->SetRequestedRegion( region );
+        values->Allocate();
+        }
+      else
+        {
+        values->SetBufferedRegion( region );
+        values->SetRequestedRegion( region );
+        }
+      this->GenerateBlockFeatures( input, region, values, scratch[threadId] );
+
+      const OutputImageType * tile = values;
+      auto storeLine = [&]( const IndexType & start, SizeValueType n )
+        {
+        cache->Store( start, tile->GetBufferPointer() + tile->ComputeOffset( start ), n );
+        };
+      ForEachRegionLine( region, storeLine );
+      };
+    ParallelForEachBlock( pending.size(), computeTile );
+    }
+
+  for ( SizeValueType tile = 0; tile < this->m_TileState.size(); ++tile )
+    {
+    if( this->m_TileState[tile] == Pending )
+      {
+      this->m_TileState[tile] = Computed;
+      }
+    }
+
+  // Assemble the feature: the cached minimum over active tiles, 0 elsewhere.
+  // Dequantisation is fused into the assembly.
+  typename OutputImageType::Pointer outputImage = OutputImageType::New();
+  outputImage->CopyInformation( input );
+  outputImage->SetRegions( this->m_TiledRegion );
+  outputImage->Allocate();
+
+  const QuantizedFeatureBuffer< NDimension > * regular =
+    this->m_RegularFeatureCache.IsAllocated() ? &this->m_RegularFeatureCache : nullptr;
+  const QuantizedFeatureBuffer< NDimension > * block =
+    this->m_BlockFeatureCache.IsAllocated() ? &this->m_BlockFeatureCache : nullptr;
+  OutputImageType * output = outputImage;
+  auto assembleTile = [&]( SizeValueType tile, ThreadIdType )
+    {
+    const bool active = this->m_TileState[tile] == Computed;
+    auto assembleLine = [&]( const IndexType & start, SizeValueType n )
+      {
+      OutputPixelType * out = output->GetBufferPointer() + output->ComputeOffset( start );
+      if( !active )
+        {
+        std::fill( out, out + n, NumericTraits< OutputPixelType >::ZeroValue() );
+        return;
+        }
+      if( regular && block )
+        {
+        regular->Load( start, out, n );
+        block->LoadMinimum( start, out, n );
+        }
+      else
+        {
+        ( regular ? regular : block )->Load( start, out, n );
+        }
+      };
+    ForEachRegionLine( this->GetTileRegion( tile ), assembleLine );
+    };
+  ParallelForEachBlock( this->GetNumberOfTiles(), assembleTile );
+
+  auto * outputObject = dynamic_cast< typename Superclass::OutputImageSpatialObjectType * >(
+    this->ProcessObject::GetOutput(0) );
+
+  outputObject->SetImage( outputImage );
+}
+
+} // end namespace itk
+
+#endif
@@ -26,6 +26,7 @@
 //#include "itkLungWallFeatureGenerator2.h"
 #include "itkLungWallFeatureGenerator.h"
 #include "itkSatoVesselnessSigmoidFeatureGenerator.h"
+#include "itkSatoVesselnessFeatureGenerator.h"
 #include "itkSigmoidFeatureGenerator.h"
 #include "itkCannyEdgesFeatureGenerator.h"
 #include "itkFastMarchingAndGeodesicActiveContourLevelSetSegmentationModule.h"
@@ -34,6 +35,21 @@
 #include "itkLesionSegmentationMethod.h"
 #include "itkMinimumFeatureAggregator.h"
 #include "itkIsotropicResamplerImageFilter.h"
+#include "itkResampleImageFilter.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkStreamingMinimumFeatureAggregator.h"
+#include "itkSigmoidBlockFeatureGenerator.h"
+#include "itkSatoVesselnessSigmoidBlockFeatureGenerator.h"
+#include "itkLazyTileMinimumFeatureAggregator.h"
+#include "itkFusedCannyEdgesFeatureGenerator.h"
+#include "itkParallelVesselEnhancingDiffusion3DImageFilter.h"
+#include "itkPrecomputedLungWallFeatureGenerator.h"
+#include "itkStudyFeatureCache.h"
+#include "itkCachedBlockFeatureGenerator.h"
+#include "itkSeparableIsotropicResamplerImageFilter.h"
+#include "itkGeodesicActiveContourLevelSetImageFilter.h"
+#include "itkTransform.h"
+#include "SupersampleVolume.h"
 #include <string>
 
 namespace itk
@@ -132,11 +148,157 @@ public:
   itkSetMacro( AnisotropyThreshold, double );
   itkGetMacro( AnisotropyThreshold, double );
 
+  /** Resample with the SeparableIsotropicResamplerImageFilter (per axis
+   * weight tables and passes) instead of the IsotropicResamplerImageFilter
+   * (ResampleImageFilter with a BSpline interpolator). Both use cubic
+   * B-splines, but the results are not identical: the separable resampler
+   * fills outside the input with -1024 and rounds to the nearest value
+   * where the other truncates. The regions resampled by coarse to fine
+   * refinement, adaptive regions of interest and warm starts use the same
+   * resampler as the whole ROI. Defaults to false. */
+  itkSetMacro( SeparableResampling, bool );
+  itkGetMacro( SeparableResampling, bool );
+  itkBooleanMacro( SeparableResampling );
+
+  /** When IsotropicSampleSpacing is set, resample with
+   * supersample::SupersampleVolume instead: in-plane Gaussian anti-aliasing
+   * when the spacing is coarser than the in-plane spacing, then trilinear
+   * interpolation. Defaults to false. */
+  itkSetMacro( AntiAliasedSupersampling, bool );
+  itkGetMacro( AntiAliasedSupersampling, bool );
+  itkBooleanMacro( AntiAliasedSupersampling );
+
+  /** Segment on a grid of CoarseSpacing first, then resample the data at the
+   * output spacing only around the coarse segmentation (RefinementMargin),
+   * recompute the features there, and refine the upsampled coarse level set
+   * with RefinementIterations of geodesic active contours. Elsewhere the
+   * output is the linearly upsampled coarse level set. This only applies
+   * when the data is resampled to a spacing finer than CoarseSpacing, as
+   * with supersampling. With more than two NumberOfPyramidLevels, the
+   * level set is refined the same way on intermediate grids first.
+   *
+   * This approximates the segmentation at the output spacing; it does not
+   * reproduce it. Away from the band the surface is the upsampled coarse
+   * one, and the fine surface only gets RefinementIterations. No tolerance
+   * on the volume against the full supersampled segmentation has been
+   * measured, so do not substitute it for full supersampling before it has
+   * been validated on reference cases. Defaults to false. */
+  itkSetMacro( CoarseToFineRefinement, bool );
+  itkGetMacro( CoarseToFineRefinement, bool );
+  itkBooleanMacro( CoarseToFineRefinement );
+
+  /** Spacing of the coarse segmentation, in physical units. Axes with a
+   * coarser output spacing keep it. Defaults to 0.5. */
+  itkSetMacro( CoarseSpacing, double );
+  itkGetMacro( CoarseSpacing, double );
+
+  /** Number of grids of a coarse to fine segmentation, the coarse and the
+   * output ones included. The spacings of the intermediate grids are
+   * geometrically spaced between CoarseSpacing and the output spacing, and
+   * each grid starts from the upsampled level set of the previous one. The
+   * data of every grid is resampled around the surface as the whole ROI is,
+   * with the resampling AntiAliasedSupersampling and SeparableResampling
+   * select. Defaults to 2. */
+  itkSetClampMacro( NumberOfPyramidLevels, unsigned int, 2, NumericTraits< unsigned int >::max() );
+  itkGetMacro( NumberOfPyramidLevels, unsigned int );
+
+  /** Margin around the coarse segmentation over which the fine features are
+   * computed, in physical units. Defaults to 2. */
+  itkSetMacro( RefinementMargin, double );
+  itkGetMacro( RefinementMargin, double );
+
+  /** Iterations of the fine refinement. Defaults to 50. */
+  itkSetMacro( RefinementIterations, unsigned int );
+  itkGetMacro( RefinementIterations, unsigned int );
+
+  /** Segment in a box of InitialRegionRadius around the seeds first, and
+   * grow the box by RegionGrowthFactor only while the segmented surface
+   * reaches one of its faces. The grown box starts from the level set of
+   * the previous one, and the surface only evolves around where it met the
+   * faces of the previous box, as far as the box grew; elsewhere it is
+   * taken to have converged. RegionOfInterest stays the largest box, and
+   * the output covers it; the output is outside beyond the last box. The
+   * data of each box is resampled as the whole ROI is, so its voxels are
+   * those of a fixed ROI; the features still differ near the faces of a
+   * box, where their filters see its border. Coarse to fine refinement
+   * does not apply. Defaults to false. */
+  itkSetMacro( AdaptiveRegionOfInterest, bool );
+  itkGetMacro( AdaptiveRegionOfInterest, bool );
+  itkBooleanMacro( AdaptiveRegionOfInterest );
+
+  /** Radius of the first box around the seeds, in physical units. Defaults
+   * to 10. */
+  itkSetMacro( InitialRegionRadius, double );
+  itkGetMacro( InitialRegionRadius, double );
+
+  /** Factor the box radius grows by. Defaults to 2. */
+  itkSetClampMacro( RegionGrowthFactor, double, 1.1, NumericTraits< double >::max() );
+  itkGetMacro( RegionGrowthFactor, double );
+
+  /** Prior segmentation to start from instead of the seeds, such as the
+   * output of an earlier run or of the previous scan of a follow-up. It is
+   * a level set with the iso-value and sign of the output, on any grid, or
+   * a mask, nonzero inside, with InitialSegmentationIsMask. Fast marching
+   * is skipped: the prior, resampled onto the output grid, evolves for
+   * WarmStartIterations of geodesic active contours over a box of
+   * WarmStartMargin around it, on features computed there only. The data
+   * of that box is resampled as a cold start resamples the whole ROI, so on
+   * an unchanged study its voxels are those of the cold start. Adaptive
+   * region of interest and coarse to fine refinement do not apply. */
+  itkSetConstObjectMacro( InitialSegmentation, OutputImageType );
+  itkGetConstObjectMacro( InitialSegmentation, OutputImageType );
+
+  /** Whether InitialSegmentation is a mask rather than a level set.
+   * Defaults to false. */
+  itkSetMacro( InitialSegmentationIsMask, bool );
+  itkGetMacro( InitialSegmentationIsMask, bool );
+  itkBooleanMacro( InitialSegmentationIsMask );
+
+  /** Transform from the physical space of the input to that of
+   * InitialSegmentation, such as the rigid registration of a follow-up
+   * scan to the previous one. Defaults to the identity. */
+  typedef Transform< double, ImageDimension, ImageDimension > InitialSegmentationTransformType;
+  itkSetConstObjectMacro( InitialSegmentationTransform, InitialSegmentationTransformType );
+  itkGetConstObjectMacro( InitialSegmentationTransform, InitialSegmentationTransformType );
+
+  /** Iterations of geodesic active contours from InitialSegmentation.
+   * Defaults to 50. */
+  itkSetMacro( WarmStartIterations, unsigned int );
+  itkGetMacro( WarmStartIterations, unsigned int );
+
+  /** Margin around InitialSegmentation the surface can move within, in
+   * physical units. Defaults to 5. */
+  itkSetMacro( WarmStartMargin, double );
+  itkGetMacro( WarmStartMargin, double );
+
   /** Turn On/Off the use of vessel enhancing diffusion (R. Manniesing et al)
-   * prior to computing the vesselness. This is slow. Defaults to false. */
+   * prior to computing the vesselness. Defaults to false. */
   virtual void SetUseVesselEnhancingDiffusion( bool );
+  itkGetMacro( UseVesselEnhancingDiffusion, bool );
   itkBooleanMacro( UseVesselEnhancingDiffusion );
 
+  /** Run vessel enhancing diffusion with the multithreaded
+   * ParallelVesselEnhancingDiffusion3DImageFilter instead of the toolkit's
+   * filter inside the vesselness generator. It implements the same scheme
+   * with the same parameters, so the diffused image matches the toolkit
+   * filter's up to float rounding. The diffused image then feeds every
+   * vesselness feature, including the brick streamed one. Only used with
+   * UseVesselEnhancingDiffusion. Defaults to true. */
+  itkSetMacro( FastVesselEnhancingDiffusion, bool );
+  itkGetMacro( FastVesselEnhancingDiffusion, bool );
+  itkBooleanMacro( FastVesselEnhancingDiffusion );
+
+  /** Restrict the fast vessel enhancing diffusion to the neighbourhood of
+   * tissue above the lung threshold. The voxels far from tissue are left
+   * undiffused, so the result then differs from the toolkit filter's
+   * there. Defaults to false. */
+  itkSetMacro( RestrictVesselEnhancingDiffusion, bool );
+  itkGetMacro( RestrictVesselEnhancingDiffusion, bool );
+  itkBooleanMacro( RestrictVesselEnhancingDiffusion );
+
+  /** Seed independent features of the study, prepared in the background. */
+  typedef StudyFeatureCache< InputImageType >             StudyFeatureCacheType;
+
   typedef itk::LandmarkSpatialObject< ImageDimension >    SeedSpatialObjectType;
   typedef typename SeedSpatialObjectType::PointListType   PointListType;
 
@@ -164,6 +326,113 @@ public:
 	itkGetMacro(WriteFeatureImages, bool);
 	itkBooleanMacro(WriteFeatureImages);
 
+  /** Aggregate the features with the StreamingMinimumFeatureAggregator
+   * instead of the MinimumFeatureAggregator. The intensity sigmoid and the
+   * vesselness sigmoid are then evaluated inline while folding, and the other
+   * features are released as soon as they have been folded in, so only the
+   * running minimum and one other feature image are alive at any time.
+   * Defaults to false. */
+  itkSetMacro( StreamFeatureAggregation, bool );
+  itkGetMacro( StreamFeatureAggregation, bool );
+  itkBooleanMacro( StreamFeatureAggregation );
+
+  /** Compute the features brick by brick. This implies
+   * StreamFeatureAggregation. The ROI is split into bricks of
+   * FeatureBrickSize voxels (grown to twice the largest halo if needed), and
+   * the intensity sigmoid, the vesselness and the minimum are computed per
+   * brick, in parallel across bricks. The lung wall and Canny features are
+   * not local and are still computed on the whole ROI, then folded in brick
+   * by brick. With vessel enhancing diffusion the vesselness is computed on
+   * the whole ROI too. Defaults to false. */
+  itkSetMacro( BrickStreamFeatures, bool );
+  itkGetMacro( BrickStreamFeatures, bool );
+  itkBooleanMacro( BrickStreamFeatures );
+
+  /** Edge length, in voxels, of the feature bricks. Defaults to 32. */
+  itkSetMacro( FeatureBrickSize, unsigned int );
+  itkGetMacro( FeatureBrickSize, unsigned int );
+
+  /** Evaluate the local features (intensity sigmoid and vesselness) lazily,
+   * tile by tile, only where the front goes. The segmentation starts with
+   * the tiles around the seeds, the feature being 0 on the other tiles. As
+   * long as the segmented region reaches into tiles next to unevaluated
+   * ones, those are evaluated and the level set evolves on from where it
+   * stopped; fast marching is not rerun. This implies
+   * StreamFeatureAggregation. Defaults to false. */
+  itkSetMacro( LazyFeatureEvaluation, bool );
+  itkGetMacro( LazyFeatureEvaluation, bool );
+  itkBooleanMacro( LazyFeatureEvaluation );
+
+  /** Number of tile expansions after which lazy evaluation gives up and
+   * evaluates all remaining tiles for a final evolution. Defaults to 8. */
+  itkSetMacro( MaximumNumberOfTileExpansions, unsigned int );
+  itkGetMacro( MaximumNumberOfTileExpansions, unsigned int );
+
+  /** Compute the Canny edge feature with the FusedCannyEdgesFeatureGenerator
+   * (fused edge classification and union-find hysteresis) instead of the
+   * CannyEdgesFeatureGenerator. Defaults to false. */
+  itkSetMacro( UseFusedCannyEdges, bool );
+  itkGetMacro( UseFusedCannyEdges, bool );
+  itkBooleanMacro( UseFusedCannyEdges );
+
+  /** Compute the vesselness only where there is tissue: voxels at or above
+   * the lung threshold, dilated by the Gaussian support. Bricks with no such
+   * voxel skip the Hessian and get the feature of a zero vesselness. This
+   * implies brick streamed vesselness, and has no effect with vessel
+   * enhancing diffusion. Defaults to false. */
+  itkSetMacro( SparseVesselness, bool );
+  itkGetMacro( SparseVesselness, bool );
+  itkBooleanMacro( SparseVesselness );
+
+  /** Bits per voxel of the feature caches kept between the passes of lazy
+   * feature evaluation: 16 for fixed point over [0,1], 32 for float. Only
+   * those caches are affected: without LazyFeatureEvaluation this has no
+   * effect, and the aggregated feature handed to the level set, as well as
+   * the speed image the level set derives from it, stay float. The change
+   * of the segmented volumes has not been measured on reference cases.
+   * Other values throw. Defaults to 32. */
+  virtual void SetFeatureStorageBits( unsigned int bits );
+  itkGetMacro( FeatureStorageBits, unsigned int );
+
+  /** Lung mask of the whole study, as computed by
+   * StudyLungWallMaskImageFilter. When set, the lung wall feature is
+   * resampled from it instead of being computed on the ROI, so the mask can
+   * be computed once and shared by all the nodules of a study. Defaults to
+   * none. */
+  void SetStudyLungMask( const MaskImageType * mask );
+  const MaskImageType * GetStudyLungMask() const;
+
+  /** Features prepared when the study was opened. When set, GenerateData()
+   * waits for the cache to be ready, then takes the lung wall feature from
+   * its lung mask (overriding StudyLungMask) and, unless vessel enhancing
+   * diffusion is on, the vesselness feature from its vesselness cache when
+   * the features are computed at its FeatureSpacing. Otherwise the
+   * vesselness is computed on the ROI as without a cache. Defaults to none. */
+  itkSetObjectMacro( StudyFeatureCache, StudyFeatureCacheType );
+  itkGetObjectMacro( StudyFeatureCache, StudyFeatureCacheType );
+
+  /** Peak resident memory wanted, in bytes. When the estimate for the
+   * requested spacing is over it, a supersampled spacing is coarsened until
+   * the estimate fits, up to the spacing without supersampling. A plan that
+   * still does not fit, or one at the native spacing that is over it, makes
+   * GenerateOutputInformation() throw, before anything is allocated. The
+   * estimate is computed from buffer sizes, not measured. Defaults to 0, no
+   * budget. */
+  itkSetMacro( MemoryBudget, ::itk::SizeValueType );
+  itkGetMacro( MemoryBudget, ::itk::SizeValueType );
+
+  /** Estimates for the current settings, as of the last
+   * GenerateOutputInformation(). The memory is in bytes, the runtime in
+   * seconds. Both are model estimates, not measurements. */
+  itkGetConstMacro( EstimatedPeakMemory, ::itk::SizeValueType );
+  itkGetConstMacro( EstimatedRuntime, double );
+
+  /** Time of one pass over one voxel, which scales the runtime estimate.
+   * The default of 5e-9 is a guess for one recent core, not a measurement:
+   * calibrate it with a timed run on the target machine. */
+  itkSetMacro( SecondsPerVoxelPass, double );
+  itkGetMacro( SecondsPerVoxelPass, double );
+
 	/** Use the GPU ? */
 	itkSetMacro(UseGPU, bool);
 	itkGetMacro(UseGPU, bool);
@@ -184,16 +453,142 @@ protected:
   typedef LungWallFeatureGenerator< ImageDimension >                LungWallGeneratorType;
   typedef SigmoidFeatureGenerator< ImageDimension >                 SigmoidFeatureGeneratorType;
   typedef MinimumFeatureAggregator< ImageDimension >                FeatureAggregatorType;
+  typedef SatoVesselnessFeatureGenerator< ImageDimension >          RawVesselnessGeneratorType;
+  typedef SigmoidBlockFeatureGenerator< ImageDimension >            SigmoidBlockFeatureGeneratorType;
+  typedef StreamingMinimumFeatureAggregator< ImageDimension >       StreamingFeatureAggregatorType;
+  typedef SatoVesselnessSigmoidBlockFeatureGenerator< ImageDimension > VesselnessBlockFeatureGeneratorType;
+  typedef LazyTileMinimumFeatureAggregator< ImageDimension >        LazyFeatureAggregatorType;
+  typedef FusedCannyEdgesFeatureGenerator< ImageDimension >         FusedCannyEdgesFeatureGeneratorType;
+  typedef FeatureGenerator< ImageDimension >                        FeatureGeneratorType;
+  typedef PrecomputedLungWallFeatureGenerator< ImageDimension >     PrecomputedLungWallGeneratorType;
+  typedef CachedBlockFeatureGenerator< ImageDimension >             CachedFeatureGeneratorType;
+  typedef ParallelVesselEnhancingDiffusion3DImageFilter<
+    InputImageType, InputImageType >                                VesselEnhancingDiffusionFilterType;
   typedef FastMarchingAndGeodesicActiveContourLevelSetSegmentationModule< ImageDimension > SegmentationModuleType;
   typedef RegionOfInterestImageFilter< InputImageType, InputImageType > CropFilterType;
   typedef typename SegmentationModuleType::SpatialObjectType        SpatialObjectType;
   typedef typename SegmentationModuleType::OutputSpatialObjectType  OutputSpatialObjectType;
   typedef ImageSpatialObject< ImageDimension, InputImagePixelType > InputImageSpatialObjectType;
   typedef IsotropicResamplerImageFilter< InputImageType, InputImageType > IsotropicResamplerType;
+  typedef ResampleImageFilter< InputImageType, InputImageType >     RegionResamplerType;
+  typedef BSplineInterpolateImageFunction< InputImageType, double > RegionInterpolatorType;
+  typedef SeparableIsotropicResamplerImageFilter<
+    InputImageType, InputImageType >                                SeparableResamplerType;
+  typedef SeparableIsotropicResamplerImageFilter<
+    OutputImageType, OutputImageType >                              LevelSetResamplerType;
+  typedef supersample::SupersampleVolume<
+    InputImagePixelType, float, InputImagePixelType >               SupersamplerType;
+  typedef Image< float, ImageDimension >                            FeatureImageType;
+  typedef ImageSpatialObject< ImageDimension, float >               FeatureSpatialObjectType;
+  typedef GeodesicActiveContourLevelSetImageFilter<
+    OutputImageType, FeatureImageType >                             RefinementFilterType;
   typedef typename RegionType::SizeType                             SizeType;
   typedef typename SizeType::SizeValueType                          SizeValueType;
   typedef MemberCommand< Self >                                     CommandType;
 
+  /** Hook the aggregator selected by StreamFeatureAggregation up to the
+   * lesion segmentation method. */
+  void ConnectFeatureAggregator();
+
+  bool UseStreamingFeatureAggregator() const;
+  bool UseVesselnessBlockFeature() const;
+  bool UseFastVesselEnhancingDiffusion() const;
+  /** Whether the vesselness of the study feature cache is used, on the
+   * current feature grid or on a grid of \a spacing. */
+  bool UseCachedVesselnessFeature() const;
+  bool UseCachedVesselnessFeature( const SpacingType & spacing ) const;
+  bool UseCoarseToFineRefinement() const;
+  bool UseAntiAliasedSupersampling() const;
+  StreamingFeatureAggregatorType * GetStreamingFeatureAggregator();
+
+  /** The Canny edge feature generator selected by UseFusedCannyEdges. */
+  FeatureGeneratorType * GetCannyEdgesFeatureGenerator();
+
+  /** The lung wall feature generator, precomputed if there is a study lung
+   * mask. */
+  FeatureGeneratorType * GetLungWallFeatureGenerator();
+
+  /** The whole image vesselness feature generator, cached if the study
+   * feature cache applies to the feature grid. */
+  FeatureGeneratorType * GetVesselnessFeatureGenerator();
+
+  /** Estimate the peak memory (bytes) and runtime (seconds) of a run
+   * producing the output at \a spacing, before anything is allocated. */
+  void EstimateResources( const SpacingType & spacing,
+                          SizeValueType & peakMemory, double & runtime ) const;
+
+  /** Peak memory (bytes) and work (voxel passes) of one segmentation of
+   * \a numberOfVoxels voxels at \a spacing, excluding the output. */
+  void EstimateSegmentationPass( const SpacingType & spacing, double numberOfVoxels,
+                                 double & peakMemory, double & work ) const;
+
+  /** Make \a image the input of the feature generators, running the fast
+   * vessel enhancing diffusion on it if enabled. */
+  void SetFeatureInputImage( InputImageType * image );
+
+  /** Run the segmentation, growing the evaluated tiles until the front is
+   * contained in them. */
+  void SegmentWithLazyFeatures();
+
+  /** Run the segmentation from InitialSegmentation instead of the seeds. */
+  void SegmentFromInitialSegmentation();
+
+  /** Evolve \a levelSet for \a iterations over the box of its segmentation
+   * grown by \a margin, on features resampled over that box. */
+  void EvolveAroundSegmentation( OutputImageType * levelSet, double margin,
+                                 unsigned int iterations );
+
+  /** Bring the coarse segmentation \a coarse onto the output grid, through
+   * the intermediate grids of the pyramid, refining it around its surface
+   * on each. */
+  typename OutputImageType::Pointer RefineOnOutputGrid( const OutputImageType * coarse );
+
+  /** Bring the level set \a coarse onto the grid of \a grid, refining it
+   * around its segmentation. */
+  typename OutputImageType::Pointer RefineOnGrid( const OutputImageType * coarse,
+                                                  const OutputImageType * grid );
+
+  /** Grid of intermediate level \a level of the pyramid, covering the
+   * output; level 0 is the coarse grid and the last level the output. */
+  typename OutputImageType::Pointer MakePyramidGrid( unsigned int level ) const;
+
+  /** Make the cropped input, resampled onto \a region of the output grid,
+   * the input of the feature generators. */
+  void SetFeatureInputRegion( const OutputImageRegionType & region );
+
+  /** Make the cropped input, resampled onto \a region of the grid of
+   * \a grid, the input of the feature generators. The resampling is the
+   * one GenerateData() uses for the whole grid, so the voxels are the same
+   * as those of the whole resampled ROI on that grid. */
+  void SetFeatureInputRegion( const OutputImageType * grid, const OutputImageRegionType & region );
+
+  /** Evolve \a levelSet over \a region for \a iterations of geodesic
+   * active contours, on the features of the current feature input; with
+   * lazy features, over all tiles unless \a activateAllTiles is false, in
+   * which case the active tiles are kept. */
+  void EvolveLevelSet( OutputImageType * levelSet, const OutputImageRegionType & region,
+                       unsigned int iterations, bool activateAllTiles = true );
+
+  /** Box of the output grid around the seeds, grown by \a radius. */
+  OutputImageRegionType GetSeedRegion( double radius ) const;
+
+  /** Whether the segmented surface of \a levelSet is near a face of
+   * \a region that is not a face of the output. If so \a contact is the
+   * box of the inside voxels near those faces. */
+  bool ReachesRegionBoundary( const OutputImageType * levelSet,
+                              const OutputImageRegionType & region,
+                              OutputImageRegionType & contact ) const;
+
+  /** \a levelSet linearly interpolated onto \a region of the output grid,
+   * \a outsideValue where it has no samples. */
+  typename OutputImageType::Pointer ResampleLevelSet( const OutputImageType * levelSet,
+                                                      const OutputImageRegionType & region,
+                                                      OutputImagePixelType outsideValue ) const;
+
+  /** Segment into the output, growing the box around the seeds until the
+   * segmented surface is contained in it. */
+  void SegmentWithAdaptiveRegion();
+
 	void WriteFeatureImages();
 	void WriteFeatureImage(FeatureGenerator< 3 > *);
 
@@ -211,18 +606,64 @@ private:
   typename SigmoidFeatureGeneratorType::Pointer       m_SigmoidFeatureGenerator;
   typename CannyEdgesFeatureGeneratorType::Pointer    m_CannyEdgesFeatureGenerator;
   typename FeatureAggregatorType::Pointer             m_FeatureAggregator;
+  typename RawVesselnessGeneratorType::Pointer        m_RawVesselnessFeatureGenerator;
+  typename SigmoidBlockFeatureGeneratorType::Pointer  m_SigmoidBlockFeatureGenerator;
+  typename StreamingFeatureAggregatorType::Pointer    m_StreamingFeatureAggregator;
+  typename VesselnessBlockFeatureGeneratorType::Pointer m_VesselnessBlockFeatureGenerator;
+  typename LazyFeatureAggregatorType::Pointer         m_LazyFeatureAggregator;
+  typename FusedCannyEdgesFeatureGeneratorType::Pointer m_FusedCannyEdgesFeatureGenerator;
+  typename VesselEnhancingDiffusionFilterType::Pointer m_VesselEnhancingDiffusionFilter;
+  typename PrecomputedLungWallGeneratorType::Pointer  m_PrecomputedLungWallFeatureGenerator;
+  typename CachedFeatureGeneratorType::Pointer        m_CachedVesselnessFeatureGenerator;
+  typename StudyFeatureCacheType::Pointer             m_StudyFeatureCache;
   typename SegmentationModuleType::Pointer            m_SegmentationModule;
   typename CropFilterType::Pointer                    m_CropFilter;
   typename IsotropicResamplerType::Pointer            m_IsotropicResampler;
+  typename SeparableResamplerType::Pointer            m_SeparableResampler;
+  typename SeparableResamplerType::Pointer            m_RefinementResampler;
+  typename RegionResamplerType::Pointer               m_RegionResampler;
+  typename LevelSetResamplerType::Pointer             m_LevelSetResampler;
+  typename RefinementFilterType::Pointer              m_RefinementFilter;
   typename CommandType::Pointer                       m_CommandObserver;
   RegionType                                          m_RegionOfInterest;
   std::string                                         m_StatusMessage;
   typename SeedSpatialObjectType::PointListType       m_Seeds;
   typename InputImageSpatialObjectType::Pointer       m_InputSpatialObject;
+  typename InputImageSpatialObjectType::Pointer       m_VesselnessInputSpatialObject;
   bool                                                m_ResampleThickSliceData;
   double                                              m_AnisotropyThreshold;
   bool                                                m_UserSpecifiedSigmas;
   double                                              m_IsotropicSampleSpacing;
+  bool                                                m_SeparableResampling;
+  bool                                                m_AntiAliasedSupersampling;
+  bool                                                m_CoarseToFineRefinement;
+  double                                              m_CoarseSpacing;
+  unsigned int                                        m_NumberOfPyramidLevels;
+  double                                              m_RefinementMargin;
+  unsigned int                                        m_RefinementIterations;
+  bool                                                m_AdaptiveRegionOfInterest;
+  double                                              m_InitialRegionRadius;
+  double                                              m_RegionGrowthFactor;
+  typename OutputImageType::ConstPointer              m_InitialSegmentation;
+  bool                                                m_InitialSegmentationIsMask;
+  typename InitialSegmentationTransformType::ConstPointer m_InitialSegmentationTransform;
+  unsigned int                                        m_WarmStartIterations;
+  double                                              m_WarmStartMargin;
+  SizeValueType                                       m_MemoryBudget;
+  SizeValueType                                       m_EstimatedPeakMemory;
+  double                                              m_EstimatedRuntime;
+  double                                              m_SecondsPerVoxelPass;
+  bool                                                m_StreamFeatureAggregation;
+  bool                                                m_BrickStreamFeatures;
+  unsigned int                                        m_FeatureBrickSize;
+  bool                                                m_UseVesselEnhancingDiffusion;
+  bool                                                m_LazyFeatureEvaluation;
+  unsigned int                                        m_MaximumNumberOfTileExpansions;
+  bool                                                m_UseFusedCannyEdges;
+  bool                                                m_SparseVesselness;
+  unsigned int                                        m_FeatureStorageBits;
+  bool                                                m_FastVesselEnhancingDiffusion;
+  bool                                                m_RestrictVesselEnhancingDiffusion;
 	bool m_WriteFeatureImages;
 	bool m_UseGPU;
 };
@@ -23,6 +23,14 @@
 #include "itkGradientMagnitudeImageFilter.h"
 #include "itkImageFileReader.h"
 #include "itkImageFileWriter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageAlgorithm.h"
+#include "itkMultiThreader.h"
+#include "itkResampleImageFilter.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 namespace itk
 {
@@ -39,10 +47,26 @@ LesionSegmentationImageFilterACM() :
   m_VesselnessFeatureGenerator = VesselnessGeneratorType::New();
   m_SigmoidFeatureGenerator = SigmoidFeatureGeneratorType::New();
   m_FeatureAggregator = FeatureAggregatorType::New();
+  m_RawVesselnessFeatureGenerator = RawVesselnessGeneratorType::New();
+  m_SigmoidBlockFeatureGenerator = SigmoidBlockFeatureGeneratorType::New();
+  m_StreamingFeatureAggregator = StreamingFeatureAggregatorType::New();
+  m_VesselnessBlockFeatureGenerator = VesselnessBlockFeatureGeneratorType::New();
+  m_LazyFeatureAggregator = LazyFeatureAggregatorType::New();
+  m_FusedCannyEdgesFeatureGenerator = FusedCannyEdgesFeatureGeneratorType::New();
+  m_VesselEnhancingDiffusionFilter = VesselEnhancingDiffusionFilterType::New();
+  m_PrecomputedLungWallFeatureGenerator = PrecomputedLungWallGeneratorType::New();
+  m_CachedVesselnessFeatureGenerator = CachedFeatureGeneratorType::New();
   m_SegmentationModule = SegmentationModuleType::New();
   m_CropFilter = CropFilterType::New();
   m_IsotropicResampler = IsotropicResamplerType::New();
+  m_SeparableResampler = SeparableResamplerType::New();
+  m_RefinementResampler = SeparableResamplerType::New();
+  m_RegionResampler = RegionResamplerType::New();
+  m_RegionResampler->SetInterpolator( RegionInterpolatorType::New() );
+  m_LevelSetResampler = LevelSetResamplerType::New();
+  m_RefinementFilter = RefinementFilterType::New();
   m_InputSpatialObject = InputImageSpatialObjectType::New();
+  m_VesselnessInputSpatialObject = InputImageSpatialObjectType::New();
 
   // Report progress.
   m_CommandObserver    = CommandType::New();
@@ -57,26 +81,49 @@ LesionSegmentationImageFilterACM() :
       itk::ProgressEvent(), m_CommandObserver );
   m_CannyEdgesFeatureGenerator->AddObserver(
       itk::ProgressEvent(), m_CommandObserver );
+  m_RawVesselnessFeatureGenerator->AddObserver(
+      itk::ProgressEvent(), m_CommandObserver );
+  m_StreamingFeatureAggregator->AddObserver(
+      itk::ProgressEvent(), m_CommandObserver );
+  m_LazyFeatureAggregator->AddObserver(
+      itk::ProgressEvent(), m_CommandObserver );
+  m_FusedCannyEdgesFeatureGenerator->AddObserver(
+      itk::ProgressEvent(), m_CommandObserver );
+  m_VesselEnhancingDiffusionFilter->AddObserver(
+      itk::ProgressEvent(), m_CommandObserver );
+  m_PrecomputedLungWallFeatureGenerator->AddObserver(
+      itk::ProgressEvent(), m_CommandObserver );
   m_SegmentationModule->AddObserver(
       itk::ProgressEvent(), m_CommandObserver );
   m_CropFilter->AddObserver(
       itk::ProgressEvent(), m_CommandObserver );
   m_IsotropicResampler->AddObserver(
       itk::ProgressEvent(), m_CommandObserver );
+  m_SeparableResampler->AddObserver(
+      itk::ProgressEvent(), m_CommandObserver );
+  m_RefinementFilter->AddObserver(
+      itk::ProgressEvent(), m_CommandObserver );
 
   // Connect pipeline
 //  m_LungWallFeatureGenerator2->SetInput( m_InputSpatialObject );
   m_LungWallFeatureGenerator->SetInput( m_InputSpatialObject );
   m_SigmoidFeatureGenerator->SetInput( m_InputSpatialObject );
-  m_VesselnessFeatureGenerator->SetInput( m_InputSpatialObject );
+  m_VesselnessFeatureGenerator->SetInput( m_VesselnessInputSpatialObject );
   m_CannyEdgesFeatureGenerator->SetInput( m_InputSpatialObject );
 //  m_FeatureAggregator->AddFeatureGenerator( m_LungWallFeatureGenerator2 );
   m_FeatureAggregator->AddFeatureGenerator( m_LungWallFeatureGenerator );
   m_FeatureAggregator->AddFeatureGenerator( m_VesselnessFeatureGenerator );
   m_FeatureAggregator->AddFeatureGenerator( m_SigmoidFeatureGenerator );
   m_FeatureAggregator->AddFeatureGenerator( m_CannyEdgesFeatureGenerator );
-  m_LesionSegmentationMethod->AddFeatureGenerator( m_FeatureAggregator );
-  m_LesionSegmentationMethod->SetSegmentationModule( m_SegmentationModule );
+
+  m_RawVesselnessFeatureGenerator->SetInput( m_VesselnessInputSpatialObject );
+  m_SigmoidBlockFeatureGenerator->SetInput( m_InputSpatialObject );
+  m_VesselnessBlockFeatureGenerator->SetInput( m_VesselnessInputSpatialObject );
+  m_StreamingFeatureAggregator->SetInput( m_InputSpatialObject );
+  m_LazyFeatureAggregator->SetInput( m_InputSpatialObject );
+  m_FusedCannyEdgesFeatureGenerator->SetInput( m_InputSpatialObject );
+  m_PrecomputedLungWallFeatureGenerator->SetInput( m_InputSpatialObject );
+  m_CachedVesselnessFeatureGenerator->SetInput( m_InputSpatialObject );
 
   // Populate some parameters
 //  m_LungWallFeatureGenerator2->SetLungThreshold( -400 );
@@ -86,11 +133,30 @@ LesionSegmentationImageFilterACM() :
   m_VesselnessFeatureGenerator->SetAlpha2( 2.0 );
   m_VesselnessFeatureGenerator->SetSigmoidAlpha( -10.0 );
   m_VesselnessFeatureGenerator->SetSigmoidBeta( 40.0 );
+  m_RawVesselnessFeatureGenerator->SetSigma( 1.0 );
+  m_RawVesselnessFeatureGenerator->SetAlpha1( 0.1 );
+  m_RawVesselnessFeatureGenerator->SetAlpha2( 2.0 );
+  m_VesselnessBlockFeatureGenerator->SetSigma( 1.0 );
+  m_VesselnessBlockFeatureGenerator->SetAlpha1( 0.1 );
+  m_VesselnessBlockFeatureGenerator->SetAlpha2( 2.0 );
+  m_VesselnessBlockFeatureGenerator->SetSigmoidAlpha( -10.0 );
+  m_VesselnessBlockFeatureGenerator->SetSigmoidBeta( 40.0 );
+  m_VesselnessBlockFeatureGenerator->SetActivityThreshold( -400.0 );
+  m_VesselEnhancingDiffusionFilter->SetActivityThreshold( -400.0 );
   m_SigmoidFeatureGenerator->SetAlpha( 100.0 );
   m_SigmoidFeatureGenerator->SetBeta( -500.0 );
+  m_SigmoidBlockFeatureGenerator->SetAlpha( 100.0 );
+  m_SigmoidBlockFeatureGenerator->SetBeta( -500.0 );
   m_CannyEdgesFeatureGenerator->SetSigma(0.5);
   m_CannyEdgesFeatureGenerator->SetUpperThreshold( 150.0 );
   m_CannyEdgesFeatureGenerator->SetLowerThreshold( 75.0 );
+  m_FusedCannyEdgesFeatureGenerator->SetSigma(0.5);
+  m_FusedCannyEdgesFeatureGenerator->SetUpperThreshold( 150.0 );
+  m_FusedCannyEdgesFeatureGenerator->SetLowerThreshold( 75.0 );
+  // Air, for the few output voxels past the edge of the ROI.
+  m_SeparableResampler->SetDefaultPixelValue( -1024 );
+  m_RefinementResampler->SetDefaultPixelValue( -1024 );
+  m_LevelSetResampler->SetResamplingMethod( LevelSetResamplerType::Linear );
   m_FastMarchingStoppingTime = 5.0;
   m_FastMarchingDistanceFromSeeds = 0.5;
   m_SigmoidBeta = -500.0;
@@ -104,6 +170,34 @@ LesionSegmentationImageFilterACM() :
   m_AnisotropyThreshold = 1.0;
   m_UserSpecifiedSigmas = false;
   m_IsotropicSampleSpacing = 0;
+  m_SeparableResampling = false;
+  m_AntiAliasedSupersampling = false;
+  m_CoarseToFineRefinement = false;
+  m_CoarseSpacing = 0.5;
+  m_NumberOfPyramidLevels = 2;
+  m_RefinementMargin = 2.0;
+  m_RefinementIterations = 50;
+  m_AdaptiveRegionOfInterest = false;
+  m_InitialRegionRadius = 10.0;
+  m_RegionGrowthFactor = 2.0;
+  m_InitialSegmentationIsMask = false;
+  m_WarmStartIterations = 50;
+  m_WarmStartMargin = 5.0;
+  m_MemoryBudget = 0;
+  m_EstimatedPeakMemory = 0;
+  m_EstimatedRuntime = 0.0;
+  m_SecondsPerVoxelPass = 5e-9;
+  m_StreamFeatureAggregation = false;
+  m_BrickStreamFeatures = false;
+  m_FeatureBrickSize = 32;
+  m_UseVesselEnhancingDiffusion = false;
+  m_LazyFeatureEvaluation = false;
+  m_MaximumNumberOfTileExpansions = 8;
+  m_UseFusedCannyEdges = false;
+  m_SparseVesselness = false;
+  m_FeatureStorageBits = 32;
+  m_FastVesselEnhancingDiffusion = true;
+  m_RestrictVesselEnhancingDiffusion = false;
 #ifdef USE_GPU
 	m_UseGPU = true;
 #else
@@ -136,6 +230,7 @@ LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
 {
   this->m_UserSpecifiedSigmas = true;
   m_CannyEdgesFeatureGenerator->SetSigmaArray(s);
+  m_FusedCannyEdgesFeatureGenerator->SetSigmaArray(s);
 }
 
 template <class TInputImage, class TOutputImage>
@@ -176,14 +271,58 @@ LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
     }
 
 
+  const SpacingType unsupersampledSpacing = outputSpacing;
   if (m_IsotropicSampleSpacing != 0)
     {
     outputSpacing[0] = m_IsotropicSampleSpacing;
     outputSpacing[1] = m_IsotropicSampleSpacing;
     outputSpacing[2] = m_IsotropicSampleSpacing;
     }
-  
-  if (m_ResampleThickSliceData || m_IsotropicSampleSpacing != 0)
+
+  // Check the plan against the memory budget before anything is allocated.
+  // Only supersampling gives resolution away: the isotropic spacing is
+  // coarsened until the estimate fits, up to the coarsest axis of the
+  // spacing without supersampling. A plan that still does not fit, at the
+  // native spacing too, is refused before anything is allocated.
+  this->EstimateResources( outputSpacing, m_EstimatedPeakMemory, m_EstimatedRuntime );
+  if (m_MemoryBudget != 0 && m_EstimatedPeakMemory > m_MemoryBudget)
+    {
+    double coarsest = outputSpacing[0];
+    for (int i = 0; i < ImageDimension; i++)
+      {
+      coarsest = std::max( coarsest, unsupersampledSpacing[i] );
+      }
+    while (m_IsotropicSampleSpacing != 0 && m_EstimatedPeakMemory > m_MemoryBudget &&
+           outputSpacing[0] < coarsest)
+      {
+      outputSpacing.Fill( std::min( outputSpacing[0] * 1.05, coarsest ) );
+      this->EstimateResources( outputSpacing, m_EstimatedPeakMemory, m_EstimatedRuntime );
+      }
+    if (m_EstimatedPeakMemory > m_MemoryBudget)
+      {
+      itkExceptionMacro("The segmentation needs an estimated "
+        << m_EstimatedPeakMemory / (1024 * 1024) << " MB at a spacing of "
+        << outputSpacing << ", over the memory budget of "
+        << m_MemoryBudget / (1024 * 1024) << " MB. Reduce the region of interest, "
+        "supersample less, or turn off the options that keep features around "
+        "(WriteFeatureImages).");
+      }
+    }
+
+  if (this->UseAntiAliasedSupersampling())
+    {
+    m_CropFilter->UpdateOutputInformation();
+    outputPtr->CopyInformation( SupersamplerType::GetOutputGeometry(
+      m_CropFilter->GetOutput(), true, outputSpacing[0] ) );
+    }
+  else if ((m_ResampleThickSliceData || m_IsotropicSampleSpacing != 0) && m_SeparableResampling)
+    {
+    m_SeparableResampler->SetInput( m_CropFilter->GetOutput() );
+    m_SeparableResampler->SetOutputSpacing( outputSpacing );
+    m_SeparableResampler->UpdateOutputInformation();
+    outputPtr->CopyInformation( m_SeparableResampler->GetOutput() );
+    }
+  else if (m_ResampleThickSliceData || m_IsotropicSampleSpacing != 0)
     {
     m_IsotropicResampler->SetInput( m_CropFilter->GetOutput() );
     m_IsotropicResampler->SetOutputSpacing( outputSpacing );
@@ -207,6 +346,7 @@ LesionSegmentationImageFilterACM< TInputImage, TOutputImage >
 //	m_LungWallFeatureGenerator->SetUseGPU(m_UseGPU);
 
   m_SigmoidFeatureGenerator->SetBeta( m_SigmoidBeta );
+  m_SigmoidBlockFeatureGenerator->SetBeta( m_SigmoidBeta );
   m_SegmentationModule->SetDistanceFromSeeds(m_FastMarchingDistanceFromSeeds);
   m_SegmentationModule->SetStoppingValue(m_FastMarchingStoppingTime);
 
@@ -220,9 +360,64 @@ LesionSegmentationImageFilterACM< TInputImage, TOutputImage >
   // Crop and perform thin slice resampling (done only if necessary)
   m_CropFilter->Update();
 
+  // Features prepared with the study. Cropping and resampling above overlap
+  // with whatever is left of that work.
+  if (m_StudyFeatureCache)
+    {
+    m_StatusMessage = "Waiting for the study features..";
+    m_StudyFeatureCache->Wait();
+    m_PrecomputedLungWallFeatureGenerator->SetStudyLungMask( m_StudyFeatureCache->GetLungMask() );
+    m_CachedVesselnessFeatureGenerator->SetCachedFeature(
+      m_StudyFeatureCache->GetVesselnessFeature() );
+    m_CachedVesselnessFeatureGenerator->SetOutsideValue(
+      m_StudyFeatureCache->GetVesselnessOutsideValue() );
+    }
+
+  if (m_InitialSegmentation)
+    {
+    this->SegmentFromInitialSegmentation();
+    this->WriteFeatureImages();
+    return;
+    }
+
+  if (m_AdaptiveRegionOfInterest)
+    {
+    this->SegmentWithAdaptiveRegion();
+    this->WriteFeatureImages();
+    return;
+    }
+
+  // The first pass of a coarse to fine segmentation runs at the coarse
+  // spacing; the output spacing is restored by GenerateOutputInformation().
+  const bool coarseToFine = this->UseCoarseToFineRefinement();
+  SpacingType coarseSpacing = this->GetOutput()->GetSpacing();
+  for (int i = 0; i < ImageDimension; i++)
+    {
+    coarseSpacing[i] = std::max( coarseSpacing[i], m_CoarseSpacing );
+    }
+
   typename InputImageType::Pointer inputImage = nullptr;
-  if (m_ResampleThickSliceData || m_IsotropicSampleSpacing != 0)
+  if (this->UseAntiAliasedSupersampling())
+    {
+    m_StatusMessage = "Supersampling data..";
+    inputImage = SupersamplerType::Execute( m_CropFilter->GetOutput(), true,
+      coarseToFine ? coarseSpacing[0] : this->GetOutput()->GetSpacing()[0] );
+    }
+  else if ((m_ResampleThickSliceData || m_IsotropicSampleSpacing != 0) && m_SeparableResampling)
+    {
+    if (coarseToFine)
+      {
+      m_SeparableResampler->SetOutputSpacing( coarseSpacing );
+      }
+    m_SeparableResampler->Update();
+    inputImage = this->m_SeparableResampler->GetOutput();
+    }
+  else if (m_ResampleThickSliceData || m_IsotropicSampleSpacing != 0)
     {
+    if (coarseToFine)
+      {
+      m_IsotropicResampler->SetOutputSpacing( coarseSpacing );
+      }
     m_IsotropicResampler->Update();
     inputImage = this->m_IsotropicResampler->GetOutput();
     }
@@ -236,35 +431,25 @@ LesionSegmentationImageFilterACM< TInputImage, TOutputImage >
   // the lesion segmentation method
 
   inputImage->DisconnectPipeline();
-  m_InputSpatialObject->SetImage(inputImage);
-
-  // Sigma for the canny is the max spacing of the original input (before
-  // resampling)
-
-	typename Superclass::OutputImagePointer outputPtr = this->GetOutput();
-	SpacingType outputSpacing = outputPtr->GetSpacing();
-	if (m_UserSpecifiedSigmas == false)
-    {
-    //double maxSpacing = NumericTraits< double >::min();
-    //for (int i = 0; i < ImageDimension; i++)
-    //  {
-    //  maxSpacing = (maxSpacing < input->GetSpacing()[i] ?
-    //                  input->GetSpacing()[i] : maxSpacing);
-    //  }
-    //m_CannyEdgesFeatureGenerator->SetSigma( maxSpacing );
-		m_CannyEdgesFeatureGenerator->SetSigma( 
-			(outputSpacing[0] + outputSpacing[1] + outputSpacing[2]) / 3.0 );
-	}
+  this->SetFeatureInputImage(inputImage);
 
   // Seeds
 
   typename SeedSpatialObjectType::Pointer seedSpatialObject =
     SeedSpatialObjectType::New();
   seedSpatialObject->SetPoints(m_Seeds);
+  this->ConnectFeatureAggregator();
   m_LesionSegmentationMethod->SetInitialSegmentation(seedSpatialObject);
 
   // Do the actual segmentation.
-  m_LesionSegmentationMethod->Update();
+  if (m_LazyFeatureEvaluation)
+    {
+    this->SegmentWithLazyFeatures();
+    }
+  else
+    {
+    m_LesionSegmentationMethod->Update();
+    }
 
 	// Write images if any
 	this->WriteFeatureImages();
@@ -277,6 +462,10 @@ LesionSegmentationImageFilterACM< TInputImage, TOutputImage >
   typename OutputImageType::Pointer outputImage =
     const_cast< OutputImageType * >(outputObject->GetImage());
   outputImage->DisconnectPipeline();
+  if (coarseToFine)
+    {
+    outputImage = this->RefineOnOutputGrid(outputImage);
+    }
   this->GraftOutput(outputImage);
 
   /* // DEBUGGING CODE
@@ -289,6 +478,1047 @@ LesionSegmentationImageFilterACM< TInputImage, TOutputImage >
 }
 
 
+template <class TInputImage, class TOutputImage>
+bool
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::UseStreamingFeatureAggregator() const
+{
+  return m_StreamFeatureAggregation || m_BrickStreamFeatures || m_LazyFeatureEvaluation ||
+    m_SparseVesselness;
+}
+
+template <class TInputImage, class TOutputImage>
+bool
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::UseVesselnessBlockFeature() const
+{
+  // The toolkit's vessel enhancing diffusion runs inside the whole-image
+  // generator, so it rules out per-block vesselness. The fast one runs
+  // beforehand and does not.
+  return (m_BrickStreamFeatures || m_LazyFeatureEvaluation || m_SparseVesselness) &&
+    (!m_UseVesselEnhancingDiffusion || m_FastVesselEnhancingDiffusion);
+}
+
+template <class TInputImage, class TOutputImage>
+bool
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::UseFastVesselEnhancingDiffusion() const
+{
+  return m_UseVesselEnhancingDiffusion && m_FastVesselEnhancingDiffusion;
+}
+
+template <class TInputImage, class TOutputImage>
+bool
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::UseCachedVesselnessFeature() const
+{
+  const InputImageType * featureInput = m_InputSpatialObject->GetImage();
+  return featureInput && this->UseCachedVesselnessFeature( featureInput->GetSpacing() );
+}
+
+template <class TInputImage, class TOutputImage>
+bool
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::UseCachedVesselnessFeature( const SpacingType & spacing ) const
+{
+  // The cache holds the vesselness of the undiffused image, computed at its
+  // feature spacing (the study spacing if that is 0). The vesselness of
+  // another grid is not the same feature.
+  if (!m_StudyFeatureCache || m_UseVesselEnhancingDiffusion)
+    {
+    return false;
+    }
+  SpacingType cacheSpacing = this->GetInput()->GetSpacing();
+  if (m_StudyFeatureCache->GetFeatureSpacing() > 0)
+    {
+    cacheSpacing.Fill( m_StudyFeatureCache->GetFeatureSpacing() );
+    }
+  for (int i = 0; i < ImageDimension; i++)
+    {
+    if (std::abs( spacing[i] - cacheSpacing[i] ) > 1e-6 * cacheSpacing[i])
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+template <class TInputImage, class TOutputImage>
+bool
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::UseCoarseToFineRefinement() const
+{
+  if (!m_CoarseToFineRefinement || m_AdaptiveRegionOfInterest ||
+      !(m_ResampleThickSliceData || m_IsotropicSampleSpacing != 0))
+    {
+    return false;
+    }
+  const SpacingType & spacing = this->GetOutput()->GetSpacing();
+  for (int i = 0; i < ImageDimension; i++)
+    {
+    if (spacing[i] < m_CoarseSpacing)
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+template <class TInputImage, class TOutputImage>
+bool
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::UseAntiAliasedSupersampling() const
+{
+  // SupersampleVolume only produces isotropic images.
+  return m_AntiAliasedSupersampling && m_IsotropicSampleSpacing != 0;
+}
+
+template <class TInputImage, class TOutputImage>
+typename LesionSegmentationImageFilterACM<TInputImage,TOutputImage>::StreamingFeatureAggregatorType *
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::GetStreamingFeatureAggregator()
+{
+  if (m_LazyFeatureEvaluation)
+    {
+    return m_LazyFeatureAggregator.GetPointer();
+    }
+  return m_StreamingFeatureAggregator.GetPointer();
+}
+
+template <class TInputImage, class TOutputImage>
+typename LesionSegmentationImageFilterACM<TInputImage,TOutputImage>::FeatureGeneratorType *
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::GetCannyEdgesFeatureGenerator()
+{
+  if (m_UseFusedCannyEdges)
+    {
+    return m_FusedCannyEdgesFeatureGenerator.GetPointer();
+    }
+  return m_CannyEdgesFeatureGenerator.GetPointer();
+}
+
+template <class TInputImage, class TOutputImage>
+typename LesionSegmentationImageFilterACM<TInputImage,TOutputImage>::FeatureGeneratorType *
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::GetLungWallFeatureGenerator()
+{
+  if (m_PrecomputedLungWallFeatureGenerator->GetStudyLungMask())
+    {
+    return m_PrecomputedLungWallFeatureGenerator.GetPointer();
+    }
+  return m_LungWallFeatureGenerator.GetPointer();
+}
+
+template <class TInputImage, class TOutputImage>
+typename LesionSegmentationImageFilterACM<TInputImage,TOutputImage>::FeatureGeneratorType *
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::GetVesselnessFeatureGenerator()
+{
+  if (this->UseCachedVesselnessFeature())
+    {
+    return m_CachedVesselnessFeatureGenerator.GetPointer();
+    }
+  return m_VesselnessFeatureGenerator.GetPointer();
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::SetStudyLungMask( const MaskImageType * mask )
+{
+  m_PrecomputedLungWallFeatureGenerator->SetStudyLungMask( mask );
+  this->Modified();
+}
+
+template <class TInputImage, class TOutputImage>
+const typename LesionSegmentationImageFilterACM<TInputImage,TOutputImage>::MaskImageType *
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::GetStudyLungMask() const
+{
+  return m_PrecomputedLungWallFeatureGenerator->GetStudyLungMask();
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::EstimateSegmentationPass( const SpacingType & spacing, double n,
+                            double & peakMemory, double & work ) const
+{
+  // Bytes per voxel of what each stage keeps and of its own scratch, and
+  // passes over the voxels each stage makes. The bytes are counted from the
+  // buffers each stage allocates, ignoring allocator overhead and the
+  // toolkit's own temporaries. The passes are relative costs read off the
+  // algorithms, not timings; SecondsPerVoxelPass turns them into seconds.
+  // None of these has been checked against a measured run.
+  const double inputBytes = sizeof( InputImagePixelType );
+  const double realBytes = sizeof( float );
+  const double levelSetBytes = sizeof( OutputImagePixelType );
+  const double threads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+  const bool streaming = this->UseStreamingFeatureAggregator();
+
+  // The resampled input, and the diffused copy the vesselness may read.
+  double resident = inputBytes;
+  double scratch = 0.0;
+  double parallelWork = 0.0;
+  if (this->UseFastVesselEnhancingDiffusion())
+    {
+    resident += inputBytes;
+    // Two float buffers, six tensor components and the activity mask.
+    scratch = 8.0 * realBytes + 1.0;
+    parallelWork += 100.0;
+    }
+
+  // Whole image features: output and scratch per voxel, and passes.
+  struct Stage { double Output; double Scratch; double Passes; };
+  std::vector< Stage > regular;
+  std::vector< Stage > block;
+  if (this->GetStudyLungMask() || m_StudyFeatureCache)
+    {
+    regular.push_back( Stage{ realBytes, 0.0, 2.0 } );
+    }
+  else
+    {
+    regular.push_back( Stage{ realBytes, 3.0 * realBytes, 30.0 } );
+    }
+  if (m_UseFusedCannyEdges)
+    {
+    regular.push_back( Stage{ realBytes, 2.0 * realBytes, 12.0 } );
+    }
+  else
+    {
+    regular.push_back( Stage{ realBytes, 4.0 * realBytes, 20.0 } );
+    }
+  const Stage sigmoid = { realBytes, 0.0, 1.0 };
+  const bool cachedVesselness = this->UseCachedVesselnessFeature( spacing );
+  const Stage vesselness = cachedVesselness ?
+    Stage{ realBytes, 0.0, 2.0 } :
+    ( m_UseVesselEnhancingDiffusion && !m_FastVesselEnhancingDiffusion ?
+      Stage{ realBytes, 10.0 * realBytes, 300.0 } :
+      Stage{ realBytes, 7.0 * realBytes, 40.0 } );
+  if (streaming)
+    {
+    block.push_back( sigmoid );
+    if (cachedVesselness || this->UseVesselnessBlockFeature())
+      {
+      block.push_back( vesselness );
+      }
+    else
+      {
+      regular.push_back( vesselness );
+      }
+    }
+  else
+    {
+    regular.push_back( sigmoid );
+    regular.push_back( vesselness );
+    }
+
+  // The plain aggregator keeps every feature; the streaming one folds them
+  // into its output and drops them unless they are to be written. Lazy
+  // evaluation also caches the regular minimum and each block feature.
+  double features = realBytes;
+  double featureScratch = 0.0;
+  for (typename std::vector< Stage >::const_iterator it = regular.begin(); it != regular.end(); ++it)
+    {
+    if (!streaming || m_WriteFeatureImages)
+      {
+      features += it->Output;
+      featureScratch = std::max( featureScratch, it->Scratch );
+      }
+    else
+      {
+      featureScratch = std::max( featureScratch, it->Output + it->Scratch );
+      }
+    parallelWork += it->Passes;
+    }
+  for (typename std::vector< Stage >::const_iterator it = block.begin(); it != block.end(); ++it)
+    {
+    if (m_WriteFeatureImages)
+      {
+      features += it->Output;
+      }
+    parallelWork += it->Passes;
+    }
+  if (m_LazyFeatureEvaluation)
+    {
+    features += ( 1 + block.size() ) * ( m_FeatureStorageBits == 16 ? 2.0 : realBytes );
+    }
+
+  // Fast marching (output and labels), then geodesic active contours
+  // (input, output, speed and status). The level set solvers run on one
+  // thread, over a narrow band of the surface.
+  const double segmentationScratch = 3.0 * levelSetBytes + realBytes + 2.0;
+  const double bandVoxels = 50.0 * std::pow( n, 2.0 / 3.0 );
+  const double serialWork = 10.0 * n +
+    m_SegmentationModule->GetMaximumNumberOfIterations() * bandVoxels;
+
+  peakMemory = n * ( resident + std::max( scratch,
+    std::max( features + featureScratch, features + segmentationScratch ) ) );
+  work = n * parallelWork / threads + serialWork;
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::EstimateResources( const SpacingType & spacing,
+                     SizeValueType & peakMemory, double & runtime ) const
+{
+  const InputImageType * input = this->GetInput();
+  const double inputBytes = sizeof( InputImagePixelType );
+  const double levelSetBytes = sizeof( OutputImagePixelType );
+  const double threads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+
+  // Voxels of the ROI as cropped, and at a spacing.
+  const double nativeVoxels = m_RegionOfInterest.GetNumberOfPixels();
+  auto numberOfVoxels = [&]( const SpacingType & s )
+    {
+    double n = 1.0;
+    for (int i = 0; i < ImageDimension; i++)
+      {
+      n *= std::max( 1.0, std::floor(
+        m_RegionOfInterest.GetSize()[i] * input->GetSpacing()[i] / s[i] + 1e-6 ) );
+      }
+    return n;
+    };
+
+  // The coarse pass of a coarse to fine run, or the only pass.
+  bool coarseToFine = false;
+  SpacingType passSpacing = spacing;
+  if (m_CoarseToFineRefinement && (m_ResampleThickSliceData || m_IsotropicSampleSpacing != 0))
+    {
+    for (int i = 0; i < ImageDimension; i++)
+      {
+      coarseToFine = coarseToFine || spacing[i] < m_CoarseSpacing;
+      passSpacing[i] = std::max( spacing[i], m_CoarseSpacing );
+      }
+    }
+  const double outputVoxels = numberOfVoxels( spacing );
+  const double passVoxels = coarseToFine ? numberOfVoxels( passSpacing ) : outputVoxels;
+
+  // Resampling: the separable resampler holds two float copies, the
+  // generic one a double B-spline coefficient image of the ROI, and
+  // SupersampleVolume only slices.
+  double resampleScratch = 0.0;
+  double resampleWork = 0.0;
+  if (m_ResampleThickSliceData || m_IsotropicSampleSpacing != 0)
+    {
+    if (this->UseAntiAliasedSupersampling())
+      {
+      resampleWork = 4.0 * passVoxels;
+      }
+    else if (m_SeparableResampling)
+      {
+      resampleScratch = 2.0 * sizeof( float ) * passVoxels;
+      resampleWork = 12.0 * passVoxels;
+      }
+    else
+      {
+      resampleScratch = sizeof( double ) * nativeVoxels;
+      resampleWork = 64.0 * passVoxels;
+      }
+    }
+
+  double passMemory = 0.0;
+  double passWork = 0.0;
+  this->EstimateSegmentationPass( passSpacing, passVoxels, passMemory, passWork );
+  double peak = std::max( resampleScratch, passMemory );
+  double work = resampleWork / threads + passWork;
+
+  if (coarseToFine)
+    {
+    // On each finer grid, the previous level set, the upsampled one, and a
+    // pass over the box around the segmentation, taken to be half the ROI
+    // along each axis.
+    double previousVoxels = passVoxels;
+    for (unsigned int level = 1; level < m_NumberOfPyramidLevels; level++)
+      {
+      const double fraction = static_cast< double >( level ) / ( m_NumberOfPyramidLevels - 1 );
+      SpacingType levelSpacing;
+      for (int i = 0; i < ImageDimension; i++)
+        {
+        levelSpacing[i] = passSpacing[i] * std::pow( spacing[i] / passSpacing[i], fraction );
+        }
+      const double levelVoxels = level + 1 < m_NumberOfPyramidLevels ?
+        numberOfVoxels( levelSpacing ) : outputVoxels;
+      double refineMemory = 0.0;
+      double refineWork = 0.0;
+      this->EstimateSegmentationPass( levelSpacing, levelVoxels / 8.0, refineMemory, refineWork );
+      peak = std::max( peak, levelSetBytes * ( previousVoxels + levelVoxels ) + refineMemory );
+      work += ( 4.0 * levelVoxels ) / threads + refineWork;
+      previousVoxels = levelVoxels;
+      }
+    }
+
+  // The cropped ROI and the output are alive throughout.
+  peakMemory = static_cast< SizeValueType >(
+    inputBytes * nativeVoxels + levelSetBytes * outputVoxels + peak );
+  runtime = work * m_SecondsPerVoxelPass;
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::SetFeatureInputImage( InputImageType * image )
+{
+  m_InputSpatialObject->SetImage(image);
+
+  // The vesselness features read the diffused image when the fast vessel
+  // enhancing diffusion is on, and the toolkit's diffusion is used otherwise.
+  const bool toolkitDiffusion =
+    m_UseVesselEnhancingDiffusion && !this->UseFastVesselEnhancingDiffusion();
+  m_VesselnessFeatureGenerator->SetUseVesselEnhancingDiffusion( toolkitDiffusion );
+  m_RawVesselnessFeatureGenerator->SetUseVesselEnhancingDiffusion( toolkitDiffusion );
+  if (this->UseFastVesselEnhancingDiffusion())
+    {
+    m_VesselEnhancingDiffusionFilter->SetRestrictToActivityMask( m_RestrictVesselEnhancingDiffusion );
+    m_VesselEnhancingDiffusionFilter->SetInput( image );
+    m_VesselEnhancingDiffusionFilter->Update();
+    typename InputImageType::Pointer diffusedImage = m_VesselEnhancingDiffusionFilter->GetOutput();
+    diffusedImage->DisconnectPipeline();
+    m_VesselnessInputSpatialObject->SetImage(diffusedImage);
+    }
+  else
+    {
+    m_VesselnessInputSpatialObject->SetImage(image);
+    }
+
+  // Sigma for the canny is the mean spacing the features are computed at.
+	SpacingType spacing = image->GetSpacing();
+	if (m_UserSpecifiedSigmas == false)
+    {
+    //double maxSpacing = NumericTraits< double >::min();
+    //for (int i = 0; i < ImageDimension; i++)
+    //  {
+    //  maxSpacing = (maxSpacing < input->GetSpacing()[i] ?
+    //                  input->GetSpacing()[i] : maxSpacing);
+    //  }
+    //m_CannyEdgesFeatureGenerator->SetSigma( maxSpacing );
+		m_CannyEdgesFeatureGenerator->SetSigma( 
+			(spacing[0] + spacing[1] + spacing[2]) / 3.0 );
+		m_FusedCannyEdgesFeatureGenerator->SetSigma(
+			(spacing[0] + spacing[1] + spacing[2]) / 3.0 );
+	}
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::SegmentWithLazyFeatures()
+{
+  // Start with the tiles fast marching can reach from the seeds: the feature
+  // is at most 1, so the front travels at most the stopping time in mm.
+  m_LazyFeatureAggregator->ResetTiles();
+  for (typename PointListType::const_iterator it = m_Seeds.begin(); it != m_Seeds.end(); ++it)
+    {
+    m_LazyFeatureAggregator->ActivateTilesAround(
+      it->GetPosition(), m_FastMarchingStoppingTime + m_FastMarchingDistanceFromSeeds );
+    }
+
+  // Voxels at or above this value are inside, or within about one unit of,
+  // the segmented surface (iso-value -0.5).
+  const double frontThreshold = -1.5;
+
+  // Fast marching and geodesic active contours once, from the seeds.
+  m_LesionSegmentationMethod->Modified();
+  m_SegmentationModule->Modified();
+  m_LesionSegmentationMethod->Update();
+
+  // Each expansion carries on from the level set of the previous pass, in
+  // the module's output, on the features of the newly activated tiles. The
+  // evolution stops on the module's RMS criterion, so a front that only
+  // has a little way to go costs few iterations.
+  const OutputSpatialObjectType * outputObject =
+    dynamic_cast< const OutputSpatialObjectType * >( m_SegmentationModule->GetOutput() );
+  OutputImageType * levelSet = const_cast< OutputImageType * >( outputObject->GetImage() );
+  unsigned int expansions = 0;
+  while (!this->GetAbortGenerateData() &&
+         m_LazyFeatureAggregator->ActivateTilesTouchedBy( levelSet, frontThreshold ) != 0)
+    {
+    if (++expansions >= m_MaximumNumberOfTileExpansions)
+      {
+      // Still growing; finish on the complete feature, so that the front is
+      // not held back by tiles left unevaluated.
+      m_LazyFeatureAggregator->ActivateAllTiles();
+      this->EvolveLevelSet( levelSet, levelSet->GetBufferedRegion(),
+                            m_SegmentationModule->GetMaximumNumberOfIterations(), false );
+      break;
+      }
+    this->EvolveLevelSet( levelSet, levelSet->GetBufferedRegion(),
+                          m_SegmentationModule->GetMaximumNumberOfIterations(), false );
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::SetFeatureInputRegion( const OutputImageRegionType & region )
+{
+  this->SetFeatureInputRegion( this->GetOutput(), region );
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::SetFeatureInputRegion( const OutputImageType * grid, const OutputImageRegionType & region )
+{
+  // The cropped data resampled onto the grid, over the region only, the way
+  // GenerateData() resamples it.
+  const InputImageType * crop = m_CropFilter->GetOutput();
+  typename OutputImageType::Pointer regionGrid = OutputImageType::New();
+  regionGrid->CopyInformation( grid );
+  regionGrid->SetLargestPossibleRegion( region );
+  typename InputImageType::Pointer image = nullptr;
+  if (this->UseAntiAliasedSupersampling())
+    {
+    image = SupersamplerType::ExecuteOnGrid( crop, grid, region );
+    image->SetLargestPossibleRegion( region );
+    }
+  else if ((m_ResampleThickSliceData || m_IsotropicSampleSpacing != 0) && m_SeparableResampling)
+    {
+    m_RefinementResampler->SetInput( crop );
+    m_RefinementResampler->SetOutputParametersFromImage( regionGrid );
+    m_RefinementResampler->Update();
+    image = m_RefinementResampler->GetOutput();
+    image->DisconnectPipeline();
+    }
+  else if (m_ResampleThickSliceData || m_IsotropicSampleSpacing != 0)
+    {
+    // The ResampleImageFilter and cubic B-spline of the
+    // IsotropicResamplerImageFilter, at the points of the region only. The
+    // B-spline coefficients are those of the whole cropped data.
+    m_RegionResampler->SetInput( crop );
+    m_RegionResampler->SetOutputParametersFromImage( regionGrid );
+    m_RegionResampler->Update();
+    image = m_RegionResampler->GetOutput();
+    image->DisconnectPipeline();
+    }
+  else
+    {
+    // The grid is that of the cropped data.
+    image = InputImageType::New();
+    image->CopyInformation( crop );
+    image->SetRegions( region );
+    image->Allocate();
+    ImageAlgorithm::Copy( crop, image.GetPointer(), region, region );
+    }
+  this->SetFeatureInputImage( image );
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::EvolveLevelSet( OutputImageType * levelSet, const OutputImageRegionType & region,
+                  unsigned int iterations, bool activateAllTiles )
+{
+  // Iso-value of the segmented surface; the inside is above it.
+  const double isoValue = -0.5;
+
+  // Features over the region, with the aggregator of the last segmentation.
+  FeatureGeneratorType * aggregator = m_FeatureAggregator.GetPointer();
+  if (this->UseStreamingFeatureAggregator())
+    {
+    aggregator = this->GetStreamingFeatureAggregator();
+    }
+  if (m_LazyFeatureEvaluation && activateAllTiles)
+    {
+    m_LazyFeatureAggregator->ResetTiles();
+    m_LazyFeatureAggregator->ActivateAllTiles();
+    }
+  aggregator->Update();
+  const FeatureSpatialObjectType * featureObject =
+    dynamic_cast< const FeatureSpatialObjectType * >( aggregator->GetFeature() );
+
+  // Geodesic active contours take the inside negative and the surface at 0.
+  typename OutputImageType::Pointer initialLevelSet = OutputImageType::New();
+  initialLevelSet->CopyInformation( levelSet );
+  initialLevelSet->SetRegions( region );
+  initialLevelSet->Allocate();
+  ImageRegionConstIterator< OutputImageType > lit( levelSet, region );
+  ImageRegionIterator< OutputImageType > iit( initialLevelSet, region );
+  for (; !iit.IsAtEnd(); ++iit, ++lit)
+    {
+    iit.Set( static_cast< OutputImagePixelType >( isoValue - lit.Get() ) );
+    }
+
+  // With the parameters of the segmentation module.
+  m_RefinementFilter->SetInput( initialLevelSet );
+  m_RefinementFilter->SetFeatureImage( featureObject->GetImage() );
+  m_RefinementFilter->SetCurvatureScaling( m_SegmentationModule->GetCurvatureScaling() );
+  m_RefinementFilter->SetAdvectionScaling( m_SegmentationModule->GetAdvectionScaling() );
+  m_RefinementFilter->SetPropagationScaling( m_SegmentationModule->GetPropagationScaling() );
+  m_RefinementFilter->SetMaximumRMSError( m_SegmentationModule->GetMaximumRMSError() );
+  m_RefinementFilter->SetNumberOfIterations( iterations );
+  m_RefinementFilter->Update();
+
+  ImageRegionConstIterator< OutputImageType > rit( m_RefinementFilter->GetOutput(), region );
+  ImageRegionIterator< OutputImageType > oit( levelSet, region );
+  for (; !oit.IsAtEnd(); ++oit, ++rit)
+    {
+    oit.Set( static_cast< OutputImagePixelType >( isoValue - rit.Get() ) );
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+typename LesionSegmentationImageFilterACM<TInputImage,TOutputImage>::OutputImageType::Pointer
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::RefineOnOutputGrid( const OutputImageType * coarse )
+{
+  // Each intermediate grid starts from the level set of the previous one.
+  typename OutputImageType::ConstPointer levelSet = coarse;
+  for (unsigned int level = 1; level + 1 < m_NumberOfPyramidLevels; level++)
+    {
+    if (this->GetAbortGenerateData())
+      {
+      break;
+      }
+    typename OutputImageType::Pointer grid = this->MakePyramidGrid( level );
+    levelSet = this->RefineOnGrid( levelSet, grid );
+    }
+  return this->RefineOnGrid( levelSet, this->GetOutput() );
+}
+
+template <class TInputImage, class TOutputImage>
+typename LesionSegmentationImageFilterACM<TInputImage,TOutputImage>::OutputImageType::Pointer
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::MakePyramidGrid( unsigned int level ) const
+{
+  typedef typename OutputImageType::PointType   OutputPointType;
+
+  // Spacings geometrically between the coarse and the output ones, over the
+  // physical extent of the output.
+  const OutputImageType * output = this->GetOutput();
+  const OutputImageRegionType & outputRegion = output->GetLargestPossibleRegion();
+  const SpacingType & outputSpacing = output->GetSpacing();
+  const double fraction = static_cast< double >( level ) / ( m_NumberOfPyramidLevels - 1 );
+  SpacingType spacing;
+  OutputImageRegionType region;
+  Vector< double, ImageDimension > corner;
+  Vector< double, ImageDimension > halfVoxel;
+  for (int i = 0; i < ImageDimension; i++)
+    {
+    const double coarseSpacing = std::max( outputSpacing[i], m_CoarseSpacing );
+    spacing[i] = coarseSpacing * std::pow( outputSpacing[i] / coarseSpacing, fraction );
+    corner[i] = ( outputRegion.GetIndex()[i] - 0.5 ) * outputSpacing[i];
+    halfVoxel[i] = 0.5 * spacing[i];
+    region.SetIndex( i, 0 );
+    region.SetSize( i, static_cast< SizeValueType >( std::ceil(
+      outputRegion.GetSize()[i] * outputSpacing[i] / spacing[i] - 1e-6 ) ) );
+    }
+  OutputPointType origin = output->GetOrigin() + output->GetDirection() * corner;
+  origin += output->GetDirection() * halfVoxel;
+
+  typename OutputImageType::Pointer grid = OutputImageType::New();
+  grid->SetOrigin( origin );
+  grid->SetSpacing( spacing );
+  grid->SetDirection( output->GetDirection() );
+  grid->SetRegions( region );
+  return grid;
+}
+
+template <class TInputImage, class TOutputImage>
+typename LesionSegmentationImageFilterACM<TInputImage,TOutputImage>::OutputImageType::Pointer
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::RefineOnGrid( const OutputImageType * coarse, const OutputImageType * grid )
+{
+  // The coarse level set, linearly interpolated onto the grid. The few
+  // voxels past its last sample are outside.
+  m_StatusMessage = "Upsampling the coarse segmentation..";
+  const OutputImagePixelType lowest = *std::min_element( coarse->GetBufferPointer(),
+    coarse->GetBufferPointer() + coarse->GetBufferedRegion().GetNumberOfPixels() );
+  m_LevelSetResampler->SetInput( coarse );
+  m_LevelSetResampler->SetOutputParametersFromImage( grid );
+  m_LevelSetResampler->SetDefaultPixelValue( lowest );
+  m_LevelSetResampler->Update();
+  typename OutputImageType::Pointer levelSet = m_LevelSetResampler->GetOutput();
+  levelSet->DisconnectPipeline();
+
+  this->EvolveAroundSegmentation( levelSet, m_RefinementMargin, m_RefinementIterations );
+  return levelSet;
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::EvolveAroundSegmentation( OutputImageType * levelSet, double margin, unsigned int iterations )
+{
+  typedef typename OutputImageType::RegionType  OutputRegionType;
+  typedef typename OutputImageType::IndexType   OutputIndexType;
+
+  // Iso-value of the segmented surface; the inside is above it.
+  const double isoValue = -0.5;
+
+  // Bounding box of the segmentation, grown by the margin.
+  const OutputRegionType outputRegion = levelSet->GetBufferedRegion();
+  OutputIndexType lower = outputRegion.GetUpperIndex();
+  OutputIndexType upper = outputRegion.GetIndex();
+  bool empty = true;
+  for (ImageRegionConstIteratorWithIndex< OutputImageType > it( levelSet, outputRegion );
+       !it.IsAtEnd(); ++it)
+    {
+    if (it.Get() >= isoValue)
+      {
+      const OutputIndexType & index = it.GetIndex();
+      for (int i = 0; i < ImageDimension; i++)
+        {
+        lower[i] = std::min( lower[i], index[i] );
+        upper[i] = std::max( upper[i], index[i] );
+        }
+      empty = false;
+      }
+    }
+  if (empty || this->GetAbortGenerateData())
+    {
+    return;
+    }
+  OutputRegionType band;
+  for (int i = 0; i < ImageDimension; i++)
+    {
+    const IndexValueType voxels = static_cast< IndexValueType >(
+      std::ceil( margin / levelSet->GetSpacing()[i] ) );
+    band.SetIndex( i, lower[i] - voxels );
+    band.SetSize( i, static_cast< SizeValueType >( upper[i] - lower[i] + 1 + 2 * voxels ) );
+    }
+  band.Crop( outputRegion );
+
+  m_StatusMessage = "Resampling data around the segmentation..";
+  this->SetFeatureInputRegion( levelSet, band );
+  this->EvolveLevelSet( levelSet, band, iterations );
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::SegmentFromInitialSegmentation()
+{
+  typedef ResampleImageFilter< OutputImageType, OutputImageType >       ResamplerType;
+  typedef LinearInterpolateImageFunction< OutputImageType, double >     InterpolatorType;
+
+  // A mask becomes a level set of the output's iso-value, halfway between
+  // the voxels inside and outside.
+  typename OutputImageType::ConstPointer prior = m_InitialSegmentation;
+  if (m_InitialSegmentationIsMask)
+    {
+    typename OutputImageType::Pointer levelSet = OutputImageType::New();
+    levelSet->CopyInformation( m_InitialSegmentation );
+    levelSet->SetRegions( m_InitialSegmentation->GetBufferedRegion() );
+    levelSet->Allocate();
+    ImageRegionConstIterator< OutputImageType > mit( m_InitialSegmentation,
+      m_InitialSegmentation->GetBufferedRegion() );
+    ImageRegionIterator< OutputImageType > lit( levelSet, levelSet->GetBufferedRegion() );
+    for (; !lit.IsAtEnd(); ++lit, ++mit)
+      {
+      lit.Set( static_cast< OutputImagePixelType >(
+        mit.Get() != NumericTraits< OutputImagePixelType >::Zero ? 0.5 : -1.5 ) );
+      }
+    prior = levelSet;
+    }
+
+  // The prior, linearly interpolated onto the output grid. Voxels it does
+  // not cover are outside.
+  m_StatusMessage = "Resampling the initial segmentation..";
+  const OutputImagePixelType lowest = *std::min_element( prior->GetBufferPointer(),
+    prior->GetBufferPointer() + prior->GetBufferedRegion().GetNumberOfPixels() );
+  typename ResamplerType::Pointer resampler = ResamplerType::New();
+  resampler->SetInput( prior );
+  resampler->SetInterpolator( InterpolatorType::New() );
+  if (m_InitialSegmentationTransform)
+    {
+    resampler->SetTransform( m_InitialSegmentationTransform );
+    }
+  resampler->SetOutputParametersFromImage( this->GetOutput() );
+  resampler->SetDefaultPixelValue( lowest );
+  resampler->SetAbortGenerateData( this->GetAbortGenerateData() );
+  resampler->Update();
+  typename OutputImageType::Pointer levelSet = resampler->GetOutput();
+  levelSet->DisconnectPipeline();
+
+  // No fast marching: the level set evolves from the prior, on the
+  // features of the box around it.
+  this->ConnectFeatureAggregator();
+  this->EvolveAroundSegmentation( levelSet, m_WarmStartMargin, m_WarmStartIterations );
+  this->GraftOutput( levelSet );
+}
+
+template <class TInputImage, class TOutputImage>
+typename LesionSegmentationImageFilterACM<TInputImage,TOutputImage>::OutputImageRegionType
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::GetSeedRegion( double radius ) const
+{
+  typedef typename OutputImageType::IndexType   OutputIndexType;
+
+  const OutputImageType * output = this->GetOutput();
+  const OutputImageRegionType fullRegion = output->GetLargestPossibleRegion();
+  if (m_Seeds.empty())
+    {
+    return fullRegion;
+    }
+
+  OutputIndexType lower;
+  output->TransformPhysicalPointToIndex( m_Seeds.front().GetPosition(), lower );
+  OutputIndexType upper = lower;
+  for (typename PointListType::const_iterator it = m_Seeds.begin(); it != m_Seeds.end(); ++it)
+    {
+    OutputIndexType index;
+    output->TransformPhysicalPointToIndex( it->GetPosition(), index );
+    for (int i = 0; i < ImageDimension; i++)
+      {
+      lower[i] = std::min( lower[i], index[i] );
+      upper[i] = std::max( upper[i], index[i] );
+      }
+    }
+
+  OutputImageRegionType region;
+  for (int i = 0; i < ImageDimension; i++)
+    {
+    const IndexValueType margin = static_cast< IndexValueType >(
+      std::ceil( radius / output->GetSpacing()[i] ) );
+    region.SetIndex( i, lower[i] - margin );
+    region.SetSize( i, static_cast< SizeValueType >( upper[i] - lower[i] + 1 + 2 * margin ) );
+    }
+  if (!region.Crop( fullRegion ))
+    {
+    // Seeds out of the region of interest; segment all of it.
+    return fullRegion;
+    }
+  return region;
+}
+
+template <class TInputImage, class TOutputImage>
+bool
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::ReachesRegionBoundary( const OutputImageType * levelSet,
+                         const OutputImageRegionType & region,
+                         OutputImageRegionType & contact ) const
+{
+  typedef typename OutputImageType::IndexType   OutputIndexType;
+
+  // Iso-value of the segmented surface; the inside is above it.
+  const double isoValue = -0.5;
+
+  // Inside voxels this close to a face stop the front there.
+  const IndexValueType nearFace = 2;
+
+  const OutputImageRegionType fullRegion = this->GetOutput()->GetLargestPossibleRegion();
+  OutputIndexType lower = region.GetUpperIndex();
+  OutputIndexType upper = region.GetIndex();
+  bool reached = false;
+  for (ImageRegionConstIteratorWithIndex< OutputImageType > it( levelSet, region );
+       !it.IsAtEnd(); ++it)
+    {
+    if (it.Get() < isoValue)
+      {
+      continue;
+      }
+    const OutputIndexType & index = it.GetIndex();
+    bool nearBoundary = false;
+    for (int i = 0; i < ImageDimension; i++)
+      {
+      nearBoundary = nearBoundary ||
+        ( region.GetIndex()[i] != fullRegion.GetIndex()[i] &&
+          index[i] - region.GetIndex()[i] < nearFace ) ||
+        ( region.GetUpperIndex()[i] != fullRegion.GetUpperIndex()[i] &&
+          region.GetUpperIndex()[i] - index[i] < nearFace );
+      }
+    if (nearBoundary)
+      {
+      for (int i = 0; i < ImageDimension; i++)
+        {
+        lower[i] = std::min( lower[i], index[i] );
+        upper[i] = std::max( upper[i], index[i] );
+        }
+      reached = true;
+      }
+    }
+  if (reached)
+    {
+    contact.SetIndex( lower );
+    for (int i = 0; i < ImageDimension; i++)
+      {
+      contact.SetSize( i, static_cast< SizeValueType >( upper[i] - lower[i] + 1 ) );
+      }
+    }
+  return reached;
+}
+
+template <class TInputImage, class TOutputImage>
+typename LesionSegmentationImageFilterACM<TInputImage,TOutputImage>::OutputImageType::Pointer
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::ResampleLevelSet( const OutputImageType * levelSet, const OutputImageRegionType & region,
+                    OutputImagePixelType outsideValue ) const
+{
+  typedef ResampleImageFilter< OutputImageType, OutputImageType >       ResamplerType;
+  typedef LinearInterpolateImageFunction< OutputImageType, double >     InterpolatorType;
+
+  // Matched by physical point, so the index origins of the two grids need
+  // not agree. Where the grids coincide the values are copied.
+  typename OutputImageType::Pointer regionGrid = OutputImageType::New();
+  regionGrid->CopyInformation( this->GetOutput() );
+  regionGrid->SetLargestPossibleRegion( region );
+
+  typename ResamplerType::Pointer resampler = ResamplerType::New();
+  resampler->SetInput( levelSet );
+  resampler->SetInterpolator( InterpolatorType::New() );
+  resampler->SetOutputParametersFromImage( regionGrid );
+  resampler->SetDefaultPixelValue( outsideValue );
+  resampler->Update();
+  typename OutputImageType::Pointer resampled = resampler->GetOutput();
+  resampled->DisconnectPipeline();
+  return resampled;
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::SegmentWithAdaptiveRegion()
+{
+  OutputImageType * output = this->GetOutput();
+  const OutputImageRegionType fullRegion = output->GetLargestPossibleRegion();
+
+  double radius = m_InitialRegionRadius;
+  OutputImageRegionType region = this->GetSeedRegion( radius );
+  OutputImageRegionType previousRegion = region;
+  OutputImageRegionType contact = region;
+  typename OutputImageType::Pointer levelSet;
+  OutputImagePixelType outsideValue = NumericTraits< OutputImagePixelType >::Zero;
+  while (true)
+    {
+    if (!levelSet)
+      {
+      // The usual segmentation from the seeds, in the first box.
+      m_StatusMessage = "Resampling data around the seeds..";
+      this->SetFeatureInputRegion( region );
+      typename SeedSpatialObjectType::Pointer seedSpatialObject =
+        SeedSpatialObjectType::New();
+      seedSpatialObject->SetPoints(m_Seeds);
+      this->ConnectFeatureAggregator();
+      m_LesionSegmentationMethod->SetInitialSegmentation(seedSpatialObject);
+      if (m_LazyFeatureEvaluation)
+        {
+        this->SegmentWithLazyFeatures();
+        }
+      else
+        {
+        m_LesionSegmentationMethod->Update();
+        }
+      const OutputSpatialObjectType * outputObject =
+        dynamic_cast< const OutputSpatialObjectType * >( m_SegmentationModule->GetOutput() );
+      const OutputImageType * moduleLevelSet = outputObject->GetImage();
+      outsideValue = *std::min_element( moduleLevelSet->GetBufferPointer(),
+        moduleLevelSet->GetBufferPointer() +
+        moduleLevelSet->GetBufferedRegion().GetNumberOfPixels() );
+      levelSet = this->ResampleLevelSet( moduleLevelSet, region, outsideValue );
+      }
+    else
+      {
+      // The grown box starts from the level set of the previous one, which
+      // is outside beyond it. Fast marching is not rerun, and only the
+      // shell the front can reach evolves: where it met the faces of the
+      // previous box, grown by as much as the box grew. The features are
+      // computed there only.
+      levelSet = this->ResampleLevelSet( levelSet, region, outsideValue );
+      typename OutputImageRegionType::SizeType growth;
+      for (int i = 0; i < ImageDimension; i++)
+        {
+        growth[i] = static_cast< SizeValueType >( std::max(
+          previousRegion.GetIndex()[i] - region.GetIndex()[i],
+          region.GetUpperIndex()[i] - previousRegion.GetUpperIndex()[i] ) );
+        }
+      OutputImageRegionType shell = contact;
+      shell.PadByRadius( growth );
+      shell.Crop( region );
+      m_StatusMessage = "Resampling data around the front..";
+      this->SetFeatureInputRegion( shell );
+      this->EvolveLevelSet( levelSet, shell,
+                            m_SegmentationModule->GetMaximumNumberOfIterations() );
+      }
+
+    if (region == fullRegion || this->GetAbortGenerateData() ||
+        !this->ReachesRegionBoundary( levelSet, region, contact ))
+      {
+      break;
+      }
+
+    // Grow until the box covers more of the region of interest.
+    previousRegion = region;
+    do
+      {
+      radius *= m_RegionGrowthFactor;
+      region = this->GetSeedRegion( radius );
+      }
+    while (region == previousRegion);
+    }
+
+  // Outside beyond the last box.
+  output->FillBuffer( outsideValue );
+  ImageRegionConstIterator< OutputImageType > lit( levelSet, region );
+  ImageRegionIterator< OutputImageType > oit( output, region );
+  for (; !oit.IsAtEnd(); ++oit, ++lit)
+    {
+    oit.Set( lit.Get() );
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
+::ConnectFeatureAggregator()
+{
+  // The method has no way to remove a feature generator, so a fresh one is
+  // wired up with the aggregator selected for this run.
+  m_LesionSegmentationMethod = LesionSegmentationMethodType::New();
+  m_LesionSegmentationMethod->SetAbortGenerateData( this->GetAbortGenerateData() );
+  m_LesionSegmentationMethod->SetSegmentationModule( m_SegmentationModule );
+  if (this->UseStreamingFeatureAggregator())
+    {
+    // The intensity sigmoid is always evaluated inline. The vesselness is
+    // either computed per brick (or tile), or computed raw on the whole ROI
+    // and mapped through its sigmoid while being folded in.
+    StreamingFeatureAggregatorType * aggregator = this->GetStreamingFeatureAggregator();
+    aggregator->RemoveAllFeatureGenerators();
+    aggregator->AddFeatureGenerator( this->GetLungWallFeatureGenerator() );
+    aggregator->AddBlockFeatureGenerator( m_SigmoidBlockFeatureGenerator );
+    aggregator->AddFeatureGenerator( this->GetCannyEdgesFeatureGenerator() );
+    if (this->UseCachedVesselnessFeature())
+      {
+      aggregator->AddBlockFeatureGenerator( m_CachedVesselnessFeatureGenerator );
+      }
+    else if (this->UseVesselnessBlockFeature())
+      {
+      m_VesselnessBlockFeatureGenerator->SetSparseEvaluation( m_SparseVesselness );
+      aggregator->AddBlockFeatureGenerator( m_VesselnessBlockFeatureGenerator );
+      }
+    else
+      {
+      aggregator->AddSigmoidMappedFeatureGenerator(
+        m_RawVesselnessFeatureGenerator, -10.0, 40.0 );
+      }
+
+    typename StreamingFeatureAggregatorType::SizeType brickSize;
+    // Sparse vesselness skips whole bricks, so it needs bricks rather than
+    // slabs spanning the ROI.
+    brickSize.Fill( (m_BrickStreamFeatures || m_SparseVesselness) ? m_FeatureBrickSize : 0 );
+    aggregator->SetBrickSize( brickSize );
+
+    m_LazyFeatureAggregator->SetFeatureStorage(
+      QuantizedFeatureStorage::StorageForBits( m_FeatureStorageBits ) );
+
+    // Keep the individual features around only if they are to be written.
+    aggregator->SetReleaseFeatureData( !m_WriteFeatureImages );
+    m_LesionSegmentationMethod->AddFeatureGenerator( aggregator );
+    }
+  else
+    {
+    // Likewise for the aggregator, which may need the other Canny generator.
+    m_FeatureAggregator = FeatureAggregatorType::New();
+    m_FeatureAggregator->AddFeatureGenerator( this->GetLungWallFeatureGenerator() );
+    m_FeatureAggregator->AddFeatureGenerator( this->GetVesselnessFeatureGenerator() );
+    m_FeatureAggregator->AddFeatureGenerator( m_SigmoidFeatureGenerator );
+    m_FeatureAggregator->AddFeatureGenerator( this->GetCannyEdgesFeatureGenerator() );
+    m_LesionSegmentationMethod->AddFeatureGenerator( m_FeatureAggregator );
+    }
+}
+
+
 template <class TInputImage, class TOutputImage>
 void LesionSegmentationImageFilterACM< TInputImage,TOutputImage >
 ::ProgressUpdate( Object * caller,
@@ -308,6 +1538,12 @@ void LesionSegmentationImageFilterACM< TInputImage,TOutputImage >
       this->UpdateProgress( m_IsotropicResampler->GetProgress() );
       }
 
+    else if (dynamic_cast< SeparableResamplerType * >(caller))
+      {
+      this->m_StatusMessage = "Isotropic resampling of data using separable BSpline interpolation..";
+      this->UpdateProgress( m_SeparableResampler->GetProgress() );
+      }
+
     else if (dynamic_cast< LungWallGeneratorType * >(caller))
       {
       // Given its iterative nature.. a cranky heuristic here.
@@ -317,6 +1553,12 @@ void LesionSegmentationImageFilterACM< TInputImage,TOutputImage >
         m_LungWallFeatureGenerator->GetProgress()*500))%100))/100.0 );
       }
 
+    else if (dynamic_cast< PrecomputedLungWallGeneratorType * >(caller))
+      {
+      this->m_StatusMessage = "Resampling study lung wall feature..";
+      this->UpdateProgress( m_PrecomputedLungWallFeatureGenerator->GetProgress() );
+      }
+
     else if (dynamic_cast< SigmoidFeatureGeneratorType * >(caller))
       {
       this->m_StatusMessage = "Generating intensity feature..";
@@ -329,6 +1571,12 @@ void LesionSegmentationImageFilterACM< TInputImage,TOutputImage >
       this->UpdateProgress( m_CannyEdgesFeatureGenerator->GetProgress());
       }
 
+    else if (dynamic_cast< FusedCannyEdgesFeatureGeneratorType * >(caller))
+      {
+      m_StatusMessage = "Generating canny edge feature..";
+      this->UpdateProgress( m_FusedCannyEdgesFeatureGenerator->GetProgress());
+      }
+
     else if (dynamic_cast< VesselnessGeneratorType * >(caller))
       {
       m_StatusMessage = "Generating vesselness feature (Sato et al.)..";
@@ -336,11 +1584,35 @@ void LesionSegmentationImageFilterACM< TInputImage,TOutputImage >
       this->UpdateProgress( m_LungWallFeatureGenerator->GetProgress() );
       }
 
+    else if (dynamic_cast< RawVesselnessGeneratorType * >(caller))
+      {
+      m_StatusMessage = "Generating vesselness feature (Sato et al.)..";
+      this->UpdateProgress( m_RawVesselnessFeatureGenerator->GetProgress() );
+      }
+
+    else if (dynamic_cast< StreamingFeatureAggregatorType * >(caller))
+      {
+      m_StatusMessage = "Aggregating features..";
+      this->UpdateProgress( this->GetStreamingFeatureAggregator()->GetProgress() );
+      }
+
+    else if (dynamic_cast< VesselEnhancingDiffusionFilterType * >(caller))
+      {
+      m_StatusMessage = "Vessel enhancing diffusion (Manniesing et al.)..";
+      this->UpdateProgress( m_VesselEnhancingDiffusionFilter->GetProgress() );
+      }
+
     else if (dynamic_cast< SegmentationModuleType * >(caller))
       {
       m_StatusMessage = "Segmenting using level sets..";
       this->UpdateProgress( m_SegmentationModule->GetProgress() );
       }
+
+    else if (dynamic_cast< RefinementFilterType * >(caller))
+      {
+      m_StatusMessage = "Refining the segmentation..";
+      this->UpdateProgress( m_RefinementFilter->GetProgress() );
+      }
     }
 }
 
@@ -351,6 +1623,11 @@ void LesionSegmentationImageFilterACM< TInputImage,TOutputImage >
   this->Superclass::SetAbortGenerateData(abort);
   this->m_CropFilter->SetAbortGenerateData(abort);
   this->m_IsotropicResampler->SetAbortGenerateData(abort);
+  this->m_SeparableResampler->SetAbortGenerateData(abort);
+  this->m_RefinementResampler->SetAbortGenerateData(abort);
+  this->m_RegionResampler->SetAbortGenerateData(abort);
+  this->m_RefinementFilter->SetAbortGenerateData(abort);
+  this->m_VesselEnhancingDiffusionFilter->SetAbortGenerateData(abort);
   this->m_LesionSegmentationMethod->SetAbortGenerateData(abort);
 }
 
@@ -359,6 +1636,23 @@ void LesionSegmentationImageFilterACM< TInputImage,TOutputImage >
 ::SetUseVesselEnhancingDiffusion( bool b )
 {
   this->m_VesselnessFeatureGenerator->SetUseVesselEnhancingDiffusion(b);
+  this->m_RawVesselnessFeatureGenerator->SetUseVesselEnhancingDiffusion(b);
+  this->m_UseVesselEnhancingDiffusion = b;
+}
+
+template <class TInputImage, class TOutputImage>
+void LesionSegmentationImageFilterACM< TInputImage,TOutputImage >
+::SetFeatureStorageBits( unsigned int bits )
+{
+  if (bits != 16 && bits != 32)
+    {
+    itkExceptionMacro("FeatureStorageBits must be 16 or 32, not " << bits);
+    }
+  if (this->m_FeatureStorageBits != bits)
+    {
+    this->m_FeatureStorageBits = bits;
+    this->Modified();
+    }
 }
 
 template <class TInputImage, class TOutputImage>
@@ -367,6 +1661,39 @@ LesionSegmentationImageFilterACM<TInputImage,TOutputImage>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf(os,indent);
+  os << indent << "SeparableResampling: " << m_SeparableResampling << std::endl;
+  os << indent << "AntiAliasedSupersampling: " << m_AntiAliasedSupersampling << std::endl;
+  os << indent << "CoarseToFineRefinement: " << m_CoarseToFineRefinement << std::endl;
+  os << indent << "CoarseSpacing: " << m_CoarseSpacing << std::endl;
+  os << indent << "NumberOfPyramidLevels: " << m_NumberOfPyramidLevels << std::endl;
+  os << indent << "RefinementMargin: " << m_RefinementMargin << std::endl;
+  os << indent << "RefinementIterations: " << m_RefinementIterations << std::endl;
+  os << indent << "AdaptiveRegionOfInterest: " << m_AdaptiveRegionOfInterest << std::endl;
+  os << indent << "InitialRegionRadius: " << m_InitialRegionRadius << std::endl;
+  os << indent << "RegionGrowthFactor: " << m_RegionGrowthFactor << std::endl;
+  os << indent << "InitialSegmentation: " << m_InitialSegmentation.GetPointer() << std::endl;
+  os << indent << "InitialSegmentationIsMask: " << m_InitialSegmentationIsMask << std::endl;
+  os << indent << "InitialSegmentationTransform: "
+     << m_InitialSegmentationTransform.GetPointer() << std::endl;
+  os << indent << "WarmStartIterations: " << m_WarmStartIterations << std::endl;
+  os << indent << "WarmStartMargin: " << m_WarmStartMargin << std::endl;
+  os << indent << "MemoryBudget: " << m_MemoryBudget << std::endl;
+  os << indent << "EstimatedPeakMemory: " << m_EstimatedPeakMemory << std::endl;
+  os << indent << "EstimatedRuntime: " << m_EstimatedRuntime << std::endl;
+  os << indent << "SecondsPerVoxelPass: " << m_SecondsPerVoxelPass << std::endl;
+  os << indent << "StreamFeatureAggregation: " << m_StreamFeatureAggregation << std::endl;
+  os << indent << "BrickStreamFeatures: " << m_BrickStreamFeatures << std::endl;
+  os << indent << "FeatureBrickSize: " << m_FeatureBrickSize << std::endl;
+  os << indent << "LazyFeatureEvaluation: " << m_LazyFeatureEvaluation << std::endl;
+  os << indent << "MaximumNumberOfTileExpansions: " << m_MaximumNumberOfTileExpansions << std::endl;
+  os << indent << "UseFusedCannyEdges: " << m_UseFusedCannyEdges << std::endl;
+  os << indent << "SparseVesselness: " << m_SparseVesselness << std::endl;
+  os << indent << "FeatureStorageBits: " << m_FeatureStorageBits << std::endl;
+  os << indent << "UseVesselEnhancingDiffusion: " << m_UseVesselEnhancingDiffusion << std::endl;
+  os << indent << "FastVesselEnhancingDiffusion: " << m_FastVesselEnhancingDiffusion << std::endl;
+  os << indent << "RestrictVesselEnhancingDiffusion: " << m_RestrictVesselEnhancingDiffusion << std::endl;
+  os << indent << "StudyLungMask: " << this->GetStudyLungMask() << std::endl;
+  os << indent << "StudyFeatureCache: " << m_StudyFeatureCache.GetPointer() << std::endl;
 }
 
 template <class TInputImage, class TOutputImage>
@@ -374,13 +1701,36 @@ void
 LesionSegmentationImageFilterACM<TInputImage, TOutputImage>
 ::WriteFeatureImages()
 {
-	if (this->m_WriteFeatureImages)
+	if (this->m_WriteFeatureImages && this->UseStreamingFeatureAggregator())
+	{
+		this->WriteFeatureImage(this->GetLungWallFeatureGenerator());
+		if (this->UseCachedVesselnessFeature())
+		{
+			this->m_CachedVesselnessFeatureGenerator->Update();
+			this->WriteFeatureImage(this->m_CachedVesselnessFeatureGenerator);
+		}
+		else if (this->UseVesselnessBlockFeature())
+		{
+			this->m_VesselnessBlockFeatureGenerator->Update();
+			this->WriteFeatureImage(this->m_VesselnessBlockFeatureGenerator);
+		}
+		else
+		{
+			this->WriteFeatureImage(this->m_RawVesselnessFeatureGenerator);
+		}
+		// Only ever evaluated inline by the aggregator, so compute it here.
+		this->m_SigmoidBlockFeatureGenerator->Update();
+		this->WriteFeatureImage(this->m_SigmoidBlockFeatureGenerator);
+		this->WriteFeatureImage(this->GetCannyEdgesFeatureGenerator());
+		this->WriteFeatureImage(this->GetStreamingFeatureAggregator());
+	}
+	else if (this->m_WriteFeatureImages)
 	{
 //		this->WriteFeatureImage(this->m_LungWallFeatureGenerator2);
-		this->WriteFeatureImage(this->m_LungWallFeatureGenerator);
-		this->WriteFeatureImage(this->m_VesselnessFeatureGenerator);
+		this->WriteFeatureImage(this->GetLungWallFeatureGenerator());
+		this->WriteFeatureImage(this->GetVesselnessFeatureGenerator());
 		this->WriteFeatureImage(this->m_SigmoidFeatureGenerator);
-		this->WriteFeatureImage(this->m_CannyEdgesFeatureGenerator);
+		this->WriteFeatureImage(this->GetCannyEdgesFeatureGenerator());
 		this->WriteFeatureImage(this->m_FeatureAggregator);
 		/*
 		using FeaturePixelType = float;
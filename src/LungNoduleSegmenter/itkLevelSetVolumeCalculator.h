@@ -0,0 +1,120 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkLevelSetVolumeCalculator.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkLevelSetVolumeCalculator_h
+#define itkLevelSetVolumeCalculator_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImage.h"
+#include "itkNumericTraits.h"
+
+namespace itk
+{
+
+/** \class LevelSetVolumeCalculator
+ * \brief Volume enclosed by an iso-surface of a level set, by partial volume
+ * integration of its trilinear interpolant.
+ *
+ * The level set is taken as the trilinear interpolant of its samples; the
+ * inside is where it is at or above IsoValue. The volume is integrated over
+ * the cells between 8 neighbouring samples, the same cells marching cubes
+ * works on:
+ *  - cells whose corners are all inside or all outside count fully or not
+ *    at all;
+ *  - in the others the interpolant is linear along z on every column of
+ *    the cell, so the inside length of a column is exact. Columns are
+ *    sampled at the midpoints of a SamplesPerAxis x SamplesPerAxis grid
+ *    over the cell's xy face.
+ *
+ * Unlike the volume of a marching cubes mesh, this does not approximate
+ * the surface by planar facets within a cell, and it needs no mesh. The
+ * cells are summed in parallel over z layers, then in a fixed order, so the
+ * result does not depend on the number of threads.
+ *
+ * The image directions are assumed to be orthonormal. Only 3D images are
+ * supported.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template< typename TImage >
+class ITK_EXPORT LevelSetVolumeCalculator : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(LevelSetVolumeCalculator);
+
+  /** Standard class typedefs. */
+  typedef LevelSetVolumeCalculator      Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(LevelSetVolumeCalculator, Object);
+
+  static_assert( TImage::ImageDimension == 3,
+                 "LevelSetVolumeCalculator only supports 3D images" );
+
+  typedef TImage                          ImageType;
+  typedef typename ImageType::PixelType   PixelType;
+
+  itkSetConstObjectMacro( Image, ImageType );
+  itkGetConstObjectMacro( Image, ImageType );
+
+  /** Iso-value of the surface; the inside is at or above it. Defaults to 0. */
+  itkSetMacro( IsoValue, double );
+  itkGetMacro( IsoValue, double );
+
+  /** Columns per axis in the cells the surface crosses. Defaults to 8. */
+  itkSetClampMacro( SamplesPerAxis, unsigned int, 1, NumericTraits< unsigned int >::max() );
+  itkGetMacro( SamplesPerAxis, unsigned int );
+
+  /** Integrate the volume over the buffered region of the image. */
+  void Compute();
+
+  /** Volume in physical units, as of the last Compute(). */
+  itkGetConstMacro( Volume, double );
+
+  /** Number of cells the surface crosses, as of the last Compute(). */
+  itkGetConstMacro( NumberOfSurfaceCells, SizeValueType );
+
+protected:
+  LevelSetVolumeCalculator();
+  ~LevelSetVolumeCalculator() override {}
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+private:
+  /** Inside fraction of a cell crossed by the surface, given its corner
+   * values relative to the iso-value, x fastest. */
+  double CellFraction( const double corners[8] ) const;
+
+  typename ImageType::ConstPointer  m_Image;
+  double                            m_IsoValue;
+  unsigned int                      m_SamplesPerAxis;
+  double                            m_Volume;
+  SizeValueType                     m_NumberOfSurfaceCells;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkLevelSetVolumeCalculator.hxx"
+#endif
+
+#endif
@@ -0,0 +1,167 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkLevelSetVolumeCalculator.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkLevelSetVolumeCalculator_hxx
+#define itkLevelSetVolumeCalculator_hxx
+
+#include "itkLevelSetVolumeCalculator.h"
+#include "itkParallelForEachBlock.h"
+#include <vector>
+
+namespace itk
+{
+
+template< typename TImage >
+LevelSetVolumeCalculator< TImage >
+::LevelSetVolumeCalculator()
+{
+  this->m_IsoValue = 0.0;
+  this->m_SamplesPerAxis = 8;
+  this->m_Volume = 0.0;
+  this->m_NumberOfSurfaceCells = 0;
+}
+
+
+template< typename TImage >
+void
+LevelSetVolumeCalculator< TImage >
+::PrintSelf( std::ostream& os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "IsoValue " << this->m_IsoValue << std::endl;
+  os << indent << "SamplesPerAxis " << this->m_SamplesPerAxis << std::endl;
+  os << indent << "Volume " << this->m_Volume << std::endl;
+  os << indent << "NumberOfSurfaceCells " << this->m_NumberOfSurfaceCells << std::endl;
+}
+
+
+template< typename TImage >
+double
+LevelSetVolumeCalculator< TImage >
+::CellFraction( const double corners[8] ) const
+{
+  const unsigned int n = this->m_SamplesPerAxis;
+  double inside = 0.0;
+  for ( unsigned int j = 0; j < n; ++j )
+    {
+    const double v = ( j + 0.5 ) / n;
+    // Bottom (z = 0) and top (z = 1) faces, interpolated along y.
+    const double b0 = corners[0] + v * ( corners[2] - corners[0] );
+    const double b1 = corners[1] + v * ( corners[3] - corners[1] );
+    const double t0 = corners[4] + v * ( corners[6] - corners[4] );
+    const double t1 = corners[5] + v * ( corners[7] - corners[5] );
+    for ( unsigned int i = 0; i < n; ++i )
+      {
+      const double u = ( i + 0.5 ) / n;
+      const double a = b0 + u * ( b1 - b0 );
+      const double b = t0 + u * ( t1 - t0 );
+      // The column is a + ( b - a ) z over z in [0,1].
+      if ( a >= 0.0 && b >= 0.0 )
+        {
+        inside += 1.0;
+        }
+      else if ( a >= 0.0 )
+        {
+        inside += a / ( a - b );
+        }
+      else if ( b >= 0.0 )
+        {
+        inside += b / ( b - a );
+        }
+      }
+    }
+  return inside / ( n * n );
+}
+
+
+template< typename TImage >
+void
+LevelSetVolumeCalculator< TImage >
+::Compute()
+{
+  if ( !this->m_Image )
+    {
+    itkExceptionMacro("Image not set");
+    }
+
+  const ImageType * image = this->m_Image;
+  const typename ImageType::RegionType region = image->GetBufferedRegion();
+  const typename ImageType::SizeType size = region.GetSize();
+  const PixelType * buffer = image->GetBufferPointer();
+  const double isoValue = this->m_IsoValue;
+
+  this->m_Volume = 0.0;
+  this->m_NumberOfSurfaceCells = 0;
+  if ( size[0] < 2 || size[1] < 2 || size[2] < 2 )
+    {
+    return;
+    }
+
+  const OffsetValueType strideY = size[0];
+  const OffsetValueType strideZ = size[0] * size[1];
+  const OffsetValueType cornerOffsets[8] = {
+    0, 1, strideY, strideY + 1,
+    strideZ, strideZ + 1, strideZ + strideY, strideZ + strideY + 1 };
+
+  // One block per layer of cells; each keeps its own sums.
+  const SizeValueType numberOfLayers = size[2] - 1;
+  std::vector< double > layerVolume( numberOfLayers, 0.0 );
+  std::vector< SizeValueType > layerSurfaceCells( numberOfLayers, 0 );
+  auto integrateLayer = [&]( SizeValueType z, ThreadIdType )
+    {
+    double volume = 0.0;
+    SizeValueType surfaceCells = 0;
+    double corners[8];
+    for ( SizeValueType y = 0; y + 1 < size[1]; ++y )
+      {
+      const PixelType * row = buffer + z * strideZ + y * strideY;
+      for ( SizeValueType x = 0; x + 1 < size[0]; ++x )
+        {
+        unsigned int numberInside = 0;
+        for ( unsigned int c = 0; c < 8; ++c )
+          {
+          corners[c] = static_cast< double >( row[x + cornerOffsets[c]] ) - isoValue;
+          numberInside += corners[c] >= 0.0;
+          }
+        if ( numberInside == 8 )
+          {
+          volume += 1.0;
+          }
+        else if ( numberInside != 0 )
+          {
+          volume += this->CellFraction( corners );
+          ++surfaceCells;
+          }
+        }
+      }
+    layerVolume[z] = volume;
+    layerSurfaceCells[z] = surfaceCells;
+    };
+  ParallelForEachBlock( numberOfLayers, integrateLayer );
+
+  double cells = 0.0;
+  for ( SizeValueType z = 0; z < numberOfLayers; ++z )
+    {
+    cells += layerVolume[z];
+    this->m_NumberOfSurfaceCells += layerSurfaceCells[z];
+    }
+  const typename ImageType::SpacingType & spacing = image->GetSpacing();
+  this->m_Volume = cells * spacing[0] * spacing[1] * spacing[2];
+}
+
+} // end namespace itk
+
+#endif
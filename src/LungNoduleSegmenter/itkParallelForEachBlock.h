@@ -0,0 +1,219 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkParallelForEachBlock.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkParallelForEachBlock_h
+#define itkParallelForEachBlock_h
+
+#include "itkMultiThreader.h"
+#include "itkImageRegion.h"
+#include <algorithm>
+#include <atomic>
+
+namespace itk
+{
+
+namespace ParallelForEachBlockDetail
+{
+template< typename TFunctor >
+struct SharedData
+{
+  TFunctor                     *Functor;
+  SizeValueType                 NumberOfBlocks;
+  std::atomic< SizeValueType >  NextBlock;
+};
+
+template< typename TFunctor >
+ITK_THREAD_RETURN_TYPE Callback( void *arg )
+{
+  MultiThreader::ThreadInfoStruct *info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  SharedData< TFunctor > *data = static_cast< SharedData< TFunctor > * >( info->UserData );
+  const ThreadIdType threadId = info->ThreadID;
+
+  // Blocks are handed out dynamically so that uneven blocks (e.g. bricks
+  // that are mostly air) do not leave threads idle.
+  for ( SizeValueType block = data->NextBlock++; block < data->NumberOfBlocks;
+        block = data->NextBlock++ )
+    {
+    ( *data->Functor )( block, threadId );
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+} // end namespace ParallelForEachBlockDetail
+
+/** Calls functor( block, threadId ) for every block in [0, numberOfBlocks)
+ * on the ITK multithreader. threadId is in [0, numberOfThreads) and can be
+ * used to index per-thread scratch storage. When numberOfThreads is 0 the
+ * global default number of threads is used. The functor must not throw. */
+template< typename TFunctor >
+void ParallelForEachBlock( SizeValueType numberOfBlocks, TFunctor & functor,
+                           ThreadIdType numberOfThreads = 0 )
+{
+  if ( numberOfBlocks == 0 )
+    {
+    return;
+    }
+  if ( numberOfThreads == 0 )
+    {
+    numberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+    }
+  numberOfThreads = static_cast< ThreadIdType >(
+    std::max< SizeValueType >( 1, std::min< SizeValueType >( numberOfThreads, numberOfBlocks ) ) );
+
+  ParallelForEachBlockDetail::SharedData< TFunctor > data;
+  data.Functor = &functor;
+  data.NumberOfBlocks = numberOfBlocks;
+  data.NextBlock = 0;
+
+  if ( numberOfThreads == 1 )
+    {
+    for ( SizeValueType block = 0; block < numberOfBlocks; ++block )
+      {
+      functor( block, 0 );
+      }
+    return;
+    }
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( numberOfThreads );
+  threader->SetSingleMethod( &ParallelForEachBlockDetail::Callback< TFunctor >, &data );
+  threader->SingleMethodExecute();
+}
+
+/** Number of threads ParallelForEachBlock will use for numberOfBlocks
+ * blocks. Handy for sizing per-thread scratch storage. */
+inline ThreadIdType GetParallelForEachBlockNumberOfThreads( SizeValueType numberOfBlocks,
+                                                            ThreadIdType numberOfThreads = 0 )
+{
+  if ( numberOfThreads == 0 )
+    {
+    numberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+    }
+  return static_cast< ThreadIdType >(
+    std::max< SizeValueType >( 1, std::min< SizeValueType >( numberOfThreads, numberOfBlocks ) ) );
+}
+
+/** Splits \a region into slabs of at most \a slabThickness along its last
+ * axis. Used for the slab-parallel passes of the feature pipeline. */
+template< unsigned int VDimension >
+class SlabRegionSplitter
+{
+public:
+  typedef ImageRegion< VDimension > RegionType;
+
+  SlabRegionSplitter( const RegionType & region, SizeValueType slabThickness ) :
+    m_Region( region ),
+    m_SlabThickness( std::max< SizeValueType >( 1, slabThickness ) )
+    {}
+
+  SizeValueType GetNumberOfSlabs() const
+    {
+    const SizeValueType n = m_Region.GetSize()[VDimension - 1];
+    return ( n + m_SlabThickness - 1 ) / m_SlabThickness;
+    }
+
+  RegionType GetSlab( SizeValueType slab ) const
+    {
+    RegionType r = m_Region;
+    const SizeValueType first = slab * m_SlabThickness;
+    const SizeValueType n = m_Region.GetSize()[VDimension - 1];
+    r.SetIndex( VDimension - 1, m_Region.GetIndex()[VDimension - 1] + static_cast< IndexValueType >( first ) );
+    r.SetSize( VDimension - 1, std::min< SizeValueType >( m_SlabThickness, n - first ) );
+    return r;
+    }
+
+private:
+  RegionType    m_Region;
+  SizeValueType m_SlabThickness;
+};
+
+/** Splits \a region into bricks of at most \a brickSize voxels. Bricks are
+ * numbered with the first axis varying fastest. */
+template< unsigned int VDimension >
+class BrickRegionSplitter
+{
+public:
+  typedef ImageRegion< VDimension >       RegionType;
+  typedef typename RegionType::SizeType   SizeType;
+  typedef typename RegionType::IndexType  IndexType;
+
+  BrickRegionSplitter( const RegionType & region, const SizeType & brickSize ) :
+    m_Region( region )
+    {
+    for ( unsigned int i = 0; i < VDimension; ++i )
+      {
+      m_BrickSize[i] = std::max< SizeValueType >( 1, brickSize[i] );
+      m_NumberOfBricks[i] = ( region.GetSize()[i] + m_BrickSize[i] - 1 ) / m_BrickSize[i];
+      }
+    }
+
+  SizeValueType GetNumberOfBricks() const
+    {
+    SizeValueType n = 1;
+    for ( unsigned int i = 0; i < VDimension; ++i )
+      {
+      n *= m_NumberOfBricks[i];
+      }
+    return n;
+    }
+
+  RegionType GetBrick( SizeValueType brick ) const
+    {
+    RegionType r;
+    for ( unsigned int i = 0; i < VDimension; ++i )
+      {
+      const SizeValueType first = ( brick % m_NumberOfBricks[i] ) * m_BrickSize[i];
+      brick /= m_NumberOfBricks[i];
+      r.SetIndex( i, m_Region.GetIndex()[i] + static_cast< IndexValueType >( first ) );
+      r.SetSize( i, std::min< SizeValueType >( m_BrickSize[i], m_Region.GetSize()[i] - first ) );
+      }
+    return r;
+    }
+
+private:
+  RegionType  m_Region;
+  SizeType    m_BrickSize;
+  SizeType    m_NumberOfBricks;
+};
+
+/** Calls functor( lineStart, length ) for every line of \a region along the
+ * first axis. Lines are contiguous in any image buffer that contains
+ * \a region, which lets callers run plain pointer loops over bricks. */
+template< unsigned int VDimension, typename TFunctor >
+void ForEachRegionLine( const ImageRegion< VDimension > & region, TFunctor & functor )
+{
+  const SizeValueType length = region.GetSize()[0];
+  if ( region.GetNumberOfPixels() == 0 )
+    {
+    return;
+    }
+  const SizeValueType numberOfLines = region.GetNumberOfPixels() / length;
+  typename ImageRegion< VDimension >::IndexType lineStart = region.GetIndex();
+  for ( SizeValueType line = 0; line < numberOfLines; ++line )
+    {
+    SizeValueType rest = line;
+    for ( unsigned int i = 1; i < VDimension; ++i )
+      {
+      lineStart[i] = region.GetIndex()[i] + static_cast< IndexValueType >( rest % region.GetSize()[i] );
+      rest /= region.GetSize()[i];
+      }
+    functor( lineStart, length );
+    }
+}
+
+} // end namespace itk
+
+#endif
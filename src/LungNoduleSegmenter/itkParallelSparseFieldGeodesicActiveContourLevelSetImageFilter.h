@@ -0,0 +1,262 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilter.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilter_h
+#define itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilter_h
+
+#include "itkGeodesicActiveContourLevelSetImageFilter.h"
+#include <vector>
+
+namespace itk
+{
+
+/** \class ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter
+ * \brief GeodesicActiveContourLevelSetImageFilter that evaluates the sparse
+ * field on several threads.
+ *
+ * The level set function (curvature, propagation and advection terms), the
+ * time step, the RMS change and the stopping criteria are those of the
+ * superclass. Two passes of each iteration run in parallel:
+ *  - CalculateChange(): the update of every active layer node, the bulk of
+ *    the work. The active layer is cut into chunks of ChunkSize nodes in
+ *    list order; each thread fills the update buffer over its chunks and
+ *    keeps its own global data, and the time step comes from the maximum
+ *    curvature, advection and propagation changes of all of them.
+ *  - the propagation of values to the outer layers: the new value of every
+ *    node of a layer only depends on its neighbours in the layer inside it,
+ *    so the values are computed in parallel, and the nodes without such
+ *    neighbours are moved to the next layer serially, in list order.
+ *
+ * The rest of each iteration is serial, as its outcome depends on the
+ * order of the nodes: UpdateActiveLayerValues(), which visits every active
+ * node and the face neighbours of those leaving the layer,
+ * ProcessStatusList() and ProcessOutsideList(), which visit the nodes
+ * changing layers and their neighbours, the gathering of the nodes into
+ * chunks, and the moves of the nodes left without neighbours during the
+ * propagation. These passes touch each node a few times without evaluating
+ * the level set function, while CalculateChange() evaluates its stencil,
+ * derivatives and interpolated speed and advection at every active node.
+ * Still, their share of an iteration grows with the number of threads and
+ * bounds the speed-up. It has not been measured.
+ *
+ * Chunks do not depend on the number of threads and maxima do not depend
+ * on the order they are taken in, so by construction the result is the
+ * one of the superclass, bit for bit, whatever the number of threads.
+ * VerifySerialUpdate checks this on actual data: the evolution is run a
+ * second time with the superclass' serial passes, and the two level sets
+ * are compared.
+ *
+ * The parallel passes are copies of CalculateChange() and
+ * PropagateLayerValues() of SparseFieldLevelSetImageFilter as of ITK 4.13,
+ * and rely on its protected layer members: they must be checked against
+ * the superclass when the toolkit is upgraded. The superclass skips the
+ * neighbourhood bounds checks while no node is near the faces of the
+ * image, a flag private to it; here the same decision is taken per chunk.
+ *
+ * When SpecializeLevelSetFunction is on (the default), each update swaps
+ * in the SpecializedGeodesicActiveContourLevelSetFunction instantiation for
+ * the weights in use, so that the disabled terms cost nothing per node, and
+ * restores the superclass' function afterwards. The updates are unchanged.
+ * With SparseSpeedImage that function also keeps the speed image in a
+ * SparseBrickImage, without changing the updates either.
+ *
+ * With StopOnConvergence, the evolution also stops once what is measured
+ * from it has settled: every ConvergenceInterval iterations the enclosed
+ * volume and the set of active layer voxels (the zero crossing) are
+ * compared with those of the previous check, and the filter halts when
+ * both changed by less than ConvergenceTolerance, relatively. The volume
+ * is summed over the image once, at the first check; each update then
+ * adds the change over the active layer and its neighbours, the only
+ * voxels whose part inside the zero level set it can change. The volumes
+ * are kept in GetVolumeTrajectory() and the number of iterations in
+ * GetElapsedIterations().
+ *
+ * Since the class derives from GeodesicActiveContourLevelSetImageFilter it
+ * can be used wherever that filter is, directly or through the object
+ * factory override installed by
+ * ParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory,
+ * which reaches the filter inside the toolkit's segmentation module.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType = float >
+class ITK_EXPORT ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter :
+  public GeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter);
+
+  /** Standard class typedefs. */
+  typedef ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter Self;
+  typedef GeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+                                                                      Superclass;
+  typedef SmartPointer< Self >                                        Pointer;
+  typedef SmartPointer< const Self >                                  ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter,
+               GeodesicActiveContourLevelSetImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  typedef typename Superclass::OutputImageType    OutputImageType;
+  typedef typename Superclass::ValueType          ValueType;
+  typedef typename Superclass::TimeStepType       TimeStepType;
+  typedef typename Superclass::StatusType         StatusType;
+  typedef typename Superclass::StatusImageType    StatusImageType;
+  typedef typename Superclass::LayerType          LayerType;
+  typedef typename Superclass::LayerNodeType      LayerNodeType;
+
+  /** Nodes per chunk of a layer. Chunks are the unit of work of the
+   * threads; they do not change the result. Defaults to 256. */
+  itkSetClampMacro( ChunkSize, SizeValueType, 1, NumericTraits< SizeValueType >::max() );
+  itkGetConstMacro( ChunkSize, SizeValueType );
+
+  /** Evaluate the level set function through the instantiation compiled
+   * for the terms in use. Defaults to on.
+   *
+   * The specialized function computes the speed and advection images for
+   * itself, and the superclass' function is put back after the update, so
+   * GetSpeedImage() and GetAdvectionImage() then return empty images. Turn
+   * it off to inspect them. */
+  itkSetMacro( SpecializeLevelSetFunction, bool );
+  itkGetConstMacro( SpecializeLevelSetFunction, bool );
+  itkBooleanMacro( SpecializeLevelSetFunction );
+
+  /** Keep the speed image of the specialized level set function in a
+   * SparseBrickImage, so that the regions of zero speed take no memory.
+   * Without SpecializeLevelSetFunction it has no effect. Defaults to off. */
+  itkSetMacro( SparseSpeedImage, bool );
+  itkGetConstMacro( SparseSpeedImage, bool );
+  itkBooleanMacro( SparseSpeedImage );
+
+  /** Evolve the level set a second time with the superclass'
+   * CalculateChange() and PropagateAllLayerValues() in place of the
+   * parallel passes, and throw unless both level sets are the same, bit
+   * for bit. The output is the one of the serial run. It doubles the run
+   * time; it is meant to check the parallel passes on real cases, for
+   * instance after a toolkit upgrade. Defaults to off. */
+  itkSetMacro( VerifySerialUpdate, bool );
+  itkGetConstMacro( VerifySerialUpdate, bool );
+  itkBooleanMacro( VerifySerialUpdate );
+
+  /** Stop once the volume and the zero crossing have converged, in
+   * addition to the criteria of the superclass. Defaults to off. */
+  itkSetMacro( StopOnConvergence, bool );
+  itkGetConstMacro( StopOnConvergence, bool );
+  itkBooleanMacro( StopOnConvergence );
+
+  /** Relative change of the volume and of the zero crossing below which
+   * the evolution has converged. Defaults to 0.001. */
+  itkSetClampMacro( ConvergenceTolerance, double, 0.0, NumericTraits< double >::max() );
+  itkGetConstMacro( ConvergenceTolerance, double );
+
+  /** Iterations between two convergence checks. Defaults to 10. */
+  itkSetClampMacro( ConvergenceInterval, unsigned int, 1, NumericTraits< unsigned int >::max() );
+  itkGetConstMacro( ConvergenceInterval, unsigned int );
+
+  /** Volume enclosed by the zero level set, in physical units, at
+   * iteration 0 and at every check of the last update. Empty unless
+   * StopOnConvergence is on. */
+  const std::vector< double > & GetVolumeTrajectory() const
+    {
+    return this->m_VolumeTrajectory;
+    }
+
+  /** Whether the last update stopped on convergence. */
+  itkGetConstMacro( Converged, bool );
+
+protected:
+  ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter();
+  ~ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter() override {}
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  /** The superclass' update, with the specialized level set function when
+   * there is one for the settings, and its serial check with
+   * VerifySerialUpdate. */
+  void GenerateData() override;
+
+  /** The superclass' criteria, then the convergence check. */
+  bool Halt() override;
+
+  TimeStepType CalculateChange() override;
+
+  /** The superclass' update, with the parallel propagation of the layer
+   * values. */
+  void ApplyUpdate( const TimeStepType & dt ) override;
+
+  /** Parallel counterparts of the superclass' methods of the same name. */
+  void PropagateAllLayerValues();
+  void PropagateLayerValues( StatusType from, StatusType to, StatusType promote, int inOrOut );
+
+private:
+  /** One evolution of the level set, serial or not. */
+  void Evolve( bool serial );
+
+  /** The nodes of \a layer, in list order. */
+  static void GatherNodes( LayerType * layer, std::vector< LayerNodeType * > & nodes );
+
+  /** Whether the neighbourhoods of \a radius around the nodes [begin, end)
+   * of m_Nodes lie inside \a region, so that they need no bounds checks. */
+  bool NeighborhoodsInside( SizeValueType begin, SizeValueType end,
+                            const typename OutputImageType::SizeType & radius,
+                            const typename OutputImageType::RegionType & region ) const;
+
+  /** Part of a voxel of value \a value inside the zero level set: 1 below
+   * -0.5, 0.5 - value within [-0.5, 0.5], 0 above. */
+  static double InsideFraction( ValueType value )
+    {
+    return value <= -0.5 ? 1.0 : ( value < 0.5 ? 0.5 - value : 0.0 );
+    }
+
+  /** Volume inside the zero level set, in physical units: the sum of the
+   * inside fractions of all the voxels. */
+  double ComputeEnclosedVolume() const;
+
+  /** Offsets of the active layer nodes and of their face neighbours, the
+   * only voxels whose inside fraction an update can change, in
+   * m_VolumeVoxels. Returns the sum of their inside fractions. */
+  double GatherVolumeVoxels();
+
+  /** Sum of the inside fractions of m_VolumeVoxels. */
+  double SumVolumeVoxels() const;
+
+  SizeValueType                   m_ChunkSize;
+  bool                            m_SpecializeLevelSetFunction;
+  bool                            m_SparseSpeedImage;
+  bool                            m_VerifySerialUpdate;
+  bool                            m_SerialUpdate;
+  bool                            m_StopOnConvergence;
+  double                          m_ConvergenceTolerance;
+  unsigned int                    m_ConvergenceInterval;
+  bool                            m_Converged;
+  std::vector< double >           m_VolumeTrajectory;
+  double                          m_EnclosedVolume;
+  std::vector< OffsetValueType >  m_VolumeVoxels;
+  std::vector< OffsetValueType >  m_ZeroCrossing;
+  std::vector< LayerNodeType * >  m_Nodes;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilter.hxx"
+#endif
+
+#endif
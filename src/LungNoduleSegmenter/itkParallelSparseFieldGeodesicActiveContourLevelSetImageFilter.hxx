@@ -0,0 +1,676 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilter.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilter_hxx
+#define itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilter_hxx
+
+#include "itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilter.h"
+#include "itkParallelForEachBlock.h"
+#include "itkSpecializedGeodesicActiveContourLevelSetFunction.h"
+#include "itkNeighborhoodIterator.h"
+#include "itkLevelSetFunction.h"
+#include "itkMath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace itk
+{
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter()
+{
+  this->m_ChunkSize = 256;
+  this->m_SpecializeLevelSetFunction = true;
+  this->m_SparseSpeedImage = false;
+  this->m_VerifySerialUpdate = false;
+  this->m_SerialUpdate = false;
+  this->m_StopOnConvergence = false;
+  this->m_ConvergenceTolerance = 0.001;
+  this->m_ConvergenceInterval = 10;
+  this->m_Converged = false;
+  this->m_EnclosedVolume = 0.0;
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+void
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::GenerateData()
+{
+  if ( !this->m_VerifySerialUpdate )
+    {
+    this->Evolve( false );
+    return;
+    }
+  if ( this->GetManualReinitialization() )
+    {
+    itkExceptionMacro("VerifySerialUpdate evolves the level set twice from the input, "
+                      "which ManualReinitialization prevents");
+    }
+
+  this->Evolve( false );
+  const OutputImageType * output = this->GetOutput();
+  const SizeValueType numberOfPixels = output->GetBufferedRegion().GetNumberOfPixels();
+  const std::vector< ValueType > parallel( output->GetBufferPointer(),
+                                           output->GetBufferPointer() + numberOfPixels );
+  const IdentifierType parallelIterations = this->GetElapsedIterations();
+
+  this->Evolve( true );
+  const ValueType * serial = this->GetOutput()->GetBufferPointer();
+  SizeValueType mismatches = 0;
+  double largestDifference = 0.0;
+  for ( SizeValueType k = 0; k < numberOfPixels; ++k )
+    {
+    if ( std::memcmp( &parallel[k], &serial[k], sizeof( ValueType ) ) != 0 )
+      {
+      ++mismatches;
+      largestDifference = std::max( largestDifference,
+        std::abs( static_cast< double >( parallel[k] ) - static_cast< double >( serial[k] ) ) );
+      }
+    }
+  if ( mismatches != 0 || parallelIterations != this->GetElapsedIterations() )
+    {
+    itkExceptionMacro("The parallel update differs from the serial one: " << mismatches
+                      << " voxels differ, by up to " << largestDifference << ", after "
+                      << parallelIterations << " and " << this->GetElapsedIterations()
+                      << " iterations");
+    }
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+void
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::Evolve( bool serial )
+{
+  typedef typename Superclass::SegmentationFunctionType SegmentationFunctionType;
+
+  this->m_SerialUpdate = serial;
+  this->m_Converged = false;
+  this->m_EnclosedVolume = 0.0;
+  this->m_VolumeTrajectory.clear();
+  this->m_ZeroCrossing.clear();
+
+  typename SegmentationFunctionType::Pointer generic = this->GetSegmentationFunction();
+  typename SegmentationFunctionType::Pointer specialized;
+  if ( this->m_SpecializeLevelSetFunction && this->GetAutoGenerateSpeedAdvection() )
+    {
+    specialized = CreateSpecializedGeodesicActiveContourLevelSetFunction(
+      generic.GetPointer(), this->m_SparseSpeedImage );
+    }
+  if ( !specialized )
+    {
+    Superclass::GenerateData();
+    return;
+    }
+
+  // The setters of the superclass act on its own function; put it back
+  // whatever happens.
+  this->SetSegmentationFunction( specialized );
+  try
+    {
+    Superclass::GenerateData();
+    }
+  catch ( ... )
+    {
+    this->SetSegmentationFunction( generic );
+    throw;
+    }
+  this->SetSegmentationFunction( generic );
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+void
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::GatherNodes( LayerType * layer, std::vector< LayerNodeType * > & nodes )
+{
+  nodes.clear();
+  nodes.reserve( layer->Size() );
+  for ( typename LayerType::Iterator it = layer->Begin(); it != layer->End(); ++it )
+    {
+    nodes.push_back( it.GetPointer() );
+    }
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+bool
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::NeighborhoodsInside( SizeValueType begin, SizeValueType end,
+                       const typename OutputImageType::SizeType & radius,
+                       const typename OutputImageType::RegionType & region ) const
+{
+  const typename OutputImageType::IndexType lower = region.GetIndex();
+  const typename OutputImageType::IndexType upper = region.GetUpperIndex();
+  for ( SizeValueType n = begin; n < end; ++n )
+    {
+    const typename OutputImageType::IndexType & index = this->m_Nodes[n]->m_Value;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      const OffsetValueType r = static_cast< OffsetValueType >( radius[i] );
+      if ( index[i] - r < lower[i] || index[i] + r > upper[i] )
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+double
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::ComputeEnclosedVolume() const
+{
+  typedef typename OutputImageType::IndexType IndexType;
+
+  const OutputImageType * output = this->GetOutput();
+  const ValueType * buffer = output->GetBufferPointer();
+  const SlabRegionSplitter< ImageDimension > slabs( output->GetBufferedRegion(), 1 );
+
+  // Slices are summed in parallel, then in order.
+  std::vector< double > partial( slabs.GetNumberOfSlabs(), 0.0 );
+  auto sumSlab = [&]( SizeValueType slab, ThreadIdType )
+    {
+    double sum = 0.0;
+    auto sumLine = [&]( const IndexType & lineStart, SizeValueType length )
+      {
+      const ValueType * line = buffer + output->ComputeOffset( lineStart );
+      for ( SizeValueType x = 0; x < length; ++x )
+        {
+        sum += InsideFraction( line[x] );
+        }
+      };
+    ForEachRegionLine( slabs.GetSlab( slab ), sumLine );
+    partial[slab] = sum;
+    };
+  ParallelForEachBlock( partial.size(), sumSlab );
+
+  double volume = 0.0;
+  for ( SizeValueType slab = 0; slab < partial.size(); ++slab )
+    {
+    volume += partial[slab];
+    }
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    volume *= output->GetSpacing()[i];
+    }
+  return volume;
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+double
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::GatherVolumeVoxels()
+{
+  typedef typename OutputImageType::IndexType IndexType;
+
+  // The values outside the active layer are at least 0.5 away from the
+  // zero level set, so their inside fraction is 0 or 1 by sign. An update
+  // only gives a voxel a value nearer than that, or changes its sign, in
+  // the active layer or next to it: the nodes that leave it, and the
+  // neighbours that take their place.
+  const OutputImageType * output = this->GetOutput();
+  const typename OutputImageType::RegionType & region = output->GetBufferedRegion();
+  this->m_VolumeVoxels.clear();
+  for ( typename LayerType::ConstIterator it = this->m_Layers[0]->Begin(); it != this->m_Layers[0]->End(); ++it )
+    {
+    const IndexType & index = it->m_Value;
+    this->m_VolumeVoxels.push_back( output->ComputeOffset( index ) );
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      IndexType neighbor = index;
+      for ( int step = -1; step <= 1; step += 2 )
+        {
+        neighbor[i] = index[i] + step;
+        if ( region.IsInside( neighbor ) )
+          {
+          this->m_VolumeVoxels.push_back( output->ComputeOffset( neighbor ) );
+          }
+        }
+      }
+    }
+  std::sort( this->m_VolumeVoxels.begin(), this->m_VolumeVoxels.end() );
+  this->m_VolumeVoxels.erase( std::unique( this->m_VolumeVoxels.begin(), this->m_VolumeVoxels.end() ),
+                              this->m_VolumeVoxels.end() );
+  return this->SumVolumeVoxels();
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+double
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::SumVolumeVoxels() const
+{
+  const ValueType * buffer = this->GetOutput()->GetBufferPointer();
+  double sum = 0.0;
+  for ( std::vector< OffsetValueType >::const_iterator it = this->m_VolumeVoxels.begin();
+        it != this->m_VolumeVoxels.end(); ++it )
+    {
+    sum += InsideFraction( buffer[*it] );
+    }
+  return sum;
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+bool
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::Halt()
+{
+  if ( Superclass::Halt() )
+    {
+    return true;
+    }
+  if ( !this->m_StopOnConvergence ||
+       this->GetElapsedIterations() % this->m_ConvergenceInterval != 0 )
+    {
+    return false;
+    }
+
+  const OutputImageType * output = this->GetOutput();
+  if ( this->m_VolumeTrajectory.empty() )
+    {
+    this->m_EnclosedVolume = this->ComputeEnclosedVolume();
+    }
+  const double volume = this->m_EnclosedVolume;
+  std::vector< OffsetValueType > zeroCrossing;
+  zeroCrossing.reserve( this->m_Layers[0]->Size() );
+  for ( typename LayerType::ConstIterator it = this->m_Layers[0]->Begin(); it != this->m_Layers[0]->End(); ++it )
+    {
+    zeroCrossing.push_back( output->ComputeOffset( it->m_Value ) );
+    }
+  std::sort( zeroCrossing.begin(), zeroCrossing.end() );
+
+  if ( !this->m_VolumeTrajectory.empty() )
+    {
+    const double previousVolume = this->m_VolumeTrajectory.back();
+    const double volumeScale = std::max( std::abs( volume ), std::abs( previousVolume ) );
+    const double volumeChange = volumeScale > 0.0 ? std::abs( volume - previousVolume ) / volumeScale : 0.0;
+
+    // Voxels that entered or left the zero crossing since the last check.
+    SizeValueType moved = 0;
+    std::vector< OffsetValueType >::const_iterator a = this->m_ZeroCrossing.begin();
+    std::vector< OffsetValueType >::const_iterator b = zeroCrossing.begin();
+    while ( a != this->m_ZeroCrossing.end() && b != zeroCrossing.end() )
+      {
+      if ( *a < *b )
+        {
+        ++moved;
+        ++a;
+        }
+      else if ( *b < *a )
+        {
+        ++moved;
+        ++b;
+        }
+      else
+        {
+        ++a;
+        ++b;
+        }
+      }
+    moved += ( this->m_ZeroCrossing.end() - a ) + ( zeroCrossing.end() - b );
+    const double zeroCrossingScale = static_cast< double >(
+      std::max< SizeValueType >( 1, std::max( this->m_ZeroCrossing.size(), zeroCrossing.size() ) ) );
+    const double zeroCrossingChange = moved / zeroCrossingScale;
+
+    this->m_Converged = volumeChange < this->m_ConvergenceTolerance &&
+                        zeroCrossingChange < this->m_ConvergenceTolerance;
+    }
+
+  this->m_VolumeTrajectory.push_back( volume );
+  this->m_ZeroCrossing.swap( zeroCrossing );
+  return this->m_Converged;
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+typename ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >::TimeStepType
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::CalculateChange()
+{
+  typedef typename Superclass::FiniteDifferenceFunctionType   FunctionType;
+  typedef typename FunctionType::FloatOffsetType              FloatOffsetType;
+  typedef LevelSetFunction< OutputImageType >                 LevelSetFunctionType;
+  typedef typename LevelSetFunctionType::GlobalDataStruct     GlobalDataStruct;
+
+  if ( this->m_SerialUpdate )
+    {
+    return Superclass::CalculateChange();
+    }
+
+  const typename FunctionType::Pointer df = this->GetDifferenceFunction();
+  OutputImageType * output = this->GetOutput();
+
+  ValueType minNorm = 1.0e-6;
+  if ( this->GetUseImageSpacing() )
+    {
+    double minSpacing = NumericTraits< double >::max();
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      minSpacing = std::min( minSpacing, this->GetInput()->GetSpacing()[i] );
+      }
+    minNorm *= minSpacing;
+    }
+
+  GatherNodes( this->m_Layers[0], this->m_Nodes );
+  const SizeValueType numberOfNodes = this->m_Nodes.size();
+  const SizeValueType numberOfChunks = ( numberOfNodes + this->m_ChunkSize - 1 ) / this->m_ChunkSize;
+  this->m_UpdateBuffer.resize( numberOfNodes );
+
+  // One global data per thread: the function only accumulates maxima in it.
+  const ThreadIdType numberOfThreads = GetParallelForEachBlockNumberOfThreads( numberOfChunks );
+  std::vector< void * > globalData( numberOfThreads );
+  for ( ThreadIdType t = 0; t < numberOfThreads; ++t )
+    {
+    globalData[t] = df->GetGlobalDataPointer();
+    }
+
+  const bool interpolate = this->GetInterpolateSurfaceLocation();
+
+  // Same computation as SparseFieldLevelSetImageFilter::CalculateChange()
+  // for the nodes of one chunk.
+  auto updateChunk = [&]( SizeValueType chunk, ThreadIdType threadId )
+    {
+    NeighborhoodIterator< OutputImageType > outputIt( df->GetRadius(), output,
+                                                      output->GetRequestedRegion() );
+    FloatOffsetType offset;
+    const SizeValueType begin = chunk * this->m_ChunkSize;
+    const SizeValueType end = std::min( numberOfNodes, begin + this->m_ChunkSize );
+    if ( this->NeighborhoodsInside( begin, end, df->GetRadius(), output->GetRequestedRegion() ) )
+      {
+      outputIt.NeedToUseBoundaryConditionOff();
+      }
+    for ( SizeValueType n = begin; n < end; ++n )
+      {
+      outputIt.SetLocation( this->m_Nodes[n]->m_Value );
+
+      // Offset from the center of the neighborhood to the zero crossing,
+      // used by the function to sample its terms on the surface.
+      const ValueType centerValue = outputIt.GetCenterPixel();
+      if ( interpolate && centerValue != 0.0 )
+        {
+        ValueType normGradPhiSquared = 0.0;
+        for ( unsigned int i = 0; i < ImageDimension; ++i )
+          {
+          const ValueType forwardValue = outputIt.GetNext( i );
+          const ValueType backwardValue = outputIt.GetPrevious( i );
+          if ( forwardValue * backwardValue >= 0 )
+            {
+            const ValueType dxForward = forwardValue - centerValue;
+            const ValueType dxBackward = centerValue - backwardValue;
+            offset[i] = Math::abs( dxForward ) > Math::abs( dxBackward ) ? dxForward : dxBackward;
+            }
+          else if ( forwardValue * centerValue < 0 )
+            {
+            offset[i] = forwardValue - centerValue;
+            }
+          else
+            {
+            offset[i] = centerValue - backwardValue;
+            }
+          normGradPhiSquared += offset[i] * offset[i];
+          }
+        for ( unsigned int i = 0; i < ImageDimension; ++i )
+          {
+          offset[i] = ( offset[i] * centerValue ) / ( normGradPhiSquared + minNorm );
+          }
+        this->m_UpdateBuffer[n] = df->ComputeUpdate( outputIt, globalData[threadId], offset );
+        }
+      else
+        {
+        this->m_UpdateBuffer[n] = df->ComputeUpdate( outputIt, globalData[threadId] );
+        }
+      }
+    };
+  ParallelForEachBlock( numberOfChunks, updateChunk );
+
+  // The time step only depends on the maxima over all the nodes.
+  GlobalDataStruct * merged = static_cast< GlobalDataStruct * >( globalData[0] );
+  for ( ThreadIdType t = 1; t < numberOfThreads; ++t )
+    {
+    const GlobalDataStruct * d = static_cast< const GlobalDataStruct * >( globalData[t] );
+    merged->m_MaxCurvatureChange = std::max( merged->m_MaxCurvatureChange, d->m_MaxCurvatureChange );
+    merged->m_MaxAdvectionChange = std::max( merged->m_MaxAdvectionChange, d->m_MaxAdvectionChange );
+    merged->m_MaxPropagationChange = std::max( merged->m_MaxPropagationChange, d->m_MaxPropagationChange );
+    }
+  const TimeStepType timeStep = df->ComputeGlobalTimeStep( merged );
+
+  for ( ThreadIdType t = 0; t < numberOfThreads; ++t )
+    {
+    df->ReleaseGlobalDataPointer( globalData[t] );
+    }
+  return timeStep;
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+void
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::ApplyUpdate( const TimeStepType & dt )
+{
+  typedef typename LayerType::Pointer LayerPointerType;
+
+  LayerPointerType upList[2];
+  LayerPointerType downList[2];
+  for ( unsigned int i = 0; i < 2; ++i )
+    {
+    upList[i] = LayerType::New();
+    downList[i] = LayerType::New();
+    }
+
+  // Once the volume has been summed, follow it through the voxels the
+  // update can change.
+  const bool trackVolume = this->m_StopOnConvergence && !this->m_VolumeTrajectory.empty();
+  const double volumeBefore = trackVolume ? this->GatherVolumeVoxels() : 0.0;
+
+  // Update the active layer and record the nodes that leave it.
+  this->UpdateActiveLayerValues( dt, upList[0], downList[0] );
+
+  // Move the status changes outwards, layer by layer.
+  this->ProcessStatusList( upList[0], upList[1], 2, 1 );
+  this->ProcessStatusList( downList[0], downList[1], 1, 2 );
+
+  StatusType upTo = 0;
+  StatusType downTo = 0;
+  StatusType upSearch = 3;
+  StatusType downSearch = 4;
+  unsigned int j = 1;
+  unsigned int k = 0;
+  while ( downSearch < static_cast< StatusType >( this->m_Layers.size() ) )
+    {
+    this->ProcessStatusList( upList[j], upList[k], upTo, upSearch );
+    this->ProcessStatusList( downList[j], downList[k], downTo, downSearch );
+
+    upTo += upTo == 0 ? 1 : 2;
+    downTo += 2;
+    upSearch += 2;
+    downSearch += 2;
+    std::swap( j, k );
+    }
+
+  this->ProcessStatusList( upList[j], upList[k], upTo, this->m_StatusNull );
+  this->ProcessStatusList( downList[j], downList[k], downTo, this->m_StatusNull );
+
+  // Bring the remaining nodes into the outermost inside and outside layers.
+  this->ProcessOutsideList( upList[k], static_cast< int >( this->m_Layers.size() ) - 2 );
+  this->ProcessOutsideList( downList[k], static_cast< int >( this->m_Layers.size() ) - 1 );
+
+  if ( this->m_SerialUpdate )
+    {
+    Superclass::PropagateAllLayerValues();
+    }
+  else
+    {
+    this->PropagateAllLayerValues();
+    }
+
+  if ( trackVolume )
+    {
+    double voxelVolume = 1.0;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      voxelVolume *= this->GetOutput()->GetSpacing()[i];
+      }
+    this->m_EnclosedVolume += ( this->SumVolumeVoxels() - volumeBefore ) * voxelVolume;
+    }
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+void
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::PropagateAllLayerValues()
+{
+  // Inside layers are odd, outside layers even; each is seeded by the one
+  // inside it.
+  this->PropagateLayerValues( 0, 1, 3, 1 );
+  this->PropagateLayerValues( 0, 2, 4, 0 );
+  for ( unsigned int i = 1; i < this->m_Layers.size() - 2; ++i )
+    {
+    this->PropagateLayerValues( i, i + 2, i + 4, ( i + 2 ) % 2 );
+    }
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+void
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::PropagateLayerValues( StatusType from, StatusType to, StatusType promote, int inOrOut )
+{
+  const StatusType pastEnd = static_cast< StatusType >( this->m_Layers.size() ) - 1;
+  const ValueType delta = inOrOut == 1 ? -this->m_ConstantGradientValue : this->m_ConstantGradientValue;
+  OutputImageType * output = this->GetOutput();
+  StatusImageType * status = this->m_StatusImage;
+  LayerType * layer = this->m_Layers[to];
+
+  // Drop the nodes that another layer has claimed. Only a node's own
+  // status can change below, so this can be done first.
+  for ( typename LayerType::Iterator it = layer->Begin(); it != layer->End(); )
+    {
+    LayerNodeType * node = it.GetPointer();
+    ++it;
+    if ( status->GetPixel( node->m_Value ) != to )
+      {
+      layer->Unlink( node );
+      this->m_LayerNodeStore->Return( node );
+      }
+    }
+
+  // The new value of a node only reads its neighbours of status "from",
+  // which this pass does not modify, so the nodes are independent.
+  GatherNodes( layer, this->m_Nodes );
+  const SizeValueType numberOfNodes = this->m_Nodes.size();
+  const SizeValueType numberOfChunks = ( numberOfNodes + this->m_ChunkSize - 1 ) / this->m_ChunkSize;
+  std::vector< unsigned char > found( numberOfNodes );
+
+  auto propagateChunk = [&]( SizeValueType chunk, ThreadIdType )
+    {
+    NeighborhoodIterator< OutputImageType > outputIt( this->m_NeighborList.GetRadius(), output,
+                                                      output->GetRequestedRegion() );
+    NeighborhoodIterator< StatusImageType > statusIt( this->m_NeighborList.GetRadius(), status,
+                                                      output->GetRequestedRegion() );
+    const SizeValueType begin = chunk * this->m_ChunkSize;
+    const SizeValueType end = std::min( numberOfNodes, begin + this->m_ChunkSize );
+    if ( this->NeighborhoodsInside( begin, end, this->m_NeighborList.GetRadius(),
+                                    output->GetRequestedRegion() ) )
+      {
+      outputIt.NeedToUseBoundaryConditionOff();
+      statusIt.NeedToUseBoundaryConditionOff();
+      }
+    for ( SizeValueType n = begin; n < end; ++n )
+      {
+      const typename OutputImageType::IndexType & index = this->m_Nodes[n]->m_Value;
+      statusIt.SetLocation( index );
+      outputIt.SetLocation( index );
+
+      // Keep the "from" neighbour closest to the zero level set.
+      bool foundNeighbor = false;
+      ValueType value = NumericTraits< ValueType >::ZeroValue();
+      for ( unsigned int i = 0; i < this->m_NeighborList.GetSize(); ++i )
+        {
+        const unsigned int neighbor = this->m_NeighborList.GetArrayIndex( i );
+        if ( statusIt.GetPixel( neighbor ) != from )
+          {
+          continue;
+          }
+        const ValueType neighborValue = outputIt.GetPixel( neighbor );
+        if ( !foundNeighbor
+             || ( inOrOut == 1 && neighborValue > value )
+             || ( inOrOut != 1 && neighborValue < value ) )
+          {
+          value = neighborValue;
+          }
+        foundNeighbor = true;
+        }
+      if ( foundNeighbor )
+        {
+        outputIt.SetCenterPixel( value + delta );
+        }
+      found[n] = foundNeighbor;
+      }
+    };
+  ParallelForEachBlock( numberOfChunks, propagateChunk );
+
+  // Nodes without a "from" neighbour move to the next layer out, or are
+  // deleted past the last one, in list order as in the superclass.
+  for ( SizeValueType n = 0; n < numberOfNodes; ++n )
+    {
+    if ( found[n] )
+      {
+      continue;
+      }
+    LayerNodeType * node = this->m_Nodes[n];
+    layer->Unlink( node );
+    if ( promote > pastEnd )
+      {
+      this->m_LayerNodeStore->Return( node );
+      status->SetPixel( node->m_Value, this->m_StatusNull );
+      }
+    else
+      {
+      this->m_Layers[promote]->PushFront( node );
+      status->SetPixel( node->m_Value, promote );
+      }
+    }
+}
+
+
+template< typename TInputImage, typename TFeatureImage, typename TOutputPixelType >
+void
+ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< TInputImage, TFeatureImage, TOutputPixelType >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "ChunkSize: " << this->m_ChunkSize << std::endl;
+  os << indent << "SpecializeLevelSetFunction: " << this->m_SpecializeLevelSetFunction << std::endl;
+  os << indent << "SparseSpeedImage: " << this->m_SparseSpeedImage << std::endl;
+  os << indent << "VerifySerialUpdate: " << this->m_VerifySerialUpdate << std::endl;
+  os << indent << "StopOnConvergence: " << this->m_StopOnConvergence << std::endl;
+  os << indent << "ConvergenceTolerance: " << this->m_ConvergenceTolerance << std::endl;
+  os << indent << "ConvergenceInterval: " << this->m_ConvergenceInterval << std::endl;
+  os << indent << "Converged: " << this->m_Converged << std::endl;
+}
+
+} // end namespace itk
+
+#endif
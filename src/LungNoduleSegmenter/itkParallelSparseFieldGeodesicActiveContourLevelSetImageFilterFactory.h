@@ -0,0 +1,163 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory_h
+#define itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory_h
+
+#include "itkObjectFactoryBase.h"
+#include "itkCreateObjectFunction.h"
+#include "itkVersion.h"
+#include "itkImage.h"
+#include "itkCommand.h"
+#include "itkParallelSparseFieldGeodesicActiveContourLevelSetImageFilter.h"
+#include <typeinfo>
+
+namespace itk
+{
+
+/** \class ParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory
+ * \brief Object factory that substitutes
+ * ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter for
+ * GeodesicActiveContourLevelSetImageFilter.
+ *
+ * Once registered, every GeodesicActiveContourLevelSetImageFilter::New()
+ * on 3D float images returns the parallel implementation. This reaches the
+ * level set inside the toolkit's
+ * FastMarchingAndGeodesicActiveContourLevelSetSegmentationModule, as well
+ * as the refinement of LesionSegmentationImageFilterACM, without modifying
+ * them.
+ *
+ * The filters it makes can be given convergence settings, a sparse speed
+ * image, the check against the serial update, and an observer of their EndEvent to report on them, since their
+ * owners do not expose them.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+class ParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory : public ObjectFactoryBase
+{
+public:
+  typedef ParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory Self;
+  typedef ObjectFactoryBase                          Superclass;
+  typedef SmartPointer< Self >                       Pointer;
+  typedef SmartPointer< const Self >                 ConstPointer;
+
+  const char * GetITKSourceVersion() const override
+    {
+    return ITK_SOURCE_VERSION;
+    }
+
+  const char * GetDescription() const override
+    {
+    return "Parallel sparse field GeodesicActiveContourLevelSetImageFilter";
+    }
+
+  /** Method for class instantiation. */
+  itkFactorylessNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory, ObjectFactoryBase);
+
+  typedef Image< float, 3 >                                                       ImageType;
+  typedef GeodesicActiveContourLevelSetImageFilter< ImageType, ImageType, float > BaseFilterType;
+  typedef ParallelSparseFieldGeodesicActiveContourLevelSetImageFilter< ImageType, ImageType, float >
+                                                                                  ParallelFilterType;
+
+  /** Register one factory of this type */
+  static void RegisterOneFactory()
+    {
+    Pointer factory = Self::New();
+    ObjectFactoryBase::RegisterFactory(factory);
+    }
+
+  /** Register one factory of this type whose filters stop on convergence
+   * with \a tolerance and \a interval, when \a tolerance is positive, are
+   * observed by \a observer, when not null, keep their speed image in
+   * bricks with \a sparseSpeedImage, and check their result against the
+   * serial update with \a verifySerialUpdate. */
+  static void RegisterOneFactory( double tolerance, unsigned int interval, Command * observer,
+                                  bool sparseSpeedImage = false, bool verifySerialUpdate = false )
+    {
+    Pointer factory = Self::New();
+    factory->m_ConvergenceTolerance = tolerance;
+    factory->m_ConvergenceInterval = interval;
+    factory->m_Observer = observer;
+    factory->m_SparseSpeedImage = sparseSpeedImage;
+    factory->m_VerifySerialUpdate = verifySerialUpdate;
+    ObjectFactoryBase::RegisterFactory(factory);
+    }
+
+protected:
+  /** Makes the filters with the settings of its factory. */
+  class CreateFilterFunction : public CreateObjectFunctionBase
+  {
+  public:
+    typedef CreateFilterFunction        Self;
+    typedef SmartPointer< Self >        Pointer;
+
+    itkFactorylessNewMacro(Self);
+
+    LightObject::Pointer CreateObject() override
+      {
+      ParallelFilterType::Pointer filter = ParallelFilterType::New();
+      if ( m_Factory->m_ConvergenceTolerance > 0.0 )
+        {
+        filter->StopOnConvergenceOn();
+        filter->SetConvergenceTolerance( m_Factory->m_ConvergenceTolerance );
+        filter->SetConvergenceInterval( m_Factory->m_ConvergenceInterval );
+        }
+      filter->SetSparseSpeedImage( m_Factory->m_SparseSpeedImage );
+      filter->SetVerifySerialUpdate( m_Factory->m_VerifySerialUpdate );
+      if ( m_Factory->m_Observer )
+        {
+        filter->AddObserver( EndEvent(), m_Factory->m_Observer );
+        }
+      return filter.GetPointer();
+      }
+
+    const ParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory * m_Factory;
+
+  protected:
+    CreateFilterFunction() : m_Factory( nullptr ) {}
+  };
+
+  ParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory() :
+    m_ConvergenceTolerance( 0.0 ),
+    m_ConvergenceInterval( 10 ),
+    m_SparseSpeedImage( false ),
+    m_VerifySerialUpdate( false )
+    {
+    CreateFilterFunction::Pointer createFilter = CreateFilterFunction::New();
+    createFilter->m_Factory = this;
+    this->RegisterOverride( typeid( BaseFilterType ).name(),
+                            typeid( ParallelFilterType ).name(),
+                            "Parallel sparse field GeodesicActiveContourLevelSetImageFilter override",
+                            true,
+                            createFilter.GetPointer() );
+    }
+
+private:
+  ITK_DISALLOW_COPY_AND_ASSIGN(ParallelSparseFieldGeodesicActiveContourLevelSetImageFilterFactory);
+
+  double              m_ConvergenceTolerance;
+  unsigned int        m_ConvergenceInterval;
+  bool                m_SparseSpeedImage;
+  bool                m_VerifySerialUpdate;
+  Command::Pointer    m_Observer;
+};
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,479 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkParallelVesselEnhancingDiffusion3DImageFilter.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkParallelVesselEnhancingDiffusion3DImageFilter_hxx
+#define itkParallelVesselEnhancingDiffusion3DImageFilter_hxx
+
+#include "itkParallelVesselEnhancingDiffusion3DImageFilter.h"
+#include "itkHessianRecursiveGaussianImageFilter.h"
+#include "itkSymmetricEigenAnalysis.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkParallelForEachBlock.h"
+#include "itkNumericTraits.h"
+#include "itkMath.h"
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+template< typename TInputImage, typename TOutputImage >
+ParallelVesselEnhancingDiffusion3DImageFilter< TInputImage, TOutputImage >
+::ParallelVesselEnhancingDiffusion3DImageFilter()
+{
+  this->m_TimeStep = 0.001;
+  this->m_Iterations = 30;
+  this->m_RecalculateVesselness = 100;
+  this->m_Alpha = 0.5;
+  this->m_Beta = 0.5;
+  this->m_Gamma = 5.0;
+  this->m_Epsilon = 0.01;
+  this->m_Omega = 25.0;
+  this->m_Sensitivity = 5.0;
+  this->m_Scales.push_back( 0.300 );
+  this->m_Scales.push_back( 0.482 );
+  this->m_Scales.push_back( 0.775 );
+  this->m_Scales.push_back( 1.245 );
+  this->m_Scales.push_back( 2.000 );
+  this->m_DarkObjectLightBackground = false;
+  this->m_RestrictToActivityMask = false;
+  this->m_ActivityThreshold = -400.0;
+  this->m_ActivityRadius = 2.0;
+  this->m_NumberOfSlicesPerBlock = 4;
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+ParallelVesselEnhancingDiffusion3DImageFilter< TInputImage, TOutputImage >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "TimeStep " << this->m_TimeStep << std::endl;
+  os << indent << "Iterations " << this->m_Iterations << std::endl;
+  os << indent << "RecalculateVesselness " << this->m_RecalculateVesselness << std::endl;
+  os << indent << "Alpha " << this->m_Alpha << std::endl;
+  os << indent << "Beta " << this->m_Beta << std::endl;
+  os << indent << "Gamma " << this->m_Gamma << std::endl;
+  os << indent << "Epsilon " << this->m_Epsilon << std::endl;
+  os << indent << "Omega " << this->m_Omega << std::endl;
+  os << indent << "Sensitivity " << this->m_Sensitivity << std::endl;
+  os << indent << "Scales";
+  for ( size_t i = 0; i < this->m_Scales.size(); ++i )
+    {
+    os << " " << this->m_Scales[i];
+    }
+  os << std::endl;
+  os << indent << "DarkObjectLightBackground " << this->m_DarkObjectLightBackground << std::endl;
+  os << indent << "RestrictToActivityMask " << this->m_RestrictToActivityMask << std::endl;
+  os << indent << "ActivityThreshold " << this->m_ActivityThreshold << std::endl;
+  os << indent << "ActivityRadius " << this->m_ActivityRadius << std::endl;
+  os << indent << "Slices per block " << this->m_NumberOfSlicesPerBlock << std::endl;
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+ParallelVesselEnhancingDiffusion3DImageFilter< TInputImage, TOutputImage >
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  if ( this->GetInput() )
+    {
+    InputImageType * input = const_cast< InputImageType * >( this->GetInput() );
+    input->SetRequestedRegionToLargestPossibleRegion();
+    }
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+ParallelVesselEnhancingDiffusion3DImageFilter< TInputImage, TOutputImage >
+::EnlargeOutputRequestedRegion( DataObject * output )
+{
+  Superclass::EnlargeOutputRequestedRegion( output );
+  output->SetRequestedRegionToLargestPossibleRegion();
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+ParallelVesselEnhancingDiffusion3DImageFilter< TInputImage, TOutputImage >
+::ComputeActivityMask( const PrecisionImageType * image )
+{
+  const typename PrecisionImageType::SizeType size = image->GetBufferedRegion().GetSize();
+  const SizeValueType numberOfPixels = image->GetBufferedRegion().GetNumberOfPixels();
+  if ( !this->m_RestrictToActivityMask )
+    {
+    this->m_Mask.assign( numberOfPixels, 1 );
+    return;
+    }
+
+  const PrecisionType * u = image->GetBufferPointer();
+  const PrecisionType threshold = static_cast< PrecisionType >( this->m_ActivityThreshold );
+  this->m_Mask.resize( numberOfPixels );
+  for ( SizeValueType v = 0; v < numberOfPixels; ++v )
+    {
+    this->m_Mask[v] = u[v] >= threshold;
+    }
+
+  // Separable box dilation. Lines along x and y are dilated one slice per
+  // block, lines along z one row per block.
+  const SizeValueType nx = size[0];
+  const SizeValueType ny = size[1];
+  const SizeValueType nz = size[2];
+  const SizeValueType strides[3] = { 1, nx, nx * ny };
+  unsigned char * mask = &this->m_Mask[0];
+  for ( unsigned int d = 0; d < 3; ++d )
+    {
+    const SizeValueType n = size[d];
+    const SizeValueType r = static_cast< SizeValueType >(
+      std::ceil( std::max( 0.0, this->m_ActivityRadius / image->GetSpacing()[d] ) ) );
+    if ( r == 0 || n < 2 )
+      {
+      continue;
+      }
+    const SizeValueType stride = strides[d];
+    const SizeValueType numberOfBlocks = d < 2 ? nz : ny;
+    std::vector< std::vector< unsigned char > > lines(
+      GetParallelForEachBlockNumberOfThreads( numberOfBlocks ) );
+
+    auto dilateLine = [&]( SizeValueType first, std::vector< unsigned char > & line )
+      {
+      line.resize( n );
+      for ( SizeValueType i = 0; i < n; ++i )
+        {
+        line[i] = mask[first + i * stride];
+        }
+      SizeValueType count = 0;
+      for ( SizeValueType i = 0; i < std::min( n, r ); ++i )
+        {
+        count += line[i];
+        }
+      for ( SizeValueType i = 0; i < n; ++i )
+        {
+        if ( i + r < n )
+          {
+          count += line[i + r];
+          }
+        if ( i > r )
+          {
+          count -= line[i - r - 1];
+          }
+        mask[first + i * stride] = count > 0;
+        }
+      };
+    auto dilateBlock = [&]( SizeValueType block, ThreadIdType threadId )
+      {
+      if ( d == 0 )
+        {
+        for ( SizeValueType y = 0; y < ny; ++y )
+          {
+          dilateLine( block * strides[2] + y * nx, lines[threadId] );
+          }
+        }
+      else if ( d == 1 )
+        {
+        for ( SizeValueType x = 0; x < nx; ++x )
+          {
+          dilateLine( block * strides[2] + x, lines[threadId] );
+          }
+        }
+      else
+        {
+        for ( SizeValueType x = 0; x < nx; ++x )
+          {
+          dilateLine( block * nx + x, lines[threadId] );
+          }
+        }
+      };
+    ParallelForEachBlock( numberOfBlocks, dilateBlock );
+    }
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+ParallelVesselEnhancingDiffusion3DImageFilter< TInputImage, TOutputImage >
+::ComputeDiffusionTensor( const PrecisionImageType * image )
+{
+  typedef HessianRecursiveGaussianImageFilter< PrecisionImageType > HessianFilterType;
+  typedef typename HessianFilterType::OutputImageType               HessianImageType;
+  typedef typename HessianImageType::PixelType                      HessianType;
+  typedef FixedArray< double, 3 >                                   EigenValuesType;
+  typedef Matrix< double, 3, 3 >                                    EigenVectorsType;
+  typedef SymmetricEigenAnalysis< HessianType, EigenValuesType, EigenVectorsType > EigenAnalysisType;
+
+  const typename PrecisionImageType::SizeType size = image->GetBufferedRegion().GetSize();
+  const SizeValueType numberOfPixels = image->GetBufferedRegion().GetNumberOfPixels();
+  const SizeValueType sliceSize = size[0] * size[1];
+  const SizeValueType nz = size[2];
+
+  // Identity everywhere, which is the tensor of a zero vesselness.
+  this->m_Tensor.assign( 6 * numberOfPixels, 0.0f );
+  for ( SizeValueType v = 0; v < numberOfPixels; ++v )
+    {
+    this->m_Tensor[6 * v] = this->m_Tensor[6 * v + 3] = this->m_Tensor[6 * v + 5] = 1.0f;
+    }
+  std::vector< PrecisionType > bestVesselness( numberOfPixels, 0.0f );
+
+  const double twoAlpha2 = 2.0 * this->m_Alpha * this->m_Alpha;
+  const double twoBeta2 = 2.0 * this->m_Beta * this->m_Beta;
+  const double twoGamma2 = 2.0 * this->m_Gamma * this->m_Gamma;
+  const double exponent = 1.0 / this->m_Sensitivity;
+  const bool dark = this->m_DarkObjectLightBackground;
+  const SizeValueType thickness = std::max< SizeValueType >( 1, this->m_NumberOfSlicesPerBlock );
+  const SizeValueType numberOfSlabs = ( nz + thickness - 1 ) / thickness;
+
+  for ( size_t s = 0; s < this->m_Scales.size(); ++s )
+    {
+    typename HessianFilterType::Pointer hessian = HessianFilterType::New();
+    hessian->SetInput( image );
+    hessian->SetSigma( this->m_Scales[s] );
+    hessian->SetNormalizeAcrossScale( true );
+    hessian->Update();
+    const HessianType * h = hessian->GetOutput()->GetBufferPointer();
+
+    auto analyseSlab = [&]( SizeValueType slab, ThreadIdType )
+      {
+      EigenAnalysisType eigenAnalysis( 3 );
+      eigenAnalysis.SetOrderEigenMagnitudes( true );
+      EigenValuesType l;
+      EigenVectorsType e;
+
+      const SizeValueType first = slab * thickness * sliceSize;
+      const SizeValueType last = std::min( nz, ( slab + 1 ) * thickness ) * sliceSize;
+      for ( SizeValueType v = first; v < last; ++v )
+        {
+        if ( !this->m_Mask[v] )
+          {
+          continue;
+          }
+        eigenAnalysis.ComputeEigenValuesAndVectors( h[v], l, e );
+
+        // Frangi vesselness, eigenvalues in increasing magnitude.
+        const bool wrongSign = dark ? ( l[1] < 0 || l[2] < 0 ) : ( l[1] > 0 || l[2] > 0 );
+        if ( wrongSign || l[1] == 0 || l[2] == 0 )
+          {
+          continue;
+          }
+        const double ra2 = ( l[1] * l[1] ) / ( l[2] * l[2] );
+        const double rb2 = ( l[0] * l[0] ) / std::abs( l[1] * l[2] );
+        const double s2 = l[0] * l[0] + l[1] * l[1] + l[2] * l[2];
+        const double vesselness = ( 1.0 - std::exp( -ra2 / twoAlpha2 ) ) *
+          std::exp( -rb2 / twoBeta2 ) * ( 1.0 - std::exp( -s2 / twoGamma2 ) );
+        if ( vesselness <= bestVesselness[v] )
+          {
+          continue;
+          }
+        bestVesselness[v] = static_cast< PrecisionType >( vesselness );
+
+        // D = across * I + ( along - across ) * e0 e0^T, e0 being the
+        // direction of the vessel (first row).
+        const double p = std::pow( vesselness, exponent );
+        const double along = 1.0 + ( this->m_Omega - 1.0 ) * p;
+        const double across = 1.0 + ( this->m_Epsilon - 1.0 ) * p;
+        const double k = along - across;
+        PrecisionType * d = &this->m_Tensor[6 * v];
+        d[0] = static_cast< PrecisionType >( across + k * e[0][0] * e[0][0] );
+        d[1] = static_cast< PrecisionType >( k * e[0][0] * e[0][1] );
+        d[2] = static_cast< PrecisionType >( k * e[0][0] * e[0][2] );
+        d[3] = static_cast< PrecisionType >( across + k * e[0][1] * e[0][1] );
+        d[4] = static_cast< PrecisionType >( k * e[0][1] * e[0][2] );
+        d[5] = static_cast< PrecisionType >( across + k * e[0][2] * e[0][2] );
+        }
+      };
+    ParallelForEachBlock( numberOfSlabs, analyseSlab );
+    }
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+ParallelVesselEnhancingDiffusion3DImageFilter< TInputImage, TOutputImage >
+::DiffusionStep( const PrecisionImageType * in, PrecisionImageType * out ) const
+{
+  const typename PrecisionImageType::SizeType size = in->GetBufferedRegion().GetSize();
+  const typename PrecisionImageType::SpacingType spacing = in->GetSpacing();
+  const SizeValueType nx = size[0];
+  const SizeValueType ny = size[1];
+  const SizeValueType nz = size[2];
+  const SizeValueType sliceSize = nx * ny;
+  const PrecisionType * u = in->GetBufferPointer();
+  PrecisionType * next = out->GetBufferPointer();
+  const PrecisionType * tensor = &this->m_Tensor[0];
+  const unsigned char * mask = &this->m_Mask[0];
+  const double timeStep = this->m_TimeStep;
+
+  // Tensor component of ( i, j ) in the six stored per voxel.
+  static const unsigned int component[3][3] = { { 0, 1, 2 }, { 1, 3, 4 }, { 2, 4, 5 } };
+  double inverseSquaredSpacing[3];
+  double inverseTwiceSpacing[3];
+  for ( unsigned int i = 0; i < 3; ++i )
+    {
+    inverseSquaredSpacing[i] = 1.0 / ( spacing[i] * spacing[i] );
+    inverseTwiceSpacing[i] = 0.5 / spacing[i];
+    }
+
+  const SizeValueType thickness = std::max< SizeValueType >( 1, this->m_NumberOfSlicesPerBlock );
+  const SizeValueType numberOfSlabs = ( nz + thickness - 1 ) / thickness;
+  auto stepSlab = [&]( SizeValueType slab, ThreadIdType )
+    {
+    const SizeValueType z0 = slab * thickness;
+    const SizeValueType z1 = std::min( nz, z0 + thickness );
+    for ( SizeValueType z = z0; z < z1; ++z )
+      {
+      for ( SizeValueType y = 0; y < ny; ++y )
+        {
+        for ( SizeValueType x = 0; x < nx; ++x )
+          {
+          const SizeValueType v = x + nx * y + sliceSize * z;
+          if ( !mask[v] )
+            {
+            next[v] = u[v];
+            continue;
+            }
+
+          // Neighbour coordinates, clamped for zero flux boundaries.
+          const SizeValueType c[3] = { x, y, z };
+          const SizeValueType n[3] = { nx, ny, nz };
+          SizeValueType minus[3];
+          SizeValueType plus[3];
+          for ( unsigned int i = 0; i < 3; ++i )
+            {
+            minus[i] = c[i] > 0 ? c[i] - 1 : c[i];
+            plus[i] = c[i] + 1 < n[i] ? c[i] + 1 : c[i];
+            }
+          auto at = [&]( const SizeValueType p[3] )
+            {
+            return p[0] + nx * p[1] + sliceSize * p[2];
+            };
+
+          const double u0 = u[v];
+          double divergence = 0.0;
+          for ( unsigned int i = 0; i < 3; ++i )
+            {
+            SizeValueType p[3] = { x, y, z };
+            p[i] = plus[i];
+            const SizeValueType vp = at( p );
+            p[i] = minus[i];
+            const SizeValueType vm = at( p );
+
+            // d/di ( D_ii du/di ) with conductances at the half points.
+            const unsigned int ii = component[i][i];
+            const double dp = 0.5 * ( tensor[6 * v + ii] + tensor[6 * vp + ii] );
+            const double dm = 0.5 * ( tensor[6 * v + ii] + tensor[6 * vm + ii] );
+            divergence += ( dp * ( u[vp] - u0 ) - dm * ( u0 - u[vm] ) ) * inverseSquaredSpacing[i];
+
+            // d/di ( D_ij du/dj ) for j != i, central differences.
+            for ( unsigned int j = 0; j < 3; ++j )
+              {
+              if ( j == i )
+                {
+                continue;
+                }
+              const unsigned int ij = component[i][j];
+              SizeValueType q[3] = { x, y, z };
+              q[i] = plus[i];
+              q[j] = plus[j];
+              const double upp = u[at( q )];
+              q[j] = minus[j];
+              const double upm = u[at( q )];
+              q[i] = minus[i];
+              const double umm = u[at( q )];
+              q[j] = plus[j];
+              const double ump = u[at( q )];
+              const double fluxPlus = tensor[6 * vp + ij] * ( upp - upm ) * inverseTwiceSpacing[j];
+              const double fluxMinus = tensor[6 * vm + ij] * ( ump - umm ) * inverseTwiceSpacing[j];
+              divergence += ( fluxPlus - fluxMinus ) * inverseTwiceSpacing[i];
+              }
+            }
+          next[v] = static_cast< PrecisionType >( u0 + timeStep * divergence );
+          }
+        }
+      }
+    };
+  ParallelForEachBlock( numberOfSlabs, stepSlab );
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+ParallelVesselEnhancingDiffusion3DImageFilter< TInputImage, TOutputImage >
+::GenerateData()
+{
+  const InputImageType * input = this->GetInput();
+  const typename InputImageType::RegionType region = input->GetLargestPossibleRegion();
+
+  typename PrecisionImageType::Pointer current = PrecisionImageType::New();
+  current->CopyInformation( input );
+  current->SetRegions( region );
+  current->Allocate();
+  typename PrecisionImageType::Pointer next = PrecisionImageType::New();
+  next->CopyInformation( input );
+  next->SetRegions( region );
+  next->Allocate();
+
+  ImageRegionConstIterator< InputImageType > iit( input, region );
+  ImageRegionIterator< PrecisionImageType > cit( current, region );
+  for ( ; !iit.IsAtEnd(); ++iit, ++cit )
+    {
+    cit.Set( static_cast< PrecisionType >( iit.Get() ) );
+    }
+
+  this->ComputeActivityMask( current );
+  for ( unsigned int iteration = 0; iteration < this->m_Iterations; ++iteration )
+    {
+    if ( iteration == 0 || ( this->m_RecalculateVesselness > 0 &&
+                             iteration % this->m_RecalculateVesselness == 0 ) )
+      {
+      this->ComputeDiffusionTensor( current );
+      }
+    this->DiffusionStep( current, next );
+    std::swap( current, next );
+    this->UpdateProgress( static_cast< float >( iteration + 1 ) / this->m_Iterations );
+    if ( this->GetAbortGenerateData() )
+      {
+      break;
+      }
+    }
+  next = nullptr;
+  std::vector< PrecisionType >().swap( this->m_Tensor );
+  std::vector< unsigned char >().swap( this->m_Mask );
+
+  OutputImageType * output = this->GetOutput();
+  output->SetBufferedRegion( output->GetRequestedRegion() );
+  output->Allocate();
+
+  const double lowest = static_cast< double >( NumericTraits< OutputPixelType >::NonpositiveMin() );
+  const double highest = static_cast< double >( NumericTraits< OutputPixelType >::max() );
+  ImageRegionConstIterator< PrecisionImageType > rit( current, output->GetRequestedRegion() );
+  ImageRegionIterator< OutputImageType > oit( output, output->GetRequestedRegion() );
+  for ( ; !oit.IsAtEnd(); ++rit, ++oit )
+    {
+    double value = rit.Get();
+    if ( NumericTraits< OutputPixelType >::is_integer )
+      {
+      value = std::max( lowest, std::min( highest, static_cast< double >( Math::Round< long >( value ) ) ) );
+      }
+    oit.Set( static_cast< OutputPixelType >( value ) );
+    }
+}
+
+} // end namespace itk
+
+#endif
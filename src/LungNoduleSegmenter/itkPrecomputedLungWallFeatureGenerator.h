@@ -0,0 +1,104 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkPrecomputedLungWallFeatureGenerator.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkPrecomputedLungWallFeatureGenerator_h
+#define itkPrecomputedLungWallFeatureGenerator_h
+
+#include "itkFeatureGenerator.h"
+#include "itkImage.h"
+#include "itkImageSpatialObject.h"
+
+namespace itk
+{
+
+/** \class PrecomputedLungWallFeatureGenerator
+ * \brief Lung wall feature resampled from a study-wide lung mask.
+ *
+ * Produces the feature of LungWallFeatureGenerator (1 in the lung, vessels
+ * and nodules included, 0 in the wall) without computing anything on the
+ * ROI: the StudyLungMask, typically computed once per study by
+ * StudyLungWallMaskImageFilter, is resampled with linear interpolation onto
+ * the grid of the input image. The coarse mask thus gives a smooth [0,1]
+ * transition at the wall rather than a step. Voxels outside the mask get 0.
+ *
+ * \ingroup SpatialObjectFilters
+ * \ingroup LesionSizingToolkit
+ */
+template <unsigned int NDimension>
+class ITK_EXPORT PrecomputedLungWallFeatureGenerator : public FeatureGenerator<NDimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(PrecomputedLungWallFeatureGenerator);
+
+  /** Standard class typedefs. */
+  typedef PrecomputedLungWallFeatureGenerator   Self;
+  typedef FeatureGenerator<NDimension>          Superclass;
+  typedef SmartPointer<Self>                    Pointer;
+  typedef SmartPointer<const Self>              ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(PrecomputedLungWallFeatureGenerator, FeatureGenerator);
+
+  /** Dimension of the space */
+  itkStaticConstMacro(Dimension, unsigned int, NDimension);
+
+  /** Type of spatialObject that will be passed as input to this
+   * feature generator. Only its image grid is used. */
+  typedef signed short                                          InputPixelType;
+  typedef Image< InputPixelType, Dimension >                    InputImageType;
+  typedef ImageSpatialObject< NDimension, InputPixelType >      InputImageSpatialObjectType;
+  typedef typename Superclass::SpatialObjectType                SpatialObjectType;
+
+  typedef unsigned char                                         MaskPixelType;
+  typedef Image< MaskPixelType, Dimension >                     MaskImageType;
+
+  typedef float                                                 OutputPixelType;
+  typedef Image< OutputPixelType, Dimension >                   OutputImageType;
+  typedef ImageSpatialObject< NDimension, OutputPixelType >     OutputImageSpatialObjectType;
+
+  /** Input data that will be used for generating the feature. */
+  using ProcessObject::SetInput;
+  void SetInput( const SpatialObjectType * input );
+
+  /** Output data that carries the feature in the form of a
+   * SpatialObject. */
+  const SpatialObjectType * GetFeature() const;
+
+  /** Lung mask of the study: 1 in the lung, 0 elsewhere. */
+  itkSetConstObjectMacro( StudyLungMask, MaskImageType );
+  itkGetConstObjectMacro( StudyLungMask, MaskImageType );
+
+protected:
+  PrecomputedLungWallFeatureGenerator();
+  ~PrecomputedLungWallFeatureGenerator() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  void GenerateData() override;
+
+private:
+  typename MaskImageType::ConstPointer  m_StudyLungMask;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkPrecomputedLungWallFeatureGenerator.hxx"
+#endif
+
+#endif
@@ -0,0 +1,143 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkPrecomputedLungWallFeatureGenerator.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkPrecomputedLungWallFeatureGenerator_hxx
+#define itkPrecomputedLungWallFeatureGenerator_hxx
+
+#include "itkPrecomputedLungWallFeatureGenerator.h"
+#include "itkResampleImageFilter.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkProgressAccumulator.h"
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template <unsigned int NDimension>
+PrecomputedLungWallFeatureGenerator<NDimension>
+::PrecomputedLungWallFeatureGenerator()
+{
+  this->SetNumberOfRequiredInputs( 1 );
+  this->SetNumberOfRequiredOutputs( 1 );
+
+  typename OutputImageSpatialObjectType::Pointer outputObject = OutputImageSpatialObjectType::New();
+
+  this->ProcessObject::SetNthOutput( 0, outputObject.GetPointer() );
+}
+
+
+/*
+ * Destructor
+ */
+template <unsigned int NDimension>
+PrecomputedLungWallFeatureGenerator<NDimension>
+::~PrecomputedLungWallFeatureGenerator()
+{
+}
+
+template <unsigned int NDimension>
+void
+PrecomputedLungWallFeatureGenerator<NDimension>
+::SetInput( const SpatialObjectType * spatialObject )
+{
+  // Process object is not const-correct so the const casting is required.
+  this->SetNthInput(0, const_cast<SpatialObjectType *>( spatialObject ));
+}
+
+template <unsigned int NDimension>
+const typename PrecomputedLungWallFeatureGenerator<NDimension>::SpatialObjectType *
+PrecomputedLungWallFeatureGenerator<NDimension>
+::GetFeature() const
+{
+  if (this->GetNumberOfOutputs() < 1)
+    {
+    return nullptr;
+    }
+
+  return static_cast<const SpatialObjectType*>(this->ProcessObject::GetOutput(0));
+}
+
+
+/*
+ * PrintSelf
+ */
+template <unsigned int NDimension>
+void
+PrecomputedLungWallFeatureGenerator<NDimension>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "Study lung mask " << this->m_StudyLungMask.GetPointer() << std::endl;
+}
+
+
+/*
+ * Generate Data
+ */
+template <unsigned int NDimension>
+void
+PrecomputedLungWallFeatureGenerator<NDimension>
+::GenerateData()
+{
+  typename InputImageSpatialObjectType::ConstPointer inputObject =
+    dynamic_cast<const InputImageSpatialObjectType * >( this->ProcessObject::GetInput(0) );
+
+  if( !inputObject )
+    {
+    itkExceptionMacro("Missing input spatial object");
+    }
+
+  const InputImageType * inputImage = inputObject->GetImage();
+
+  if( !inputImage )
+    {
+    itkExceptionMacro("Missing input image");
+    }
+
+  if( !this->m_StudyLungMask )
+    {
+    itkExceptionMacro("Missing study lung mask");
+    }
+
+  typedef ResampleImageFilter< MaskImageType, OutputImageType, double >   ResampleFilterType;
+  typedef LinearInterpolateImageFunction< MaskImageType, double >         InterpolatorType;
+
+  // Report progress.
+  ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
+  progress->SetMiniPipelineFilter(this);
+
+  typename ResampleFilterType::Pointer resampler = ResampleFilterType::New();
+  resampler->SetInput( this->m_StudyLungMask );
+  resampler->SetInterpolator( InterpolatorType::New() );
+  resampler->SetOutputParametersFromImage( inputImage );
+  resampler->SetDefaultPixelValue( 0.0 );
+  progress->RegisterInternalFilter( resampler, 1.0 );
+  resampler->Update();
+
+  typename OutputImageType::Pointer outputImage = resampler->GetOutput();
+
+  outputImage->DisconnectPipeline();
+
+  auto * outputObject = dynamic_cast< OutputImageSpatialObjectType * >(this->ProcessObject::GetOutput(0));
+
+  outputObject->SetImage( outputImage );
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,352 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkQuantizedFeatureBuffer.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkQuantizedFeatureBuffer_h
+#define itkQuantizedFeatureBuffer_h
+
+#include "itkSparseBrickImage.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace itk
+{
+
+/** \class QuantizedFeatureStorage
+ * \brief Storage of the values of a QuantizedFeatureBuffer.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+class QuantizedFeatureStorage
+{
+public:
+  enum StorageType { Float32 = 0, Fixed16 };
+
+  /** Storage matching a number of bits: 16, anything else is float. */
+  static StorageType StorageForBits( unsigned int bits )
+    {
+    return bits == 16 ? Fixed16 : Float32;
+    }
+};
+
+
+/** \class QuantizedFeatureBuffer
+ * \brief Brick-mapped buffer of feature values in [0,1], stored as float
+ * or as 16 bit fixed point.
+ *
+ * Speed features are in [0,1], so fixed point loses nothing in range. Its
+ * steps are uniform: a 16 bit code is finer than a half float above about
+ * 0.03, where the half float step exceeds 1.5e-5 (4.9e-4 just below 1),
+ * and coarser below, where half floats get finer towards 0. Values are
+ * clamped to [0,1] and rounded to the nearest of 65535 levels, so the error
+ * is at most half a level, 7.6e-6. Rounding is monotonic, so the minimum of
+ * quantised values is the quantised minimum.
+ *
+ * The values are held by a SparseBrickImage over the buffered region, of
+ * floats or of codes. Bricks are allocated explicitly with
+ * AllocateBricks(), and the others read as 0: memory follows the regions
+ * that were stored, not the extent of the buffer.
+ *
+ * Values go in and out a line at a time, along the first axis; the
+ * conversions are fused with the copy, and Load() and LoadMinimum()
+ * dequantise straight into the consumer's float buffer. Different threads
+ * may store to and load from the allocated bricks concurrently.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template< unsigned int NDimension >
+class QuantizedFeatureBuffer : public QuantizedFeatureStorage
+{
+public:
+  typedef SparseBrickImage< float, NDimension >          FloatImageType;
+  typedef SparseBrickImage< std::uint16_t, NDimension >  FixedImageType;
+  typedef typename FloatImageType::IndexType             IndexType;
+  typedef typename FloatImageType::RegionType            RegionType;
+
+  QuantizedFeatureBuffer() : m_Storage( Float32 ) {}
+
+  /** Set up an empty buffer over \a region, in bricks of \a brickSize
+   * voxels per axis, rounded up to a power of two. */
+  void Allocate( StorageType storage, const RegionType & region, unsigned int brickSize )
+    {
+    this->Release();
+    this->m_Storage = storage;
+    switch ( storage )
+      {
+      case Fixed16:
+        this->m_Fixed16 = FixedImageType::New();
+        Initialize( this->m_Fixed16.GetPointer(), region, brickSize );
+        break;
+      default:
+        this->m_Float32 = FloatImageType::New();
+        Initialize( this->m_Float32.GetPointer(), region, brickSize );
+        break;
+      }
+    }
+
+  void Release()
+    {
+    this->m_Float32 = nullptr;
+    this->m_Fixed16 = nullptr;
+    }
+
+  bool IsAllocated() const { return this->m_Float32.IsNotNull() || this->m_Fixed16.IsNotNull(); }
+  StorageType GetStorage() const { return this->m_Storage; }
+
+  /** Bytes held by the allocated bricks. */
+  SizeValueType GetNumberOfBytes() const
+    {
+    if ( this->m_Fixed16 )
+      {
+      return this->m_Fixed16->GetNumberOfAllocatedBytes();
+      }
+    return this->m_Float32 ? this->m_Float32->GetNumberOfAllocatedBytes() : 0;
+    }
+
+  /** Allocate the bricks overlapped by \a region, which must be within the
+   * buffered region. Not thread safe. */
+  void AllocateBricks( const RegionType & region )
+    {
+    if ( this->m_Fixed16 )
+      {
+      AllocateBricks( this->m_Fixed16.GetPointer(), region );
+      }
+    else
+      {
+      AllocateBricks( this->m_Float32.GetPointer(), region );
+      }
+    }
+
+  /** Release the bricks that only hold 0. */
+  SizeValueType ReleaseBackgroundBricks()
+    {
+    if ( this->m_Fixed16 )
+      {
+      return this->m_Fixed16->ReleaseBackgroundBricks();
+      }
+    return this->m_Float32->ReleaseBackgroundBricks();
+    }
+
+  /** Store \a n values from \a start along the first axis, in bricks
+   * allocated with AllocateBricks(). */
+  void Store( const IndexType & start, const float * values, SizeValueType n )
+    {
+    if ( this->m_Fixed16 )
+      {
+      ForEachBrickRun( this->m_Fixed16.GetPointer(), start, n,
+        [&]( std::uint16_t * codes, SizeValueType done, SizeValueType count )
+          {
+          Quantize( values + done, count, 65535.0f, codes );
+          } );
+      }
+    else
+      {
+      ForEachBrickRun( this->m_Float32.GetPointer(), start, n,
+        [&]( float * stored, SizeValueType done, SizeValueType count )
+          {
+          std::copy( values + done, values + done + count, stored );
+          } );
+      }
+    }
+
+  /** Load \a n values from \a start along the first axis into \a out. */
+  void Load( const IndexType & start, float * out, SizeValueType n ) const
+    {
+    if ( this->m_Fixed16 )
+      {
+      ForEachBrickRun( this->m_Fixed16.GetPointer(), start, n,
+        [&]( const std::uint16_t * codes, SizeValueType done, SizeValueType count )
+          {
+          if ( codes )
+            {
+            Dequantize( codes, count, 1.0f / 65535.0f, out + done );
+            }
+          else
+            {
+            std::fill( out + done, out + done + count, 0.0f );
+            }
+          } );
+      }
+    else
+      {
+      ForEachBrickRun( this->m_Float32.GetPointer(), start, n,
+        [&]( const float * stored, SizeValueType done, SizeValueType count )
+          {
+          if ( stored )
+            {
+            std::copy( stored, stored + count, out + done );
+            }
+          else
+            {
+            std::fill( out + done, out + done + count, 0.0f );
+            }
+          } );
+      }
+    }
+
+  /** Replace the \a n values of \a out by their minimum with the values
+   * from \a start along the first axis. */
+  void LoadMinimum( const IndexType & start, float * out, SizeValueType n ) const
+    {
+    if ( this->m_Fixed16 )
+      {
+      ForEachBrickRun( this->m_Fixed16.GetPointer(), start, n,
+        [&]( const std::uint16_t * codes, SizeValueType done, SizeValueType count )
+          {
+          if ( codes )
+            {
+            DequantizeMinimum( codes, count, 1.0f / 65535.0f, out + done );
+            }
+          else
+            {
+            Minimum( out + done, count, 0.0f );
+            }
+          } );
+      }
+    else
+      {
+      ForEachBrickRun( this->m_Float32.GetPointer(), start, n,
+        [&]( const float * stored, SizeValueType done, SizeValueType count )
+          {
+          if ( stored )
+            {
+            for ( SizeValueType i = 0; i < count; ++i )
+              {
+              out[done + i] = std::min( out[done + i], stored[i] );
+              }
+            }
+          else
+            {
+            Minimum( out + done, count, 0.0f );
+            }
+          } );
+      }
+    }
+
+private:
+  template< typename TImage >
+  static void Initialize( TImage * image, const RegionType & region, unsigned int brickSize )
+    {
+    image->SetBrickSize( brickSize );
+    image->SetRegions( region );
+    image->Allocate();
+    }
+
+  template< typename TImage >
+  static void AllocateBricks( TImage * image, const RegionType & region )
+    {
+    const IndexType & start = image->GetBufferedRegion().GetIndex();
+    const IndexValueType brickSize = image->GetBrickSize();
+    IndexType first;
+    IndexType last;
+    for ( unsigned int i = 0; i < NDimension; ++i )
+      {
+      first[i] = ( region.GetIndex()[i] - start[i] ) / brickSize;
+      last[i] = ( region.GetIndex()[i] + static_cast< IndexValueType >( region.GetSize()[i] ) - 1 -
+                  start[i] ) / brickSize;
+      if ( first[i] > last[i] )
+        {
+        return;
+        }
+      }
+    IndexType b = first;
+    while ( true )
+      {
+      SizeValueType brick = 0;
+      for ( int i = NDimension - 1; i >= 0; --i )
+        {
+        brick = brick * image->GetNumberOfBricksPerAxis()[i] + static_cast< SizeValueType >( b[i] );
+        }
+      image->AllocateBrick( brick );
+
+      unsigned int axis = 0;
+      while ( axis < NDimension && ++b[axis] > last[axis] )
+        {
+        b[axis] = first[axis];
+        ++axis;
+        }
+      if ( axis == NDimension )
+        {
+        break;
+        }
+      }
+    }
+
+  /** Call \a f with the part within each brick of the \a n pixels from
+   * \a start along the first axis: the brick's pixels from the first of
+   * them, or null if the brick is not allocated, how many of the \a n
+   * pixels come before, and how many are in the brick. */
+  template< typename TImage, typename TFunction >
+  static void ForEachBrickRun( TImage * image, IndexType start, SizeValueType n, TFunction f )
+    {
+    const IndexValueType origin = image->GetBufferedRegion().GetIndex()[0];
+    const SizeValueType brickSize = image->GetBrickSize();
+    SizeValueType done = 0;
+    while ( done < n )
+      {
+      const SizeValueType within = static_cast< SizeValueType >( start[0] - origin ) & ( brickSize - 1 );
+      const SizeValueType count = std::min( n - done, brickSize - within );
+      auto * buffer = image->GetBrickBuffer( image->ComputeBrickNumber( start ) );
+      f( buffer ? buffer + image->ComputeBrickOffset( start ) : nullptr, done, count );
+      start[0] += static_cast< IndexValueType >( count );
+      done += count;
+      }
+    }
+
+  template< typename TCode >
+  static void Quantize( const float * values, SizeValueType n, float levels, TCode * codes )
+    {
+    for ( SizeValueType i = 0; i < n; ++i )
+      {
+      // Written so that NaN clamps to 0.
+      const float v = values[i] > 0.0f ? std::min( values[i], 1.0f ) : 0.0f;
+      codes[i] = static_cast< TCode >( v * levels + 0.5f );
+      }
+    }
+
+  template< typename TCode >
+  static void Dequantize( const TCode * codes, SizeValueType n, float scale, float * out )
+    {
+    for ( SizeValueType i = 0; i < n; ++i )
+      {
+      out[i] = codes[i] * scale;
+      }
+    }
+
+  template< typename TCode >
+  static void DequantizeMinimum( const TCode * codes, SizeValueType n, float scale, float * out )
+    {
+    for ( SizeValueType i = 0; i < n; ++i )
+      {
+      out[i] = std::min( out[i], codes[i] * scale );
+      }
+    }
+
+  static void Minimum( float * out, SizeValueType n, float value )
+    {
+    for ( SizeValueType i = 0; i < n; ++i )
+      {
+      out[i] = std::min( out[i], value );
+      }
+    }
+
+  StorageType                       m_Storage;
+  typename FloatImageType::Pointer  m_Float32;
+  typename FixedImageType::Pointer  m_Fixed16;
+};
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,166 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSatoVesselnessSigmoidBlockFeatureGenerator.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSatoVesselnessSigmoidBlockFeatureGenerator_h
+#define itkSatoVesselnessSigmoidBlockFeatureGenerator_h
+
+#include "itkBlockFeatureGenerator.h"
+#include "itkHessianRecursiveGaussianImageFilter.h"
+#include "itkHessian3DToVesselnessMeasureImageFilter.h"
+#include <vector>
+
+namespace itk
+{
+
+/** \class SatoVesselnessSigmoidBlockFeatureGenerator
+ * \brief Sato vesselness followed by a sigmoid, evaluated brick by brick.
+ *
+ * Computes the feature of SatoVesselnessSigmoidFeatureGenerator (without
+ * vessel enhancing diffusion) on one block at a time. Each block is padded
+ * by a halo of HaloInSigmas Gaussian sigmas, the Hessian and the vesselness
+ * measure are computed single threaded on the padded block, and only the
+ * block itself is written out. Blocks are independent so the aggregator
+ * runs them in parallel.
+ *
+ * The recursive Gaussian has infinite support, so the result differs from
+ * the whole-image feature near block faces by the truncated kernel tail,
+ * which is below exp( -HaloInSigmas^2 / 2 ) of the kernel peak.
+ *
+ * With SparseEvaluation on, the response is only computed where there is
+ * tissue that could be a vessel. The activity mask holds the voxels at or
+ * above ActivityThreshold, dilated by ActivityRadiusInSigmas Gaussian sigmas
+ * (the support the Hessian sees). Blocks that do not touch the mask skip
+ * the Hessian altogether, and within the other blocks the eigen analysis is
+ * only done inside the mask. Outside the mask the feature is the sigmoid of
+ * a zero vesselness, which is what air far from tissue evaluates to anyway.
+ *
+ * \ingroup SpatialObjectFilters
+ * \ingroup LesionSizingToolkit
+ */
+template <unsigned int NDimension>
+class ITK_EXPORT SatoVesselnessSigmoidBlockFeatureGenerator : public BlockFeatureGenerator<NDimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(SatoVesselnessSigmoidBlockFeatureGenerator);
+
+  /** Standard class typedefs. */
+  typedef SatoVesselnessSigmoidBlockFeatureGenerator  Self;
+  typedef BlockFeatureGenerator<NDimension>           Superclass;
+  typedef SmartPointer<Self>                          Pointer;
+  typedef SmartPointer<const Self>                    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SatoVesselnessSigmoidBlockFeatureGenerator, BlockFeatureGenerator);
+
+  typedef typename Superclass::InputImageType   InputImageType;
+  typedef typename Superclass::OutputImageType  OutputImageType;
+  typedef typename Superclass::OutputPixelType  OutputPixelType;
+  typedef typename Superclass::RegionType       RegionType;
+  typedef typename Superclass::SizeType         SizeType;
+
+  /** Sigma value to be used in the Gaussian smoothing preceding the
+   * Hessian computation. */
+  itkSetMacro( Sigma, double );
+  itkGetMacro( Sigma, double );
+
+  /** Alpha1 value to be used in the Sato Vesselness filter. */
+  itkSetMacro( Alpha1, double );
+  itkGetMacro( Alpha1, double );
+
+  /** Alpha2 value to be used in the Sato Vesselness filter. */
+  itkSetMacro( Alpha2, double );
+  itkGetMacro( Alpha2, double );
+
+  /** Alpha value to be used in the Sigmoid filter. */
+  itkSetMacro( SigmoidAlpha, double );
+  itkGetMacro( SigmoidAlpha, double );
+
+  /** Beta value to be used in the Sigmoid filter. */
+  itkSetMacro( SigmoidBeta, double );
+  itkGetMacro( SigmoidBeta, double );
+
+  /** Halo around each block, in multiples of Sigma. Defaults to 4. */
+  itkSetMacro( HaloInSigmas, double );
+  itkGetMacro( HaloInSigmas, double );
+
+  /** Only evaluate the vesselness inside the activity mask. Defaults to
+   * false. */
+  itkSetMacro( SparseEvaluation, bool );
+  itkGetMacro( SparseEvaluation, bool );
+  itkBooleanMacro( SparseEvaluation );
+
+  /** Intensity at and above which a voxel is tissue that could belong to a
+   * vessel. Defaults to -400. */
+  itkSetMacro( ActivityThreshold, double );
+  itkGetMacro( ActivityThreshold, double );
+
+  /** Dilation of the activity mask, in multiples of Sigma. Defaults to 3. */
+  itkSetMacro( ActivityRadiusInSigmas, double );
+  itkGetMacro( ActivityRadiusInSigmas, double );
+
+  /** Sato line measure of the ascending eigenvalues of a Hessian, as
+   * computed by Hessian3DToVesselnessMeasureImageFilter. */
+  static double LineMeasure( double lambda1, double lambda2, double lambda3,
+                             double alpha1, double alpha2 );
+
+  SizeType GetBlockHaloRadius( const InputImageType * input ) const override;
+
+  void GenerateBlock( const InputImageType * input,
+                      const RegionType & region,
+                      OutputImageType * output ) const override;
+
+protected:
+  SatoVesselnessSigmoidBlockFeatureGenerator();
+  ~SatoVesselnessSigmoidBlockFeatureGenerator() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+private:
+  typedef HessianRecursiveGaussianImageFilter< InputImageType >       HessianFilterType;
+  typedef typename HessianFilterType::OutputImageType                 HessianImageType;
+  typedef Hessian3DToVesselnessMeasureImageFilter< OutputPixelType >  VesselnessMeasureFilterType;
+
+  SizeType GetActivityRadius( const InputImageType * input ) const;
+
+  /** Fill \a mask, in raster order over \a support, with the activity mask
+   * dilated by \a radius. Returns false if the mask is empty. */
+  bool ComputeActivityMask( const InputImageType * input, const RegionType & support,
+                            const SizeType & radius, std::vector< unsigned char > & mask ) const;
+
+  /** Write the dense vesselness sigmoid of \a brick over \a region. */
+  void GenerateDenseBlock( const InputImageType * brick, const RegionType & region,
+                           OutputImageType * output ) const;
+
+  double m_Sigma;
+  double m_Alpha1;
+  double m_Alpha2;
+  double m_SigmoidAlpha;
+  double m_SigmoidBeta;
+  double m_HaloInSigmas;
+  bool   m_SparseEvaluation;
+  double m_ActivityThreshold;
+  double m_ActivityRadiusInSigmas;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkSatoVesselnessSigmoidBlockFeatureGenerator.hxx"
+#endif
+
+#endif
@@ -0,0 +1,320 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSatoVesselnessSigmoidBlockFeatureGenerator.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSatoVesselnessSigmoidBlockFeatureGenerator_hxx
+#define itkSatoVesselnessSigmoidBlockFeatureGenerator_hxx
+
+#include "itkSatoVesselnessSigmoidBlockFeatureGenerator.h"
+#include "itkSigmoidBlockFeatureGenerator.h"
+#include "itkImageAlgorithm.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkSymmetricEigenAnalysis.h"
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template <unsigned int NDimension>
+SatoVesselnessSigmoidBlockFeatureGenerator<NDimension>
+::SatoVesselnessSigmoidBlockFeatureGenerator()
+{
+  this->m_Sigma = 1.0;
+  this->m_Alpha1 = 0.5;
+  this->m_Alpha2 = 2.0;
+  this->m_SigmoidAlpha = -1.0;
+  this->m_SigmoidBeta = 90.0;
+  this->m_HaloInSigmas = 4.0;
+  this->m_SparseEvaluation = false;
+  this->m_ActivityThreshold = -400.0;
+  this->m_ActivityRadiusInSigmas = 3.0;
+}
+
+
+/*
+ * Destructor
+ */
+template <unsigned int NDimension>
+SatoVesselnessSigmoidBlockFeatureGenerator<NDimension>
+::~SatoVesselnessSigmoidBlockFeatureGenerator()
+{
+}
+
+
+/*
+ * PrintSelf
+ */
+template <unsigned int NDimension>
+void
+SatoVesselnessSigmoidBlockFeatureGenerator<NDimension>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "Sigma " << this->m_Sigma << std::endl;
+  os << indent << "Alpha1 " << this->m_Alpha1 << std::endl;
+  os << indent << "Alpha2 " << this->m_Alpha2 << std::endl;
+  os << indent << "SigmoidAlpha " << this->m_SigmoidAlpha << std::endl;
+  os << indent << "SigmoidBeta " << this->m_SigmoidBeta << std::endl;
+  os << indent << "HaloInSigmas " << this->m_HaloInSigmas << std::endl;
+  os << indent << "SparseEvaluation " << this->m_SparseEvaluation << std::endl;
+  os << indent << "ActivityThreshold " << this->m_ActivityThreshold << std::endl;
+  os << indent << "ActivityRadiusInSigmas " << this->m_ActivityRadiusInSigmas << std::endl;
+}
+
+
+template <unsigned int NDimension>
+typename SatoVesselnessSigmoidBlockFeatureGenerator<NDimension>::SizeType
+SatoVesselnessSigmoidBlockFeatureGenerator<NDimension>
+::GetBlockHaloRadius( const InputImageType * input ) const
+{
+  SizeType radius;
+  for ( unsigned int i = 0; i < NDimension; ++i )
+    {
+    // At least two voxels so that a padded block is never too small for the
+    // recursive Gaussian.
+    const double voxels = this->m_HaloInSigmas * this->m_Sigma / input->GetSpacing()[i];
+    radius[i] = std::max< SizeValueType >( 2, static_cast< SizeValueType >( std::ceil( voxels ) ) );
+    }
+  return radius;
+}
+
+
+template <unsigned int NDimension>
+typename SatoVesselnessSigmoidBlockFeatureGenerator<NDimension>::SizeType
+SatoVesselnessSigmoidBlockFeatureGenerator<NDimension>
+::GetActivityRadius( const InputImageType * input ) const
+{
+  SizeType radius;
+  for ( unsigned int i = 0; i < NDimension; ++i )
+    {
+    const double voxels = this->m_ActivityRadiusInSigmas * this->m_Sigma / input->GetSpacing()[i];
+    radius[i] = static_cast< SizeValueType >( std::ceil( std::max( 0.0, voxels ) ) );
+    }
+  return radius;
+}
+
+
+template <unsigned int NDimension>
+double
+SatoVesselnessSigmoidBlockFeatureGenerator<NDimension>
+::LineMeasure( double lambda1, double lambda2, double lambda3,
+               double alpha1, double alpha2 )
+{
+  // Negative for bright line structures.
+  const double normalizeValue = std::min( -lambda2, -lambda1 );
+  if ( normalizeValue <= 0 )
+    {
+    return 0.0;
+    }
+
+  const double alpha = lambda3 <= 0 ? alpha1 : alpha2;
+  const double ratio = lambda3 / ( alpha * normalizeValue );
+  return normalizeValue * std::exp( -0.5 * ratio * ratio );
+}
+
+
+template <unsigned int NDimension>
+bool
+SatoVesselnessSigmoidBlockFeatureGenerator<NDimension>
+::ComputeActivityMask( const InputImageType * input, const RegionType & support,
+                       const SizeType & radius, std::vector< unsigned char > & mask ) const
+{
+  const SizeType size = support.GetSize();
+  mask.resize( support.GetNumberOfPixels() );
+
+  bool active = false;
+  ImageRegionConstIterator< InputImageType > it( input, support );
+  for ( std::vector< unsigned char >::iterator mit = mask.begin(); !it.IsAtEnd(); ++it, ++mit )
+    {
+    *mit = it.Get() >= this->m_ActivityThreshold;
+    active = active || *mit;
+    }
+  if ( !active )
+    {
+    return false;
+    }
+
+  // Separable box dilation, one axis at a time, with a running count of the
+  // active voxels in the window.
+  std::vector< unsigned char > line;
+  SizeValueType stride = 1;
+  for ( unsigned int d = 0; d < NDimension; ++d )
+    {
+    const SizeValueType n = size[d];
+    const SizeValueType r = radius[d];
+    if ( r > 0 && n > 1 )
+      {
+      line.resize( n );
+      for ( SizeValueType first = 0; first < mask.size(); ++first )
+        {
+        if ( ( first / stride ) % n != 0 )
+          {
+          continue;
+          }
+        for ( SizeValueType i = 0; i < n; ++i )
+          {
+          line[i] = mask[first + i * stride];
+          }
+        SizeValueType count = 0;
+        for ( SizeValueType i = 0; i < std::min( n, r ); ++i )
+          {
+          count += line[i];
+          }
+        for ( SizeValueType i = 0; i < n; ++i )
+          {
+          if ( i + r < n )
+            {
+            count += line[i + r];
+            }
+          if ( i > r )
+            {
+            count -= line[i - r - 1];
+            }
+          mask[first + i * stride] = count > 0;
+          }
+        }
+      }
+    stride *= n;
+    }
+  return true;
+}
+
+
+template <unsigned int NDimension>
+void
+SatoVesselnessSigmoidBlockFeatureGenerator<NDimension>
+::GenerateDenseBlock( const InputImageType * brick, const RegionType & region,
+                      OutputImageType * output ) const
+{
+  // Blocks are already processed in parallel, so each pipeline runs on the
+  // calling thread only.
+  typename HessianFilterType::Pointer hessian = HessianFilterType::New();
+  hessian->SetInput( brick );
+  hessian->SetSigma( this->m_Sigma );
+  hessian->SetNumberOfThreads( 1 );
+
+  typename VesselnessMeasureFilterType::Pointer vesselness = VesselnessMeasureFilterType::New();
+  vesselness->SetInput( hessian->GetOutput() );
+  vesselness->SetAlpha1( this->m_Alpha1 );
+  vesselness->SetAlpha2( this->m_Alpha2 );
+  vesselness->SetNumberOfThreads( 1 );
+  vesselness->Update();
+
+  ImageRegionConstIterator< OutputImageType > vit( vesselness->GetOutput(), region );
+  ImageRegionIterator< OutputImageType > oit( output, region );
+  for ( ; !vit.IsAtEnd(); ++vit, ++oit )
+    {
+    oit.Set( SigmoidBlockFeatureGenerator< NDimension >::Sigmoid(
+      vit.Get(), this->m_SigmoidAlpha, this->m_SigmoidBeta ) );
+    }
+}
+
+
+template <unsigned int NDimension>
+void
+SatoVesselnessSigmoidBlockFeatureGenerator<NDimension>
+::GenerateBlock( const InputImageType * input,
+                 const RegionType & region,
+                 OutputImageType * output ) const
+{
+  // Everything that is not computed has a vesselness of zero.
+  const OutputPixelType background = SigmoidBlockFeatureGenerator< NDimension >::Sigmoid(
+    0.0, this->m_SigmoidAlpha, this->m_SigmoidBeta );
+
+  std::vector< unsigned char > mask;
+  RegionType support = region;
+  if ( this->m_SparseEvaluation )
+    {
+    support.PadByRadius( this->GetActivityRadius( input ) );
+    support.Crop( input->GetBufferedRegion() );
+    if ( !this->ComputeActivityMask( input, support, this->GetActivityRadius( input ), mask ) )
+      {
+      ImageRegionIterator< OutputImageType > oit( output, region );
+      for ( ; !oit.IsAtEnd(); ++oit )
+        {
+        oit.Set( background );
+        }
+      return;
+      }
+    }
+
+  RegionType padded = region;
+  padded.PadByRadius( this->GetBlockHaloRadius( input ) );
+  padded.Crop( input->GetBufferedRegion() );
+
+  typename InputImageType::Pointer brick = InputImageType::New();
+  brick->CopyInformation( input );
+  brick->SetRegions( padded );
+  brick->Allocate();
+  ImageAlgorithm::Copy( input, brick.GetPointer(), padded, padded );
+
+  if ( !this->m_SparseEvaluation )
+    {
+    this->GenerateDenseBlock( brick, region, output );
+    return;
+    }
+
+  typename HessianFilterType::Pointer hessian = HessianFilterType::New();
+  hessian->SetInput( brick );
+  hessian->SetSigma( this->m_Sigma );
+  hessian->SetNumberOfThreads( 1 );
+  hessian->Update();
+
+  // Eigenvalues in ascending order, as Hessian3DToVesselnessMeasureImageFilter
+  // orders them.
+  typedef typename HessianImageType::PixelType                  TensorType;
+  typedef FixedArray< double, NDimension >                      EigenValueArrayType;
+  typedef SymmetricEigenAnalysis< TensorType, EigenValueArrayType > EigenAnalysisType;
+  EigenAnalysisType eigenAnalysis( NDimension );
+  eigenAnalysis.SetOrderEigenValues( true );
+
+  ImageRegionConstIteratorWithIndex< HessianImageType > hit( hessian->GetOutput(), region );
+  ImageRegionIterator< OutputImageType > oit( output, region );
+  const typename RegionType::IndexType supportStart = support.GetIndex();
+  const SizeType supportSize = support.GetSize();
+  EigenValueArrayType eigenValues;
+  for ( ; !hit.IsAtEnd(); ++hit, ++oit )
+    {
+    const typename RegionType::IndexType index = hit.GetIndex();
+    SizeValueType offset = 0;
+    SizeValueType stride = 1;
+    for ( unsigned int d = 0; d < NDimension; ++d )
+      {
+      offset += ( index[d] - supportStart[d] ) * stride;
+      stride *= supportSize[d];
+      }
+    if ( !mask[offset] )
+      {
+      oit.Set( background );
+      continue;
+      }
+
+    eigenAnalysis.ComputeEigenValues( hit.Get(), eigenValues );
+    const double measure = LineMeasure( eigenValues[0], eigenValues[1], eigenValues[2],
+                                        this->m_Alpha1, this->m_Alpha2 );
+    oit.Set( SigmoidBlockFeatureGenerator< NDimension >::Sigmoid(
+      static_cast< OutputPixelType >( measure ), this->m_SigmoidAlpha, this->m_SigmoidBeta ) );
+    }
+}
+
+} // end namespace itk
+
+#endif
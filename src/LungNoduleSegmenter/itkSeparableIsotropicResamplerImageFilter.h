@@ -0,0 +1,165 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSeparableIsotropicResamplerImageFilter.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSeparableIsotropicResamplerImageFilter_h
+#define itkSeparableIsotropicResamplerImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkImage.h"
+#include <vector>
+
+namespace itk
+{
+
+/** \class SeparableIsotropicResamplerImageFilter
+ * \brief Resamples an image to a new spacing, one axis at a time.
+ *
+ * Produces the resampling IsotropicResamplerImageFilter does (identity
+ * transform, same origin and direction, OutputSpacing) without the generic
+ * ResampleImageFilter machinery. Since every output axis only depends on
+ * the matching input axis, the tensor product interpolation is done as one
+ * 1D pass per axis:
+ *  - the tap indices and weights of every output position are tabulated
+ *    once per axis;
+ *  - with BSpline, each line is prefiltered into cubic B-spline
+ *    coefficients (mirror boundaries, as BSplineDecompositionImageFilter)
+ *    right before it is interpolated;
+ *  - passes along the second and later axes work on panels of contiguous
+ *    first-axis rows, so both the prefilter recursion and the tap sums are
+ *    plain loops over contiguous floats that the compiler vectorises.
+ * Axes whose spacing does not change are skipped: interpolating at the
+ * sample positions gives the samples back.
+ *
+ * By default the output starts at the input origin, and covers the input
+ * extent: floor( size * inputSpacing / OutputSpacing ) voxels per axis.
+ * SetOutputParametersFromImage() instead resamples onto the grid of a
+ * reference image, which must have the input direction; this is how a
+ * sub-region of a finer grid is filled. Positions more than half a voxel
+ * outside the input get DefaultPixelValue. Integer output is rounded and
+ * clamped.
+ *
+ * \ingroup ImageFilters
+ * \ingroup LesionSizingToolkit
+ */
+template< typename TInputImage, typename TOutputImage = TInputImage >
+class ITK_EXPORT SeparableIsotropicResamplerImageFilter :
+  public ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(SeparableIsotropicResamplerImageFilter);
+
+  /** Standard class typedefs. */
+  typedef SeparableIsotropicResamplerImageFilter              Self;
+  typedef ImageToImageFilter< TInputImage, TOutputImage >     Superclass;
+  typedef SmartPointer< Self >                                Pointer;
+  typedef SmartPointer< const Self >                          ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SeparableIsotropicResamplerImageFilter, ImageToImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  typedef TInputImage                                   InputImageType;
+  typedef TOutputImage                                  OutputImageType;
+  typedef typename InputImageType::PixelType            InputPixelType;
+  typedef typename OutputImageType::PixelType           OutputPixelType;
+  typedef typename OutputImageType::SpacingType         SpacingType;
+  typedef typename OutputImageType::SizeType            SizeType;
+  typedef typename OutputImageType::PointType           PointType;
+  typedef typename OutputImageType::RegionType          OutputImageRegionType;
+  typedef ImageBase< ImageDimension >                   ImageBaseType;
+
+  /** Interpolation kernel. */
+  enum ResamplingMethodType { Linear = 0, BSpline };
+
+  /** Spacing of the output. */
+  itkSetMacro( OutputSpacing, SpacingType );
+  itkGetConstReferenceMacro( OutputSpacing, SpacingType );
+
+  /** Resample onto the grid (spacing, origin and largest possible region)
+   * of \a reference instead of the default grid. */
+  void SetOutputParametersFromImage( const ImageBaseType * reference );
+
+  /** Go back to the default grid. */
+  void UseDefaultOutputGrid();
+
+  /** Defaults to BSpline (cubic), as IsotropicResamplerImageFilter. */
+  itkSetMacro( ResamplingMethod, ResamplingMethodType );
+  itkGetMacro( ResamplingMethod, ResamplingMethodType );
+
+  /** Value of the output outside the input. Defaults to 0. */
+  itkSetMacro( DefaultPixelValue, OutputPixelType );
+  itkGetMacro( DefaultPixelValue, OutputPixelType );
+
+  /** Number of first-axis columns of the panels processed together by the
+   * passes along the other axes. Defaults to 256. */
+  itkSetMacro( PanelWidth, unsigned int );
+  itkGetMacro( PanelWidth, unsigned int );
+
+protected:
+  SeparableIsotropicResamplerImageFilter();
+  ~SeparableIsotropicResamplerImageFilter() override {}
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  void GenerateOutputInformation() override;
+  void GenerateInputRequestedRegion() override;
+  void EnlargeOutputRequestedRegion( DataObject * output ) override;
+  void GenerateData() override;
+
+private:
+  typedef float PrecisionType;
+
+  /** Taps of the output positions along one axis. */
+  struct AxisTable
+    {
+    unsigned int                  NumberOfTaps;
+    std::vector< SizeValueType >  Index;    // NumberOfTaps per position
+    std::vector< PrecisionType >  Weight;   // NumberOfTaps per position
+    std::vector< bool >           Inside;
+    };
+
+  void BuildAxisTable( SizeValueType inputSize, SizeValueType outputSize,
+                       double offset, double ratio, AxisTable & table ) const;
+
+  /** Turn \a n samples, \a stride apart, of \a width interleaved lines into
+   * cubic B-spline coefficients in place. */
+  static void PrefilterLines( PrecisionType * data, SizeValueType n,
+                              SizeValueType stride, SizeValueType width );
+
+  /** Resample \a in, of size \a dims, along \a axis into \a out. */
+  void ResampleAxis( const std::vector< PrecisionType > & in, const SizeValueType * dims,
+                     unsigned int axis, const AxisTable & table,
+                     std::vector< PrecisionType > & out ) const;
+
+  SpacingType           m_OutputSpacing;
+  ResamplingMethodType  m_ResamplingMethod;
+  OutputPixelType       m_DefaultPixelValue;
+  unsigned int          m_PanelWidth;
+  bool                  m_UseReferenceGrid;
+  PointType             m_ReferenceOrigin;
+  OutputImageRegionType m_ReferenceRegion;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkSeparableIsotropicResamplerImageFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,529 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSeparableIsotropicResamplerImageFilter.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSeparableIsotropicResamplerImageFilter_hxx
+#define itkSeparableIsotropicResamplerImageFilter_hxx
+
+#include "itkSeparableIsotropicResamplerImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkParallelForEachBlock.h"
+#include "itkNumericTraits.h"
+#include "itkMath.h"
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+template< typename TInputImage, typename TOutputImage >
+SeparableIsotropicResamplerImageFilter< TInputImage, TOutputImage >
+::SeparableIsotropicResamplerImageFilter()
+{
+  this->m_OutputSpacing.Fill( 1.0 );
+  this->m_ResamplingMethod = BSpline;
+  this->m_DefaultPixelValue = NumericTraits< OutputPixelType >::ZeroValue();
+  this->m_PanelWidth = 256;
+  this->m_UseReferenceGrid = false;
+  this->m_ReferenceOrigin.Fill( 0.0 );
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+SeparableIsotropicResamplerImageFilter< TInputImage, TOutputImage >
+::SetOutputParametersFromImage( const ImageBaseType * reference )
+{
+  this->m_OutputSpacing = reference->GetSpacing();
+  this->m_ReferenceOrigin = reference->GetOrigin();
+  this->m_ReferenceRegion = reference->GetLargestPossibleRegion();
+  this->m_UseReferenceGrid = true;
+  this->Modified();
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+SeparableIsotropicResamplerImageFilter< TInputImage, TOutputImage >
+::UseDefaultOutputGrid()
+{
+  if ( this->m_UseReferenceGrid )
+    {
+    this->m_UseReferenceGrid = false;
+    this->Modified();
+    }
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+SeparableIsotropicResamplerImageFilter< TInputImage, TOutputImage >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "OutputSpacing " << this->m_OutputSpacing << std::endl;
+  os << indent << "ResamplingMethod " << ( this->m_ResamplingMethod == BSpline ? "BSpline" : "Linear" ) << std::endl;
+  os << indent << "DefaultPixelValue "
+     << static_cast< typename NumericTraits< OutputPixelType >::PrintType >( this->m_DefaultPixelValue ) << std::endl;
+  os << indent << "PanelWidth " << this->m_PanelWidth << std::endl;
+  os << indent << "UseReferenceGrid " << this->m_UseReferenceGrid << std::endl;
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+SeparableIsotropicResamplerImageFilter< TInputImage, TOutputImage >
+::GenerateOutputInformation()
+{
+  const InputImageType * input = this->GetInput();
+  OutputImageType * output = this->GetOutput();
+  if ( !input || !output )
+    {
+    return;
+    }
+
+  if ( this->m_UseReferenceGrid )
+    {
+    output->SetLargestPossibleRegion( this->m_ReferenceRegion );
+    output->SetSpacing( this->m_OutputSpacing );
+    output->SetOrigin( this->m_ReferenceOrigin );
+    output->SetDirection( input->GetDirection() );
+    return;
+    }
+
+  const typename InputImageType::RegionType inputRegion = input->GetLargestPossibleRegion();
+  typename OutputImageType::RegionType outputRegion;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    if ( !( this->m_OutputSpacing[i] > 0.0 ) )
+      {
+      itkExceptionMacro("Output spacing must be positive, got " << this->m_OutputSpacing);
+      }
+    // The tolerance keeps exact multiples from losing a voxel to rounding.
+    const double extent = inputRegion.GetSize()[i] * input->GetSpacing()[i] / this->m_OutputSpacing[i];
+    outputRegion.SetIndex( i, 0 );
+    outputRegion.SetSize( i, std::max< SizeValueType >( 1,
+      static_cast< SizeValueType >( std::floor( extent + 1e-6 ) ) ) );
+    }
+
+  typename OutputImageType::PointType origin;
+  input->TransformIndexToPhysicalPoint( inputRegion.GetIndex(), origin );
+
+  output->SetLargestPossibleRegion( outputRegion );
+  output->SetSpacing( this->m_OutputSpacing );
+  output->SetOrigin( origin );
+  output->SetDirection( input->GetDirection() );
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+SeparableIsotropicResamplerImageFilter< TInputImage, TOutputImage >
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  if ( this->GetInput() )
+    {
+    InputImageType * input = const_cast< InputImageType * >( this->GetInput() );
+    input->SetRequestedRegionToLargestPossibleRegion();
+    }
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+SeparableIsotropicResamplerImageFilter< TInputImage, TOutputImage >
+::EnlargeOutputRequestedRegion( DataObject * output )
+{
+  Superclass::EnlargeOutputRequestedRegion( output );
+  output->SetRequestedRegionToLargestPossibleRegion();
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+SeparableIsotropicResamplerImageFilter< TInputImage, TOutputImage >
+::BuildAxisTable( SizeValueType inputSize, SizeValueType outputSize,
+                  double offset, double ratio, AxisTable & table ) const
+{
+  const bool bspline = this->m_ResamplingMethod == BSpline;
+  const unsigned int taps = bspline ? 4 : 2;
+  table.NumberOfTaps = taps;
+  table.Index.resize( outputSize * taps );
+  table.Weight.resize( outputSize * taps );
+  table.Inside.resize( outputSize );
+
+  // Mirror boundaries, as BSplineInterpolateImageFunction.
+  const IndexValueType length2 = 2 * static_cast< IndexValueType >( inputSize ) - 2;
+  auto mirror = [inputSize, length2]( IndexValueType k ) -> SizeValueType
+    {
+    if ( inputSize == 1 )
+      {
+      return 0;
+      }
+    k = k < 0 ? -k - length2 * ( ( -k ) / length2 ) : k - length2 * ( k / length2 );
+    if ( k >= static_cast< IndexValueType >( inputSize ) )
+      {
+      k = length2 - k;
+      }
+    return static_cast< SizeValueType >( k );
+    };
+  auto clamp = [inputSize]( IndexValueType k ) -> SizeValueType
+    {
+    return static_cast< SizeValueType >(
+      std::max< IndexValueType >( 0, std::min< IndexValueType >( k, inputSize - 1 ) ) );
+    };
+
+  for ( SizeValueType i = 0; i < outputSize; ++i )
+    {
+    const double x = offset + i * ratio;
+    table.Inside[i] = x >= -0.5 && x < inputSize - 0.5;
+    const IndexValueType k = Math::Floor< IndexValueType >( x );
+    const double t = x - k;
+    SizeValueType * index = &table.Index[i * taps];
+    PrecisionType * weight = &table.Weight[i * taps];
+    if ( bspline )
+      {
+      const double t2 = t * t;
+      const double t3 = t2 * t;
+      const double s = 1.0 - t;
+      weight[0] = static_cast< PrecisionType >( s * s * s / 6.0 );
+      weight[1] = static_cast< PrecisionType >( 2.0 / 3.0 - t2 + 0.5 * t3 );
+      weight[2] = static_cast< PrecisionType >( ( 1.0 + 3.0 * t + 3.0 * t2 - 3.0 * t3 ) / 6.0 );
+      weight[3] = static_cast< PrecisionType >( t3 / 6.0 );
+      for ( unsigned int j = 0; j < 4; ++j )
+        {
+        index[j] = mirror( k - 1 + static_cast< IndexValueType >( j ) );
+        }
+      }
+    else
+      {
+      weight[0] = static_cast< PrecisionType >( 1.0 - t );
+      weight[1] = static_cast< PrecisionType >( t );
+      index[0] = clamp( k );
+      index[1] = clamp( k + 1 );
+      }
+    }
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+SeparableIsotropicResamplerImageFilter< TInputImage, TOutputImage >
+::PrefilterLines( PrecisionType * data, SizeValueType n,
+                  SizeValueType stride, SizeValueType width )
+{
+  // Cubic B-spline interpolation coefficients (Unser et al.), with the
+  // boundary handling and tolerance of BSplineDecompositionImageFilter. The
+  // recursions run along the lines and are vectorised across them.
+  if ( n < 2 )
+    {
+    return;
+    }
+  const double z = std::sqrt( 3.0 ) - 2.0;
+  const PrecisionType zf = static_cast< PrecisionType >( z );
+  const PrecisionType gain = static_cast< PrecisionType >( ( 1.0 - z ) * ( 1.0 - 1.0 / z ) );
+  auto row = [data, stride]( SizeValueType k ) { return data + k * stride; };
+
+  for ( SizeValueType k = 0; k < n; ++k )
+    {
+    PrecisionType * r = row( k );
+    for ( SizeValueType x = 0; x < width; ++x )
+      {
+      r[x] *= gain;
+      }
+    }
+
+  // Initial causal coefficient, as a weighted sum of each line.
+  std::vector< PrecisionType > initialWeight( n, 0.0f );
+  const SizeValueType horizon = static_cast< SizeValueType >(
+    std::ceil( std::log( 1e-10 ) / std::log( std::fabs( z ) ) ) );
+  if ( horizon < n )
+    {
+    double zn = 1.0;
+    for ( SizeValueType k = 0; k < horizon; ++k )
+      {
+      initialWeight[k] = static_cast< PrecisionType >( zn );
+      zn *= z;
+      }
+    }
+  else
+    {
+    double zn = z;
+    double z2n = std::pow( z, static_cast< double >( n - 1 ) );
+    std::vector< double > w( n, 0.0 );
+    w[0] = 1.0;
+    w[n - 1] += z2n;
+    z2n *= z2n / z;
+    for ( SizeValueType k = 1; k + 1 < n; ++k )
+      {
+      w[k] += zn + z2n;
+      zn *= z;
+      z2n /= z;
+      }
+    const double norm = 1.0 / ( 1.0 - zn * zn );
+    for ( SizeValueType k = 0; k < n; ++k )
+      {
+      initialWeight[k] = static_cast< PrecisionType >( w[k] * norm );
+      }
+    }
+  std::vector< PrecisionType > initial( width, 0.0f );
+  for ( SizeValueType k = 0; k < n; ++k )
+    {
+    const PrecisionType a = initialWeight[k];
+    if ( a == 0.0f )
+      {
+      continue;
+      }
+    const PrecisionType * r = row( k );
+    for ( SizeValueType x = 0; x < width; ++x )
+      {
+      initial[x] += a * r[x];
+      }
+    }
+  std::copy( initial.begin(), initial.end(), row( 0 ) );
+
+  // Causal recursion.
+  for ( SizeValueType k = 1; k < n; ++k )
+    {
+    PrecisionType * r = row( k );
+    const PrecisionType * p = row( k - 1 );
+    for ( SizeValueType x = 0; x < width; ++x )
+      {
+      r[x] += zf * p[x];
+      }
+    }
+
+  // Anti-causal recursion.
+  {
+  PrecisionType * r = row( n - 1 );
+  const PrecisionType * p = row( n - 2 );
+  const PrecisionType a = static_cast< PrecisionType >( z / ( z * z - 1.0 ) );
+  for ( SizeValueType x = 0; x < width; ++x )
+    {
+    r[x] = a * ( zf * p[x] + r[x] );
+    }
+  }
+  for ( SizeValueType k = n - 1; k-- > 0; )
+    {
+    PrecisionType * r = row( k );
+    const PrecisionType * q = row( k + 1 );
+    for ( SizeValueType x = 0; x < width; ++x )
+      {
+      r[x] = zf * ( q[x] - r[x] );
+      }
+    }
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+SeparableIsotropicResamplerImageFilter< TInputImage, TOutputImage >
+::ResampleAxis( const std::vector< PrecisionType > & in, const SizeValueType * dims,
+                unsigned int axis, const AxisTable & table,
+                std::vector< PrecisionType > & out ) const
+{
+  SizeValueType stride = 1;
+  for ( unsigned int i = 0; i < axis; ++i )
+    {
+    stride *= dims[i];
+    }
+  SizeValueType outer = 1;
+  for ( unsigned int i = axis + 1; i < ImageDimension; ++i )
+    {
+    outer *= dims[i];
+    }
+  const SizeValueType n = dims[axis];
+  const SizeValueType m = table.Inside.size();
+  const unsigned int taps = table.NumberOfTaps;
+  const bool bspline = this->m_ResamplingMethod == BSpline;
+  out.resize( stride * m * outer );
+
+  // Lines along the first axis are contiguous and handled one at a time.
+  // Along the other axes, a panel of up to PanelWidth adjacent lines is
+  // gathered so that the inner loops run over contiguous columns.
+  const SizeValueType width = axis == 0 ? 1 : std::min< SizeValueType >(
+    stride, std::max< unsigned int >( 1, this->m_PanelWidth ) );
+  const SizeValueType chunks = axis == 0 ? 1 : ( stride + width - 1 ) / width;
+  const SizeValueType linesPerBlock = axis == 0 ? 64 : 1;
+  const SizeValueType numberOfBlocks = ( outer * chunks + linesPerBlock - 1 ) / linesPerBlock;
+
+  std::vector< std::vector< PrecisionType > > scratch(
+    GetParallelForEachBlockNumberOfThreads( numberOfBlocks ) );
+  auto resampleBlock = [&]( SizeValueType block, ThreadIdType threadId )
+    {
+    std::vector< PrecisionType > & panel = scratch[threadId];
+    panel.resize( n * width );
+    if ( axis == 0 )
+      {
+      const SizeValueType last = std::min( outer, ( block + 1 ) * linesPerBlock );
+      for ( SizeValueType line = block * linesPerBlock; line < last; ++line )
+        {
+        const PrecisionType * src = &in[line * n];
+        const PrecisionType * coefficients = src;
+        if ( bspline )
+          {
+          std::copy( src, src + n, panel.begin() );
+          PrefilterLines( &panel[0], n, 1, 1 );
+          coefficients = &panel[0];
+          }
+        PrecisionType * dst = &out[line * m];
+        for ( SizeValueType i = 0; i < m; ++i )
+          {
+          const SizeValueType * index = &table.Index[i * taps];
+          const PrecisionType * weight = &table.Weight[i * taps];
+          PrecisionType sum = 0.0f;
+          for ( unsigned int j = 0; j < taps; ++j )
+            {
+            sum += weight[j] * coefficients[index[j]];
+            }
+          dst[i] = sum;
+          }
+        }
+      return;
+      }
+
+    const SizeValueType o = block / chunks;
+    const SizeValueType x0 = ( block % chunks ) * width;
+    const SizeValueType w = std::min( width, stride - x0 );
+    const PrecisionType * src = &in[o * n * stride + x0];
+    for ( SizeValueType k = 0; k < n; ++k )
+      {
+      std::copy( src + k * stride, src + k * stride + w, &panel[k * w] );
+      }
+    if ( bspline )
+      {
+      PrefilterLines( &panel[0], n, w, w );
+      }
+    PrecisionType * dst = &out[o * m * stride + x0];
+    for ( SizeValueType i = 0; i < m; ++i )
+      {
+      PrecisionType * d = dst + i * stride;
+      std::fill( d, d + w, 0.0f );
+      for ( unsigned int j = 0; j < taps; ++j )
+        {
+        const PrecisionType a = table.Weight[i * taps + j];
+        const PrecisionType * r = &panel[table.Index[i * taps + j] * w];
+        for ( SizeValueType x = 0; x < w; ++x )
+          {
+          d[x] += a * r[x];
+          }
+        }
+      }
+    };
+  ParallelForEachBlock( numberOfBlocks, resampleBlock );
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+SeparableIsotropicResamplerImageFilter< TInputImage, TOutputImage >
+::GenerateData()
+{
+  const InputImageType * input = this->GetInput();
+  const typename InputImageType::RegionType inputRegion = input->GetLargestPossibleRegion();
+
+  OutputImageType * output = this->GetOutput();
+  const typename OutputImageType::RegionType outputRegion = output->GetLargestPossibleRegion();
+  output->SetBufferedRegion( outputRegion );
+  output->Allocate();
+
+  SizeValueType dims[ImageDimension];
+  std::vector< PrecisionType > current( inputRegion.GetNumberOfPixels() );
+  {
+  ImageRegionConstIterator< InputImageType > it( input, inputRegion );
+  for ( SizeValueType k = 0; !it.IsAtEnd(); ++it, ++k )
+    {
+    current[k] = static_cast< PrecisionType >( it.Get() );
+    }
+  }
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    dims[i] = inputRegion.GetSize()[i];
+    }
+
+  // Continuous input index of the first output voxel. The directions are
+  // the same, so each output axis only moves along the matching input axis.
+  typename OutputImageType::PointType first;
+  output->TransformIndexToPhysicalPoint( outputRegion.GetIndex(), first );
+  ContinuousIndex< double, ImageDimension > firstIndex;
+  input->TransformPhysicalPointToContinuousIndex( first, firstIndex );
+
+  // One pass per axis whose sampling changes.
+  std::vector< AxisTable > tables( ImageDimension );
+  std::vector< bool > resampled( ImageDimension, false );
+  std::vector< PrecisionType > next;
+  for ( unsigned int axis = 0; axis < ImageDimension; ++axis )
+    {
+    const double offset = firstIndex[axis] - inputRegion.GetIndex()[axis];
+    const double ratio = this->m_OutputSpacing[axis] / input->GetSpacing()[axis];
+    const SizeValueType outputSize = outputRegion.GetSize()[axis];
+    if ( outputSize == dims[axis] && std::fabs( ratio - 1.0 ) < 1e-9 && std::fabs( offset ) < 1e-6 )
+      {
+      continue;
+      }
+    this->BuildAxisTable( dims[axis], outputSize, offset, ratio, tables[axis] );
+    this->ResampleAxis( current, dims, axis, tables[axis], next );
+    current.swap( next );
+    dims[axis] = outputSize;
+    resampled[axis] = true;
+    this->UpdateProgress( static_cast< float >( axis + 1 ) / ( ImageDimension + 1 ) );
+    if ( this->GetAbortGenerateData() )
+      {
+      return;
+      }
+    }
+  std::vector< PrecisionType >().swap( next );
+
+  // Convert, with the default value outside the input.
+  const double lowest = static_cast< double >( NumericTraits< OutputPixelType >::NonpositiveMin() );
+  const double highest = static_cast< double >( NumericTraits< OutputPixelType >::max() );
+  const OutputPixelType defaultValue = this->m_DefaultPixelValue;
+  const SlabRegionSplitter< ImageDimension > splitter( outputRegion, 4 );
+  auto convertSlab = [&]( SizeValueType slab, ThreadIdType )
+    {
+    auto convertLine = [&]( const typename OutputImageType::IndexType & lineStart, SizeValueType n )
+      {
+      const SizeValueType offset = output->ComputeOffset( lineStart );
+      OutputPixelType * out = output->GetBufferPointer() + offset;
+      bool inside = true;
+      for ( unsigned int i = 1; i < ImageDimension; ++i )
+        {
+        inside = inside && ( !resampled[i] || tables[i].Inside[lineStart[i] - outputRegion.GetIndex()[i]] );
+        }
+      for ( SizeValueType x = 0; x < n; ++x )
+        {
+        if ( !inside || ( resampled[0] && !tables[0].Inside[x] ) )
+          {
+          out[x] = defaultValue;
+          continue;
+          }
+        double value = current[offset + x];
+        if ( NumericTraits< OutputPixelType >::is_integer )
+          {
+          value = std::max( lowest, std::min( highest, static_cast< double >( Math::Round< long >( value ) ) ) );
+          }
+        out[x] = static_cast< OutputPixelType >( value );
+        }
+      };
+    ForEachRegionLine( splitter.GetSlab( slab ), convertLine );
+    };
+  ParallelForEachBlock( splitter.GetNumberOfSlabs(), convertSlab );
+  this->UpdateProgress( 1.0f );
+}
+
+} // end namespace itk
+
+#endif
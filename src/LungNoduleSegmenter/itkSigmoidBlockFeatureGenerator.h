@@ -0,0 +1,96 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSigmoidBlockFeatureGenerator.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSigmoidBlockFeatureGenerator_h
+#define itkSigmoidBlockFeatureGenerator_h
+
+#include "itkBlockFeatureGenerator.h"
+#include <cmath>
+
+namespace itk
+{
+
+/** \class SigmoidBlockFeatureGenerator
+ * \brief Sigmoid of the input intensities, evaluated block by block.
+ *
+ * Computes the same feature as SigmoidFeatureGenerator, that is
+ * 1 / ( 1 + exp( -( I - Beta ) / Alpha ) ), but as a BlockFeatureGenerator
+ * so that the value can be computed inline by the aggregator instead of
+ * being stored in a full image.
+ *
+ * \ingroup SpatialObjectFilters
+ * \ingroup LesionSizingToolkit
+ */
+template <unsigned int NDimension>
+class ITK_EXPORT SigmoidBlockFeatureGenerator : public BlockFeatureGenerator<NDimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(SigmoidBlockFeatureGenerator);
+
+  /** Standard class typedefs. */
+  typedef SigmoidBlockFeatureGenerator      Self;
+  typedef BlockFeatureGenerator<NDimension> Superclass;
+  typedef SmartPointer<Self>                Pointer;
+  typedef SmartPointer<const Self>          ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SigmoidBlockFeatureGenerator, BlockFeatureGenerator);
+
+  typedef typename Superclass::InputImageType   InputImageType;
+  typedef typename Superclass::OutputImageType  OutputImageType;
+  typedef typename Superclass::OutputPixelType  OutputPixelType;
+  typedef typename Superclass::RegionType       RegionType;
+
+  /** Alpha value to be used in the Sigmoid filter. */
+  itkSetMacro( Alpha, double );
+  itkGetMacro( Alpha, double );
+
+  /** Beta value to be used in the Sigmoid filter. */
+  itkSetMacro( Beta, double );
+  itkGetMacro( Beta, double );
+
+  void GenerateBlock( const InputImageType * input,
+                      const RegionType & region,
+                      OutputImageType * output ) const override;
+
+  /** Sigmoid mapping shared with the aggregator's inline mappings. Matches
+   * SigmoidImageFilter with an output range of [0,1]. */
+  static OutputPixelType Sigmoid( double value, double alpha, double beta )
+    {
+    const double x = ( value - beta ) / alpha;
+    return static_cast< OutputPixelType >( 1.0 / ( 1.0 + std::exp( -x ) ) );
+    }
+
+protected:
+  SigmoidBlockFeatureGenerator();
+  ~SigmoidBlockFeatureGenerator() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+private:
+  double m_Alpha;
+  double m_Beta;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkSigmoidBlockFeatureGenerator.hxx"
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSigmoidBlockFeatureGenerator.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSigmoidBlockFeatureGenerator_hxx
+#define itkSigmoidBlockFeatureGenerator_hxx
+
+#include "itkSigmoidBlockFeatureGenerator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template <unsigned int NDimension>
+SigmoidBlockFeatureGenerator<NDimension>
+::SigmoidBlockFeatureGenerator()
+{
+  this->m_Alpha = -1.0;
+  this->m_Beta = 128.0;
+}
+
+
+/*
+ * Destructor
+ */
+template <unsigned int NDimension>
+SigmoidBlockFeatureGenerator<NDimension>
+::~SigmoidBlockFeatureGenerator()
+{
+}
+
+
+/*
+ * PrintSelf
+ */
+template <unsigned int NDimension>
+void
+SigmoidBlockFeatureGenerator<NDimension>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "Alpha " << this->m_Alpha << std::endl;
+  os << indent << "Beta " << this->m_Beta << std::endl;
+}
+
+
+template <unsigned int NDimension>
+void
+SigmoidBlockFeatureGenerator<NDimension>
+::GenerateBlock( const InputImageType * input,
+                 const RegionType & region,
+                 OutputImageType * output ) const
+{
+  ImageRegionConstIterator< InputImageType > iit( input, region );
+  ImageRegionIterator< OutputImageType > oit( output, region );
+  for ( ; !iit.IsAtEnd(); ++iit, ++oit )
+    {
+    oit.Set( Self::Sigmoid( iit.Get(), this->m_Alpha, this->m_Beta ) );
+    }
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,231 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSparseBrickImage.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSparseBrickImage_h
+#define itkSparseBrickImage_h
+
+#include "itkImageBase.h"
+#include "itkImage.h"
+#include <memory>
+#include <vector>
+
+namespace itk
+{
+
+/** \class SparseBrickImage
+ * \brief Image of scalar pixels stored in bricks allocated on demand.
+ *
+ * The buffered region is divided into cubic bricks of BrickSize voxels per
+ * axis, starting at its first index. A brick is only allocated once a pixel
+ * in it is set to something other than BackgroundValue; unallocated bricks
+ * read as BackgroundValue. Memory then follows the part of the image that
+ * holds data, not the extent of the region.
+ *
+ * Allocate() only sets up the brick table. Bricks are numbered with the
+ * first axis fastest, as BrickRegionSplitter numbers them, and the pixels of
+ * a brick are stored with the first axis fastest over the whole brick, also
+ * for the bricks cut by the end of the region. Lines along the first axis
+ * are therefore contiguous within a brick.
+ *
+ * Different threads may set pixels of, or allocate, different bricks
+ * concurrently. The geometry is that of ImageBase, so the image can be
+ * mapped to and from physical space like any other. Use
+ * SparseBrickImageRegionConstIterator and SparseBrickImageRegionIterator
+ * to visit a region, and CopyFromImage() and CopyToImage() to convert
+ * from and to a dense Image.
+ *
+ * Within LesionSegmentationImageFilterACM it holds the feature caches of
+ * LazyTileMinimumFeatureAggregator, through QuantizedFeatureBuffer, and,
+ * with SparseSpeedImage, the speed image of the geodesic active contour,
+ * sampled by LinearInterpolateImageFunction. It also holds the vesselness
+ * of StudyFeatureCache, read through CachedBlockFeatureGenerator. The
+ * resampled input, the aggregated feature handed to the level set, the
+ * level set itself and the arrival times of fast marching stay dense
+ * Images: they are the inputs and outputs of toolkit filters, which only
+ * run on an Image.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template< typename TPixel, unsigned int VImageDimension = 3 >
+class ITK_EXPORT SparseBrickImage : public ImageBase< VImageDimension >
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(SparseBrickImage);
+
+  /** Standard class typedefs. */
+  typedef SparseBrickImage                  Self;
+  typedef ImageBase< VImageDimension >      Superclass;
+  typedef SmartPointer< Self >              Pointer;
+  typedef SmartPointer< const Self >        ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SparseBrickImage, ImageBase);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, VImageDimension);
+
+  typedef TPixel                                PixelType;
+  typedef typename Superclass::IndexType        IndexType;
+  typedef typename Superclass::SizeType         SizeType;
+  typedef typename Superclass::RegionType       RegionType;
+  typedef Image< TPixel, VImageDimension >      DenseImageType;
+
+  /** Edge length of the bricks, in voxels, rounded up to a power of two.
+   * Takes effect on the next Allocate(). Defaults to 16. */
+  void SetBrickSize( unsigned int size );
+  itkGetConstMacro( BrickSize, unsigned int );
+
+  /** Value of the pixels of unallocated bricks. Set it before any brick is
+   * allocated. Defaults to 0. */
+  itkSetMacro( BackgroundValue, PixelType );
+  itkGetConstMacro( BackgroundValue, PixelType );
+
+  /** Set up the (empty) brick table over the buffered region, releasing
+   * any brick allocated before. */
+  void Allocate( bool initialize = false ) override;
+
+  /** Release all bricks and restore the initial state. */
+  void Initialize() override;
+
+  /** Access a pixel of the buffered region. Setting a pixel of an
+   * unallocated brick to anything but the background allocates it. */
+  PixelType GetPixel( const IndexType & index ) const
+    {
+    SizeValueType brick;
+    OffsetValueType offset;
+    this->ComputeBrickAndOffset( index, brick, offset );
+    const PixelType * buffer = this->m_Bricks[brick].get();
+    return buffer ? buffer[offset] : this->m_BackgroundValue;
+    }
+  void SetPixel( const IndexType & index, const PixelType & value )
+    {
+    SizeValueType brick;
+    OffsetValueType offset;
+    this->ComputeBrickAndOffset( index, brick, offset );
+    PixelType * buffer = this->m_Bricks[brick].get();
+    if ( !buffer )
+      {
+      if ( value == this->m_BackgroundValue )
+        {
+        return;
+        }
+      buffer = this->AllocateBrick( brick );
+      }
+    buffer[offset] = value;
+    }
+
+  /** Number of bricks per axis, and in all. */
+  const SizeType & GetNumberOfBricksPerAxis() const
+    { return this->m_NumberOfBricksPerAxis; }
+  SizeValueType GetNumberOfBricks() const
+    { return static_cast< SizeValueType >( this->m_Bricks.size() ); }
+
+  /** Brick of a pixel of the buffered region. */
+  SizeValueType ComputeBrickNumber( const IndexType & index ) const
+    {
+    SizeValueType brick;
+    OffsetValueType offset;
+    this->ComputeBrickAndOffset( index, brick, offset );
+    return brick;
+    }
+
+  /** Offset of a pixel of the buffered region in the buffer of its brick. */
+  OffsetValueType ComputeBrickOffset( const IndexType & index ) const
+    {
+    SizeValueType brick;
+    OffsetValueType offset;
+    this->ComputeBrickAndOffset( index, brick, offset );
+    return offset;
+    }
+
+  /** Part of the buffered region covered by \a brick. */
+  RegionType GetBrickRegion( SizeValueType brick ) const;
+
+  bool IsBrickAllocated( SizeValueType brick ) const
+    { return this->m_Bricks[brick] != nullptr; }
+
+  /** Pixels of \a brick, or null if it is not allocated. */
+  PixelType * GetBrickBuffer( SizeValueType brick )
+    { return this->m_Bricks[brick].get(); }
+  const PixelType * GetBrickBuffer( SizeValueType brick ) const
+    { return this->m_Bricks[brick].get(); }
+
+  /** Allocate \a brick, filled with the background, unless it already is.
+   * Returns its pixels. */
+  PixelType * AllocateBrick( SizeValueType brick );
+
+  /** Release \a brick; its pixels read as the background again. */
+  void ReleaseBrick( SizeValueType brick );
+
+  /** Release the allocated bricks whose pixels are all background. Returns
+   * the number of bricks released. */
+  SizeValueType ReleaseBackgroundBricks();
+
+  SizeValueType GetNumberOfAllocatedBricks() const;
+
+  /** Bytes held by the allocated bricks. */
+  SizeValueType GetNumberOfAllocatedBytes() const;
+
+  /** Take the geometry and buffered region of \a image, and its pixels,
+   * allocating only the bricks that hold something other than the
+   * background. */
+  void CopyFromImage( const DenseImageType * image );
+
+  /** Fill the buffered region of \a image, which must be within the
+   * buffered region of this image. */
+  void CopyToImage( DenseImageType * image ) const;
+
+protected:
+  SparseBrickImage();
+  ~SparseBrickImage() override {}
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+private:
+  void ComputeBrickAndOffset( const IndexType & index,
+                              SizeValueType & brick, OffsetValueType & offset ) const
+    {
+    const IndexType & start = this->GetBufferedRegion().GetIndex();
+    const OffsetValueType mask = static_cast< OffsetValueType >( this->m_BrickSize ) - 1;
+    brick = 0;
+    offset = 0;
+    for ( int i = VImageDimension - 1; i >= 0; --i )
+      {
+      const OffsetValueType relative = index[i] - start[i];
+      brick = brick * this->m_NumberOfBricksPerAxis[i] +
+        static_cast< SizeValueType >( relative >> this->m_BrickShift );
+      offset = ( offset << this->m_BrickShift ) + ( relative & mask );
+      }
+    }
+
+  SizeValueType GetNumberOfPixelsPerBrick() const
+    { return static_cast< SizeValueType >( 1 ) << ( this->m_BrickShift * VImageDimension ); }
+
+  unsigned int                                  m_BrickSize;
+  unsigned int                                  m_BrickShift;
+  PixelType                                     m_BackgroundValue;
+  SizeType                                      m_NumberOfBricksPerAxis;
+  std::vector< std::unique_ptr< PixelType[] > > m_Bricks;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkSparseBrickImage.hxx"
+#endif
+
+#endif
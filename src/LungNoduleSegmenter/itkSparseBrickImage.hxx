@@ -0,0 +1,270 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSparseBrickImage.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSparseBrickImage_hxx
+#define itkSparseBrickImage_hxx
+
+#include "itkSparseBrickImage.h"
+#include "itkParallelForEachBlock.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template< typename TPixel, unsigned int VImageDimension >
+SparseBrickImage< TPixel, VImageDimension >
+::SparseBrickImage() :
+  m_BrickSize( 16 ),
+  m_BrickShift( 4 ),
+  m_BackgroundValue( NumericTraits< PixelType >::ZeroValue() )
+{
+  this->m_NumberOfBricksPerAxis.Fill( 0 );
+}
+
+
+template< typename TPixel, unsigned int VImageDimension >
+void
+SparseBrickImage< TPixel, VImageDimension >
+::SetBrickSize( unsigned int size )
+{
+  unsigned int shift = 0;
+  while ( ( 1u << shift ) < size )
+    {
+    ++shift;
+    }
+  if ( this->m_BrickShift != shift )
+    {
+    this->m_BrickShift = shift;
+    this->m_BrickSize = 1u << shift;
+    this->Modified();
+    }
+}
+
+
+template< typename TPixel, unsigned int VImageDimension >
+void
+SparseBrickImage< TPixel, VImageDimension >
+::Allocate( bool )
+{
+  const RegionType & region = this->GetBufferedRegion();
+  SizeValueType numberOfBricks = 1;
+  for ( unsigned int i = 0; i < VImageDimension; ++i )
+    {
+    this->m_NumberOfBricksPerAxis[i] =
+      ( region.GetSize()[i] + this->m_BrickSize - 1 ) >> this->m_BrickShift;
+    numberOfBricks *= this->m_NumberOfBricksPerAxis[i];
+    }
+  this->m_Bricks.clear();
+  this->m_Bricks.resize( numberOfBricks );
+}
+
+
+template< typename TPixel, unsigned int VImageDimension >
+void
+SparseBrickImage< TPixel, VImageDimension >
+::Initialize()
+{
+  Superclass::Initialize();
+  this->m_Bricks.clear();
+  this->m_NumberOfBricksPerAxis.Fill( 0 );
+}
+
+
+template< typename TPixel, unsigned int VImageDimension >
+typename SparseBrickImage< TPixel, VImageDimension >::RegionType
+SparseBrickImage< TPixel, VImageDimension >
+::GetBrickRegion( SizeValueType brick ) const
+{
+  SizeType brickSize;
+  brickSize.Fill( this->m_BrickSize );
+  return BrickRegionSplitter< VImageDimension >(
+    this->GetBufferedRegion(), brickSize ).GetBrick( brick );
+}
+
+
+template< typename TPixel, unsigned int VImageDimension >
+typename SparseBrickImage< TPixel, VImageDimension >::PixelType *
+SparseBrickImage< TPixel, VImageDimension >
+::AllocateBrick( SizeValueType brick )
+{
+  if ( !this->m_Bricks[brick] )
+    {
+    const SizeValueType n = this->GetNumberOfPixelsPerBrick();
+    this->m_Bricks[brick].reset( new PixelType[n] );
+    std::fill( this->m_Bricks[brick].get(), this->m_Bricks[brick].get() + n,
+               this->m_BackgroundValue );
+    }
+  return this->m_Bricks[brick].get();
+}
+
+
+template< typename TPixel, unsigned int VImageDimension >
+void
+SparseBrickImage< TPixel, VImageDimension >
+::ReleaseBrick( SizeValueType brick )
+{
+  this->m_Bricks[brick].reset();
+}
+
+
+template< typename TPixel, unsigned int VImageDimension >
+SizeValueType
+SparseBrickImage< TPixel, VImageDimension >
+::ReleaseBackgroundBricks()
+{
+  const SizeValueType n = this->GetNumberOfPixelsPerBrick();
+  std::vector< unsigned char > released( this->m_Bricks.size(), 0 );
+  auto releaseBrick = [&]( SizeValueType brick, ThreadIdType )
+    {
+    const PixelType * buffer = this->m_Bricks[brick].get();
+    if ( buffer && std::all_of( buffer, buffer + n,
+           [&]( const PixelType & p ) { return p == this->m_BackgroundValue; } ) )
+      {
+      this->m_Bricks[brick].reset();
+      released[brick] = 1;
+      }
+    };
+  ParallelForEachBlock( this->GetNumberOfBricks(), releaseBrick );
+  return static_cast< SizeValueType >( std::count( released.begin(), released.end(), 1 ) );
+}
+
+
+template< typename TPixel, unsigned int VImageDimension >
+SizeValueType
+SparseBrickImage< TPixel, VImageDimension >
+::GetNumberOfAllocatedBricks() const
+{
+  SizeValueType allocated = 0;
+  for ( SizeValueType brick = 0; brick < this->m_Bricks.size(); ++brick )
+    {
+    allocated += this->m_Bricks[brick] ? 1 : 0;
+    }
+  return allocated;
+}
+
+
+template< typename TPixel, unsigned int VImageDimension >
+SizeValueType
+SparseBrickImage< TPixel, VImageDimension >
+::GetNumberOfAllocatedBytes() const
+{
+  return this->GetNumberOfAllocatedBricks() * this->GetNumberOfPixelsPerBrick() *
+    sizeof( PixelType );
+}
+
+
+template< typename TPixel, unsigned int VImageDimension >
+void
+SparseBrickImage< TPixel, VImageDimension >
+::CopyFromImage( const DenseImageType * image )
+{
+  this->CopyInformation( image );
+  this->SetRegions( image->GetBufferedRegion() );
+  this->Allocate();
+
+  // Each brick is scanned first, and only copied if it holds data.
+  auto copyBrick = [&]( SizeValueType brick, ThreadIdType )
+    {
+    const RegionType region = this->GetBrickRegion( brick );
+    bool empty = true;
+    auto scanLine = [&]( const IndexType & lineStart, SizeValueType n )
+      {
+      const PixelType * in = image->GetBufferPointer() + image->ComputeOffset( lineStart );
+      for ( SizeValueType x = 0; x < n && empty; ++x )
+        {
+        empty = in[x] == this->m_BackgroundValue;
+        }
+      };
+    ForEachRegionLine( region, scanLine );
+    if ( empty )
+      {
+      return;
+      }
+    PixelType * buffer = this->AllocateBrick( brick );
+    auto copyLine = [&]( const IndexType & lineStart, SizeValueType n )
+      {
+      const PixelType * in = image->GetBufferPointer() + image->ComputeOffset( lineStart );
+      std::copy( in, in + n, buffer + this->ComputeBrickOffset( lineStart ) );
+      };
+    ForEachRegionLine( region, copyLine );
+    };
+  ParallelForEachBlock( this->GetNumberOfBricks(), copyBrick );
+}
+
+
+template< typename TPixel, unsigned int VImageDimension >
+void
+SparseBrickImage< TPixel, VImageDimension >
+::CopyToImage( DenseImageType * image ) const
+{
+  const RegionType & region = image->GetBufferedRegion();
+  if ( !this->GetBufferedRegion().IsInside( region ) )
+    {
+    itkExceptionMacro("Region " << region << " is not within the buffered region "
+                      << this->GetBufferedRegion());
+    }
+
+  auto copyBrick = [&]( SizeValueType brick, ThreadIdType )
+    {
+    RegionType brickRegion = this->GetBrickRegion( brick );
+    if ( !brickRegion.Crop( region ) )
+      {
+      return;
+      }
+    const PixelType * buffer = this->m_Bricks[brick].get();
+    auto copyLine = [&]( const IndexType & lineStart, SizeValueType n )
+      {
+      PixelType * out = image->GetBufferPointer() + image->ComputeOffset( lineStart );
+      if ( buffer )
+        {
+        const PixelType * in = buffer + this->ComputeBrickOffset( lineStart );
+        std::copy( in, in + n, out );
+        }
+      else
+        {
+        std::fill( out, out + n, this->m_BackgroundValue );
+        }
+      };
+    ForEachRegionLine( brickRegion, copyLine );
+    };
+  ParallelForEachBlock( this->GetNumberOfBricks(), copyBrick );
+}
+
+
+/*
+ * PrintSelf
+ */
+template< typename TPixel, unsigned int VImageDimension >
+void
+SparseBrickImage< TPixel, VImageDimension >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "Brick size " << this->m_BrickSize << std::endl;
+  os << indent << "Background value "
+     << static_cast< typename NumericTraits< PixelType >::PrintType >( this->m_BackgroundValue )
+     << std::endl;
+  os << indent << "Allocated bricks " << this->GetNumberOfAllocatedBricks()
+     << " of " << this->GetNumberOfBricks() << std::endl;
+}
+
+} // end namespace itk
+
+#endif
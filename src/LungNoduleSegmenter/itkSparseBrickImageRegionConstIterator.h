@@ -0,0 +1,177 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSparseBrickImageRegionConstIterator.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSparseBrickImageRegionConstIterator_h
+#define itkSparseBrickImageRegionConstIterator_h
+
+#include "itkSparseBrickImage.h"
+
+namespace itk
+{
+
+/** \class SparseBrickImageRegionConstIterator
+ * \brief Visits the pixels of a region of a SparseBrickImage, brick by
+ * brick.
+ *
+ * The order is that of the bricks the region overlaps, first axis fastest,
+ * and within each brick that of its part of the region, first axis
+ * fastest. It is not the order of ImageRegionConstIterator: pair it with
+ * iterators over other images through GetIndex(), or with another iterator
+ * of this kind over an image with the same buffered region and brick size.
+ *
+ * Stepping is a pointer increment within a line of a brick. Pixels of
+ * unallocated bricks read as the background; IsBrickAllocated() and
+ * NextBrick() let a caller skip such bricks.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template< typename TImage >
+class SparseBrickImageRegionConstIterator
+{
+public:
+  typedef SparseBrickImageRegionConstIterator Self;
+
+  typedef TImage                            ImageType;
+  typedef typename ImageType::PixelType     PixelType;
+  typedef typename ImageType::IndexType     IndexType;
+  typedef typename ImageType::RegionType    RegionType;
+
+  itkStaticConstMacro(ImageDimension, unsigned int, ImageType::ImageDimension);
+
+  SparseBrickImageRegionConstIterator() :
+    m_Image( nullptr ),
+    m_BrickNumber( 0 ),
+    m_Buffer( nullptr ),
+    m_Offset( 0 ),
+    m_AtEnd( true )
+    {}
+
+  /** \a region must be within the buffered region of \a image. */
+  SparseBrickImageRegionConstIterator( const ImageType * image, const RegionType & region ) :
+    m_Image( const_cast< ImageType * >( image ) ),
+    m_Region( region )
+    {
+    this->GoToBegin();
+    }
+
+  void GoToBegin()
+    {
+    this->m_AtEnd = this->m_Region.GetNumberOfPixels() == 0;
+    if ( this->m_AtEnd )
+      {
+      return;
+      }
+    const IndexType & start = this->m_Image->GetBufferedRegion().GetIndex();
+    const IndexValueType brickSize = this->m_Image->GetBrickSize();
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      this->m_FirstBrick[i] = ( this->m_Region.GetIndex()[i] - start[i] ) / brickSize;
+      this->m_LastBrick[i] = ( this->m_Region.GetUpperIndex()[i] - start[i] ) / brickSize;
+      }
+    this->m_Brick = this->m_FirstBrick;
+    this->EnterBrick();
+    }
+
+  bool IsAtEnd() const { return this->m_AtEnd; }
+
+  Self & operator++()
+    {
+    ++this->m_Index[0];
+    ++this->m_Offset;
+    if ( this->m_Index[0] <= this->m_BrickEnd[0] )
+      {
+      return *this;
+      }
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      this->m_Index[i] = this->m_BrickRegion.GetIndex()[i];
+      if ( i + 1 == ImageDimension )
+        {
+        this->NextBrick();
+        return *this;
+        }
+      if ( ++this->m_Index[i + 1] <= this->m_BrickEnd[i + 1] )
+        {
+        break;
+        }
+      }
+    this->m_Offset = this->m_Image->ComputeBrickOffset( this->m_Index );
+    return *this;
+    }
+
+  /** Move to the first pixel of the region in the next brick. */
+  void NextBrick()
+    {
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      if ( ++this->m_Brick[i] <= this->m_LastBrick[i] )
+        {
+        this->EnterBrick();
+        return;
+        }
+      this->m_Brick[i] = this->m_FirstBrick[i];
+      }
+    this->m_AtEnd = true;
+    }
+
+  const IndexType & GetIndex() const { return this->m_Index; }
+
+  PixelType Get() const
+    {
+    return this->m_Buffer ? this->m_Buffer[this->m_Offset] : this->m_Image->GetBackgroundValue();
+    }
+
+  /** Whether the brick of the current pixel is allocated. */
+  bool IsBrickAllocated() const { return this->m_Buffer != nullptr; }
+
+  /** Part of the region in the brick of the current pixel. */
+  const RegionType & GetBrickRegion() const { return this->m_BrickRegion; }
+
+protected:
+  void EnterBrick()
+    {
+    SizeValueType brick = 0;
+    for ( int i = ImageDimension - 1; i >= 0; --i )
+      {
+      brick = brick * this->m_Image->GetNumberOfBricksPerAxis()[i] +
+        static_cast< SizeValueType >( this->m_Brick[i] );
+      }
+    this->m_BrickNumber = brick;
+    this->m_BrickRegion = this->m_Image->GetBrickRegion( brick );
+    this->m_BrickRegion.Crop( this->m_Region );
+    this->m_Index = this->m_BrickRegion.GetIndex();
+    this->m_BrickEnd = this->m_BrickRegion.GetUpperIndex();
+    this->m_Buffer = this->m_Image->GetBrickBuffer( brick );
+    this->m_Offset = this->m_Image->ComputeBrickOffset( this->m_Index );
+    }
+
+  ImageType *       m_Image;
+  RegionType        m_Region;
+  IndexType         m_FirstBrick;
+  IndexType         m_LastBrick;
+  IndexType         m_Brick;
+  SizeValueType     m_BrickNumber;
+  RegionType        m_BrickRegion;
+  IndexType         m_BrickEnd;
+  IndexType         m_Index;
+  PixelType *       m_Buffer;
+  OffsetValueType   m_Offset;
+  bool              m_AtEnd;
+};
+
+} // end namespace itk
+
+#endif
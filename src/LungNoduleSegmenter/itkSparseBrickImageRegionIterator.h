@@ -0,0 +1,67 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSparseBrickImageRegionIterator.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSparseBrickImageRegionIterator_h
+#define itkSparseBrickImageRegionIterator_h
+
+#include "itkSparseBrickImageRegionConstIterator.h"
+
+namespace itk
+{
+
+/** \class SparseBrickImageRegionIterator
+ * \brief SparseBrickImageRegionConstIterator that can also set pixels.
+ *
+ * Setting a pixel of an unallocated brick to anything but the background
+ * allocates the brick. Different threads may write through iterators over
+ * regions that do not share bricks.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template< typename TImage >
+class SparseBrickImageRegionIterator : public SparseBrickImageRegionConstIterator< TImage >
+{
+public:
+  typedef SparseBrickImageRegionIterator                  Self;
+  typedef SparseBrickImageRegionConstIterator< TImage >   Superclass;
+
+  typedef typename Superclass::ImageType    ImageType;
+  typedef typename Superclass::PixelType    PixelType;
+  typedef typename Superclass::RegionType   RegionType;
+
+  SparseBrickImageRegionIterator() {}
+
+  SparseBrickImageRegionIterator( ImageType * image, const RegionType & region ) :
+    Superclass( image, region )
+    {}
+
+  void Set( const PixelType & value )
+    {
+    if ( !this->m_Buffer )
+      {
+      if ( value == this->m_Image->GetBackgroundValue() )
+        {
+        return;
+        }
+      this->m_Buffer = this->m_Image->AllocateBrick( this->m_BrickNumber );
+      }
+    this->m_Buffer[this->m_Offset] = value;
+    }
+};
+
+} // end namespace itk
+
+#endif
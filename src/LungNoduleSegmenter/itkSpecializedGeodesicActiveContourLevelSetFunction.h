@@ -0,0 +1,337 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSpecializedGeodesicActiveContourLevelSetFunction.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSpecializedGeodesicActiveContourLevelSetFunction_h
+#define itkSpecializedGeodesicActiveContourLevelSetFunction_h
+
+#include "itkGeodesicActiveContourLevelSetFunction.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkSparseBrickImage.h"
+#include "itkMath.h"
+#include <algorithm>
+#include <cmath>
+#include <typeinfo>
+
+namespace itk
+{
+
+/** \class SpecializedGeodesicActiveContourLevelSetFunction
+ * \brief GeodesicActiveContourLevelSetFunction with the terms it evaluates
+ * fixed at compile time.
+ *
+ * ComputeUpdate() is the one of LevelSetFunction, with mean curvature and
+ * no Laplacian smoothing, for a geodesic active contour:
+ *  - the terms that VCurvature, VAdvection and VPropagation disable are
+ *    compiled out, along with the derivatives only they need (the Hessian
+ *    goes with the curvature);
+ *  - the speed, which scales both the curvature and the propagation, is
+ *    sampled once per node, through a non-virtual call to the linear
+ *    interpolator;
+ *  - the loops over the dimensions have constant bounds and unroll.
+ * The arithmetic is performed in the same order as in LevelSetFunction, so
+ * the updates are the same.
+ *
+ * With SparseSpeedImage, the speed image is moved into a SparseBrickImage
+ * once computed, and its dense buffer is released: the bricks where the
+ * speed is 0, such as outside the tiles of lazy feature evaluation or in
+ * the wall, take no memory. It is sampled by the same
+ * LinearInterpolateImageFunction, over the same values, so the updates do
+ * not change; each sample costs the brick lookups of the eight corners.
+ * The advection image stays dense.
+ *
+ * Instances are made by CreateSpecializedGeodesicActiveContourLevelSetFunction(),
+ * which picks the instantiation matching the weights of a
+ * GeodesicActiveContourLevelSetFunction at run time.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template< typename TImageType, typename TFeatureImageType,
+          bool VCurvature, bool VAdvection, bool VPropagation >
+class ITK_EXPORT SpecializedGeodesicActiveContourLevelSetFunction :
+  public GeodesicActiveContourLevelSetFunction< TImageType, TFeatureImageType >
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(SpecializedGeodesicActiveContourLevelSetFunction);
+
+  /** Standard class typedefs. */
+  typedef SpecializedGeodesicActiveContourLevelSetFunction                        Self;
+  typedef GeodesicActiveContourLevelSetFunction< TImageType, TFeatureImageType >  Superclass;
+  typedef SmartPointer< Self >                                                    Pointer;
+  typedef SmartPointer< const Self >                                              ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SpecializedGeodesicActiveContourLevelSetFunction, GeodesicActiveContourLevelSetFunction);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, Superclass::ImageDimension);
+
+  typedef typename Superclass::ImageType                ImageType;
+  typedef typename Superclass::PixelType                PixelType;
+  typedef typename Superclass::ScalarValueType          ScalarValueType;
+  typedef typename Superclass::NeighborhoodType         NeighborhoodType;
+  typedef typename Superclass::FloatOffsetType          FloatOffsetType;
+  typedef typename Superclass::GlobalDataStruct         GlobalDataStruct;
+  typedef typename Superclass::VectorType               VectorType;
+  typedef typename Superclass::InterpolatorType         InterpolatorType;
+  typedef typename InterpolatorType::ContinuousIndexType ContinuousIndexType;
+
+  typedef SparseBrickImage< PixelType, ImageDimension >                    SparseSpeedImageType;
+  typedef LinearInterpolateImageFunction< SparseSpeedImageType, double >    SparseSpeedInterpolatorType;
+
+  /** Keep the speed image in a SparseBrickImage. Set it before the speed
+   * image is computed. Defaults to off. */
+  itkSetMacro( SparseSpeedImage, bool );
+  itkGetConstMacro( SparseSpeedImage, bool );
+  itkBooleanMacro( SparseSpeedImage );
+
+  /** The superclass' speed image, then moved into bricks. */
+  void CalculateSpeedImage() override
+    {
+    Superclass::CalculateSpeedImage();
+    this->m_SparseSpeed = nullptr;
+    if ( this->m_SparseSpeedImage )
+      {
+      ImageType * speedImage = this->GetSpeedImage();
+      this->m_SparseSpeed = SparseSpeedImageType::New();
+      this->m_SparseSpeed->CopyFromImage( speedImage );
+      this->m_SparseSpeedInterpolator = SparseSpeedInterpolatorType::New();
+      this->m_SparseSpeedInterpolator->SetInputImage( this->m_SparseSpeed );
+      speedImage->Initialize();
+      }
+    }
+
+  /** The speed image in bricks, or null without SparseSpeedImage. */
+  const SparseSpeedImageType * GetSparseSpeed() const
+    {
+    return this->m_SparseSpeed.GetPointer();
+    }
+
+  PixelType ComputeUpdate( const NeighborhoodType & it, void * globalData,
+                           const FloatOffsetType & offset = FloatOffsetType( 0.0 ) ) override
+    {
+    const ScalarValueType zero = NumericTraits< ScalarValueType >::ZeroValue();
+    const ScalarValueType centerValue = it.GetCenterPixel();
+    const typename Superclass::NeighborhoodScalesType neighborhoodScales = this->ComputeNeighborhoodScales();
+    GlobalDataStruct * gd = static_cast< GlobalDataStruct * >( globalData );
+
+    const unsigned int center = static_cast< unsigned int >( it.Size() / 2 );
+    gd->m_GradMagSqr = 1.0e-6;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      const unsigned int positionA = center + static_cast< unsigned int >( it.GetStride( i ) );
+      const unsigned int positionB = center - static_cast< unsigned int >( it.GetStride( i ) );
+      const ScalarValueType valueA = it.GetPixel( positionA );
+      const ScalarValueType valueB = it.GetPixel( positionB );
+
+      if ( VAdvection || VPropagation )
+        {
+        gd->m_dx_forward[i] = ( valueA - centerValue ) * neighborhoodScales[i];
+        gd->m_dx_backward[i] = ( centerValue - valueB ) * neighborhoodScales[i];
+        }
+      if ( VCurvature )
+        {
+        gd->m_dx[i] = 0.5 * ( valueA - valueB ) * neighborhoodScales[i];
+        gd->m_dxy[i][i] = ( valueA + valueB - 2.0 * centerValue ) *
+          ( neighborhoodScales[i] * neighborhoodScales[i] );
+        gd->m_GradMagSqr += gd->m_dx[i] * gd->m_dx[i];
+        for ( unsigned int j = i + 1; j < ImageDimension; ++j )
+          {
+          const unsigned int strideI = static_cast< unsigned int >( it.GetStride( i ) );
+          const unsigned int strideJ = static_cast< unsigned int >( it.GetStride( j ) );
+          gd->m_dxy[i][j] = gd->m_dxy[j][i] = 0.25 *
+            ( it.GetPixel( center - strideI - strideJ ) - it.GetPixel( center - strideI + strideJ )
+              - it.GetPixel( center + strideI - strideJ ) + it.GetPixel( center + strideI + strideJ ) )
+            * neighborhoodScales[i] * neighborhoodScales[j];
+          }
+        }
+      }
+
+    // The geodesic active contour scales the curvature by the speed too.
+    ScalarValueType speed = zero;
+    if ( VCurvature || VPropagation )
+      {
+      speed = this->SampleSpeed( it, offset );
+      }
+
+    ScalarValueType curvatureTerm = zero;
+    if ( VCurvature )
+      {
+      ScalarValueType curvature = zero;
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        for ( unsigned int j = 0; j < ImageDimension; ++j )
+          {
+          if ( j != i )
+            {
+            curvature -= gd->m_dx[i] * gd->m_dx[j] * gd->m_dxy[i][j];
+            curvature += gd->m_dxy[j][j] * gd->m_dx[i] * gd->m_dx[i];
+            }
+          }
+        }
+      curvatureTerm = ( curvature / gd->m_GradMagSqr ) * this->GetCurvatureWeight() * speed;
+      gd->m_MaxCurvatureChange = std::max( gd->m_MaxCurvatureChange, Math::abs( curvatureTerm ) );
+      }
+
+    ScalarValueType advectionTerm = zero;
+    if ( VAdvection )
+      {
+      const ScalarValueType advectionWeight = this->GetAdvectionWeight();
+      const VectorType advectionField = this->AdvectionField( it, offset, gd );
+      for ( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        const ScalarValueType energy = advectionWeight * advectionField[i];
+        advectionTerm += advectionField[i] *
+          ( energy > zero ? gd->m_dx_backward[i] : gd->m_dx_forward[i] );
+        gd->m_MaxAdvectionChange = std::max( gd->m_MaxAdvectionChange, Math::abs( energy ) );
+        }
+      advectionTerm *= advectionWeight;
+      }
+
+    ScalarValueType propagationTerm = zero;
+    if ( VPropagation )
+      {
+      propagationTerm = this->GetPropagationWeight() * speed;
+
+      // Upwind gradient magnitude in the normal direction.
+      ScalarValueType propagationGradient = zero;
+      if ( propagationTerm > zero )
+        {
+        for ( unsigned int i = 0; i < ImageDimension; ++i )
+          {
+          const ScalarValueType backward = std::max( gd->m_dx_backward[i], zero );
+          const ScalarValueType forward = std::min( gd->m_dx_forward[i], zero );
+          propagationGradient += backward * backward + forward * forward;
+          }
+        }
+      else
+        {
+        for ( unsigned int i = 0; i < ImageDimension; ++i )
+          {
+          const ScalarValueType backward = std::min( gd->m_dx_backward[i], zero );
+          const ScalarValueType forward = std::max( gd->m_dx_forward[i], zero );
+          propagationGradient += backward * backward + forward * forward;
+          }
+        }
+      gd->m_MaxPropagationChange = std::max( gd->m_MaxPropagationChange, Math::abs( propagationTerm ) );
+      propagationTerm *= std::sqrt( propagationGradient );
+      }
+
+    return static_cast< PixelType >( curvatureTerm - propagationTerm - advectionTerm );
+    }
+
+protected:
+  SpecializedGeodesicActiveContourLevelSetFunction() : m_SparseSpeedImage( false ) {}
+  ~SpecializedGeodesicActiveContourLevelSetFunction() override {}
+
+  /** SegmentationLevelSetFunction::PropagationSpeed() without the virtual
+   * calls. */
+  ScalarValueType SampleSpeed( const NeighborhoodType & it, const FloatOffsetType & offset ) const
+    {
+    const typename ImageType::IndexType index = it.GetIndex();
+    ContinuousIndexType cdx;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      cdx[i] = static_cast< double >( index[i] ) - offset[i];
+      }
+    if ( this->m_SparseSpeed )
+      {
+      if ( this->m_SparseSpeedInterpolator->IsInsideBuffer( cdx ) )
+        {
+        return static_cast< ScalarValueType >(
+          this->m_SparseSpeedInterpolator->SparseSpeedInterpolatorType::EvaluateAtContinuousIndex( cdx ) );
+        }
+      return static_cast< ScalarValueType >( this->m_SparseSpeed->GetPixel( index ) );
+      }
+    if ( this->m_Interpolator->IsInsideBuffer( cdx ) )
+      {
+      return static_cast< ScalarValueType >(
+        this->m_Interpolator->InterpolatorType::EvaluateAtContinuousIndex( cdx ) );
+      }
+    return static_cast< ScalarValueType >( this->GetSpeedImage()->GetPixel( index ) );
+    }
+
+private:
+  bool                                              m_SparseSpeedImage;
+  typename SparseSpeedImageType::Pointer            m_SparseSpeed;
+  typename SparseSpeedInterpolatorType::Pointer     m_SparseSpeedInterpolator;
+};
+
+
+namespace SpecializedGeodesicActiveContourDetail
+{
+template< typename TImageType, typename TFeatureImageType,
+          bool VCurvature, bool VAdvection, bool VPropagation >
+typename SegmentationLevelSetFunction< TImageType, TFeatureImageType >::Pointer
+Create( const GeodesicActiveContourLevelSetFunction< TImageType, TFeatureImageType > * generic,
+        bool sparseSpeedImage )
+{
+  typedef SpecializedGeodesicActiveContourLevelSetFunction<
+    TImageType, TFeatureImageType, VCurvature, VAdvection, VPropagation > FunctionType;
+  typename FunctionType::Pointer function = FunctionType::New();
+  function->SetCurvatureWeight( generic->GetCurvatureWeight() );
+  function->SetAdvectionWeight( generic->GetAdvectionWeight() );
+  function->SetPropagationWeight( generic->GetPropagationWeight() );
+  function->SetLaplacianSmoothingWeight( generic->GetLaplacianSmoothingWeight() );
+  function->SetEpsilonMagnitude( generic->GetEpsilonMagnitude() );
+  function->SetDerivativeSigma( generic->GetDerivativeSigma() );
+  function->SetFeatureImage( generic->GetFeatureImage() );
+  function->SetSparseSpeedImage( sparseSpeedImage );
+  return function.GetPointer();
+}
+} // end namespace SpecializedGeodesicActiveContourDetail
+
+
+/** The SpecializedGeodesicActiveContourLevelSetFunction for the non-zero
+ * weights of \a generic, with its settings and \a sparseSpeedImage, or
+ * null when \a generic is not a plain GeodesicActiveContourLevelSetFunction
+ * or uses minimal curvature or Laplacian smoothing, which the
+ * specializations do not cover. */
+template< typename TImageType, typename TFeatureImageType >
+typename SegmentationLevelSetFunction< TImageType, TFeatureImageType >::Pointer
+CreateSpecializedGeodesicActiveContourLevelSetFunction(
+  const SegmentationLevelSetFunction< TImageType, TFeatureImageType > * function,
+  bool sparseSpeedImage = false )
+{
+  typedef GeodesicActiveContourLevelSetFunction< TImageType, TFeatureImageType > GenericType;
+  const GenericType * generic = dynamic_cast< const GenericType * >( function );
+  if ( !generic || typeid( *generic ) != typeid( GenericType ) ||
+       generic->GetUseMinimalCurvature() || generic->GetLaplacianSmoothingWeight() != 0 )
+    {
+    return ITK_NULLPTR;
+    }
+
+  const unsigned int terms = ( generic->GetCurvatureWeight() != 0 ? 1 : 0 ) |
+                             ( generic->GetAdvectionWeight() != 0 ? 2 : 0 ) |
+                             ( generic->GetPropagationWeight() != 0 ? 4 : 0 );
+  using namespace SpecializedGeodesicActiveContourDetail;
+  switch ( terms )
+    {
+    case 0: return Create< TImageType, TFeatureImageType, false, false, false >( generic, sparseSpeedImage );
+    case 1: return Create< TImageType, TFeatureImageType, true, false, false >( generic, sparseSpeedImage );
+    case 2: return Create< TImageType, TFeatureImageType, false, true, false >( generic, sparseSpeedImage );
+    case 3: return Create< TImageType, TFeatureImageType, true, true, false >( generic, sparseSpeedImage );
+    case 4: return Create< TImageType, TFeatureImageType, false, false, true >( generic, sparseSpeedImage );
+    case 5: return Create< TImageType, TFeatureImageType, true, false, true >( generic, sparseSpeedImage );
+    case 6: return Create< TImageType, TFeatureImageType, false, true, true >( generic, sparseSpeedImage );
+    default: return Create< TImageType, TFeatureImageType, true, true, true >( generic, sparseSpeedImage );
+    }
+}
+
+} // end namespace itk
+
+#endif
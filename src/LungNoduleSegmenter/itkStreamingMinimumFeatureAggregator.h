@@ -0,0 +1,188 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkStreamingMinimumFeatureAggregator.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkStreamingMinimumFeatureAggregator_h
+#define itkStreamingMinimumFeatureAggregator_h
+
+#include "itkFeatureGenerator.h"
+#include "itkBlockFeatureGenerator.h"
+#include "itkImage.h"
+#include "itkImageSpatialObject.h"
+#include <vector>
+
+namespace itk
+{
+
+/** \class StreamingMinimumFeatureAggregator
+ * \brief Voxelwise minimum of several features, accumulated in place.
+ *
+ * Produces the same feature as MinimumFeatureAggregator without keeping
+ * every input feature alive. Only one output image, the running minimum, is
+ * allocated by this class. Features are folded into it as follows:
+ *
+ *  - Block feature generators (pointwise features such as the intensity
+ *    sigmoid) are evaluated inline, slab by slab, directly from the input
+ *    image. Their feature image is never materialised.
+ *  - Regular feature generators are updated one at a time. Their output is
+ *    folded into the running minimum slab by slab, optionally through a
+ *    sigmoid mapping (e.g. raw vesselness followed by the vesselness sigmoid),
+ *    and then released unless ReleaseFeatureData is off.
+ *
+ * Blocks are processed in parallel. By default a block is a slab of
+ * NumberOfSlicesPerBlock slices. Setting a non-zero BrickSize switches to
+ * bricks instead, so that block generators with a halo (e.g. vesselness)
+ * work on small padded bricks that stay in cache. Bricks are grown to at
+ * least twice the largest halo along each axis so the halo overhead stays
+ * bounded.
+ *
+ * \ingroup SpatialObjectFilters
+ * \ingroup LesionSizingToolkit
+ */
+template <unsigned int NDimension>
+class ITK_EXPORT StreamingMinimumFeatureAggregator : public FeatureGenerator<NDimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(StreamingMinimumFeatureAggregator);
+
+  /** Standard class typedefs. */
+  typedef StreamingMinimumFeatureAggregator Self;
+  typedef FeatureGenerator<NDimension>      Superclass;
+  typedef SmartPointer<Self>                Pointer;
+  typedef SmartPointer<const Self>          ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(StreamingMinimumFeatureAggregator, FeatureGenerator);
+
+  /** Dimension of the space */
+  itkStaticConstMacro(Dimension, unsigned int, NDimension);
+
+  typedef FeatureGenerator<NDimension>                                FeatureGeneratorType;
+  typedef BlockFeatureGenerator<NDimension>                           BlockFeatureGeneratorType;
+  typedef typename Superclass::SpatialObjectType                      SpatialObjectType;
+  typedef typename BlockFeatureGeneratorType::InputImageType          InputImageType;
+  typedef typename BlockFeatureGeneratorType::InputImageSpatialObjectType InputImageSpatialObjectType;
+  typedef typename BlockFeatureGeneratorType::OutputPixelType         OutputPixelType;
+  typedef typename BlockFeatureGeneratorType::OutputImageType         OutputImageType;
+  typedef typename BlockFeatureGeneratorType::OutputImageSpatialObjectType OutputImageSpatialObjectType;
+  typedef typename InputImageType::RegionType                         RegionType;
+  typedef typename InputImageType::SizeType                           SizeType;
+
+  /** Input image, read by the block feature generators. */
+  using ProcessObject::SetInput;
+  void SetInput( const SpatialObjectType * input );
+
+  /** Output data that carries the feature in the form of a
+   * SpatialObject. */
+  const SpatialObjectType * GetFeature() const;
+
+  /** Add a generator whose full feature image is folded into the minimum. */
+  void AddFeatureGenerator( FeatureGeneratorType * generator );
+
+  /** Add a generator whose feature is mapped through
+   * 1 / ( 1 + exp( -( f - beta ) / alpha ) ) while being folded in. */
+  void AddSigmoidMappedFeatureGenerator( FeatureGeneratorType * generator,
+                                         double alpha, double beta );
+
+  /** Add a generator evaluated inline, block by block. */
+  void AddBlockFeatureGenerator( BlockFeatureGeneratorType * generator );
+
+  /** Remove the features of all kinds. */
+  void RemoveAllFeatureGenerators();
+
+  /** Number of features of all kinds. */
+  unsigned int GetNumberOfFeatureGenerators() const;
+
+  /** Release the output of the regular generators once folded. Turn this off
+   * to keep them, e.g. to write them as feature images. Defaults to true. */
+  itkSetMacro( ReleaseFeatureData, bool );
+  itkGetMacro( ReleaseFeatureData, bool );
+  itkBooleanMacro( ReleaseFeatureData );
+
+  /** Thickness (in slices) of the slabs processed in parallel. */
+  itkSetMacro( NumberOfSlicesPerBlock, unsigned int );
+  itkGetMacro( NumberOfSlicesPerBlock, unsigned int );
+
+  /** Size, in voxels, of the bricks processed in parallel. All zeros, the
+   * default, selects slabs of NumberOfSlicesPerBlock slices. */
+  itkSetMacro( BrickSize, SizeType );
+  itkGetConstReferenceMacro( BrickSize, SizeType );
+
+protected:
+  StreamingMinimumFeatureAggregator();
+  ~StreamingMinimumFeatureAggregator() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  void GenerateData() override;
+
+  /** Size of the blocks \a region is split into for parallel processing. */
+  SizeType ComputeBlockSize( const InputImageType * input, const RegionType & region ) const;
+
+  const InputImageType * GetInputImage() const;
+
+  /** Check that every block generator reads an image buffered over the
+   * region of \a input. */
+  void VerifyBlockInputImages( const InputImageType * input ) const;
+
+  /** Fold the block generators into \a output over all blocks. */
+  void FoldBlockFeatures( const InputImageType * input, OutputImageType * output );
+
+  /** Minimum of the block generators over \a region, written into \a output.
+   * \a buffer is per-thread scratch space, (re)allocated as needed. */
+  void GenerateBlockFeatures( const InputImageType * input, const RegionType & region,
+                              OutputImageType * output,
+                              typename OutputImageType::Pointer & buffer ) const;
+
+  /** Update each regular generator in turn and fold it into \a output. */
+  void FoldRegularFeatures( OutputImageType * output );
+
+  /** Latest modification time of the feature generators. */
+  ModifiedTimeType GetFeatureGeneratorsMTime() const;
+
+  bool HasBlockFeatureGenerators() const
+    { return !this->m_BlockFeatureGenerators.empty(); }
+  bool HasRegularFeatureGenerators() const
+    { return !this->m_RegularFeatures.empty(); }
+
+  /** Fold one full feature image into \a output. */
+  void FoldFeatureImage( const OutputImageType * feature, OutputImageType * output,
+                         bool sigmoidMapped, double alpha, double beta );
+
+private:
+  struct RegularFeature
+    {
+    typename FeatureGeneratorType::Pointer  Generator;
+    bool                                    SigmoidMapped;
+    double                                  Alpha;
+    double                                  Beta;
+    };
+
+  std::vector< RegularFeature >                                 m_RegularFeatures;
+  std::vector< typename BlockFeatureGeneratorType::Pointer >    m_BlockFeatureGenerators;
+  bool                                                          m_ReleaseFeatureData;
+  unsigned int                                                  m_NumberOfSlicesPerBlock;
+  SizeType                                                      m_BrickSize;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkStreamingMinimumFeatureAggregator.hxx"
+#endif
+
+#endif
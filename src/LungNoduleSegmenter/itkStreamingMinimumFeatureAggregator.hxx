@@ -0,0 +1,432 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkStreamingMinimumFeatureAggregator.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkStreamingMinimumFeatureAggregator_hxx
+#define itkStreamingMinimumFeatureAggregator_hxx
+
+#include "itkStreamingMinimumFeatureAggregator.h"
+#include "itkSigmoidBlockFeatureGenerator.h"
+#include "itkParallelForEachBlock.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template <unsigned int NDimension>
+StreamingMinimumFeatureAggregator<NDimension>
+::StreamingMinimumFeatureAggregator() :
+  m_ReleaseFeatureData(true),
+  m_NumberOfSlicesPerBlock(4)
+{
+  this->m_BrickSize.Fill( 0 );
+  this->SetNumberOfRequiredInputs( 1 );
+  this->SetNumberOfRequiredOutputs( 1 );
+
+  typename OutputImageSpatialObjectType::Pointer outputObject = OutputImageSpatialObjectType::New();
+
+  this->ProcessObject::SetNthOutput( 0, outputObject.GetPointer() );
+}
+
+
+/*
+ * Destructor
+ */
+template <unsigned int NDimension>
+StreamingMinimumFeatureAggregator<NDimension>
+::~StreamingMinimumFeatureAggregator()
+{
+}
+
+template <unsigned int NDimension>
+void
+StreamingMinimumFeatureAggregator<NDimension>
+::SetInput( const SpatialObjectType * spatialObject )
+{
+  // Process object is not const-correct so the const casting is required.
+  this->SetNthInput(0, const_cast<SpatialObjectType *>( spatialObject ));
+}
+
+template <unsigned int NDimension>
+const typename StreamingMinimumFeatureAggregator<NDimension>::SpatialObjectType *
+StreamingMinimumFeatureAggregator<NDimension>
+::GetFeature() const
+{
+  if (this->GetNumberOfOutputs() < 1)
+    {
+    return nullptr;
+    }
+
+  return static_cast<const SpatialObjectType*>(this->ProcessObject::GetOutput(0));
+}
+
+template <unsigned int NDimension>
+void
+StreamingMinimumFeatureAggregator<NDimension>
+::AddFeatureGenerator( FeatureGeneratorType * generator )
+{
+  RegularFeature feature;
+  feature.Generator = generator;
+  feature.SigmoidMapped = false;
+  feature.Alpha = 1.0;
+  feature.Beta = 0.0;
+  this->m_RegularFeatures.push_back( feature );
+  this->Modified();
+}
+
+template <unsigned int NDimension>
+void
+StreamingMinimumFeatureAggregator<NDimension>
+::AddSigmoidMappedFeatureGenerator( FeatureGeneratorType * generator,
+                                    double alpha, double beta )
+{
+  RegularFeature feature;
+  feature.Generator = generator;
+  feature.SigmoidMapped = true;
+  feature.Alpha = alpha;
+  feature.Beta = beta;
+  this->m_RegularFeatures.push_back( feature );
+  this->Modified();
+}
+
+template <unsigned int NDimension>
+void
+StreamingMinimumFeatureAggregator<NDimension>
+::AddBlockFeatureGenerator( BlockFeatureGeneratorType * generator )
+{
+  this->m_BlockFeatureGenerators.push_back( generator );
+  this->Modified();
+}
+
+template <unsigned int NDimension>
+void
+StreamingMinimumFeatureAggregator<NDimension>
+::RemoveAllFeatureGenerators()
+{
+  this->m_RegularFeatures.clear();
+  this->m_BlockFeatureGenerators.clear();
+  this->Modified();
+}
+
+template <unsigned int NDimension>
+ModifiedTimeType
+StreamingMinimumFeatureAggregator<NDimension>
+::GetFeatureGeneratorsMTime() const
+{
+  ModifiedTimeType mtime = 0;
+  for ( typename std::vector< RegularFeature >::const_iterator it = this->m_RegularFeatures.begin();
+        it != this->m_RegularFeatures.end(); ++it )
+    {
+    mtime = std::max( mtime, it->Generator->GetMTime() );
+    }
+  for ( typename std::vector< typename BlockFeatureGeneratorType::Pointer >::const_iterator it =
+          this->m_BlockFeatureGenerators.begin(); it != this->m_BlockFeatureGenerators.end(); ++it )
+    {
+    mtime = std::max( mtime, ( *it )->GetMTime() );
+    }
+  return mtime;
+}
+
+template <unsigned int NDimension>
+unsigned int
+StreamingMinimumFeatureAggregator<NDimension>
+::GetNumberOfFeatureGenerators() const
+{
+  return static_cast< unsigned int >(
+    this->m_RegularFeatures.size() + this->m_BlockFeatureGenerators.size() );
+}
+
+
+/*
+ * PrintSelf
+ */
+template <unsigned int NDimension>
+void
+StreamingMinimumFeatureAggregator<NDimension>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "Regular features " << this->m_RegularFeatures.size() << std::endl;
+  os << indent << "Block features " << this->m_BlockFeatureGenerators.size() << std::endl;
+  os << indent << "Release feature data " << this->m_ReleaseFeatureData << std::endl;
+  os << indent << "Slices per block " << this->m_NumberOfSlicesPerBlock << std::endl;
+  os << indent << "Brick size " << this->m_BrickSize << std::endl;
+}
+
+
+template <unsigned int NDimension>
+const typename StreamingMinimumFeatureAggregator<NDimension>::InputImageType *
+StreamingMinimumFeatureAggregator<NDimension>
+::GetInputImage() const
+{
+  const InputImageSpatialObjectType * inputObject =
+    dynamic_cast<const InputImageSpatialObjectType * >( this->ProcessObject::GetInput(0) );
+
+  if( !inputObject )
+    {
+    itkExceptionMacro("Missing input spatial object");
+    }
+
+  const InputImageType * inputImage = inputObject->GetImage();
+
+  if( !inputImage )
+    {
+    itkExceptionMacro("Missing input image");
+    }
+
+  return inputImage;
+}
+
+
+/*
+ * Generate Data
+ */
+template <unsigned int NDimension>
+void
+StreamingMinimumFeatureAggregator<NDimension>
+::GenerateData()
+{
+  if( this->GetNumberOfFeatureGenerators() == 0 )
+    {
+    itkExceptionMacro("No feature generators were added to the aggregator");
+    }
+
+  const InputImageType * inputImage = this->GetInputImage();
+
+  // The running minimum is the only ROI sized buffer owned by this class.
+  typename OutputImageType::Pointer outputImage = OutputImageType::New();
+  outputImage->CopyInformation( inputImage );
+  outputImage->SetRegions( inputImage->GetBufferedRegion() );
+  outputImage->Allocate();
+  outputImage->FillBuffer( NumericTraits< OutputPixelType >::max() );
+
+  this->FoldBlockFeatures( inputImage, outputImage );
+  this->FoldRegularFeatures( outputImage );
+
+  auto * outputObject = dynamic_cast< OutputImageSpatialObjectType * >(this->ProcessObject::GetOutput(0));
+
+  outputObject->SetImage( outputImage );
+}
+
+template <unsigned int NDimension>
+void
+StreamingMinimumFeatureAggregator<NDimension>
+::FoldRegularFeatures( OutputImageType * output )
+{
+  for ( typename std::vector< RegularFeature >::const_iterator it = this->m_RegularFeatures.begin();
+        it != this->m_RegularFeatures.end(); ++it )
+    {
+    it->Generator->Update();
+
+    const OutputImageSpatialObjectType * featureObject =
+      dynamic_cast< const OutputImageSpatialObjectType * >( it->Generator->GetFeature() );
+    if( !featureObject || !featureObject->GetImage() )
+      {
+      itkExceptionMacro("Feature generator " << it->Generator->GetNameOfClass()
+                        << " did not produce a float feature image");
+      }
+    const OutputImageType * featureImage = featureObject->GetImage();
+    if( featureImage->GetBufferedRegion() != output->GetBufferedRegion() )
+      {
+      itkExceptionMacro("Feature generator " << it->Generator->GetNameOfClass()
+                        << " produced a feature over " << featureImage->GetBufferedRegion()
+                        << " instead of " << output->GetBufferedRegion());
+      }
+
+    this->FoldFeatureImage( featureImage, output, it->SigmoidMapped, it->Alpha, it->Beta );
+
+    if( this->m_ReleaseFeatureData )
+      {
+      const_cast< OutputImageType * >( featureImage )->ReleaseData();
+      // Make sure the generator runs again if it is asked for its feature.
+      it->Generator->Modified();
+      }
+    }
+}
+
+template <unsigned int NDimension>
+typename StreamingMinimumFeatureAggregator<NDimension>::SizeType
+StreamingMinimumFeatureAggregator<NDimension>
+::ComputeBlockSize( const InputImageType * input, const RegionType & region ) const
+{
+  SizeType blockSize = region.GetSize();
+
+  bool useBricks = false;
+  for ( unsigned int i = 0; i < NDimension; ++i )
+    {
+    useBricks = useBricks || this->m_BrickSize[i] != 0;
+    }
+
+  if( !useBricks )
+    {
+    blockSize[NDimension - 1] = this->m_NumberOfSlicesPerBlock;
+    return blockSize;
+    }
+
+  SizeType halo;
+  halo.Fill( 0 );
+  for ( size_t g = 0; g < this->m_BlockFeatureGenerators.size(); ++g )
+    {
+    const SizeType radius = this->m_BlockFeatureGenerators[g]->GetBlockHaloRadius( input );
+    for ( unsigned int i = 0; i < NDimension; ++i )
+      {
+      halo[i] = std::max( halo[i], radius[i] );
+      }
+    }
+
+  for ( unsigned int i = 0; i < NDimension; ++i )
+    {
+    blockSize[i] = std::min( region.GetSize()[i],
+      std::max< SizeValueType >( this->m_BrickSize[i], 2 * halo[i] ) );
+    }
+  return blockSize;
+}
+
+template <unsigned int NDimension>
+void
+StreamingMinimumFeatureAggregator<NDimension>
+::VerifyBlockInputImages( const InputImageType * input ) const
+{
+  for ( size_t g = 0; g < this->m_BlockFeatureGenerators.size(); ++g )
+    {
+    const InputImageType * blockInput = this->m_BlockFeatureGenerators[g]->GetBlockInputImage( input );
+    if( blockInput->GetBufferedRegion() != input->GetBufferedRegion() )
+      {
+      itkExceptionMacro("Block feature generator " << this->m_BlockFeatureGenerators[g]->GetNameOfClass()
+                        << " reads an image over " << blockInput->GetBufferedRegion()
+                        << " instead of " << input->GetBufferedRegion());
+      }
+    }
+}
+
+template <unsigned int NDimension>
+void
+StreamingMinimumFeatureAggregator<NDimension>
+::FoldBlockFeatures( const InputImageType * input, OutputImageType * output )
+{
+  if( this->m_BlockFeatureGenerators.empty() )
+    {
+    return;
+    }
+  this->VerifyBlockInputImages( input );
+
+  const BrickRegionSplitter< NDimension > splitter( output->GetBufferedRegion(),
+    this->ComputeBlockSize( input, output->GetBufferedRegion() ) );
+  const SizeValueType numberOfBlocks = splitter.GetNumberOfBricks();
+
+  // One scratch block per thread for the second and later block features.
+  std::vector< typename OutputImageType::Pointer > scratch(
+    GetParallelForEachBlockNumberOfThreads( numberOfBlocks ) );
+
+  auto foldBlock = [&]( SizeValueType block, ThreadIdType threadId )
+    {
+    this->GenerateBlockFeatures( input, splitter.GetBrick( block ), output, scratch[threadId] );
+    };
+  ParallelForEachBlock( numberOfBlocks, foldBlock );
+}
+
+template <unsigned int NDimension>
+void
+StreamingMinimumFeatureAggregator<NDimension>
+::GenerateBlockFeatures( const InputImageType * input, const RegionType & region,
+                         OutputImageType * output,
+                         typename OutputImageType::Pointer & buffer ) const
+{
+  const std::vector< typename BlockFeatureGeneratorType::Pointer > & generators =
+    this->m_BlockFeatureGenerators;
+
+  // The first feature initialises the minimum directly.
+  generators[0]->GenerateBlock( generators[0]->GetBlockInputImage( input ), region, output );
+  if( generators.size() == 1 )
+    {
+    return;
+    }
+
+  if( buffer.IsNull() || buffer->GetBufferedRegion().GetSize() != region.GetSize() )
+    {
+    buffer = OutputImageType::New();
+    buffer->CopyInformation( output );
+    buffer->SetBufferedRegion( region );
+    buffer->SetRequestedRegion( region );
+    buffer->Allocate();
+    }
+  else
+    {
+    // Same number of pixels, so the pixel container can be reused as is.
+    buffer->SetBufferedRegion( region );
+    buffer->SetRequestedRegion( region );
+    }
+
+  OutputImageType * values = buffer.GetPointer();
+  auto foldLine = [output, values]( const typename RegionType::IndexType & start, SizeValueType n )
+    {
+    OutputPixelType * minimum = output->GetBufferPointer() + output->ComputeOffset( start );
+    const OutputPixelType * value = values->GetBufferPointer() + values->ComputeOffset( start );
+    for( SizeValueType i = 0; i < n; ++i )
+      {
+      minimum[i] = std::min( minimum[i], value[i] );
+      }
+    };
+  for( size_t g = 1; g < generators.size(); ++g )
+    {
+    generators[g]->GenerateBlock( generators[g]->GetBlockInputImage( input ), region, values );
+    ForEachRegionLine( region, foldLine );
+    }
+}
+
+template <unsigned int NDimension>
+void
+StreamingMinimumFeatureAggregator<NDimension>
+::FoldFeatureImage( const OutputImageType * feature, OutputImageType * output,
+                    bool sigmoidMapped, double alpha, double beta )
+{
+  const BrickRegionSplitter< NDimension > splitter( output->GetBufferedRegion(),
+    this->ComputeBlockSize( this->GetInputImage(), output->GetBufferedRegion() ) );
+
+  auto foldLine = [&]( const typename RegionType::IndexType & start, SizeValueType n )
+    {
+    const OffsetValueType offset = output->ComputeOffset( start );
+    OutputPixelType * minimum = output->GetBufferPointer() + offset;
+    const OutputPixelType * values = feature->GetBufferPointer() + offset;
+    if( sigmoidMapped )
+      {
+      for( SizeValueType i = 0; i < n; ++i )
+        {
+        minimum[i] = std::min( minimum[i],
+          SigmoidBlockFeatureGenerator< NDimension >::Sigmoid( values[i], alpha, beta ) );
+        }
+      }
+    else
+      {
+      for( SizeValueType i = 0; i < n; ++i )
+        {
+        minimum[i] = std::min( minimum[i], values[i] );
+        }
+      }
+    };
+  auto foldBlock = [&]( SizeValueType block, ThreadIdType )
+    {
+    ForEachRegionLine( splitter.GetBrick( block ), foldLine );
+    };
+  ParallelForEachBlock( splitter.GetNumberOfBricks(), foldBlock );
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,225 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkStudyFeatureCache.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkStudyFeatureCache_h
+#define itkStudyFeatureCache_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImage.h"
+#include "itkCachedBlockFeatureGenerator.h"
+#include "itkSatoVesselnessSigmoidBlockFeatureGenerator.h"
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+
+namespace itk
+{
+
+/** \class StudyFeatureCache
+ * \brief Seed independent features of a study, computed in the background
+ * as soon as the study is opened.
+ *
+ * Prepare() returns immediately and starts a background thread, running at
+ * a lowered priority, that:
+ *  - reads and orients the study (to an identity direction, as the command
+ *    line tool does) when given a file name;
+ *  - computes the lung mask with StudyLungWallMaskImageFilter, unless one
+ *    was given with SetLungMask();
+ *  - computes the vesselness feature (Sato vesselness and sigmoid, sparse
+ *    over tissue) over the bounding box of the lung voxels of the mask,
+ *    grown by LungMargin, brick by brick, and stores it as 16 bit fixed
+ *    point in a SparseBrickImage. Only the bricks where it differs from the
+ *    outside value, i.e. around tissue, take memory.
+ *
+ * The vesselness depends on the grid it is computed on, so it is computed
+ * at FeatureSpacing, the isotropic spacing the segmentations resample their
+ * ROI to: each brick is resampled from the study with a cubic B-spline, as
+ * the IsotropicResamplerImageFilter of the segmentation does. The grids
+ * share the study origin, not the ROI origin, so the cached feature read
+ * into a ROI is still interpolated between grid points.
+ *
+ * LesionSegmentationImageFilterACM takes the lung wall feature from the
+ * cache once Wait() returns, and the vesselness feature when its feature
+ * grid has the spacing of the cache. Only the intensity sigmoid, the Canny
+ * edges, fast marching and the level set are then left for the time the
+ * seed is known. The whole lung is more work than one ROI: the cache pays
+ * off when several nodules of a study are segmented, or when the study is
+ * opened well before the first seed is placed.
+ *
+ * The getters wait for the background work to finish, and rethrow any
+ * exception it ended with.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template< typename TInputImage >
+class ITK_EXPORT StudyFeatureCache : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(StudyFeatureCache);
+
+  /** Standard class typedefs. */
+  typedef StudyFeatureCache           Self;
+  typedef Object                      Superclass;
+  typedef SmartPointer< Self >        Pointer;
+  typedef SmartPointer< const Self >  ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(StudyFeatureCache, Object);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  typedef TInputImage                                               InputImageType;
+  typedef typename InputImageType::PixelType                        InputPixelType;
+  typedef Image< unsigned char, ImageDimension >                    MaskImageType;
+  typedef CachedBlockFeatureGenerator< ImageDimension >             CachedFeatureGeneratorType;
+  typedef typename CachedFeatureGeneratorType::CacheImageType       FeatureImageType;
+
+  /** Hounsfield value below which a voxel is lung. Defaults to -400. */
+  itkSetMacro( LungThreshold, InputPixelType );
+  itkGetMacro( LungThreshold, InputPixelType );
+
+  /** Spacing of the lung mask. Defaults to 2. */
+  itkSetMacro( LungMaskSpacing, double );
+  itkGetMacro( LungMaskSpacing, double );
+
+  /** Margin around the lung, in physical units, over which the vesselness
+   * is cached. Defaults to 20. */
+  itkSetMacro( LungMargin, double );
+  itkGetMacro( LungMargin, double );
+
+  /** Isotropic spacing of the vesselness feature: the IsotropicSampleSpacing
+   * (or resampled spacing) of the segmentations it is meant for. 0 computes
+   * it on the study grid, for segmentations that do not resample. Must be
+   * set before Prepare(). Defaults to 0. */
+  itkSetMacro( FeatureSpacing, double );
+  itkGetMacro( FeatureSpacing, double );
+
+  /** Vesselness parameters, as for SatoVesselnessSigmoidFeatureGenerator.
+   * Default to the values LesionSegmentationImageFilterACM uses: a sigma of
+   * 1, alphas of 0.1 and 2, and a sigmoid alpha and beta of -10 and 40. */
+  itkSetMacro( Sigma, double );
+  itkGetMacro( Sigma, double );
+  itkSetMacro( Alpha1, double );
+  itkGetMacro( Alpha1, double );
+  itkSetMacro( Alpha2, double );
+  itkGetMacro( Alpha2, double );
+  itkSetMacro( SigmoidAlpha, double );
+  itkGetMacro( SigmoidAlpha, double );
+  itkSetMacro( SigmoidBeta, double );
+  itkGetMacro( SigmoidBeta, double );
+
+  /** Edge length, in voxels, of the bricks the vesselness is computed in.
+   * Defaults to 64. */
+  itkSetMacro( BrickSize, unsigned int );
+  itkGetMacro( BrickSize, unsigned int );
+
+  /** Run the background work at a lowered priority. Defaults to true. */
+  itkSetMacro( LowerPriority, bool );
+  itkGetMacro( LowerPriority, bool );
+  itkBooleanMacro( LowerPriority );
+
+  /** Lung mask to use instead of computing one. Must be set before
+   * Prepare(). */
+  void SetLungMask( const MaskImageType * mask );
+
+  /** Start the background work on an oriented study. */
+  void Prepare( const InputImageType * image );
+
+  /** Start the background work on the study in \a fileName, which is read
+   * and oriented in the background too. */
+  void Prepare( const std::string & fileName );
+
+  /** Whether the background work has finished. Never waits. */
+  bool IsReady() const { return this->m_Ready; }
+
+  /** Wait for the background work to finish. Rethrows the exception it
+   * ended with, if any. */
+  void Wait();
+
+  /** The results. Each waits for the background work to finish. */
+  const InputImageType * GetImage();
+  const MaskImageType * GetLungMask();
+  const FeatureImageType * GetVesselnessFeature();
+
+  /** Vesselness feature outside the cached region: the sigmoid of a zero
+   * vesselness. */
+  double GetVesselnessOutsideValue() const;
+
+protected:
+  StudyFeatureCache();
+  ~StudyFeatureCache() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+private:
+  typedef SatoVesselnessSigmoidBlockFeatureGenerator< ImageDimension > VesselnessGeneratorType;
+  typedef typename InputImageType::RegionType                         RegionType;
+  typedef ImageBase< ImageDimension >                                 ImageBaseType;
+
+  void Start();
+  void Run();
+  void ReadImage();
+  void ComputeLungMask();
+  void ComputeVesselnessFeature();
+
+  /** Bounding box of the lung on \a grid, grown by LungMargin. */
+  RegionType GetVesselnessRegion( const InputImageType * grid ) const;
+
+  /** The voxels of \a to covering \a region of \a from, grown by \a margin
+   * in physical units. */
+  static RegionType MapRegion( const ImageBaseType * from, const RegionType & region,
+                               const ImageBaseType * to, double margin );
+
+  /** The study resampled onto \a region of \a grid, or null when no voxel
+   * it is resampled from reaches LungThreshold. */
+  typename InputImageType::Pointer ResampleBrick( const InputImageType * grid,
+                                                  const RegionType & region ) const;
+
+  static void LowerCurrentThreadPriority();
+
+  InputPixelType  m_LungThreshold;
+  double          m_LungMaskSpacing;
+  double          m_LungMargin;
+  double          m_FeatureSpacing;
+  double          m_Sigma;
+  double          m_Alpha1;
+  double          m_Alpha2;
+  double          m_SigmoidAlpha;
+  double          m_SigmoidBeta;
+  unsigned int    m_BrickSize;
+  bool            m_LowerPriority;
+
+  std::string                                 m_FileName;
+  typename InputImageType::ConstPointer       m_Image;
+  typename MaskImageType::ConstPointer        m_LungMask;
+  typename FeatureImageType::Pointer          m_VesselnessFeature;
+
+  std::thread                                 m_Thread;
+  std::atomic< bool >                         m_Ready;
+  std::exception_ptr                          m_Exception;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkStudyFeatureCache.hxx"
+#endif
+
+#endif
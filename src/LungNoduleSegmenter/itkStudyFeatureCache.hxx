@@ -0,0 +1,574 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkStudyFeatureCache.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkStudyFeatureCache_hxx
+#define itkStudyFeatureCache_hxx
+
+#include "itkStudyFeatureCache.h"
+#include "itkStudyLungWallMaskImageFilter.h"
+#include "itkSigmoidBlockFeatureGenerator.h"
+#include "itkImageFileReader.h"
+#include "itkOrientImageFilter.h"
+#include "itkResampleImageFilter.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageAlgorithm.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkParallelForEachBlock.h"
+#include "itkSparseBrickImageRegionIterator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#if defined(_WIN32)
+# include "itkWindows.h"
+#elif defined(__linux__)
+# include <sys/resource.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+namespace itk
+{
+
+template< typename TInputImage >
+StudyFeatureCache< TInputImage >
+::StudyFeatureCache() :
+  m_Ready( false )
+{
+  this->m_LungThreshold = -400;
+  this->m_LungMaskSpacing = 2.0;
+  this->m_LungMargin = 20.0;
+  this->m_FeatureSpacing = 0.0;
+  this->m_Sigma = 1.0;
+  this->m_Alpha1 = 0.1;
+  this->m_Alpha2 = 2.0;
+  this->m_SigmoidAlpha = -10.0;
+  this->m_SigmoidBeta = 40.0;
+  this->m_BrickSize = 64;
+  this->m_LowerPriority = true;
+}
+
+
+template< typename TInputImage >
+StudyFeatureCache< TInputImage >
+::~StudyFeatureCache()
+{
+  // The filters have no cheap way to be interrupted, so let the work finish.
+  if ( this->m_Thread.joinable() )
+    {
+    this->m_Thread.join();
+    }
+}
+
+
+template< typename TInputImage >
+void
+StudyFeatureCache< TInputImage >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "LungThreshold " << this->m_LungThreshold << std::endl;
+  os << indent << "LungMaskSpacing " << this->m_LungMaskSpacing << std::endl;
+  os << indent << "LungMargin " << this->m_LungMargin << std::endl;
+  os << indent << "FeatureSpacing " << this->m_FeatureSpacing << std::endl;
+  os << indent << "Sigma " << this->m_Sigma << std::endl;
+  os << indent << "Alpha1 " << this->m_Alpha1 << std::endl;
+  os << indent << "Alpha2 " << this->m_Alpha2 << std::endl;
+  os << indent << "SigmoidAlpha " << this->m_SigmoidAlpha << std::endl;
+  os << indent << "SigmoidBeta " << this->m_SigmoidBeta << std::endl;
+  os << indent << "BrickSize " << this->m_BrickSize << std::endl;
+  os << indent << "LowerPriority " << this->m_LowerPriority << std::endl;
+  os << indent << "Ready " << this->m_Ready << std::endl;
+}
+
+
+template< typename TInputImage >
+void
+StudyFeatureCache< TInputImage >
+::SetLungMask( const MaskImageType * mask )
+{
+  if ( this->m_Thread.joinable() && !this->m_Ready )
+    {
+    itkExceptionMacro("Cannot set the lung mask while the study is being prepared");
+    }
+  this->m_LungMask = mask;
+  this->Modified();
+}
+
+
+template< typename TInputImage >
+void
+StudyFeatureCache< TInputImage >
+::Prepare( const InputImageType * image )
+{
+  if ( !image )
+    {
+    itkExceptionMacro("Missing input image");
+    }
+  // Work on a view of the image that is not part of any pipeline, so that
+  // the background thread never touches the pipeline of the caller.
+  typename InputImageType::Pointer view = InputImageType::New();
+  view->Graft( image );
+  this->m_FileName.clear();
+  this->m_Image = view;
+  this->Start();
+}
+
+
+template< typename TInputImage >
+void
+StudyFeatureCache< TInputImage >
+::Prepare( const std::string & fileName )
+{
+  this->m_FileName = fileName;
+  this->m_Image = nullptr;
+  this->Start();
+}
+
+
+template< typename TInputImage >
+void
+StudyFeatureCache< TInputImage >
+::Start()
+{
+  if ( this->m_Thread.joinable() )
+    {
+    if ( !this->m_Ready )
+      {
+      itkExceptionMacro("The study is already being prepared");
+      }
+    this->m_Thread.join();
+    }
+  this->m_VesselnessFeature = nullptr;
+  this->m_Exception = nullptr;
+  this->m_Ready = false;
+  this->Modified();
+  this->m_Thread = std::thread( &Self::Run, this );
+}
+
+
+template< typename TInputImage >
+void
+StudyFeatureCache< TInputImage >
+::Wait()
+{
+  if ( this->m_Thread.joinable() )
+    {
+    this->m_Thread.join();
+    }
+  if ( this->m_Exception )
+    {
+    std::rethrow_exception( this->m_Exception );
+    }
+}
+
+
+template< typename TInputImage >
+const typename StudyFeatureCache< TInputImage >::InputImageType *
+StudyFeatureCache< TInputImage >
+::GetImage()
+{
+  this->Wait();
+  return this->m_Image.GetPointer();
+}
+
+
+template< typename TInputImage >
+const typename StudyFeatureCache< TInputImage >::MaskImageType *
+StudyFeatureCache< TInputImage >
+::GetLungMask()
+{
+  this->Wait();
+  return this->m_LungMask.GetPointer();
+}
+
+
+template< typename TInputImage >
+const typename StudyFeatureCache< TInputImage >::FeatureImageType *
+StudyFeatureCache< TInputImage >
+::GetVesselnessFeature()
+{
+  this->Wait();
+  return this->m_VesselnessFeature.GetPointer();
+}
+
+
+template< typename TInputImage >
+double
+StudyFeatureCache< TInputImage >
+::GetVesselnessOutsideValue() const
+{
+  return SigmoidBlockFeatureGenerator< ImageDimension >::Sigmoid(
+    0.0, this->m_SigmoidAlpha, this->m_SigmoidBeta );
+}
+
+
+template< typename TInputImage >
+void
+StudyFeatureCache< TInputImage >
+::Run()
+{
+  try
+    {
+    if ( this->m_LowerPriority )
+      {
+      Self::LowerCurrentThreadPriority();
+      }
+    if ( !this->m_FileName.empty() )
+      {
+      this->ReadImage();
+      }
+    if ( !this->m_LungMask )
+      {
+      this->ComputeLungMask();
+      }
+    this->ComputeVesselnessFeature();
+    }
+  catch ( ... )
+    {
+    this->m_Exception = std::current_exception();
+    }
+  this->m_Ready = true;
+}
+
+
+template< typename TInputImage >
+void
+StudyFeatureCache< TInputImage >
+::LowerCurrentThreadPriority()
+{
+#if defined(_WIN32)
+  SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL );
+#elif defined(__linux__)
+  // Nice values are per thread on Linux, and the worker threads the filters
+  // start from this one inherit it.
+  setpriority( PRIO_PROCESS, static_cast< id_t >( syscall( SYS_gettid ) ), 10 );
+#endif
+}
+
+
+template< typename TInputImage >
+void
+StudyFeatureCache< TInputImage >
+::ReadImage()
+{
+  typedef ImageFileReader< InputImageType >                   ReaderType;
+  typedef OrientImageFilter< InputImageType, InputImageType > OrientFilterType;
+
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( this->m_FileName );
+
+  // Same orientation as the command line tool, so that seeds and ROIs given
+  // in physical coordinates land in the same place.
+  typename OrientFilterType::Pointer orienter = OrientFilterType::New();
+  orienter->UseImageDirectionOn();
+  typename InputImageType::DirectionType direction;
+  direction.SetIdentity();
+  orienter->SetDesiredCoordinateDirection( direction );
+  orienter->SetInput( reader->GetOutput() );
+  orienter->Update();
+
+  typename InputImageType::Pointer image = orienter->GetOutput();
+  image->DisconnectPipeline();
+  this->m_Image = image;
+}
+
+
+template< typename TInputImage >
+void
+StudyFeatureCache< TInputImage >
+::ComputeLungMask()
+{
+  typedef StudyLungWallMaskImageFilter< InputImageType, MaskImageType > MaskFilterType;
+
+  typename MaskFilterType::Pointer maskFilter = MaskFilterType::New();
+  maskFilter->SetInput( this->m_Image );
+  maskFilter->SetLungThreshold( this->m_LungThreshold );
+  maskFilter->SetCoarseSpacing( this->m_LungMaskSpacing );
+  maskFilter->Update();
+
+  typename MaskImageType::Pointer mask = maskFilter->GetOutput();
+  mask->DisconnectPipeline();
+  this->m_LungMask = mask;
+}
+
+
+template< typename TInputImage >
+typename StudyFeatureCache< TInputImage >::RegionType
+StudyFeatureCache< TInputImage >
+::MapRegion( const ImageBaseType * from, const RegionType & region,
+             const ImageBaseType * to, double margin )
+{
+  // Voxels cover half a voxel on each side of their centre. Every corner is
+  // mapped, so the directions of the two grids may differ.
+  ContinuousIndex< double, ImageDimension > lower, upper;
+  lower.Fill( std::numeric_limits< double >::max() );
+  upper.Fill( -std::numeric_limits< double >::max() );
+  for ( unsigned int corner = 0; corner < ( 1u << ImageDimension ); ++corner )
+    {
+    ContinuousIndex< double, ImageDimension > fromIndex;
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      fromIndex[i] = ( corner & ( 1u << i ) ) ?
+        region.GetUpperIndex()[i] + 0.5 : region.GetIndex()[i] - 0.5;
+      }
+    typename InputImageType::PointType point;
+    from->TransformContinuousIndexToPhysicalPoint( fromIndex, point );
+    ContinuousIndex< double, ImageDimension > toIndex;
+    to->TransformPhysicalPointToContinuousIndex( point, toIndex );
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      lower[i] = std::min( lower[i], toIndex[i] );
+      upper[i] = std::max( upper[i], toIndex[i] );
+      }
+    }
+
+  typename RegionType::IndexType start;
+  typename RegionType::SizeType size;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    const double voxels = margin / to->GetSpacing()[i];
+    const IndexValueType first = static_cast< IndexValueType >(
+      std::floor( lower[i] - voxels ) );
+    const IndexValueType last = static_cast< IndexValueType >(
+      std::ceil( upper[i] + voxels ) );
+    start[i] = first;
+    size[i] = static_cast< SizeValueType >( std::max< IndexValueType >( 1, last - first + 1 ) );
+    }
+  return RegionType( start, size );
+}
+
+
+template< typename TInputImage >
+typename StudyFeatureCache< TInputImage >::RegionType
+StudyFeatureCache< TInputImage >
+::GetVesselnessRegion( const InputImageType * grid ) const
+{
+  typedef typename MaskImageType::IndexType MaskIndexType;
+
+  const RegionType gridRegion = grid->GetLargestPossibleRegion();
+
+  // The bounding box of every lung voxel of the mask. The air around the
+  // body is lung in the mask too, and is deliberately not told apart: the
+  // lungs clipped by the field of view reach the sides of the volume just
+  // as that air does. Most of the extra region is air, whose bricks are
+  // skipped, and the vesselness is only stored where it is not background.
+  const typename MaskImageType::RegionType maskRegion =
+    this->m_LungMask->GetBufferedRegion();
+  MaskIndexType lower = maskRegion.GetUpperIndex();
+  MaskIndexType upper = maskRegion.GetIndex();
+  bool found = false;
+  ImageRegionConstIteratorWithIndex< MaskImageType > mit( this->m_LungMask, maskRegion );
+  for ( ; !mit.IsAtEnd(); ++mit )
+    {
+    if ( mit.Get() == 0 )
+      {
+      continue;
+      }
+    const MaskIndexType index = mit.GetIndex();
+    for ( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      lower[i] = std::min( lower[i], index[i] );
+      upper[i] = std::max( upper[i], index[i] );
+      }
+    found = true;
+    }
+  if ( !found )
+    {
+    return gridRegion;
+    }
+
+  typename MaskImageType::SizeType lungSize;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    lungSize[i] = static_cast< SizeValueType >( upper[i] - lower[i] + 1 );
+    }
+  RegionType region = Self::MapRegion( this->m_LungMask,
+    RegionType( lower, lungSize ), grid, this->m_LungMargin );
+  if ( !region.Crop( gridRegion ) )
+    {
+    return gridRegion;
+    }
+  return region;
+}
+
+
+template< typename TInputImage >
+typename StudyFeatureCache< TInputImage >::InputImageType::Pointer
+StudyFeatureCache< TInputImage >
+::ResampleBrick( const InputImageType * grid, const RegionType & region ) const
+{
+  typedef ResampleImageFilter< InputImageType, InputImageType >   ResamplerType;
+  typedef BSplineInterpolateImageFunction< InputImageType, double > InterpolatorType;
+
+  const InputImageType * image = this->m_Image.GetPointer();
+
+  // Study voxels the cubic B-spline reads for the brick, two on each side.
+  double margin = 0.0;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    margin = std::max( margin, 2.0 * image->GetSpacing()[i] );
+    }
+  RegionType source = Self::MapRegion( grid, region, image, margin );
+  if ( !source.Crop( image->GetBufferedRegion() ) )
+    {
+    return nullptr;
+    }
+
+  // Without tissue the vesselness is background: skip the resampling.
+  bool tissue = false;
+  for ( ImageRegionConstIterator< InputImageType > it( image, source );
+        !it.IsAtEnd() && !tissue; ++it )
+    {
+    tissue = it.Get() >= this->m_LungThreshold;
+    }
+  if ( !tissue )
+    {
+    return nullptr;
+    }
+
+  // The interpolator decomposes its whole input, so it is given a copy of
+  // the few study voxels the brick needs.
+  typename InputImageType::Pointer crop = InputImageType::New();
+  crop->CopyInformation( image );
+  crop->SetRegions( source );
+  crop->Allocate();
+  ImageAlgorithm::Copy( image, crop.GetPointer(), source, source );
+
+  typename ResamplerType::Pointer resampler = ResamplerType::New();
+  resampler->SetInput( crop );
+  resampler->SetInterpolator( InterpolatorType::New() );
+  resampler->SetOutputOrigin( grid->GetOrigin() );
+  resampler->SetOutputSpacing( grid->GetSpacing() );
+  resampler->SetOutputDirection( grid->GetDirection() );
+  resampler->SetOutputStartIndex( region.GetIndex() );
+  resampler->SetSize( region.GetSize() );
+  resampler->SetDefaultPixelValue( -1024 );
+  resampler->SetNumberOfThreads( 1 );
+  resampler->Update();
+
+  typename InputImageType::Pointer brick = resampler->GetOutput();
+  brick->DisconnectPipeline();
+  return brick;
+}
+
+
+template< typename TInputImage >
+void
+StudyFeatureCache< TInputImage >
+::ComputeVesselnessFeature()
+{
+  typedef typename VesselnessGeneratorType::OutputImageType   BlockImageType;
+  typedef typename VesselnessGeneratorType::OutputPixelType   BlockPixelType;
+
+  typename VesselnessGeneratorType::Pointer vesselness = VesselnessGeneratorType::New();
+  vesselness->SetSigma( this->m_Sigma );
+  vesselness->SetAlpha1( this->m_Alpha1 );
+  vesselness->SetAlpha2( this->m_Alpha2 );
+  vesselness->SetSigmoidAlpha( this->m_SigmoidAlpha );
+  vesselness->SetSigmoidBeta( this->m_SigmoidBeta );
+  vesselness->SetSparseEvaluation( true );
+  vesselness->SetActivityThreshold( this->m_LungThreshold );
+
+  // The grid of the feature: the study grid, or the grid of the same
+  // origin and direction at FeatureSpacing, covering the study.
+  const InputImageType * image = this->m_Image.GetPointer();
+  const bool resample = this->m_FeatureSpacing > 0.0;
+  typename InputImageType::Pointer grid = InputImageType::New();
+  grid->CopyInformation( image );
+  if ( resample )
+    {
+    typename InputImageType::SpacingType spacing;
+    spacing.Fill( this->m_FeatureSpacing );
+    grid->SetSpacing( spacing );
+    grid->SetRegions( Self::MapRegion( image, image->GetLargestPossibleRegion(), grid, 0.0 ) );
+    }
+  const RegionType region = this->GetVesselnessRegion( grid );
+  const typename RegionType::SizeType halo = vesselness->GetBlockHaloRadius( grid );
+
+  // Cache bricks must not straddle the bricks computed by different
+  // threads: take the largest power of two up to 16 dividing BrickSize.
+  unsigned int cacheBrickSize = 16;
+  while ( this->m_BrickSize % cacheBrickSize != 0 )
+    {
+    cacheBrickSize /= 2;
+    }
+  typename FeatureImageType::Pointer feature = FeatureImageType::New();
+  feature->CopyInformation( grid );
+  feature->SetRegions( region );
+  feature->SetBrickSize( cacheBrickSize );
+  feature->SetBackgroundValue(
+    CachedFeatureGeneratorType::Encode( this->GetVesselnessOutsideValue() ) );
+  feature->Allocate();
+
+  typename RegionType::SizeType brickSize;
+  brickSize.Fill( this->m_BrickSize );
+  const BrickRegionSplitter< ImageDimension > splitter( region, brickSize );
+  const SizeValueType numberOfBricks = splitter.GetNumberOfBricks();
+
+  // Each brick is computed as float into per-thread scratch and stored as
+  // fixed point, so the float feature never exists for the whole lung. Cache
+  // bricks are only allocated where the codes differ from the background.
+  // When resampling, each brick is resampled with its halo on its own, so
+  // the study is never held at FeatureSpacing either.
+  std::vector< typename BlockImageType::Pointer > scratch(
+    GetParallelForEachBlockNumberOfThreads( numberOfBricks ) );
+  const VesselnessGeneratorType * generator = vesselness.GetPointer();
+  const InputImageType * gridPointer = grid.GetPointer();
+  FeatureImageType * output = feature.GetPointer();
+  auto computeBrick = [&]( SizeValueType brick, ThreadIdType threadId )
+    {
+    const RegionType brickRegion = splitter.GetBrick( brick );
+    typename InputImageType::ConstPointer input = image;
+    if ( resample )
+      {
+      RegionType padded = brickRegion;
+      padded.PadByRadius( halo );
+      padded.Crop( gridPointer->GetLargestPossibleRegion() );
+      input = this->ResampleBrick( gridPointer, padded ).GetPointer();
+      if ( !input )
+        {
+        return;
+        }
+      }
+
+    typename BlockImageType::Pointer & block = scratch[threadId];
+    if ( !block )
+      {
+      block = BlockImageType::New();
+      block->CopyInformation( gridPointer );
+      }
+    block->SetRegions( brickRegion );
+    block->Allocate();
+    generator->GenerateBlock( input, brickRegion, block );
+
+    const BlockPixelType * in = block->GetBufferPointer();
+    for ( SparseBrickImageRegionIterator< FeatureImageType > it( output, brickRegion );
+          !it.IsAtEnd(); ++it )
+      {
+      it.Set( CachedFeatureGeneratorType::Encode( in[block->ComputeOffset( it.GetIndex() )] ) );
+      }
+    };
+  ParallelForEachBlock( numberOfBricks, computeBrick );
+
+  this->m_VesselnessFeature = feature;
+}
+
+} // end namespace itk
+
+#endif
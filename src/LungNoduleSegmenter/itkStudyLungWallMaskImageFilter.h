@@ -0,0 +1,108 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkStudyLungWallMaskImageFilter.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkStudyLungWallMaskImageFilter_h
+#define itkStudyLungWallMaskImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkImage.h"
+
+namespace itk
+{
+
+/** \class StudyLungWallMaskImageFilter
+ * \brief Lung mask of a whole study, at a coarse resolution.
+ *
+ * Computes, once for the whole thorax, the mask that LungWallFeatureGenerator
+ * computes for each nodule ROI: voxels below LungThreshold are lung (1),
+ * the others wall or tissue (0), and the tissue enclosed in the lung
+ * (vessels, nodules) is filled in by iterative voting hole filling. The
+ * input is first averaged down by integer factors to about CoarseSpacing,
+ * which makes the hole filling cheap enough to run over the whole study.
+ *
+ * The result is meant to be computed once per study, cached, and resampled
+ * into each nodule ROI by PrecomputedLungWallFeatureGenerator.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template< typename TInputImage,
+          typename TOutputImage = Image< unsigned char, TInputImage::ImageDimension > >
+class ITK_EXPORT StudyLungWallMaskImageFilter :
+  public ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(StudyLungWallMaskImageFilter);
+
+  /** Standard class typedefs. */
+  typedef StudyLungWallMaskImageFilter                      Self;
+  typedef ImageToImageFilter< TInputImage, TOutputImage >   Superclass;
+  typedef SmartPointer< Self >                              Pointer;
+  typedef SmartPointer< const Self >                        ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(StudyLungWallMaskImageFilter, ImageToImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  typedef TInputImage                             InputImageType;
+  typedef TOutputImage                            OutputImageType;
+  typedef typename InputImageType::PixelType      InputPixelType;
+  typedef typename OutputImageType::PixelType     OutputPixelType;
+
+  /** Hounsfield value below which a voxel is lung. Defaults to -400. */
+  itkSetMacro( LungThreshold, InputPixelType );
+  itkGetMacro( LungThreshold, InputPixelType );
+
+  /** Target spacing of the mask, in physical units. Each axis is shrunk by
+   * the integer factor that comes closest without going below the input
+   * spacing. Defaults to 2. */
+  itkSetMacro( CoarseSpacing, double );
+  itkGetMacro( CoarseSpacing, double );
+
+  /** Maximum number of hole filling iterations. Defaults to 1000. */
+  itkSetMacro( MaximumNumberOfIterations, unsigned int );
+  itkGetMacro( MaximumNumberOfIterations, unsigned int );
+
+protected:
+  StudyLungWallMaskImageFilter();
+  ~StudyLungWallMaskImageFilter() override {}
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  void GenerateOutputInformation() override;
+  void GenerateInputRequestedRegion() override;
+  void EnlargeOutputRequestedRegion( DataObject * output ) override;
+  void GenerateData() override;
+
+private:
+  typedef typename InputImageType::SizeType ShrinkFactorsType;
+
+  ShrinkFactorsType GetShrinkFactors() const;
+
+  InputPixelType  m_LungThreshold;
+  double          m_CoarseSpacing;
+  unsigned int    m_MaximumNumberOfIterations;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkStudyLungWallMaskImageFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,162 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkStudyLungWallMaskImageFilter.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkStudyLungWallMaskImageFilter_hxx
+#define itkStudyLungWallMaskImageFilter_hxx
+
+#include "itkStudyLungWallMaskImageFilter.h"
+#include "itkBinShrinkImageFilter.h"
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkVotingBinaryIterativeHoleFillingImageFilter.h"
+#include "itkProgressAccumulator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+template< typename TInputImage, typename TOutputImage >
+StudyLungWallMaskImageFilter< TInputImage, TOutputImage >
+::StudyLungWallMaskImageFilter()
+{
+  this->m_LungThreshold = -400;
+  this->m_CoarseSpacing = 2.0;
+  this->m_MaximumNumberOfIterations = 1000;
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+StudyLungWallMaskImageFilter< TInputImage, TOutputImage >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "LungThreshold " << this->m_LungThreshold << std::endl;
+  os << indent << "CoarseSpacing " << this->m_CoarseSpacing << std::endl;
+  os << indent << "MaximumNumberOfIterations " << this->m_MaximumNumberOfIterations << std::endl;
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+typename StudyLungWallMaskImageFilter< TInputImage, TOutputImage >::ShrinkFactorsType
+StudyLungWallMaskImageFilter< TInputImage, TOutputImage >
+::GetShrinkFactors() const
+{
+  const InputImageType * input = this->GetInput();
+  ShrinkFactorsType factors;
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    const double ratio = this->m_CoarseSpacing / input->GetSpacing()[i];
+    factors[i] = std::max< SizeValueType >( 1, static_cast< SizeValueType >( std::floor( ratio + 0.5 ) ) );
+    factors[i] = std::min( factors[i], input->GetLargestPossibleRegion().GetSize()[i] );
+    }
+  return factors;
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+StudyLungWallMaskImageFilter< TInputImage, TOutputImage >
+::GenerateOutputInformation()
+{
+  const InputImageType * input = this->GetInput();
+  OutputImageType * output = this->GetOutput();
+  if ( !input || !output )
+    {
+    return;
+    }
+
+  // Same geometry as the shrink filter produces.
+  typedef BinShrinkImageFilter< InputImageType, InputImageType > ShrinkFilterType;
+  typename ShrinkFilterType::Pointer shrink = ShrinkFilterType::New();
+  shrink->SetInput( input );
+  shrink->SetShrinkFactors( this->GetShrinkFactors() );
+  shrink->UpdateOutputInformation();
+  output->CopyInformation( shrink->GetOutput() );
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+StudyLungWallMaskImageFilter< TInputImage, TOutputImage >
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  if ( this->GetInput() )
+    {
+    InputImageType * input = const_cast< InputImageType * >( this->GetInput() );
+    input->SetRequestedRegionToLargestPossibleRegion();
+    }
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+StudyLungWallMaskImageFilter< TInputImage, TOutputImage >
+::EnlargeOutputRequestedRegion( DataObject * output )
+{
+  Superclass::EnlargeOutputRequestedRegion( output );
+  output->SetRequestedRegionToLargestPossibleRegion();
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+StudyLungWallMaskImageFilter< TInputImage, TOutputImage >
+::GenerateData()
+{
+  typedef BinShrinkImageFilter< InputImageType, InputImageType >              ShrinkFilterType;
+  typedef BinaryThresholdImageFilter< InputImageType, OutputImageType >       ThresholdFilterType;
+  typedef VotingBinaryIterativeHoleFillingImageFilter< OutputImageType >      HoleFillingFilterType;
+
+  ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
+  progress->SetMiniPipelineFilter( this );
+
+  typename ShrinkFilterType::Pointer shrink = ShrinkFilterType::New();
+  shrink->SetInput( this->GetInput() );
+  shrink->SetShrinkFactors( this->GetShrinkFactors() );
+  shrink->ReleaseDataFlagOn();
+  progress->RegisterInternalFilter( shrink, 0.1 );
+
+  // Lung is 1, everything else 0, as in LungWallFeatureGenerator.
+  typename ThresholdFilterType::Pointer threshold = ThresholdFilterType::New();
+  threshold->SetInput( shrink->GetOutput() );
+  threshold->SetLowerThreshold( this->m_LungThreshold );
+  threshold->SetUpperThreshold( NumericTraits< InputPixelType >::max() );
+  threshold->SetInsideValue( 0 );
+  threshold->SetOutsideValue( 1 );
+  threshold->ReleaseDataFlagOn();
+  progress->RegisterInternalFilter( threshold, 0.05 );
+
+  typename HoleFillingFilterType::InputSizeType radius;
+  radius.Fill( 1 );
+  typename HoleFillingFilterType::Pointer holeFilling = HoleFillingFilterType::New();
+  holeFilling->SetInput( threshold->GetOutput() );
+  holeFilling->SetRadius( radius );
+  holeFilling->SetBackgroundValue( 0 );
+  holeFilling->SetForegroundValue( 1 );
+  holeFilling->SetMajorityThreshold( 1 );
+  holeFilling->SetMaximumNumberOfIterations( this->m_MaximumNumberOfIterations );
+  progress->RegisterInternalFilter( holeFilling, 0.85 );
+
+  holeFilling->GraftOutput( this->GetOutput() );
+  holeFilling->Update();
+  this->GraftOutput( holeFilling->GetOutput() );
+}
+
+} // end namespace itk
+
+#endif